@@ -1,6 +1,7 @@
 
 #include "irisLoader.hpp"
 #include "model.hpp"
+#include "model_fixed.hpp"
 #include <fstream>
 #include <sstream>
 #include <tuple>
@@ -18,7 +19,7 @@ int main(){
 
     std::vector<std::vector<IrisTuple>> iris_se_data, iris_vi_data, iris_ve_data;
     std::vector<std::vector<float>> trainSet, validationSet, testSet, trainOut, validationOut, testOut;
-    int a=2;
+    int a=3;  //kernels of the products planned for their shapes by train (selection 3), see kernel_dispatch.hpp
 
     auto result = readIrisData<float>("./DataSet/Iris.csv");
     auto split_result = getIrisSets<float>(result, 0.6, 0.2, 0.2);
@@ -56,6 +57,23 @@ int main(){
     //TRAINING THE MODEL
     
     model.train( a);
+
+    //BLOCK PRUNING of the hidden layers (layer2 and layer3), followed by the fine-tuning of the blocks left
+
+    //model.pruneWeights(0.8);
+    //model.train( a);
+
+    //FIXED-SIZE INFERENCE: the same layers with the sizes known at compile time, no allocation per sample
+
+    ModelFixed<float, 4, FixedLayer<128, Activation::ReLu>, FixedLayer<3, Activation::SoftMax>> fixed_model;
+    if(fixed_model.load(model)){
+        fixed_model.evaluate(testSet, testOut);
+    }
+
+    //INT8 INFERENCE
+
+    model.quantizeWeights();
+    model.evaluateQuantized();
     
     //Debug test
 
@@ -0,0 +1,435 @@
+#include "gemm_packed.hpp"
+#include "layout.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#ifndef MATRIXEXPR_HPP
+#define MATRIXEXPR_HPP
+
+//**********************************************************************************************************************
+
+// Expression templates for MatrixFlat. Header only, like MatrixFlat.hpp.
+//
+// The arithmetic operators on matrices do not compute anything: they return a small object that records the
+// operation and its operands, so that a whole expression is evaluated at once when it is assigned to a MatrixFlat.
+// The element-wise operations (+, -, % for the element-wise product, the operations with a scalar) are evaluated
+// in a single loop over the destination, with no temporary matrices:
+//
+//     W = W - lr * dW / n;        // one pass over W and dW, vectorized by the compiler
+//
+// * between two matrices is the matrix product. A chain of products A * B * C * ... is evaluated with the packed
+// engine (gemm_packed.hpp) in the order of least multiply-adds (the classic matrix chain ordering), so the result
+// of (A * B) * x or A * (B * x) does not depend on how the expression was written. The products need a temporary
+// for every intermediate result of the chain, and a product inside an element-wise expression is computed into a
+// temporary when the expression is built (C + A * B); a product assigned to a matrix (or added with +=) goes
+// directly into it.
+//
+// The operands are held by reference: an expression must be assigned before its matrices go out of scope (do not
+// keep it in an auto variable past them). A matrix in another layout than row-major (layout.hpp) is copied to
+// row-major when the expression is built; the result of an expression is row-major.
+
+//**********************************************************************************************************************
+
+
+template<typename T>
+class MatrixFlat;
+
+
+//! Base of all the expressions, E is the expression type (curiously recurring template pattern)
+template<typename E>
+class MatrixExpr{
+    public:
+        const E& derived() const {return static_cast<const E&>(*this);}
+};
+
+//! How the value of an expression is stored into the destination
+enum class AssignOp{ Assign, Add, Sub };
+
+template<typename L, typename R>
+class MatProduct;
+
+namespace matrix_expr {
+
+    template<typename E>
+    struct is_product : std::false_type {};
+    template<typename L, typename R>
+    struct is_product<MatProduct<L, R>> : std::true_type {};
+
+    //! A matrix in an element-wise node: its elements in row-major order, the ones of the matrix itself or of a
+    //! row-major copy for the other layouts, so that the loop of the evaluation reads a plain array
+    template<typename T>
+    class FlatOperand{
+        public:
+            using value_type = T;
+
+            FlatOperand(const MatrixFlat<T>& matrix): m_data(matrix.get_ptr()), m_rows(matrix.nrows()), m_cols(matrix.ncols()) {
+                if (matrix.layout() != Layout::RowMajor) {
+                    m_copy = std::make_shared<const MatrixFlat<T>>(matrix.row_major());
+                    m_data = m_copy->get_ptr();
+                }
+            };
+
+            std::size_t nrows() const {return m_rows;}
+            std::size_t ncols() const {return m_cols;}
+            const T& coeff(std::size_t index) const {return m_data[index];}
+
+        private:
+            const T* m_data;
+            std::size_t m_rows, m_cols;
+            std::shared_ptr<const MatrixFlat<T>> m_copy;
+    };
+
+    //! Operand of an element-wise node: the matrices by pointer to their elements, the products evaluated, the other
+    //! nodes by value
+    template<typename E>
+    struct elementwise_operand {using type = const E;};
+    template<typename T>
+    struct elementwise_operand<MatrixFlat<T>> {using type = const FlatOperand<T>;};
+    template<typename L, typename R>
+    struct elementwise_operand<MatProduct<L, R>> {using type = const MatrixFlat<typename MatProduct<L, R>::value_type>;};
+
+    //! Operand of a product node: the matrices by reference, everything else by value (evaluated with the chain)
+    template<typename E>
+    struct product_operand {using type = const E;};
+    template<typename T>
+    struct product_operand<MatrixFlat<T>> {using type = const MatrixFlat<T>&;};
+
+    struct Add { template<typename T> static T apply(T a, T b){return a + b;} };
+    struct Sub { template<typename T> static T apply(T a, T b){return a - b;} };
+    struct Mul { template<typename T> static T apply(T a, T b){return a * b;} };
+    struct Div { template<typename T> static T apply(T a, T b){return a / b;} };
+
+    inline void check_same_shape(std::size_t r1, std::size_t c1, std::size_t r2, std::size_t c2){
+        if (r1 != r2 || c1 != c2) {
+            std::cerr<<"Error: dimension of the two matrices are wrong: "<<r1<<"X"<<c1<<" and "<<r2<<"X"<<c2
+                     <<". Stopping execution. "<<std::endl;
+            std::exit(-1);
+        }
+    }
+
+}
+
+
+//! A scalar seen as a rows x cols matrix with all the elements equal to it
+template<typename T>
+class MatConstant : public MatrixExpr<MatConstant<T>>{
+    public:
+        using value_type = T;
+
+        MatConstant(T value, std::size_t rows, std::size_t cols): m_value(value), m_rows(rows), m_cols(cols) {};
+
+        std::size_t nrows() const {return m_rows;}
+        std::size_t ncols() const {return m_cols;}
+        T coeff(std::size_t) const {return m_value;}
+
+    private:
+        T m_value;
+        std::size_t m_rows, m_cols;
+};
+
+
+//! Element-wise operation Op between two expressions of the same shape
+template<typename Op, typename L, typename R>
+class MatBinary : public MatrixExpr<MatBinary<Op, L, R>>{
+    public:
+        using value_type = typename L::value_type;
+
+        MatBinary(const L& lhs, const R& rhs): m_lhs(lhs), m_rhs(rhs) {
+            matrix_expr::check_same_shape(m_lhs.nrows(), m_lhs.ncols(), m_rhs.nrows(), m_rhs.ncols());
+        };
+
+        std::size_t nrows() const {return m_lhs.nrows();}
+        std::size_t ncols() const {return m_lhs.ncols();}
+
+        //! Element index of the value, the matrix seen as one vector in row-major order
+        value_type coeff(std::size_t index) const {
+            return Op::apply(static_cast<value_type>(m_lhs.coeff(index)), static_cast<value_type>(m_rhs.coeff(index)));
+        }
+
+        //! Number of elements larger than tolerance in absolute value, without storing the result
+        std::size_t nnzrs(value_type tolerance = 1e-10) const {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < nrows() * ncols(); i++)
+                count += std::abs(coeff(i)) > tolerance;
+            return count;
+        }
+
+    private:
+        typename matrix_expr::elementwise_operand<L>::type m_lhs;
+        typename matrix_expr::elementwise_operand<R>::type m_rhs;
+};
+
+
+//! Matrix product of two expressions. Nested products form a chain that is evaluated in the cheapest order.
+template<typename L, typename R>
+class MatProduct : public MatrixExpr<MatProduct<L, R>>{
+    public:
+        using value_type = typename L::value_type;
+
+        MatProduct(const L& lhs, const R& rhs): m_lhs(lhs), m_rhs(rhs) {
+            if (m_lhs.ncols() != m_rhs.nrows()) {
+                std::cerr<<"Error: dimension of the two matrices are wrong: cannot compute the product of a "
+                         <<m_lhs.nrows()<<"X"<<m_lhs.ncols()<<" and a "<<m_rhs.nrows()<<"X"<<m_rhs.ncols()
+                         <<" matrix. Stopping execution. "<<std::endl;
+                std::exit(-1);
+            }
+        };
+
+        std::size_t nrows() const {return m_lhs.nrows();}
+        std::size_t ncols() const {return m_rhs.ncols();}
+
+        //! Appends the factors of the chain to factors; the ones that are not matrices are evaluated into owned
+        void collect(std::vector<const MatrixFlat<value_type>*>& factors, std::deque<MatrixFlat<value_type>>& owned) const {
+            collect_operand(m_lhs, factors, owned);
+            collect_operand(m_rhs, factors, owned);
+        }
+
+        std::size_t nnzrs(value_type tolerance = 1e-10) const {
+            MatrixFlat<value_type> result(*this);
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < nrows() * ncols(); i++)
+                count += std::abs(result[i]) > tolerance;
+            return count;
+        }
+
+    private:
+        typename matrix_expr::product_operand<L>::type m_lhs;
+        typename matrix_expr::product_operand<R>::type m_rhs;
+
+        template<typename E>
+        static void collect_operand(const E& operand, std::vector<const MatrixFlat<value_type>*>& factors,
+                                    std::deque<MatrixFlat<value_type>>& owned){
+            if constexpr (std::is_same_v<E, MatrixFlat<value_type>>) {
+                // the products read the factors as row-major arrays
+                if (operand.layout() == Layout::RowMajor)
+                    factors.push_back(&operand);
+                else {
+                    owned.push_back(operand.row_major());
+                    factors.push_back(&owned.back());
+                }
+            }
+            else if constexpr (matrix_expr::is_product<E>::value)
+                operand.collect(factors, owned);
+            else {
+                owned.emplace_back(operand);
+                factors.push_back(&owned.back());
+            }
+        }
+};
+
+
+//**********************************************************************************************************************
+// Operators
+//**********************************************************************************************************************
+
+template<typename L, typename R>
+MatBinary<matrix_expr::Add, L, R> operator+(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs){
+    return {lhs.derived(), rhs.derived()};
+}
+
+template<typename L, typename R>
+MatBinary<matrix_expr::Sub, L, R> operator-(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs){
+    return {lhs.derived(), rhs.derived()};
+}
+
+//! Element-wise (Hadamard) product
+template<typename L, typename R>
+MatBinary<matrix_expr::Mul, L, R> operator%(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs){
+    return {lhs.derived(), rhs.derived()};
+}
+
+//! Matrix product
+template<typename L, typename R>
+MatProduct<L, R> operator*(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs){
+    return {lhs.derived(), rhs.derived()};
+}
+
+template<typename E>
+MatBinary<matrix_expr::Sub, MatConstant<typename E::value_type>, E> operator-(const MatrixExpr<E>& expr){
+    const E& e = expr.derived();
+    return {MatConstant<typename E::value_type>(0, e.nrows(), e.ncols()), e};
+}
+
+// Operations with a scalar, of any arithmetic type (the learning rate is a float also for double matrices)
+
+template<typename E>
+using MatScalar = MatConstant<typename E::value_type>;
+
+template<typename S>
+using enable_if_scalar = std::enable_if_t<std::is_arithmetic_v<S>>;
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Add, E, MatScalar<E>> operator+(const MatrixExpr<E>& expr, S s){
+    const E& e = expr.derived();
+    return {e, MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols())};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Add, MatScalar<E>, E> operator+(S s, const MatrixExpr<E>& expr){
+    const E& e = expr.derived();
+    return {MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols()), e};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Sub, E, MatScalar<E>> operator-(const MatrixExpr<E>& expr, S s){
+    const E& e = expr.derived();
+    return {e, MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols())};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Sub, MatScalar<E>, E> operator-(S s, const MatrixExpr<E>& expr){
+    const E& e = expr.derived();
+    return {MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols()), e};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Mul, E, MatScalar<E>> operator*(const MatrixExpr<E>& expr, S s){
+    const E& e = expr.derived();
+    return {e, MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols())};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Mul, MatScalar<E>, E> operator*(S s, const MatrixExpr<E>& expr){
+    const E& e = expr.derived();
+    return {MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols()), e};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Div, E, MatScalar<E>> operator/(const MatrixExpr<E>& expr, S s){
+    const E& e = expr.derived();
+    return {e, MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols())};
+}
+
+template<typename E, typename S, typename = enable_if_scalar<S>>
+MatBinary<matrix_expr::Div, MatScalar<E>, E> operator/(S s, const MatrixExpr<E>& expr){
+    const E& e = expr.derived();
+    return {MatScalar<E>(static_cast<typename E::value_type>(s), e.nrows(), e.ncols()), e};
+}
+
+
+//**********************************************************************************************************************
+// Evaluation
+//**********************************************************************************************************************
+
+namespace matrix_expr {
+
+    //! dst op= expr, element by element: one loop over the rows * cols elements. A matrix of the expression may be
+    //! the destination itself, every element is read before the same element is written (hence ivdep).
+    template<typename T, typename E>
+    void assign_elementwise(T* dst, const E& e, AssignOp op){
+        const std::size_t n = e.nrows() * e.ncols();
+        switch (op) {
+            case AssignOp::Assign:
+                #pragma GCC ivdep
+                for (std::size_t i = 0; i < n; i++)
+                    dst[i] = static_cast<T>(e.coeff(i));
+                break;
+            case AssignOp::Add:
+                #pragma GCC ivdep
+                for (std::size_t i = 0; i < n; i++)
+                    dst[i] += static_cast<T>(e.coeff(i));
+                break;
+            case AssignOp::Sub:
+                #pragma GCC ivdep
+                for (std::size_t i = 0; i < n; i++)
+                    dst[i] -= static_cast<T>(e.coeff(i));
+                break;
+        }
+    }
+
+    //! Order of the products of a chain of factors: split[i * n + j] is the factor after which the product of the
+    //! factors i..j is split, the one with least multiply-adds (O(n^3) dynamic programming, n is small)
+    template<typename T>
+    std::vector<std::size_t> chain_order(const std::vector<const MatrixFlat<T>*>& factors){
+        const std::size_t n = factors.size();
+        std::vector<double> dims(n + 1);
+        for (std::size_t i = 0; i < n; i++)
+            dims[i] = static_cast<double>(factors[i]->nrows());
+        dims[n] = static_cast<double>(factors[n - 1]->ncols());
+
+        std::vector<double> cost(n * n, 0);
+        std::vector<std::size_t> split(n * n, 0);
+        for (std::size_t length = 2; length <= n; length++)
+            for (std::size_t i = 0; i + length <= n; i++) {
+                const std::size_t j = i + length - 1;
+                cost[i * n + j] = std::numeric_limits<double>::max();
+                for (std::size_t s = i; s < j; s++) {
+                    const double c = cost[i * n + s] + cost[(s + 1) * n + j] + dims[i] * dims[s + 1] * dims[j + 1];
+                    if (c < cost[i * n + j]) {
+                        cost[i * n + j] = c;
+                        split[i * n + j] = s;
+                    }
+                }
+            }
+        return split;
+    }
+
+    //! C += product of the factors i..j, C has leading dimension ldc
+    template<typename T>
+    void multiply_chain(const std::vector<const MatrixFlat<T>*>& factors, const std::vector<std::size_t>& split,
+                        std::size_t i, std::size_t j, T* C, std::size_t ldc){
+        const std::size_t n = factors.size(), s = split[i * n + j];
+        const std::size_t rows = factors[i]->nrows(), inners = factors[s]->ncols(), columns = factors[j]->ncols();
+
+        // the two sides are single factors or temporaries holding their own sub-chain
+        MatrixFlat<T> left(i == s ? 0 : rows, i == s ? 0 : inners);
+        MatrixFlat<T> right(s + 1 == j ? 0 : inners, s + 1 == j ? 0 : columns);
+        if (i != s)
+            multiply_chain(factors, split, i, s, left.get_ptr(), inners);
+        if (s + 1 != j)
+            multiply_chain(factors, split, s + 1, j, right.get_ptr(), columns);
+        const T* A = i == s ? factors[i]->get_ptr() : left.get_ptr();
+        const T* B = s + 1 == j ? factors[j]->get_ptr() : right.get_ptr();
+
+        gemm_packed(rows, columns, inners, A, inners, B, columns, C, ldc);
+    }
+
+    //! dst op= product, dst is rows x cols and contiguous
+    template<typename T, typename L, typename R>
+    void assign_product(T* dst, const MatProduct<L, R>& product, AssignOp op){
+        std::vector<const MatrixFlat<T>*> factors;
+        std::deque<MatrixFlat<T>> owned;
+        product.collect(factors, owned);
+        const std::vector<std::size_t> split = chain_order(factors);
+        const std::size_t rows = product.nrows(), cols = product.ncols();
+
+        // the product is accumulated into C: it must not be one of the factors
+        bool aliased = false;
+        for (const MatrixFlat<T>* f : factors)
+            aliased = aliased || f->get_ptr() == dst;
+
+        if (op == AssignOp::Add && !aliased) {
+            multiply_chain(factors, split, 0, factors.size() - 1, dst, cols);
+        }
+        else if (op == AssignOp::Assign && !aliased) {
+            std::fill(dst, dst + rows * cols, T(0));
+            multiply_chain(factors, split, 0, factors.size() - 1, dst, cols);
+        }
+        else {
+            MatrixFlat<T> result(rows, cols);
+            multiply_chain(factors, split, 0, factors.size() - 1, result.get_ptr(), cols);
+            assign_elementwise(dst, result, op);
+        }
+    }
+
+    //! dst op= expr, dst is expr.nrows() x expr.ncols() and contiguous
+    template<typename T, typename E>
+    void assign(T* dst, const MatrixExpr<E>& expr, AssignOp op){
+        if constexpr (is_product<E>::value)
+            assign_product(dst, expr.derived(), op);
+        else
+            assign_elementwise(dst, expr.derived(), op);
+    }
+
+}
+
+
+#endif //MATRIXEXPR_HPP
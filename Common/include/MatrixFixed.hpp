@@ -0,0 +1,130 @@
+#include "MatrixFlat.hpp"
+#include "epilogue.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#ifndef MATRIXFIXED_HPP
+#define MATRIXFIXED_HPP
+
+//**********************************************************************************************************************
+
+// Matrices with the shape fixed at compile time, for the tiny layers (the Iris model is 4 -> 128 -> 3) where the
+// runtime-sized path costs more than the arithmetic: a heap vector per matrix, a loop bound read from memory, a
+// kernel chosen at run time.
+//
+// MatrixFixed<T, R, C> keeps its R x C elements in a std::array (on the stack, no allocation), row-major as
+// MatrixFlat. The kernels below take the shapes as template parameters, so every loop has a constant trip count:
+// the compiler unrolls the short ones completely and vectorizes the others without tails, and the activation is a
+// template parameter resolved at compile time instead of a switch per element.
+// It is header only, as MatrixFlat.hpp: the kernels are instantiated for the shapes of each program.
+
+//**********************************************************************************************************************
+
+
+//! R x C matrix with a compile-time shape, stored row-major in a std::array
+template<typename T, std::size_t R, std::size_t C>
+class MatrixFixed{
+    public:
+        using value_type = T;
+        static constexpr std::size_t rows = R, cols = C;
+
+        //! All the elements are zero
+        constexpr MatrixFixed(): m_data{} {};
+
+        explicit constexpr MatrixFixed(const std::array<T, R * C>& data): m_data(data) {};
+
+        //! Copy of a MatrixFlat of the same shape
+        explicit MatrixFixed(const MatrixFlat<T>& other){
+            if (other.nrows() != R || other.ncols() != C) {
+                std::cerr<<"Error: cannot copy a "<<other.nrows()<<"X"<<other.ncols()<<" matrix in a "<<R<<"X"<<C
+                         <<" MatrixFixed. Stopping execution. "<<std::endl;
+                std::exit(-1);
+            }
+            std::copy(other.get_ptr(), other.get_ptr() + R * C, m_data.begin());
+        }
+
+        //! Copy on the heap, for the kernels of the runtime-sized matrices
+        MatrixFlat<T> flat() const {return MatrixFlat<T>(R, C, std::vector<T>(m_data.begin(), m_data.end()));}
+
+        static constexpr std::size_t nrows() {return R;}
+        static constexpr std::size_t ncols() {return C;}
+
+        T* get_ptr() {return m_data.data();}
+        const T* get_ptr() const {return m_data.data();}
+
+        //! No bound checks: the shape is known, use at() to check an index
+        constexpr T& operator[](std::size_t index) {return m_data[index];}
+        constexpr const T& operator[](std::size_t index) const {return m_data[index];}
+        constexpr T& operator()(std::size_t i, std::size_t j) {return m_data[i * C + j];}
+        constexpr const T& operator()(std::size_t i, std::size_t j) const {return m_data[i * C + j];}
+        T& at(std::size_t i, std::size_t j) {return m_data.at(i * C + j);}
+
+        constexpr void fill(T value) {m_data.fill(value);}
+
+    private:
+        alignas(64) std::array<T, R * C> m_data;
+};
+
+
+//! act(z) with the activation chosen at compile time, same definitions as epilogue.cpp
+template<Activation A, typename T>
+inline T activate(T z){
+    if constexpr (A == Activation::Linear)
+        return z;
+    else if constexpr (A == Activation::ReLu)
+        return z > 0 ? z : T(0);
+    else if constexpr (A == Activation::Sigmoid)
+        return 1 / (1 + std::exp(-z));
+    else if constexpr (A == Activation::SoftMax)    // the SoftMax of the network is applied element by element
+        return std::exp(z) / (1 + std::exp(z));
+    else
+        return std::tanh(z);
+}
+
+//! Dense layer on one sample: h = act(x * W + b), with x 1 x In, W In x Out (the layout of the weights of Model)
+template<Activation A, typename T, std::size_t In, std::size_t Out>
+inline void dense_fixed(const MatrixFixed<T, 1, In>& x, const MatrixFixed<T, In, Out>& W,
+                        const MatrixFixed<T, 1, Out>& b, MatrixFixed<T, 1, Out>& h){
+    alignas(64) std::array<T, Out> z;
+    #pragma GCC unroll 32
+    for (std::size_t j = 0; j < Out; j++)
+        z[j] = b[j];
+    #pragma GCC unroll 8
+    for (std::size_t i = 0; i < In; i++) {
+        const T xi = x[i];
+        #pragma GCC unroll 32
+        #pragma GCC ivdep
+        for (std::size_t j = 0; j < Out; j++)
+            z[j] += xi * W(i, j);
+    }
+    #pragma GCC unroll 32
+    for (std::size_t j = 0; j < Out; j++)
+        h[j] = activate<A>(z[j]);
+}
+
+//! C += A * B, with A M x K, B K x N and C M x N
+template<typename T, std::size_t M, std::size_t K, std::size_t N>
+inline void mmm_fixed(const MatrixFixed<T, M, K>& A, const MatrixFixed<T, K, N>& B, MatrixFixed<T, M, N>& C){
+    for (std::size_t i = 0; i < M; i++) {
+        alignas(64) std::array<T, N> c;
+        #pragma GCC unroll 32
+        for (std::size_t j = 0; j < N; j++)
+            c[j] = C(i, j);
+        #pragma GCC unroll 8
+        for (std::size_t k = 0; k < K; k++) {
+            const T a = A(i, k);
+            #pragma GCC unroll 32
+            #pragma GCC ivdep
+            for (std::size_t j = 0; j < N; j++)
+                c[j] += a * B(k, j);
+        }
+        #pragma GCC unroll 32
+        for (std::size_t j = 0; j < N; j++)
+            C(i, j) = c[j];
+    }
+}
+
+
+#endif //MATRIXFIXED_HPP
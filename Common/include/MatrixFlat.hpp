@@ -1,5 +1,11 @@
 #include <algorithm>
+#include <fstream>
 #include "MatrixSkltn.hpp"
+#include "layout.hpp"
+#include "MatrixView.hpp"
+#include "numa_allocator.hpp"
+#include "mapped_file.hpp"
+#include "MatrixExpr.hpp"
 
 #ifndef MATRIXFLAT_HPP
 #define MATRIXFLAT_HPP
@@ -7,28 +13,69 @@
 
 
 template<typename T>
-class MatrixFlat : public MatrixSkltn<T>{
+class MatrixFlat : public MatrixSkltn<T, MatrixFlat<T>>, public MatrixExpr<MatrixFlat<T>>{
 //! This class represent a Matrix, its element are stored contiguously in MM thanks to the use of a single std::vector.
 //! This implementation is also compatible with openblas library in which matrix data are stored in a C array.
 //! This class do not support nnz count.
+//! Besides float and double, T can be one of the 16 bit storage types of half.hpp (bf16_t, fp16_t).
+//! The pages of large matrices are interleaved on the NUMA nodes, see numa_allocator.hpp.
+//! The elements can also live in a memory-mapped file instead of the heap (map / save, see mapped_file.hpp).
+//! The arithmetic operators build expression templates, evaluated when assigned to a MatrixFlat (MatrixExpr.hpp).
+//! operator() checks the indexes (DefaultAccess, see MatrixSkltn.hpp), view / block / row / col give unchecked views
+//! on the elements without copies (MatrixView.hpp).
+//! The elements are row-major unless the matrix is made in another layout (layout.hpp, converted with to_layout of
+//! matrix_layout.hpp): operator() and the expressions follow the layout, while get_ptr, operator[] and the views
+//! expose the storage, so the kernels that take get_ptr() as row-major need a row-major matrix.
     private:
 
-        std::vector<T> m_data;
+        using Skltn = MatrixSkltn<T, MatrixFlat<T>>;
 
-        bool check_indexes(size_t i, size_t j) const;
+        std::vector<T, NumaAllocator<T>> m_data;     // heap storage, empty when the matrix is mapped
+        std::shared_ptr<MappedFile> m_file;          // file storage, null for the heap matrices
+        T* m_ptr;                                    // first element, in m_data or in the file
+        Layout m_layout = Layout::RowMajor;          // order of the elements in the storage
+
+        //! Matrix on the elements of a mapped file
+        MatrixFlat(std::size_t rows, std::size_t cols, std::shared_ptr<MappedFile> file, T* data, Layout layout):
+            Skltn(rows, cols, 0),
+            m_file(std::move(file)),
+            m_ptr(data),
+            m_layout(layout)
+            {};
+
+        //! Takes the storage of other (which gets the one of this matrix)
+        void swap_storage(MatrixFlat<T>& other);
+
+        //! True if the elements may be written: heap or a mapping that is not ReadOnly
+        bool writable() const {return !m_file || m_file->mode() != MapMode::ReadOnly;}
 
         inline static bool is_zero(T elem, T tolerance);
 
+        //! Index for the layouts other than row-major, out of line so that the row-major access stays small
+        __attribute__((noinline, cold)) size_t layout_index_other(size_t i, size_t j) const {
+            return layout_index(m_layout, i, j, this->n_rows, this->n_cols);
+        }
+
+        void check_row_major(const char* operation) const {
+            if (m_layout == Layout::RowMajor)
+                return;
+            std::cerr<<"Error: "<<operation<<" of a "<<layout_name(m_layout)<<" matrix, it needs a row-major one"
+                     <<" (see to_layout in matrix_layout.hpp). Stopping execution. "<<std::endl;
+            std::exit(-1);
+        }
+
         void compute_nzrs(T tolerance = 1e-10);
 
 
     public:
 
+        using value_type = T;
 
         //! Initializes a matrix with data given as input
         MatrixFlat(size_t rows, size_t cols, const std::vector<T> & data):
-            MatrixSkltn<T>(rows, cols, 0),
-            m_data(data)
+            Skltn(rows, cols, 0),
+            m_data(data.begin(), data.end()),
+            m_ptr(m_data.data())
             {
                 compute_nzrs();
 
@@ -36,126 +83,334 @@ class MatrixFlat : public MatrixSkltn<T>{
 
         //! Initializes a matrix of zeros
         MatrixFlat(std::size_t rows, std::size_t cols):
-            MatrixSkltn<T>(rows, cols, 0),
-            m_data(std::vector<T>(rows*cols))
+            Skltn(rows, cols, 0),
+            m_data(rows*cols),
+            m_ptr(m_data.data())
+            {};
+
+        //! Initializes a matrix of zeros stored in layout
+        MatrixFlat(std::size_t rows, std::size_t cols, Layout layout):
+            Skltn(rows, cols, 0),
+            m_data(rows*cols),
+            m_ptr(m_data.data()),
+            m_layout(layout)
             {};
 
         //! Initializes a matrix filled of random values with values in the interval (a, b)
         MatrixFlat(std::size_t rows, std::size_t cols, T a, T b):
-                MatrixSkltn<T>(rows, cols, 0)
+                Skltn(rows, cols, 0)
             {
                 m_data.resize(rows*cols);
-                MatrixSkltn<T>::generate_random_vector(a, b, m_data);
+                m_ptr = m_data.data();
+                this->generate_random_vector(a, b, m_data);
                 compute_nzrs();
             }
 
+        //! Initializes a matrix with the value of an expression (see MatrixExpr.hpp)
+        template<typename E>
+        MatrixFlat(const MatrixExpr<E>& expr):
+            Skltn(expr.derived().nrows(), expr.derived().ncols(), 0),
+            m_data(expr.derived().nrows() * expr.derived().ncols()),
+            m_ptr(m_data.data())
+            {
+                matrix_expr::assign(m_ptr, expr, AssignOp::Assign);
+            }
+
+        //! A copy of a ReadOnly mapped matrix shares the mapping, the other copies are on the heap
+        MatrixFlat(const MatrixFlat<T>& other);
+        MatrixFlat(MatrixFlat<T>&& other) noexcept;
+        //! Copies the elements in place when the shapes are the same (also into a writable mapped file, which keeps
+        //! the layout written in its header: the elements are reordered into it)
+        MatrixFlat<T>& operator=(const MatrixFlat<T>& other);
+        MatrixFlat<T>& operator=(MatrixFlat<T>&& other) noexcept;
+
+        //! Maps a matrix file written by save, the elements are read from the file when they are first used.
+        //! Stops the execution if the file cannot be mapped or is not a matrix of T.
+        static MatrixFlat<T> map(const std::string& path, const MapOptions& options = {});
+
+        //! Maps rows x cols elements of a file without header, starting at byte offset
+        static MatrixFlat<T> map(const std::string& path, std::size_t rows, std::size_t cols, std::size_t offset = 0,
+                                 const MapOptions& options = {});
+
+        //! Writes the matrix, in its layout, to a file that map can open. Returns false, with an error message, on failure.
+        bool save(const std::string& path) const;
+
+        //! True if the elements live in a mapped file
+        bool is_mapped() const {return m_file != nullptr;}
+
+        //! The mapped file (null for the heap matrices), e.g. to advise it of another access pattern
+        const std::shared_ptr<MappedFile>& mapped_file() const {return m_file;}
+
+        //! Evaluates the expression into this matrix, in a single loop for the element-wise ones. The matrix takes
+        //! the shape of the expression.
+        template<typename E>
+        MatrixFlat<T>& operator=(const MatrixExpr<E>& expr);
+
+        //! Adds / subtracts the value of an expression, a product is accumulated directly into the matrix
+        template<typename E>
+        MatrixFlat<T>& operator+=(const MatrixExpr<E>& expr);
+        template<typename E>
+        MatrixFlat<T>& operator-=(const MatrixExpr<E>& expr);
+
         //! Return an unsafe pointer to the data in the heap, useful for interact with openblas library
-        T* get_ptr(){return m_data.data(); }
+        //! (or in the mapped file: do not write through it if the matrix was mapped ReadOnly)
+        T* get_ptr(){return m_ptr; }
+        const T* get_ptr() const {return m_ptr; }
 
 
-        const T& operator()(size_t i, size_t j) const override;
-        T& operator()(size_t i, size_t j) override;
+        Layout layout() const {return m_layout;}
 
+        //! Position of element (i, j) in the storage
+        size_t index(size_t i, size_t j) const {
+            if (m_layout == Layout::RowMajor)
+                return this->n_cols * i + j;
+            return layout_index_other(i, j);
+        }
+
+        //! A row-major copy, made element by element (the fast conversions are in matrix_layout.hpp)
+        MatrixFlat<T> row_major() const;
+
+        //! Unchecked access, used by operator() after the policy
+        T& element(size_t i, size_t j) {return m_ptr[index(i, j)];}
+        const T& element(size_t i, size_t j) const {return m_ptr[index(i, j)];}
+
+        //! Views on the elements, without copies (see MatrixView.hpp). Stop the execution if the matrix is not row-major.
+        MatrixView<T> view() {check_row_major("view"); return MatrixView<T>(m_ptr, this->n_rows, this->n_cols, this->n_cols);}
+        MatrixView<const T> view() const {check_row_major("view"); return MatrixView<const T>(m_ptr, this->n_rows, this->n_cols, this->n_cols);}
+        MatrixView<T> block(size_t i0, size_t j0, size_t rows, size_t cols) {return view().block(i0, j0, rows, cols);}
+        MatrixView<const T> block(size_t i0, size_t j0, size_t rows, size_t cols) const {return view().block(i0, j0, rows, cols);}
+        MatrixView<T> row(size_t i) {return view().row(i);}
+        MatrixView<const T> row(size_t i) const {return view().row(i);}
+        MatrixView<T> col(size_t j) {return view().col(j);}
+        MatrixView<const T> col(size_t j) const {return view().col(j);}
+
+        //! Element at position index of the storage (in row-major order for the row-major matrices)
         inline const T& operator[](size_t index) const;
         inline T& operator[](size_t index);
-        void _print(std::ostream& os) const override;
+        //! Element access of the expressions (index in row-major order, whatever the layout)
+        const T& coeff(size_t index) const {
+            return m_layout == Layout::RowMajor ? m_ptr[index] : element(index / this->n_cols, index % this->n_cols);
+        }
+        void _print(std::ostream& os) const;
 
-        //aggiunto da ale, ritorno il vettore dati
-        std::vector<T> getMdata(){return m_data; }
+        //aggiunto da ale, ritorno il vettore dati (in the order of the storage)
+        std::vector<T> getMdata(){return std::vector<T>(m_ptr, m_ptr + this->nrows() * this->ncols()); }
 
 
         //Aggiunto da fil
-        size_t nnzrs() override;
+        size_t nnzrs();
 
-        //aggiunto da fil, necessario per verificare correttezza mmm
-        MatrixFlat<T> operator-(const MatrixFlat<T>& B) const;
-
-    virtual ~MatrixFlat() = default;
+    ~MatrixFlat() = default;
 
 };
 
 template<typename T>
-MatrixFlat<T> MatrixFlat<T>::operator-(const MatrixFlat<T> &B) const {
-    if(this->nrows() != B.nrows() || this->ncols() != B.ncols())
-        {
-        std::cerr<<"Error: dimension of the two matrices are wrong: cannot compute difference. Stopping execution. "<<std::endl;
-        std::exit(-1);
+template<typename E>
+MatrixFlat<T>& MatrixFlat<T>::operator=(const MatrixExpr<E>& expr) {
+    const E& e = expr.derived();
+    if (e.nrows() != this->nrows() || e.ncols() != this->ncols() || !writable() || m_layout != Layout::RowMajor) {
+        // the expression may read this matrix: it is evaluated before the data are replaced. The result is row-major.
+        MatrixFlat<T> result(expr);
+        swap_storage(result);
+        this->n_rows = e.nrows();
+        this->n_cols = e.ncols();
+        return *this;
+    }
+    matrix_expr::assign(m_ptr, expr, AssignOp::Assign);
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+MatrixFlat<T>& MatrixFlat<T>::operator+=(const MatrixExpr<E>& expr) {
+    matrix_expr::check_same_shape(this->nrows(), this->ncols(), expr.derived().nrows(), expr.derived().ncols());
+    if (!writable() || m_layout != Layout::RowMajor) {
+        MatrixFlat<T> copy = row_major();
+        swap_storage(copy);
+    }
+    matrix_expr::assign(m_ptr, expr, AssignOp::Add);
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+MatrixFlat<T>& MatrixFlat<T>::operator-=(const MatrixExpr<E>& expr) {
+    matrix_expr::check_same_shape(this->nrows(), this->ncols(), expr.derived().nrows(), expr.derived().ncols());
+    if (!writable() || m_layout != Layout::RowMajor) {
+        MatrixFlat<T> copy = row_major();
+        swap_storage(copy);
+    }
+    matrix_expr::assign(m_ptr, expr, AssignOp::Sub);
+    return *this;
+}
+
+template<typename T>
+MatrixFlat<T>::MatrixFlat(const MatrixFlat<T>& other):
+    Skltn(other)
+{
+    if (other.m_file && other.m_file->mode() == MapMode::ReadOnly) {
+        m_file = other.m_file;
+        m_ptr = other.m_ptr;
+    } else {
+        m_data.assign(other.m_ptr, other.m_ptr + other.nrows() * other.ncols());
+        m_ptr = m_data.data();
+    }
+    m_layout = other.m_layout;
+}
+
+template<typename T>
+MatrixFlat<T>::MatrixFlat(MatrixFlat<T>&& other) noexcept:
+    Skltn(other),
+    m_data(std::move(other.m_data)),
+    m_file(std::move(other.m_file)),
+    m_ptr(other.m_ptr),
+    m_layout(other.m_layout)
+{
+    other.m_data.clear();
+    other.m_ptr = other.m_data.data();
+    other.n_rows = other.n_cols = other.n_nzrs = 0;
+}
+
+template<typename T>
+MatrixFlat<T>& MatrixFlat<T>::operator=(const MatrixFlat<T>& other) {
+    if (this == &other)
+        return *this;
+    if (this->nrows() == other.nrows() && this->ncols() == other.ncols() && writable()) {
+        if (m_layout == other.m_layout || !m_file) {
+            std::copy(other.m_ptr, other.m_ptr + other.nrows() * other.ncols(), m_ptr);
+            m_layout = other.m_layout;
+        } else {
+            // the layout of a mapped matrix is the one of its file (header), the elements are reordered into it
+            for (std::size_t i = 0; i < this->nrows(); i++)
+                for (std::size_t j = 0; j < this->ncols(); j++)
+                    m_ptr[index(i, j)] = other.m_ptr[other.index(i, j)];
         }
-    std::vector<T> diff( B.nrows() * B.ncols());
-    for(size_t i = 0; i < B.nrows() * B.ncols(); i++ )
-        diff[i] = (*this)[i] - B[i];
+    } else {
+        MatrixFlat<T> copy(other);
+        swap_storage(copy);
+    }
+    Skltn::operator=(other);
+    return *this;
+}
 
-    return MatrixFlat<T>( B.nrows(),  B.ncols(), diff);
+template<typename T>
+MatrixFlat<T>& MatrixFlat<T>::operator=(MatrixFlat<T>&& other) noexcept {
+    if (this == &other)
+        return *this;
+    swap_storage(other);
+    Skltn::operator=(other);
+    return *this;
+}
+
+template<typename T>
+void MatrixFlat<T>::swap_storage(MatrixFlat<T>& other) {
+    m_data.swap(other.m_data);
+    m_file.swap(other.m_file);
+    std::swap(m_ptr, other.m_ptr);
+    std::swap(m_layout, other.m_layout);
+}
+
+template<typename T>
+MatrixFlat<T> MatrixFlat<T>::row_major() const {
+    MatrixFlat<T> copy(this->nrows(), this->ncols());
+    if (m_layout == Layout::RowMajor)
+        std::copy(m_ptr, m_ptr + this->nrows() * this->ncols(), copy.m_ptr);
+    else
+        for (std::size_t i = 0; i < this->nrows(); i++)
+            for (std::size_t j = 0; j < this->ncols(); j++)
+                copy.m_ptr[i * this->ncols() + j] = element(i, j);
+    return copy;
+}
+
+template<typename T>
+MatrixFlat<T> MatrixFlat<T>::map(const std::string& path, const MapOptions& options) {
+    std::shared_ptr<MappedFile> file = MappedFile::open(path, options);
+    if (!file || file->size() < sizeof(MatrixFileHeader)) {
+        std::cerr<<"Error: cannot map the matrix file "<<path<<". Stopping execution. "<<std::endl;
+        std::exit(-1);
+    }
+    MatrixFileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (!header.check<T>(file->size(), path)) {
+        std::cerr<<"Error: cannot map the matrix file "<<path<<". Stopping execution. "<<std::endl;
+        std::exit(-1);
+    }
+    T* data = reinterpret_cast<T*>(static_cast<char*>(file->data()) + sizeof(MatrixFileHeader));
+    return MatrixFlat<T>(header.rows, header.cols, std::move(file), data, static_cast<Layout>(header.layout));
+}
+
+template<typename T>
+MatrixFlat<T> MatrixFlat<T>::map(const std::string& path, std::size_t rows, std::size_t cols, std::size_t offset,
+                                 const MapOptions& options) {
+    std::shared_ptr<MappedFile> file = MappedFile::open(path, options);
+    if (!file || file->size() < offset + rows * cols * sizeof(T)) {
+        std::cerr<<"Error: cannot map a "<<rows<<"X"<<cols<<" matrix at byte "<<offset<<" of "<<path
+                 <<". Stopping execution. "<<std::endl;
+        std::exit(-1);
+    }
+    T* data = reinterpret_cast<T*>(static_cast<char*>(file->data()) + offset);
+    return MatrixFlat<T>(rows, cols, std::move(file), data, Layout::RowMajor);
+}
+
+template<typename T>
+bool MatrixFlat<T>::save(const std::string& path) const {
+    MatrixFileHeader header;
+    header.type = matrix_file_type<T>();
+    header.element_size = sizeof(T);
+    header.rows = this->nrows();
+    header.cols = this->ncols();
+    header.layout = static_cast<std::uint32_t>(m_layout);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_ptr), this->nrows() * this->ncols() * sizeof(T));
+    if (!file) {
+        std::cout<<"Error: cannot write the matrix file "<<path<<std::endl;
+        return false;
+    }
+    return true;
 }
 
 template<typename T>
 size_t MatrixFlat<T>::nnzrs()  {
     compute_nzrs();
-    return MatrixSkltn<T>::nnzrs();
+    return Skltn::nnzrs();
 }
 
 template<typename T>
 bool MatrixFlat<T>::is_zero(T elem, T tolerance ) {
-    return std::abs(elem) <= tolerance;
+    return std::abs(static_cast<accumulator_t<T>>(elem)) <= static_cast<accumulator_t<T>>(tolerance);
 }
 
 
 template<typename T>
 void MatrixFlat<T>::compute_nzrs(T tolerance) {
-    unsigned int count = 0;
-    for (const T& elem : m_data)
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < this->nrows() * this->ncols(); i++)
     {
-        count += !is_zero(elem, tolerance);
+        count += !is_zero(m_ptr[i], tolerance);
     }
-   MatrixSkltn<T>::n_nzrs = count;
+   this->n_nzrs = count;
 }
 
 template<typename T>
 T &MatrixFlat<T>::operator[](size_t index) {
-    return m_data[index];
+    return m_ptr[index];
 }
 
 template<typename T>
 const T &MatrixFlat<T>::operator[](size_t index) const {
-    return m_data[index];
-}
-
-template<typename T>
-bool MatrixFlat<T>::check_indexes(size_t i, size_t j) const {
-    // Since using size_t as index time and size_t > 0, it obvius that i, j > 0.
-    return i < MatrixSkltn<T>::n_rows &&
-            j < MatrixSkltn<T>::n_cols;
+    return m_ptr[index];
 }
 
 template<typename T>
 void MatrixFlat<T>::_print(std::ostream &os) const {
 
-    for (size_t i = 0; i < MatrixSkltn<T>::n_rows; i++) {
-        for (size_t j = 0; j < MatrixSkltn<T>::n_cols; j++)
+    for (size_t i = 0; i < this->n_rows; i++) {
+        for (size_t j = 0; j < this->n_cols; j++)
             std::cout << (*this).operator()(i, j) << " ";
         std::cout<<std::endl;
     }
 }
 
-template<typename T>
-T &MatrixFlat<T>::operator()(size_t i, size_t j) {
-    //@note: check_indexes is expensive, consider coding also a version that does not have this overhead
-    if(check_indexes(i, j) == 1)
-        return  m_data[MatrixSkltn<T>::n_cols * i + j];
-    std::cerr<<"Error in operator(): indexes "<< i<<", "<< j<< " are not correct.\n"
-              <<"Stopping execution. "<<std::endl;
-    std::exit(-1);
-
-}
-
-template<typename T>
-const T &MatrixFlat<T>::operator()(size_t i, size_t j) const {
-    if(check_indexes(i, j) == 1)
-        return  m_data[MatrixSkltn<T>::n_cols * i + j];
-    std::cerr<<"Error in operator(): indexes "<< i<<", "<< j<< " are not correct.\n"
-             <<"Stopping execution. "<<std::endl;
-    std::exit(-1);
-}
-
 
 #endif
\ No newline at end of file
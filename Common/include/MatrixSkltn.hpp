@@ -1,14 +1,34 @@
 #include<vector>
 #include<random>
 #include<iostream>
+#include "half.hpp"
 
 #ifndef MATRIXSKTLN_HPP
 #define MATRIXSKTLN_HPP
 
 
-    template<typename T>
+    //! Access policies of operator(): CheckedAccess stops the execution on indexes out of the matrix,
+    //! UncheckedAccess reads the element directly (for the hot loops, where the indexes are known to be valid)
+    struct CheckedAccess{ static constexpr bool checked = true; };
+    struct UncheckedAccess{ static constexpr bool checked = false; };
+
+    //! Policy of the matrices that do not choose one: checked, unless the program is built with -DNNET_UNCHECKED_ACCESS
+#ifdef NNET_UNCHECKED_ACCESS
+    using DefaultAccess = UncheckedAccess;
+#else
+    using DefaultAccess = CheckedAccess;
+#endif
+
+
+    //! Interface of the matrices, with static polymorphism (CRTP): Derived provides element(i, j), the unchecked
+    //! access to an element, and _print. operator() applies the Access policy at compile time and then calls
+    //! element, so the accesses are inlined in the loops of the generic algorithms: no virtual call, and no check
+    //! with UncheckedAccess.
+    template<typename T, typename Derived, typename Access = DefaultAccess>
     class MatrixSkltn{
     public:
+        using access_policy = Access;
+
         MatrixSkltn() : n_rows(0), n_cols(0), n_nzrs(0) {};
 
         //! Added new constructor
@@ -21,28 +41,51 @@
         size_t nrows() const {return n_rows;}
         size_t ncols() const {return n_cols;}
 
-        //MODIFICATA DA FILIPPO, aggiunto il virtual e tolto il const
-
-        virtual size_t nnzrs() {return n_nzrs;}
+        //! Hidden by the matrices that count their non zero elements
+        size_t nnzrs() {return n_nzrs;}
 
     // Print da modificare
 
         void print(std::ostream& os = std::cout) const {
         os << "nrows: " << n_rows << " | ncols:" << n_cols << " | nnz: " << n_nzrs << std::endl;
-        _print(os);
+        self()._print(os);
     };
     // Fine Print 
 
-        virtual const T& operator()(size_t i, size_t j) const = 0;
-        virtual T& operator()(size_t i, size_t j) = 0;
+        const T& operator()(size_t i, size_t j) const {
+            if constexpr (Access::checked)
+                check_indexes(i, j);
+            return self().element(i, j);
+        }
+        T& operator()(size_t i, size_t j) {
+            if constexpr (Access::checked)
+                check_indexes(i, j);
+            return self().element(i, j);
+        }
 
-        virtual ~MatrixSkltn() = default;
     protected:
         size_t n_rows, n_cols, n_nzrs;
-        virtual void _print(std::ostream& os) const = 0;
 
-        void generate_random_vector(T a, T b, std::vector<T>& vct);
-        void generate_random_vector(T a, T b, std::vector<T>& vct,  int seed);
+        //! Not virtual: the matrices are never deleted through the interface
+        ~MatrixSkltn() = default;
+
+        template<typename Allocator>
+        void generate_random_vector(T a, T b, std::vector<T, Allocator>& vct);
+        template<typename Allocator>
+        void generate_random_vector(T a, T b, std::vector<T, Allocator>& vct,  int seed);
+
+    private:
+        Derived& self() {return static_cast<Derived&>(*this);}
+        const Derived& self() const {return static_cast<const Derived&>(*this);}
+
+        void check_indexes(size_t i, size_t j) const {
+            // Since using size_t as index time and size_t > 0, it obvius that i, j > 0.
+            if (i < n_rows && j < n_cols)
+                return;
+            std::cerr<<"Error in operator(): indexes "<< i<<", "<< j<< " are not correct.\n"
+                     <<"Stopping execution. "<<std::endl;
+            std::exit(-1);
+        }
     };
 
 
@@ -50,20 +93,23 @@
     //@note: does it really make sense for this to be a method of a matrix?
     //       if we do not need the state of the object you can either define the method
     //       as static or make it a free function
-    template<typename T> 
-    void MatrixSkltn<T>::generate_random_vector(T a, T b, std::vector<T>& vct, int seed){
+    template<typename T, typename Derived, typename Access>
+    template<typename Allocator>
+    void MatrixSkltn<T, Derived, Access>::generate_random_vector(T a, T b, std::vector<T, Allocator>& vct, int seed){
 
+        //the 16 bit types are generated in float and rounded, see accumulator_t in half.hpp
         std::mt19937 gen(seed); 
-        std::uniform_real_distribution<T> dist(a, b);
+        std::uniform_real_distribution<accumulator_t<T>> dist(a, b);
 
         for(std::size_t i = 0; i<vct.size(); i++)
-            vct[i] = dist(gen); 
+            vct[i] = T(dist(gen)); 
 
 
     }
 
-    template<typename T> 
-    void MatrixSkltn<T>::generate_random_vector(T a, T b, std::vector<T>& vct){
+    template<typename T, typename Derived, typename Access>
+    template<typename Allocator>
+    void MatrixSkltn<T, Derived, Access>::generate_random_vector(T a, T b, std::vector<T, Allocator>& vct){
 
         std::random_device rd;
         generate_random_vector(a, b, vct, rd());
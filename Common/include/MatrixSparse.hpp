@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstdint>
+#include "MatrixFlat.hpp"
+
+#ifndef MATRIXSPARSE_HPP
+#define MATRIXSPARSE_HPP
+
+//**********************************************************************************************************************
+
+// Compressed sparse matrices: CSR (compressed rows) and CSC (compressed columns).
+//
+// Only the non-zero elements are stored, grouped by line (a row for CSR, a column for CSC): the elements of line l
+// are values[outer_ptr[l] .. outer_ptr[l+1]) and inner_idx gives their position inside the line (the column for
+// CSR, the row for CSC), sorted. The indices are 32 bit, so that they take half the memory traffic of size_t and can
+// be used directly by the SIMD gathers of the kernels (gemm_sparse.hpp), which limits the sides to 2^31.
+// The structure is fixed once built: the elements can be read anywhere (0 outside the pattern) and modified only
+// where they are stored, as for the weights of a pruned network.
+
+//**********************************************************************************************************************
+
+
+template<typename T, bool ByRows>
+class MatrixCompressed : public MatrixSkltn<T, MatrixCompressed<T, ByRows>>{
+    private:
+
+        using Skltn = MatrixSkltn<T, MatrixCompressed<T, ByRows>>;
+
+        std::vector<std::size_t> m_outer_ptr;
+        std::vector<std::uint32_t> m_inner_idx;
+        std::vector<T> m_values;
+
+        //! Returned by the const operator() for the elements that are not stored
+        static inline const T m_zero = T(0);
+
+        //! Position of element (i, j) in m_values, m_values.size() if it is not stored
+        std::size_t find(size_t i, size_t j) const;
+
+    public:
+
+        //! Initializes an empty matrix (no element stored)
+        MatrixCompressed(std::size_t rows, std::size_t cols):
+            Skltn(rows, cols, 0),
+            m_outer_ptr((ByRows ? rows : cols) + 1, 0)
+            {};
+
+        //! Keeps the elements of dense whose absolute value is larger than tolerance
+        explicit MatrixCompressed(const MatrixFlat<T>& dense, T tolerance = 1e-10);
+
+        //! Number of lines (rows for CSR, columns for CSC) and of elements in a line
+        std::size_t nlines() const {return m_outer_ptr.size() - 1;}
+        std::size_t line_length(std::size_t line) const {return m_outer_ptr[line + 1] - m_outer_ptr[line];}
+
+        //! Raw arrays, used by the kernels
+        const std::vector<std::size_t>& outer_ptr() const {return m_outer_ptr;}
+        const std::vector<std::uint32_t>& inner_idx() const {return m_inner_idx;}
+        const std::vector<T>& values() const {return m_values;}
+        std::vector<T>& values() {return m_values;}
+
+        //! Fraction of the elements that are stored
+        double density() const;
+
+        //! Same matrix with all the elements stored
+        MatrixFlat<T> to_dense() const;
+
+        //! Access used by operator() after the policy: 0 outside the pattern (const), only the stored elements can
+        //! be modified
+        const T& element(size_t i, size_t j) const;
+        T& element(size_t i, size_t j);
+
+        size_t nnzrs() {return m_values.size();}
+
+        void _print(std::ostream& os) const;
+
+};
+
+//! Compressed Sparse Row: the rows are stored one after the other, every row has its columns sorted
+template<typename T>
+using MatrixCSR = MatrixCompressed<T, true>;
+
+//! Compressed Sparse Column: the columns are stored one after the other, every column has its rows sorted
+template<typename T>
+using MatrixCSC = MatrixCompressed<T, false>;
+
+
+template<typename T, bool ByRows>
+MatrixCompressed<T, ByRows>::MatrixCompressed(const MatrixFlat<T>& dense, T tolerance):
+    Skltn(dense.nrows(), dense.ncols(), 0)
+{
+    if (dense.nrows() > INT32_MAX || dense.ncols() > INT32_MAX) {
+        std::cerr<<"Error: the sparse matrices are limited to 2^31 rows and columns, got "<<dense.nrows()<<" x "
+                 <<dense.ncols()<<". Stopping execution. "<<std::endl;
+        std::exit(-1);
+    }
+    const std::size_t lines = ByRows ? dense.nrows() : dense.ncols();
+    const std::size_t length = ByRows ? dense.ncols() : dense.nrows();
+    const T* data = dense.get_ptr();
+    m_outer_ptr.reserve(lines + 1);
+    m_outer_ptr.push_back(0);
+    for (std::size_t l = 0; l < lines; l++) {
+        for (std::size_t k = 0; k < length; k++) {
+            const T value = ByRows ? data[l * dense.ncols() + k] : data[k * dense.ncols() + l];
+            if (std::abs(static_cast<accumulator_t<T>>(value)) > static_cast<accumulator_t<T>>(tolerance)) {
+                m_inner_idx.push_back(static_cast<std::uint32_t>(k));
+                m_values.push_back(value);
+            }
+        }
+        m_outer_ptr.push_back(m_values.size());
+    }
+    this->n_nzrs = m_values.size();
+}
+
+template<typename T, bool ByRows>
+double MatrixCompressed<T, ByRows>::density() const {
+    const double elements = static_cast<double>(this->n_rows) * this->n_cols;
+    return elements == 0 ? 0 : m_values.size() / elements;
+}
+
+template<typename T, bool ByRows>
+MatrixFlat<T> MatrixCompressed<T, ByRows>::to_dense() const {
+    MatrixFlat<T> dense(this->n_rows, this->n_cols);
+    for (std::size_t l = 0; l < nlines(); l++)
+        for (std::size_t p = m_outer_ptr[l]; p < m_outer_ptr[l + 1]; p++) {
+            const std::size_t i = ByRows ? l : m_inner_idx[p], j = ByRows ? m_inner_idx[p] : l;
+            dense[i * this->n_cols + j] = m_values[p];
+        }
+    return dense;
+}
+
+template<typename T, bool ByRows>
+std::size_t MatrixCompressed<T, ByRows>::find(size_t i, size_t j) const {
+    const std::size_t line = ByRows ? i : j, position = ByRows ? j : i;
+    const auto first = m_inner_idx.begin() + m_outer_ptr[line], last = m_inner_idx.begin() + m_outer_ptr[line + 1];
+    const auto it = std::lower_bound(first, last, position);
+    return it != last && *it == position ? it - m_inner_idx.begin() : m_values.size();
+}
+
+template<typename T, bool ByRows>
+const T &MatrixCompressed<T, ByRows>::element(size_t i, size_t j) const {
+    const std::size_t p = find(i, j);
+    return p < m_values.size() ? m_values[p] : m_zero;
+}
+
+template<typename T, bool ByRows>
+T &MatrixCompressed<T, ByRows>::element(size_t i, size_t j) {
+    const std::size_t p = find(i, j);
+    if (p < m_values.size())
+        return m_values[p];
+    std::cerr<<"Error in operator(): element "<< i<<", "<< j<< " is not stored in the sparse matrix.\n"
+             <<"Stopping execution. "<<std::endl;
+    std::exit(-1);
+}
+
+template<typename T, bool ByRows>
+void MatrixCompressed<T, ByRows>::_print(std::ostream &os) const {
+    for (size_t i = 0; i < this->n_rows; i++) {
+        for (size_t j = 0; j < this->n_cols; j++)
+            os << (*this)(i, j) << " ";
+        os << std::endl;
+    }
+}
+
+
+#endif //MATRIXSPARSE_HPP
@@ -0,0 +1,105 @@
+#include "MatrixSkltn.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+#ifndef MATRIXVIEW_HPP
+#define MATRIXVIEW_HPP
+
+//**********************************************************************************************************************
+
+// Views on the elements of a row-major matrix, without copies: a submatrix (block), a row or a column of a
+// MatrixFlat, or of another view, are the same rows x cols matrix read through a pointer and a row stride (the
+// leading dimension of the matrix they come from). Writing an element of a view writes the matrix.
+//
+// A view is a matrix of the MatrixSkltn interface, so the generic algorithms (see matrixProd in matrixProd_VM_VV.hpp)
+// take it as well as a MatrixFlat. The default policy is UncheckedAccess: element (i, j) is data[i * stride + j],
+// which is what a loop on a raw pointer computes. The bounds are checked once, when the view is made.
+// MatrixView<const T> is a read-only view (the ones of a const MatrixFlat).
+// It is header only, as MatrixFlat.hpp.
+
+//**********************************************************************************************************************
+
+
+template<typename T, typename Access = UncheckedAccess>
+class MatrixView : public MatrixSkltn<T, MatrixView<T, Access>, Access>{
+    private:
+        using Skltn = MatrixSkltn<T, MatrixView<T, Access>, Access>;
+
+        T* m_ptr;
+        std::size_t m_stride;
+
+        //! Stops the execution if the block is not inside the matrix
+        void check_block(std::size_t i0, std::size_t j0, std::size_t rows, std::size_t cols) const {
+            if (i0 + rows <= this->nrows() && j0 + cols <= this->ncols())
+                return;
+            std::cerr<<"Error: the block of "<<rows<<"X"<<cols<<" at "<<i0<<", "<<j0<<" is not inside the "
+                     <<this->nrows()<<"X"<<this->ncols()<<" matrix. Stopping execution. "<<std::endl;
+            std::exit(-1);
+        }
+
+    public:
+        using value_type = T;
+
+        //! rows x cols elements starting at data, consecutive rows are stride elements apart (stride >= cols)
+        MatrixView(T* data, std::size_t rows, std::size_t cols, std::size_t stride):
+            Skltn(rows, cols, 0),
+            m_ptr(data),
+            m_stride(stride)
+            {};
+
+        //! A read-only view of a writable one
+        template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+        MatrixView(const MatrixView<U, Access>& other):
+            MatrixView(other.get_ptr(), other.nrows(), other.ncols(), other.stride())
+            {};
+
+        //! Unchecked access, used by operator() after the policy
+        T& element(std::size_t i, std::size_t j) const {return m_ptr[i * m_stride + j];}
+
+        T* get_ptr() const {return m_ptr;}
+        std::size_t stride() const {return m_stride;}
+
+        //! Views on a part of this one
+        MatrixView block(std::size_t i0, std::size_t j0, std::size_t rows, std::size_t cols) const {
+            check_block(i0, j0, rows, cols);
+            return MatrixView(m_ptr + i0 * m_stride + j0, rows, cols, m_stride);
+        }
+        MatrixView row(std::size_t i) const {return block(i, 0, 1, this->ncols());}
+        MatrixView col(std::size_t j) const {return block(0, j, this->nrows(), 1);}
+
+        //! Same elements with another access policy
+        template<typename OtherAccess>
+        MatrixView<T, OtherAccess> with_access() const {
+            return MatrixView<T, OtherAccess>(m_ptr, this->nrows(), this->ncols(), m_stride);
+        }
+
+        //! Copies the elements of another matrix of the same shape
+        template<typename Source>
+        void assign(const Source& other) const {
+            for (std::size_t i = 0; i < this->nrows(); i++)
+                for (std::size_t j = 0; j < this->ncols(); j++)
+                    element(i, j) = other(i, j);
+        }
+
+        size_t nnzrs() {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < this->nrows(); i++)
+                for (std::size_t j = 0; j < this->ncols(); j++)
+                    count += element(i, j) != T(0);
+            this->n_nzrs = count;
+            return count;
+        }
+
+        void _print(std::ostream& os) const {
+            for (std::size_t i = 0; i < this->nrows(); i++) {
+                for (std::size_t j = 0; j < this->ncols(); j++)
+                    os << element(i, j) << " ";
+                os << std::endl;
+            }
+        }
+};
+
+
+#endif //MATRIXVIEW_HPP
@@ -0,0 +1,129 @@
+#include <string>
+#include <map>
+#include <memory>
+#include <cstddef>
+
+#ifndef AUTOTUNER_HPP
+#define AUTOTUNER_HPP
+
+//**********************************************************************************************************************
+
+// Empirical autotuner for the blocked matrix multiplication kernels. The tuning table is defined in
+// /src/tuning_table.cpp (the only part the kernels link against), the Autotuner in /src/autotuner.cpp
+//
+// The Autotuner benchmarks candidate configurations (outer tile, inner tile, number of threads, loop order) of a
+// kernel for a given product shape on the current machine and records the fastest one. Shapes are grouped in
+// buckets (the power of two that bounds each of M, N, K) and the winners are saved in a csv tuning file, by default
+// gemm_tuning.csv in the working directory (or the file named by the environment variable NNET_TUNING_FILE).
+//
+// The kernels read the tuning file the first time they run and use the entry of the closest bucket, falling back
+// to their built-in defaults when the file does not exist. To tune a machine it is enough to run the autotune
+// program in test/profiling once.
+
+//**********************************************************************************************************************
+
+
+//! Kernels whose parameters can be tuned
+enum class TunedKernel{
+    Packed = 0,     // gemm_packed / mmm_packed
+    Tiled = 1,      // mmm_multiT / mmm_gmultiT
+    Strassen = 2    // gemm_strassen / mmm_strassen
+};
+
+std::string tuned_kernel_name(TunedKernel kernel);
+
+//! A configuration of a kernel, 0 means "use the kernel default" for every field
+struct TuningConfig{
+    int outer_tile = 0;     // packed: rows of the A block (MC)     tiled: side of the square tiles of C
+                            // strassen: crossover size below which the packed engine is used
+    int inner_tile = 0;     // packed: depth of the panels (KC)     tiled: tile of the inner dimension
+    int threads = 0;
+    int loop_order = 0;     // packed: 0 = tasks ordered by A block (A reused in L2), 1 = ordered by B chunk
+};
+
+//! Identifies a (kernel, data type, shape bucket) entry of the tuning table
+struct TuningKey{
+    TunedKernel kernel;
+    int dtype_size;
+    int m_bucket, n_bucket, k_bucket;
+
+    bool operator<(const TuningKey& other) const;
+};
+
+//! Bucket of a dimension: the smallest b such that dim <= 2^b
+int tuning_bucket(std::size_t dim);
+
+
+class TuningTable{
+public:
+
+    //! Looks for the entry of the bucket of (M, N, K), or the closest bucket tuned for the same kernel and type
+    bool lookup(TunedKernel kernel, std::size_t dtype_size, std::size_t M, std::size_t N, std::size_t K,
+                TuningConfig& config) const;
+
+    void set(const TuningKey& key, const TuningConfig& config, double time_us);
+
+    //! Adds the entries of the csv file, returns false if the file cannot be opened
+    bool load(const std::string& filename);
+
+    bool save(const std::string& filename) const;
+
+    std::size_t size() const {return entries.size();}
+
+private:
+    struct Entry{
+        TuningConfig config;
+        double time_us;
+    };
+    std::map<TuningKey, Entry> entries;
+};
+
+
+//! Name of the tuning file: $NNET_TUNING_FILE if set, gemm_tuning.csv otherwise
+std::string tuning_filename();
+
+//! Table used by the kernels, loaded from tuning_filename() at the first call
+std::shared_ptr<const TuningTable> tuning_table();
+
+//! Replaces the table used by the kernels (e.g. with the one just produced by an Autotuner)
+void install_tuning_table(std::shared_ptr<const TuningTable> table);
+
+//! Shortcut used by the kernels: fills config with the tuned values for the product, if any
+template<typename T>
+bool tuned_config(TunedKernel kernel, std::size_t M, std::size_t N, std::size_t K, TuningConfig& config){
+    return tuning_table()->lookup(kernel, sizeof(T), M, N, K, config);
+}
+
+
+class Autotuner{
+    /*
+     * Benchmarks the candidate configurations of a kernel for one shape and stores the fastest in its table.
+     * The search is a coordinate descent, which keeps the number of runs small even for large products:
+     * first the number of threads with the default tiles, then the (outer, inner) tile grid with the best number of
+     * threads, and finally the loop order. Each candidate is timed as the best of `repetitions` runs.
+     *
+     * The table starts from the content of the tuning file, so a tuning session only adds or refreshes buckets.
+     */
+public:
+
+    explicit Autotuner(int max_threads = 0, int repetitions = 3, bool verbose = true);
+
+    template<typename T>
+    TuningConfig tune(TunedKernel kernel, std::size_t M, std::size_t N, std::size_t K);
+
+    const TuningTable& table() const {return m_table;}
+
+    bool save(const std::string& filename = tuning_filename()) const {return m_table.save(filename);}
+
+    //! Makes the kernels of this process use the tuned configurations right away
+    void install() const;
+
+private:
+
+    TuningTable m_table;
+    int m_max_threads, m_repetitions;
+    bool m_verbose;
+};
+
+
+#endif //AUTOTUNER_HPP
@@ -0,0 +1,82 @@
+#include "transpose.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef BLOCK_SPARSE_HPP
+#define BLOCK_SPARSE_HPP
+
+//**********************************************************************************************************************
+
+// Block-sparse (BSR) weight matrices: block pruning and the products of the training on the blocks left.
+// The body is defined in /src/block_sparse.cpp
+//
+// The matrix is cut in block_rows x block_cols blocks and only the non-zero blocks are stored, each one as a dense
+// row-major block (the blocks on the last rows / columns are zero padded). A row of a block is one or a few full
+// vector registers, so the kernels run at the speed of dense code on the blocks left, where unstructured sparsity
+// (MatrixSparse.hpp) needs an index per element. With 70-90% of the blocks pruned the products of a layer cost
+// 10-30% of the dense ones.
+// The kernels are the three products of the per-sample training (see gemv.hpp), restricted to the stored blocks:
+//     forward:   y += x * W       (bsr_gemv Trans)
+//     backward:  y += W * x       (bsr_gemv NoTrans)
+//     gradient:  W += alpha * x * y^T on the stored blocks only, so that the pruned weights stay 0
+// They use AVX2 + FMA (also on AVX-512 CPUs: a row of an 8 column float block is one 256 bit register), with a
+// scalar fallback, and split the block columns (forward) or the block rows (backward, gradient) among the threads
+// of the pool (thread_pool.hpp), so that no two threads write the same outputs.
+
+//**********************************************************************************************************************
+
+
+//! Positions of the stored blocks of a rows x cols matrix. The values are kept apart (values_size() elements, block
+//! q at q * block_size()), so that they can live in the weight vectors of Model.
+struct BlockPattern{
+    std::size_t rows = 0, cols = 0, block_rows = 0, block_cols = 0;
+    std::vector<std::size_t> row_ptr;       // blocks of block row b: [row_ptr[b], row_ptr[b+1])
+    std::vector<std::uint32_t> col_idx;     // block column of every block
+    std::vector<std::size_t> col_ptr;       // the same blocks by block column: col_blocks[col_ptr[c] .. col_ptr[c+1])
+    std::vector<std::uint32_t> col_blocks;  // index of the block (in the row order above)
+    std::vector<std::uint32_t> col_rows;    // its block row
+
+    std::size_t block_size() const {return block_rows * block_cols;}
+    std::size_t nblocks() const {return col_idx.size();}
+    std::size_t values_size() const {return nblocks() * block_size();}
+    std::size_t block_row_count() const {return (rows + block_rows - 1) / block_rows;}
+    std::size_t block_col_count() const {return (cols + block_cols - 1) / block_cols;}
+    //! Fraction of the blocks that are stored
+    double density() const;
+};
+
+//! True if the blocks are supported by the kernels: block_cols must be 8, 16 or 32 (whole registers of float and
+//! double), block_rows at least 1
+bool valid_block_shape(std::size_t block_rows, std::size_t block_cols);
+
+//! Pattern of the blocks of the rows x cols row-major matrix W that have at least one element different from 0
+template<typename T>
+BlockPattern block_pattern(const T* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols);
+
+//! Magnitude block pruning: keeps the (1 - sparsity) fraction of the blocks with the largest Frobenius norm (at least
+//! one) and sets the other elements of W to 0. Returns the pattern of the blocks kept.
+template<typename T>
+BlockPattern prune_blocks(T* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols,
+                          float sparsity);
+
+//! Values of the stored blocks of the dense matrix W (leading dimension ldw), in the layout of the pattern
+template<typename T>
+std::vector<T> pack_blocks(const BlockPattern& pattern, const T* W, std::size_t ldw);
+
+//! Writes the stored blocks into the dense matrix W (leading dimension ldw), the other elements are left untouched
+template<typename T>
+void unpack_blocks(const BlockPattern& pattern, const T* values, T* W, std::size_t ldw);
+
+//! y += op(W) * x with W rows x cols in block-sparse format.
+//! With NoTrans x has cols elements and y has rows, with Trans x has rows elements and y has cols (x * W).
+//! numThreads <= 0 uses all the available cores; small products always run on the calling thread.
+template<typename T>
+void bsr_gemv(Transpose trans, const BlockPattern& pattern, const T* values, const T* x, T* y, int numThreads = 0);
+
+//! W += alpha * x * y^T on the stored blocks of W, x has rows elements and y has cols
+template<typename T>
+void bsr_ger(const BlockPattern& pattern, T alpha, const T* x, const T* y, T* values, int numThreads = 0);
+
+
+#endif //BLOCK_SPARSE_HPP
@@ -0,0 +1,38 @@
+#include <string>
+
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+//**********************************************************************************************************************
+
+// Runtime detection of the SIMD extensions of the CPU we are running on (cpuid + xgetbv), used to dispatch the
+// SIMD kernels to the best variant available. The body is defined in /src/cpu_features.cpp
+//
+// All the SIMD kernels of the project are compiled with per-function target attributes, so the binaries do not
+// need -march=native: the same executable runs on every x86-64 machine and picks its kernels at startup.
+
+//**********************************************************************************************************************
+
+
+struct CpuFeatures{
+    bool sse4_1 = false, sse4_2 = false;
+    bool avx = false, avx2 = false, fma = false, f16c = false;
+    bool avx512f = false, avx512bw = false, avx512dq = false, avx512vl = false;
+    bool avx512_vnni = false, avx512_bf16 = false, avx_vnni = false;
+};
+
+//! SIMD tiers for which the kernels are provided, ordered from the least to the most capable one
+enum class SimdLevel{ Scalar = 0, SSE4 = 1, AVX2 = 2, AVX512 = 3 };
+
+//! Features of the running CPU, detected once at the first call
+const CpuFeatures& cpu_features();
+
+//! Best SIMD tier supported by both the CPU and the OS.
+//! It can be lowered (never raised) with the environment variable NNET_SIMD=scalar|sse4|avx2|avx512,
+//! useful to test the fallback kernels on a machine that supports the wider ones.
+SimdLevel simd_level();
+
+std::string simd_level_name(SimdLevel level);
+
+
+#endif //CPU_FEATURES_HPP
@@ -0,0 +1,44 @@
+#include <cstddef>
+#include <string>
+
+#ifndef EPILOGUE_HPP
+#define EPILOGUE_HPP
+
+//**********************************************************************************************************************
+
+// Epilogue of the products of a dense layer: bias, activation and its derivative. The body is defined in
+// /src/epilogue.cpp
+//
+// The forward pass of a layer is z = x * W + b, h = act(z), and the training also needs act'(z). Computed one after
+// the other these are three more sweeps over z after the product. The gemv and gemm_packed versions that take an
+// Epilogue apply it to every part of the output as soon as it is final, while it is still in cache (the chunk of y
+// of a thread in gemv, the tile of C of a task in gemm_packed), so z is written once and h, act'(z) are written
+// directly from it. The bias no longer needs to be appended to the weights as an extra row.
+
+//**********************************************************************************************************************
+
+
+//! Activation functions of the layers, the same as the names accepted by applyActivationFunction
+enum class Activation{ Linear, Sigmoid, Tanh, ReLu, SoftMax };
+
+//! Activation of a name used by Layer and Output ("linear", "sigmoid", "tanh", "ReLu", "SoftMax")
+Activation activation_from_name(const std::string& name);
+
+//! What to do with a finished output tile. The pointers left to null are skipped.
+template<typename T>
+struct Epilogue{
+    const T* bias = nullptr;                    // added to every row of the output, one value per column
+    Activation activation = Activation::Linear;
+    T* h = nullptr;                             // act(z), laid out as the output with leading dimension ldh
+    T* dact = nullptr;                          // act'(z), laid out as h
+    std::size_t ldh = 0;                        // leading dimension of h and dact, 0 for the one of the output
+};
+
+//! Applies the epilogue to the rows x cols tile of the output that starts at row i0 and column j0: z is the first
+//! element of the tile, ldz the leading dimension of the output. z += bias, h = act(z), dact = act'(z)
+template<typename T>
+void apply_epilogue(const Epilogue<T>& epilogue, std::size_t rows, std::size_t cols, std::size_t i0, std::size_t j0,
+                    T* z, std::size_t ldz);
+
+
+#endif //EPILOGUE_HPP
@@ -8,6 +8,8 @@
 
 //**********************************************************************************************************************
 
+#include "transpose.hpp"
+#include "quantized.hpp"
 #include <string>
 #include <vector>
 
@@ -77,6 +79,12 @@ void mul_funct(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c, int m, i
 template<typename T>
 void mul_funct(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c, int m, int n, int nb, int selection, int block_size);
 
+template<typename T>
+void mul_funct(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c, int m, int n, int nb, int selection, Transpose transA, Transpose transB);
+
+template<typename T>
+void mul_funct(const std::vector<T>& a, const QuantizedMatrix& b, std::vector<T>& c, int m, int n, int nb);
+
 //template<typename T>
 //void mul_funct(T *a, T *b, T *c, int m, int n, int nb, int selection, int block_size);
 
@@ -0,0 +1,175 @@
+#include "MatrixFlat.hpp"
+#include "MatrixView.hpp"
+#include "transpose.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifndef GEMM_HPP
+#define GEMM_HPP
+
+//**********************************************************************************************************************
+
+// BLAS-style matrix product with the kernel chosen at run time. The body is defined in /src/gemm.cpp
+//
+//     gemm(transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc)
+//
+// computes C = alpha * op(A) * op(B) + beta * C, with op(A) M x K, op(B) K x N and C M x N, all row-major: row i of a
+// matrix starts ld elements after row i - 1, so a sub-block of a larger matrix is passed as a pointer to its first
+// element and the leading dimension of the matrix (no copy). As in BLAS, beta = 0 overwrites C without reading it and
+// the transposed operands are stored as in transpose.hpp. The MatrixFlat version takes the matrices in any layout
+// (layout.hpp), the conversions it needs are in matrix_layout.hpp.
+//
+// The products are computed by a provider, picked by name from a registry:
+//   - "packed"  the packed-panel engine (gemm_packed.hpp), the default
+//   - "avx"     the masked SIMD kernels of matrixProd_AVX.hpp (matrixMultStrided_Simd)
+//   - "naive"   the reference triple loop, to check the others
+//   - "blas"    OpenBLAS, registered by mmm_blas.cpp: only in the programs that link it
+// The default provider can be changed without recompiling with the environment variable NNET_GEMM (e.g.
+// NNET_GEMM=naive ./program), or from the program with set_gemm_provider. Another library is added to the registry
+// with register_gemm_provider. The registry is defined here, in the header, so that any object file can register a
+// provider without linking the built-in ones.
+
+//**********************************************************************************************************************
+
+
+//! C = alpha * op(A) * op(B) + beta * C, the signature of the providers
+template<typename T>
+using GemmKernel = void (*)(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                            T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                            T beta, T* C, std::size_t ldc);
+
+//! A provider of the registry: a name and the kernels in single and double precision
+struct GemmProvider{
+    std::string name;
+    std::string description;
+    GemmKernel<float> sgemm = nullptr;
+    GemmKernel<double> dgemm = nullptr;
+
+    template<typename T>
+    GemmKernel<T> kernel() const {
+        if constexpr (std::is_same_v<T, float>)
+            return sgemm;
+        else
+            return dgemm;
+    }
+};
+
+namespace gemm_registry {
+
+    struct Registry{
+        std::vector<GemmProvider> providers;
+        std::string current;            // empty until the first product or set_gemm_provider
+    };
+
+    inline Registry& instance(){
+        static Registry registry;
+        return registry;
+    }
+
+}
+
+//! Adds a provider to the registry, or replaces the one with the same name. Always returns true, so that a provider
+//! can be registered by the initializer of a static variable.
+inline bool register_gemm_provider(const GemmProvider& provider){
+    std::vector<GemmProvider>& providers = gemm_registry::instance().providers;
+    for (GemmProvider& p : providers)
+        if (p.name == provider.name) {
+            p = provider;
+            return true;
+        }
+    providers.push_back(provider);
+    return true;
+}
+
+//! The provider with this name, nullptr if there is none
+inline const GemmProvider* find_gemm_provider(const std::string& name){
+    for (const GemmProvider& p : gemm_registry::instance().providers)
+        if (p.name == name)
+            return &p;
+    return nullptr;
+}
+
+//! Names of the registered providers
+inline std::vector<std::string> gemm_providers(){
+    std::vector<std::string> names;
+    for (const GemmProvider& p : gemm_registry::instance().providers)
+        names.push_back(p.name);
+    return names;
+}
+
+//! Selects the provider used by gemm. Returns false, with an error message, if there is none with this name.
+inline bool set_gemm_provider(const std::string& name){
+    if (!find_gemm_provider(name)) {
+        std::cout<<"Error: no GEMM provider named "<<name<<", the available ones are:";
+        for (const std::string& p : gemm_providers())
+            std::cout<<" "<<p;
+        std::cout<<std::endl;
+        return false;
+    }
+    gemm_registry::instance().current = name;
+    return true;
+}
+
+//! Name of the provider used by gemm: the one selected with set_gemm_provider, otherwise NNET_GEMM, otherwise "packed"
+inline const std::string& gemm_provider(){
+    std::string& current = gemm_registry::instance().current;
+    if (current.empty()) {
+        const char* env = std::getenv("NNET_GEMM");
+        if (!env || !set_gemm_provider(env))
+            current = "packed";
+    }
+    return current;
+}
+
+
+//! C = alpha * op(A) * op(B) + beta * C with the current provider (see gemm_provider). Returns false, with an error
+//! message, if a leading dimension is smaller than the rows it holds or the provider has no kernel for T.
+template<typename T>
+bool gemm(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+          T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+          T beta, T* C, std::size_t ldc);
+
+//! Same as above with the provider chosen by name, whatever the current one is
+template<typename T>
+bool gemm(const std::string& provider, Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+          T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+          T beta, T* C, std::size_t ldc);
+
+//! The shapes come from the matrices: op(A) is M x K and C M x N. The strides of the views are the leading
+//! dimensions, so blocks of larger matrices (see MatrixView.hpp) are multiplied in place. Stops the execution if the
+//! shapes do not match, as the operators of MatrixFlat.
+template<typename T>
+bool gemm(Transpose transA, Transpose transB, T alpha, const MatrixView<const T>& A, const MatrixView<const T>& B,
+          T beta, const MatrixView<T>& C){
+    const std::size_t M = transA == Trans ? A.ncols() : A.nrows(), K = transA == Trans ? A.nrows() : A.ncols();
+    const std::size_t KB = transB == Trans ? B.ncols() : B.nrows(), N = transB == Trans ? B.nrows() : B.ncols();
+    if (K != KB || C.nrows() != M || C.ncols() != N) {
+        std::cerr<<"Error: cannot compute the "<<C.nrows()<<"X"<<C.ncols()<<" product of op(A) "<<M<<"X"<<K
+                 <<" by op(B) "<<KB<<"X"<<N<<". Stopping execution. "<<std::endl;
+        std::exit(-1);
+    }
+    return gemm<T>(transA, transB, M, N, K, alpha, A.get_ptr(), A.stride(), B.get_ptr(), B.stride(),
+                   beta, C.get_ptr(), C.stride());
+}
+
+//! Views of writable matrices, e.g. the blocks of a non-const MatrixFlat
+template<typename T>
+bool gemm(Transpose transA, Transpose transB, T alpha, const MatrixView<T>& A, const MatrixView<T>& B,
+          T beta, const MatrixView<T>& C){
+    return gemm<T>(transA, transB, alpha, MatrixView<const T>(A), MatrixView<const T>(B), beta, C);
+}
+
+//! Matrices in any layout (layout.hpp), each one in its own: the column-major ones are read in place as transposed
+//! row-major ones (a column-major C takes the product of the transposes, C^T = op(B)^T * op(A)^T), a tiled C is
+//! computed tile by tile from tiled copies of the operands that are not tiled, a tiled operand of a row- or
+//! column-major C is copied to row-major first. Stops the execution if the shapes do not match.
+template<typename T>
+bool gemm(Transpose transA, Transpose transB, T alpha, const MatrixFlat<T>& A, const MatrixFlat<T>& B,
+          T beta, MatrixFlat<T>& C);
+
+
+#endif //GEMM_HPP
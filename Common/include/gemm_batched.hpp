@@ -0,0 +1,61 @@
+#include <cstddef>
+#include <vector>
+
+#ifndef GEMM_BATCHED_HPP
+#define GEMM_BATCHED_HPP
+
+//**********************************************************************************************************************
+
+// Batched GEMM for many independent small products, used by mmm_batched. The body is defined in /src/mmm_batched.cpp
+//
+// A product of a few hundred flops (4 x 128 times 128 x 3, as in the iris network) costs less than the overhead
+// of one call to mmm_*: thread spawn, printing, timing, tuning-table lookup, packing. The batched API amortizes
+// all of it over the whole batch:
+//   - every product is an independent work item, the items are distributed among the threads (dynamic schedule,
+//     the shapes can differ); a single product always runs on one thread
+//   - small products (every dimension up to small_dimension) go to register-blocked kernels specialized for each
+//     width of C up to 16 columns and compiled for every SIMD tier (picked at runtime, see cpu_features.hpp): the
+//     columns of B are copied once into zero padded vectors of the tier, and a block of rows of C stays in at most 8
+//     vector registers along the whole K loop; wider C are processed 16 columns at a time
+//   - larger products in the batch go to the packed engine (gemm_packed.hpp) on the thread of the item
+// The products accumulate (C += A*B) and must not write to overlapping C.
+
+//**********************************************************************************************************************
+
+
+//! One product of a batch: C += A*B where A is M x K, B is K x N and C is M x N, row-major with leading
+//! dimensions lda, ldb, ldc
+template<typename T>
+struct GemmDescriptor{
+    std::size_t M = 0, N = 0, K = 0;
+    const T* A = nullptr;
+    std::size_t lda = 0;
+    const T* B = nullptr;
+    std::size_t ldb = 0;
+    T* C = nullptr;
+    std::size_t ldc = 0;
+};
+
+//! Largest dimension handled by the small kernels (up to it they beat a call to gemm_packed per product, from ~10x
+//! at 4 x 4 x 4 down to ~1.1x at 64 x 64 x 64)
+constexpr std::size_t small_dimension = 64;
+
+//! Computes the count products of batch. numThreads <= 0 uses all the available cores; small batches always run on
+//! the calling thread.
+template<typename T>
+void gemm_batched(const GemmDescriptor<T>* batch, std::size_t count, int numThreads = 0);
+
+template<typename T>
+void gemm_batched(const std::vector<GemmDescriptor<T>>& batch, int numThreads = 0);
+
+//! Batch of count products with the same shape, the operands of the product p being A + p*strideA, B + p*strideB
+//! and C + p*strideC. A stride of 0 for A or B shares the operand (e.g. the same weights applied to many inputs).
+template<typename T>
+void gemm_batched(std::size_t M, std::size_t N, std::size_t K,
+                  const T* A, std::size_t lda, std::size_t strideA,
+                  const T* B, std::size_t ldb, std::size_t strideB,
+                  T* C, std::size_t ldc, std::size_t strideC,
+                  std::size_t count, int numThreads = 0);
+
+
+#endif //GEMM_BATCHED_HPP
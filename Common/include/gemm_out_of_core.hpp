@@ -0,0 +1,50 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef GEMM_OUT_OF_CORE_HPP
+#define GEMM_OUT_OF_CORE_HPP
+
+//**********************************************************************************************************************
+
+// Out-of-core matrix multiplication, used by mmm_out_of_core. The body is defined in /src/mmm_out_of_core.cpp
+//
+// A, B and C are matrix files (the format of MatrixFlat::save, see mapped_file.hpp) that do not have to fit in
+// memory: C is computed one block of mb x nb elements at a time, as the sum over the inner dimension of the products
+// of an mb x kb panel of A by a kb x nb panel of B. Only two sets of panels are in memory:
+//
+// - while the packed engine (gemm_packed.hpp) multiplies one pair of panels, a reader thread loads the next pair
+//   with pread into the other set of buffers (double buffering), so the disk and the cores work at the same time
+// - a finished block of C is written back with pwrite by another thread, while the next block is computed
+// - the panel size is the largest that fits in the memory budget (6 panels: A, B and C, twice), rounded to a
+//   multiple of 64. The bigger the panels, the fewer times A and B are read: A is read N / nb times, B M / mb times.
+//
+// All the sizes and offsets are 64 bit, the matrices can have more than 2^31 elements.
+
+//**********************************************************************************************************************
+
+
+struct OutOfCoreOptions{
+    std::size_t memory_budget = 0;  // bytes for the panels, 0 uses a quarter of the physical memory
+    std::size_t panel = 0;          // side of the panels, 0 uses the largest one that fits in the budget
+    bool accumulate = false;        // C += A*B on an existing C file, otherwise C = A*B in a new file
+    int numThreads = 0;             // threads of the packed engine, <= 0 uses the tuned number
+};
+
+//! Time spent by gemm_out_of_core, to check how much of the I/O was hidden behind the products
+struct OutOfCoreStats{
+    std::size_t panel_rows = 0, panel_inners = 0, panel_columns = 0;
+    std::uint64_t bytes_read = 0, bytes_written = 0;
+    int64_t compute_us = 0;         // in the packed engine
+    int64_t wait_us = 0;            // waiting for a read or a write to finish
+};
+
+//! Performs C = A*B (or C += A*B with options.accumulate) where pathA holds an M x K matrix of T and pathB a K x N
+//! one, writing the M x N result to pathC. Returns false, with an error message, if a file cannot be read or
+//! written or the shapes do not match.
+template<typename T>
+bool gemm_out_of_core(const std::string& pathA, const std::string& pathB, const std::string& pathC,
+                      const OutOfCoreOptions& options = {}, OutOfCoreStats* stats = nullptr);
+
+
+#endif //GEMM_OUT_OF_CORE_HPP
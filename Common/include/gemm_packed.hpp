@@ -0,0 +1,91 @@
+#include "autotuner.hpp"
+#include "epilogue.hpp"
+#include "transpose.hpp"
+#include "half.hpp"
+#include <cstddef>
+
+#ifndef GEMM_PACKED_HPP
+#define GEMM_PACKED_HPP
+
+//**********************************************************************************************************************
+
+// Packed-panel GEMM engine used by mmm_packed (and by every other kernel that needs a fast C += A*B on raw buffers).
+// The body is defined in /src/mmm_packed.cpp
+//
+// The product is computed in the classic three level blocking scheme:
+//   - B is packed in KC x NC panels, stored as NR-wide column slivers (fits in L3)
+//   - A is packed in MC x KC blocks,  stored as MR-tall row slivers    (fits in L2)
+//   - a register-blocked MR x NR micro-kernel streams one A sliver and one B sliver (fits in L1 / registers)
+// Packing pads the ragged edges with zeros, so the micro-kernel never has to deal with partial tiles and the
+// engine works for any M, N, K.
+
+//**********************************************************************************************************************
+
+
+//! Blocking parameters of the packed engine for a given data type
+template<typename T>
+struct PackedBlocking{
+    std::size_t mr, nr;         // micro-tile computed by the micro-kernel
+    std::size_t mc, kc, nc;     // cache blocks of A (mc x kc) and B (kc x nc)
+};
+
+template<typename T>
+PackedBlocking<T> packed_default_blocking();
+
+//! Performs C += A*B where A is M x K, B is K x N and C is M x N, all stored row-major with leading dimensions
+//! lda, ldb, ldc. The work is split among numThreads threads of the pool. The cache blocks, the loop order and (when
+//! numThreads <= 0) the number of threads come from the tuning file, see autotuner.hpp.
+template<typename T>
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K,
+                 const T* A, std::size_t lda,
+                 const T* B, std::size_t ldb,
+                 T* C, std::size_t ldc,
+                 int numThreads = 0);
+
+//! Same as above with an explicit configuration: outer_tile = MC, inner_tile = KC, threads, loop_order.
+//! The fields left to 0 take the default values.
+template<typename T>
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K,
+                 const T* A, std::size_t lda,
+                 const T* B, std::size_t ldb,
+                 T* C, std::size_t ldc,
+                 const TuningConfig& config);
+
+//! Performs C += op(A)*op(B) where op(A) is M x K and op(B) is K x N (see transpose.hpp). The transposed operands
+//! are read in place by the packing routines: a transposed A is stored K x M, a transposed B is stored N x K.
+template<typename T>
+void gemm_packed(Transpose transA, Transpose transB,
+                 std::size_t M, std::size_t N, std::size_t K,
+                 const T* A, std::size_t lda,
+                 const T* B, std::size_t ldb,
+                 T* C, std::size_t ldc,
+                 int numThreads = 0);
+
+//! Same as above followed by the epilogue (see epilogue.hpp) on C: C += bias (one value per column), H = act(C),
+//! D = act'(C). Every tile of C gets it from the task that adds its last KC block, while the tile is still in cache:
+//! the forward pass of a layer for a batch of samples (one per row of A) in one pass.
+template<typename T>
+void gemm_packed(Transpose transA, Transpose transB,
+                 std::size_t M, std::size_t N, std::size_t K,
+                 const T* A, std::size_t lda,
+                 const T* B, std::size_t ldb,
+                 T* C, std::size_t ldc,
+                 const Epilogue<T>& epilogue,
+                 int numThreads = 0);
+
+//! Performs C += A*B with A and B stored in 16 bit (see half.hpp): they are converted to fp32 while they are packed,
+//! so the product runs on the float micro-kernels and is accumulated in fp32.
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K,
+                 const bf16_t* A, std::size_t lda,
+                 const bf16_t* B, std::size_t ldb,
+                 float* C, std::size_t ldc,
+                 int numThreads = 0);
+
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K,
+                 const fp16_t* A, std::size_t lda,
+                 const fp16_t* B, std::size_t ldb,
+                 float* C, std::size_t ldc,
+                 int numThreads = 0);
+
+
+#endif //GEMM_PACKED_HPP
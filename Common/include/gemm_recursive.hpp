@@ -0,0 +1,34 @@
+#include <cstddef>
+
+#ifndef GEMM_RECURSIVE_HPP
+#define GEMM_RECURSIVE_HPP
+
+//**********************************************************************************************************************
+
+// Cache-oblivious recursive matrix multiplication, used by mmm_recursive. The body is defined in /src/mmm_recursive.cpp
+//
+// The tiled and packed engines work on blocks of a fixed size, which has to be tuned for the caches of the machine
+// (see autotuner.hpp). Here the product is instead split in two along its largest dimension, M, N or K, over and
+// over until all three are at most the size of the base case: at some level of the recursion the sub-products fit
+// in each level of the cache, whatever its size, so there is no tile size to tune.
+//
+// - the base case is a register-blocked kernel on 4 rows of C and a strip of columns as wide as a few vector
+//   registers, vectorized by the compiler for the SIMD tier of the machine (see cpu_features.hpp)
+// - the two halves of a split along M or N write different parts of C and run as two tasks of the pool
+//   (thread_pool.hpp) while the sub-product is large enough, the halves of a split along K run one after the other
+// - no copies and no workspace: the operands are read in place, with their leading dimensions
+
+//**********************************************************************************************************************
+
+
+//! Performs C += A*B where A is M x K, B is K x N and C is M x N, all stored row-major with leading dimensions
+//! lda, ldb, ldc. numThreads <= 0 uses all the cores; small products always run on the calling thread.
+template<typename T>
+void gemm_recursive(std::size_t M, std::size_t N, std::size_t K,
+                    const T* A, std::size_t lda,
+                    const T* B, std::size_t ldb,
+                    T* C, std::size_t ldc,
+                    int numThreads = 0);
+
+
+#endif //GEMM_RECURSIVE_HPP
@@ -0,0 +1,48 @@
+#include "MatrixSparse.hpp"
+#include <cstddef>
+
+#ifndef GEMM_SPARSE_HPP
+#define GEMM_SPARSE_HPP
+
+//**********************************************************************************************************************
+
+// Sparse x dense products (SpMM) and sparse matrix-vector products (SpMV), used by mmm_sparse.
+// The body is defined in /src/mmm_sparse.cpp
+//
+// The work is proportional to the stored elements, so a pruned matrix with 10% of the weights costs about 10% of
+// the dense product. The kernels are compiled for every SIMD tier and picked at runtime (see cpu_features.hpp):
+//   - CSR x dense: row i of C is a combination of the rows of B selected by the columns of row i of A. C is
+//     processed in strips of a few vector registers that stay in registers for the whole row of A, so every
+//     element of A costs one broadcast and one FMA per register. B is read in blocks of columns that stay in L2.
+//   - dense x CSC: blocks of 16 rows of A are packed transposed, so that the same register kernel computes 16
+//     rows of a column of C at once.
+//   - CSR x vector and a few rows times CSC: every output is the dot product of a sparse line with a dense vector,
+//     read with the gathers of AVX2 / AVX-512 (scalar below).
+// The rows of the output are distributed among the threads of the pool (thread_pool.hpp) in small dynamic chunks,
+// which balances the rows with different numbers of elements. All the products accumulate (C += ...).
+
+//**********************************************************************************************************************
+
+
+//! C += A*B, where A is M x K in CSR, B is K x N and C is M x N, row-major with leading dimensions ldb, ldc.
+//! numThreads <= 0 uses all the cores; small products always run on the calling thread.
+template<typename T>
+void spmm(const MatrixCSR<T>& A, const T* B, std::size_t N, std::size_t ldb, T* C, std::size_t ldc,
+          int numThreads = 0);
+
+//! C += A*B, where A is M x K row-major with leading dimension lda, B is K x N in CSC and C is M x N: the product
+//! of the activations (one sample per row) by a sparse weight matrix
+template<typename T>
+void spmm(std::size_t M, const T* A, std::size_t lda, const MatrixCSC<T>& B, T* C, std::size_t ldc,
+          int numThreads = 0);
+
+//! y += A*x, where A is M x N in CSR, x has N elements and y has M
+template<typename T>
+void spmv(const MatrixCSR<T>& A, const T* x, T* y, int numThreads = 0);
+
+//! y += x*A, where x is a row vector of M elements, A is M x N in CSC and y has N elements
+template<typename T>
+void spmv(const T* x, const MatrixCSC<T>& A, T* y, int numThreads = 0);
+
+
+#endif //GEMM_SPARSE_HPP
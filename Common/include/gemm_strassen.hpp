@@ -0,0 +1,52 @@
+#include "autotuner.hpp"
+#include <cstddef>
+
+#ifndef GEMM_STRASSEN_HPP
+#define GEMM_STRASSEN_HPP
+
+//**********************************************************************************************************************
+
+// Strassen-Winograd fast matrix multiplication, used by mmm_strassen. The body is defined in /src/mmm_strassen.cpp
+//
+// Every level of the recursion splits A, B and C in 2 x 2 blocks and computes the product with 7 block products
+// (instead of 8) and 15 block additions, which brings the cost from O(n^3) down to O(n^2.81). The recursion stops
+// at the crossover size, below which the packed engine (gemm_packed.hpp) is faster: the crossover depends on the
+// machine and is read from the tuning file (see autotuner.hpp), 1024 when the shape was never tuned.
+//
+// - odd dimensions are peeled: the even part goes through the recursion, the last row / column / inner index are
+//   added with the packed engine
+// - the temporaries of all the levels are carved out of a single workspace allocated once per call
+// - at the top level the 7 products are computed in parallel, each one by its own thread with its own slice of
+//   the workspace, and added to the blocks of C as soon as they are ready; below the top level the recursion is
+//   serial (so at most 7 threads are used)
+//
+// The result differs from the classic product by rounding only, but the error bound grows with the number of
+// levels (each level adds sums and differences of blocks): it is meant for the very large products, not as a
+// replacement of the packed engine.
+
+//**********************************************************************************************************************
+
+
+//! Performs C += A*B where A is M x K, B is K x N and C is M x N, all stored row-major with leading dimensions
+//! lda, ldb, ldc. Crossover and threads (when numThreads <= 0) come from the tuning file.
+template<typename T>
+void gemm_strassen(std::size_t M, std::size_t N, std::size_t K,
+                   const T* A, std::size_t lda,
+                   const T* B, std::size_t ldb,
+                   T* C, std::size_t ldc,
+                   int numThreads = 0);
+
+//! Same as above with an explicit configuration: outer_tile = crossover, threads.
+//! The fields left to 0 take the default values.
+template<typename T>
+void gemm_strassen(std::size_t M, std::size_t N, std::size_t K,
+                   const T* A, std::size_t lda,
+                   const T* B, std::size_t ldb,
+                   T* C, std::size_t ldc,
+                   const TuningConfig& config);
+
+//! Number of elements of the workspace used by a product, with the given crossover and number of threads
+std::size_t strassen_workspace_size(std::size_t M, std::size_t N, std::size_t K, std::size_t crossover, int threads);
+
+
+#endif //GEMM_STRASSEN_HPP
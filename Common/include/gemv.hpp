@@ -0,0 +1,49 @@
+#include "epilogue.hpp"
+#include "transpose.hpp"
+#include "half.hpp"
+#include <cstddef>
+
+#ifndef GEMV_HPP
+#define GEMV_HPP
+
+//**********************************************************************************************************************
+
+// Matrix-vector product (GEMV) and rank-1 update (GER) kernels. The body is defined in /src/gemv.cpp
+//
+// These are the shapes of the per-sample training: the forward pass multiplies a row vector by the weight matrix,
+// the backpropagation multiplies the error by the transposed weights and accumulates the outer product h^T * dE_db
+// into the gradient. They are memory bound (every element of the matrix is used once), so instead of going through
+// the general GEMM path (packing, zero padding) the kernels stream the matrix exactly once, row by row, with the
+// SIMD instruction set selected at runtime (see cpu_features.hpp) and the rows split among the threads of the pool
+// (thread_pool.hpp).
+
+//**********************************************************************************************************************
+
+
+//! y += op(A) * x, where A is M x N stored row-major with leading dimension lda.
+//! With NoTrans x has N elements and y has M, with Trans x has M elements and y has N.
+//! numThreads <= 0 uses all the available cores; small products always run on the calling thread.
+template<typename T>
+void gemv(Transpose trans, std::size_t M, std::size_t N, const T* A, std::size_t lda, const T* x, T* y,
+          int numThreads = 0);
+
+//! Same as above followed by the epilogue (see epilogue.hpp) on y, seen as a row: y += bias, h = act(y) and
+//! dact = act'(y). Every thread applies it to its own part of y right after computing it.
+template<typename T>
+void gemv(Transpose trans, std::size_t M, std::size_t N, const T* A, std::size_t lda, const T* x, T* y,
+          const Epilogue<T>& epilogue, int numThreads = 0);
+
+//! A += alpha * x * y^T, where A is M x N stored row-major with leading dimension lda, x has M elements and y has N.
+//! The update is accumulated into A, so the per-sample gradients of a batch sum up directly in the gradient matrix.
+template<typename T>
+void ger(std::size_t M, std::size_t N, T alpha, const T* x, const T* y, T* A, std::size_t lda, int numThreads = 0);
+
+//! y += op(A) * x with the matrix stored in 16 bit (see half.hpp) and the vectors in float: the rows of A are widened
+//! to fp32 as they are loaded and the products are accumulated in fp32. Same conventions as the gemv above.
+void gemv(Transpose trans, std::size_t M, std::size_t N, const bf16_t* A, std::size_t lda, const float* x, float* y,
+          int numThreads = 0);
+void gemv(Transpose trans, std::size_t M, std::size_t N, const fp16_t* A, std::size_t lda, const float* x, float* y,
+          int numThreads = 0);
+
+
+#endif //GEMV_HPP
@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+#ifndef HALF_HPP
+#define HALF_HPP
+
+//**********************************************************************************************************************
+
+// 16 bit floating point storage types: bf16_t for bfloat16 (the upper half of an IEEE float: 8 bits of exponent,
+// 7 of mantissa) and fp16_t for float16 (IEEE binary16: 5 bits of exponent, 10 of mantissa). The names avoid the
+// bfloat16 typedef of the OpenBLAS headers. The bulk conversions are defined in /src/half.cpp
+//
+// They are storage formats only: every arithmetic operation converts them to float (implicitly), and the kernels
+// that read them (gemm_packed, gemv) accumulate in fp32, see accumulator_t. Halving the bytes per element is what
+// matters for the memory bound products, like the GEMV-shaped forward pass over large weight matrices.
+// Conversions from float round to the nearest even value.
+
+//**********************************************************************************************************************
+
+
+namespace half_detail {
+
+    inline std::uint32_t float_bits(float value){
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float bits_float(std::uint32_t bits){
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline std::uint16_t float_to_bf16(float value){
+        std::uint32_t bits = float_bits(value);
+        if ((bits & 0x7FFFFFFF) > 0x7F800000)           // NaN: keep it a (quiet) NaN
+            return static_cast<std::uint16_t>((bits >> 16) | 0x40);
+        bits += 0x7FFF + ((bits >> 16) & 1);             // round to nearest even
+        return static_cast<std::uint16_t>(bits >> 16);
+    }
+
+    inline float bf16_to_float(std::uint16_t bits){
+        return bits_float(static_cast<std::uint32_t>(bits) << 16);
+    }
+
+    inline std::uint16_t float_to_fp16(float value){
+        std::uint32_t bits = float_bits(value);
+        const std::uint32_t sign = (bits >> 16) & 0x8000;
+        bits &= 0x7FFFFFFF;
+        if (bits >= 0x7F800000)                          // inf, NaN
+            return static_cast<std::uint16_t>(sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 : 0));
+        if (bits >= 0x477FF000)                          // >= 65520 rounds to inf
+            return static_cast<std::uint16_t>(sign | 0x7C00);
+        if (bits < 0x38800000) {                         // below 2^-14: subnormal, in units of 2^-24
+            const float units = std::nearbyint(bits_float(bits) * 16777216.0f);
+            return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(units));
+        }
+        // rebias the exponent (127 -> 15) and round the mantissa (23 -> 10 bits) to nearest even, a carry out of
+        // the mantissa correctly increments the exponent
+        std::uint32_t half = (bits - 0x38000000) >> 13;
+        const std::uint32_t rest = bits & 0x1FFF;
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+            half++;
+        return static_cast<std::uint16_t>(sign | half);
+    }
+
+    inline float fp16_to_float(std::uint16_t bits){
+        const std::uint32_t sign = static_cast<std::uint32_t>(bits & 0x8000) << 16;
+        const std::uint32_t exponent = (bits >> 10) & 0x1F;
+        const std::uint32_t mantissa = bits & 0x3FF;
+        if (exponent == 0) {                             // zero, subnormal: mantissa * 2^-24
+            const float value = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+            return sign ? -value : value;
+        }
+        if (exponent == 31)                              // inf, NaN
+            return bits_float(sign | 0x7F800000 | (mantissa << 13));
+        return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+}
+
+
+struct bf16_t{
+    std::uint16_t bits = 0;
+
+    bf16_t() = default;
+    bf16_t(float value) : bits(half_detail::float_to_bf16(value)) {}
+
+    operator float() const {return half_detail::bf16_to_float(bits);}
+
+    static bf16_t from_bits(std::uint16_t bits){
+        bf16_t value;
+        value.bits = bits;
+        return value;
+    }
+};
+
+struct fp16_t{
+    std::uint16_t bits = 0;
+
+    fp16_t() = default;
+    fp16_t(float value) : bits(half_detail::float_to_fp16(value)) {}
+
+    operator float() const {return half_detail::fp16_to_float(bits);}
+
+    static fp16_t from_bits(std::uint16_t bits){
+        fp16_t value;
+        value.bits = bits;
+        return value;
+    }
+};
+
+static_assert(sizeof(bf16_t) == 2 && sizeof(fp16_t) == 2, "16 bit types must be stored in 2 bytes");
+
+
+//! Type in which the elements of T are generated, compared and accumulated: T itself for float and double,
+//! float for the 16 bit types
+template<typename T>
+struct accumulator{ using type = T; };
+
+template<>
+struct accumulator<bf16_t>{ using type = float; };
+
+template<>
+struct accumulator<fp16_t>{ using type = float; };
+
+template<typename T>
+using accumulator_t = typename accumulator<T>::type;
+
+
+//! Bulk conversions of n elements, vectorized where the CPU allows it (F16C / AVX-512 for float16, AVX512-BF16 for
+//! float -> bfloat16; bfloat16 -> float is a shift). The AVX512-BF16 conversion flushes subnormal floats to zero.
+void convert(const float* src, bf16_t* dst, std::size_t n);
+void convert(const bf16_t* src, float* dst, std::size_t n);
+void convert(const float* src, fp16_t* dst, std::size_t n);
+void convert(const fp16_t* src, float* dst, std::size_t n);
+
+
+#endif //HALF_HPP
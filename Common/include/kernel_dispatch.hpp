@@ -0,0 +1,104 @@
+#include "transpose.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef KERNEL_DISPATCH_HPP
+#define KERNEL_DISPATCH_HPP
+
+//**********************************************************************************************************************
+
+// Shape-aware choice of the kernel of mul_funct (selection 3). The body is defined in /src/kernel_dispatch.cpp
+//
+// The products of a model go from a 1 x 4 * 4 x 128 GEMV to outer products and, with batches, to large GEMMs: no
+// kernel is the fastest for all of them. For a product c += op(a) * op(b), op(a) m x n and op(b) n x nb, the
+// dispatcher plans the kernel and the number of threads among the candidates available for the shape:
+//   - Vector           the GEMV / GER kernels of gemv.hpp, when m, n or nb is 1, on one thread or on the whole pool
+//   - CacheOptimised   MatrixCaheOptimised(Trans) of matrixProd_VM_VV.hpp, on one thread
+//   - Simd             the masked SIMD kernels (matrixMultMasked_Simd), or the packed engine on one thread when an
+//                      operand is transposed; not a candidate on CPUs without SIMD extensions
+//   - Packed           the packed engine (gemm_packed.hpp) on the whole pool
+//
+// The plan comes from a cost model, time = overhead + flops / rate, whose overhead and rate are calibrated for each
+// candidate, data type, class of shape (ShapeClass) and pair of transpose flags the first time a product is planned,
+// by timing it on a small and a large product of the class (a few tens of ms). With the environment variable
+// NNET_DISPATCH=benchmark the candidates the model does not rule out are instead timed on the shape itself. The plans
+// are cached by shape, so each shape is planned once per process: Model::train plans the products of its layers when
+// the selection is 3, and keeps them.
+
+//**********************************************************************************************************************
+
+
+//! Kernels the dispatcher chooses among
+enum class MulKernel{
+    Vector = 0,
+    CacheOptimised = 1,
+    Simd = 2,
+    Packed = 3
+};
+
+std::string mul_kernel_name(MulKernel kernel);
+
+//! How the plans are made: with the calibrated cost model, or timing the candidates on the shape
+enum class DispatchMode{
+    CostModel = 0,
+    Benchmark = 1
+};
+
+//! Benchmark if $NNET_DISPATCH is "benchmark", CostModel otherwise
+DispatchMode dispatch_mode();
+
+//! Kinds of shapes the cost model is calibrated on: a row vector times a matrix (m = 1), an outer product (n = 1),
+//! a matrix times a column vector (nb = 1), any other product
+enum class ShapeClass{
+    Matrix = 0,
+    Row = 1,
+    Outer = 2,
+    Column = 3
+};
+
+ShapeClass shape_class(std::size_t m, std::size_t n, std::size_t nb);
+
+//! Kernel and number of threads of a product, time_us is the predicted (or measured) time
+struct MulPlan{
+    MulKernel kernel = MulKernel::CacheOptimised;
+    int threads = 1;
+    double time_us = 0;
+};
+
+//! Calibrated cost of a candidate: time_us = overhead_us + flops / flops_per_us
+struct KernelCost{
+    double overhead_us = 0;
+    double flops_per_us = 1;
+};
+
+//! The candidates for the shape (time_us not set), the same for every pair of transpose flags
+template<typename T>
+std::vector<MulPlan> mul_candidates(std::size_t m, std::size_t n, std::size_t nb);
+
+//! Calibrated cost of the candidate (kernel, threads) on the shapes of the class with the transpose flags, measured
+//! at the first call for the data type
+template<typename T>
+KernelCost kernel_cost(const MulPlan& candidate, ShapeClass shape, Transpose transA, Transpose transB);
+
+//! Plans the product without looking at the cache
+template<typename T>
+MulPlan plan_product(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB,
+                     DispatchMode mode = dispatch_mode());
+
+//! The plan of the shape, planned with dispatch_mode() at the first call and cached
+template<typename T>
+MulPlan product_plan(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB);
+
+//! c += op(a) * op(b) with the GEMV / GER kernels when m, n or nb is 1, returns false (nothing done) otherwise
+template<typename T>
+bool mul_vector(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c,
+                std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB, int numThreads = 0);
+
+//! c += op(a) * op(b) with the kernel and the threads of plan, op(a) m x n and op(b) n x nb, stored as in transpose.hpp
+template<typename T>
+void run_product(const MulPlan& plan, const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c,
+                 std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB);
+
+
+#endif //KERNEL_DISPATCH_HPP
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cstddef>
+
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+//**********************************************************************************************************************
+
+// Storage orders of the elements of a MatrixFlat. The conversions between them and the products of matrices in any
+// of them are in matrix_layout.hpp.
+//
+//   - RowMajor  element (i, j) at i * cols + j, the default and the order every kernel of the library reads
+//   - ColMajor  element (i, j) at j * rows + i: the storage of the transpose, what the kernels that want the columns
+//               of B (MatrixBTransposeOptimised, matrixMultTransposeOpt_Avx) read
+//   - Tiled     the matrix is cut in layout_tile x layout_tile tiles, stored one after the other by rows of tiles,
+//               each tile contiguous and row-major inside. The tiles of the last row and column are cut to the
+//               matrix, so the matrix takes rows * cols elements as in the other layouts. A tile of a large matrix
+//               is a few consecutive pages instead of layout_tile rows far apart.
+//
+// It is header only, as transpose.hpp.
+
+//**********************************************************************************************************************
+
+
+enum class Layout{
+    RowMajor = 0,
+    ColMajor = 1,
+    Tiled = 2
+};
+
+//! Side of the tiles of the Tiled layout
+constexpr std::size_t layout_tile = 64;
+
+inline const char* layout_name(Layout layout){
+    switch (layout) {
+        case Layout::RowMajor: return "row-major";
+        case Layout::ColMajor: return "column-major";
+        case Layout::Tiled:    return "tiled";
+    }
+    return "unknown";
+}
+
+//! Position of element (i, j) of a rows x cols matrix stored in layout
+inline std::size_t layout_index(Layout layout, std::size_t i, std::size_t j, std::size_t rows, std::size_t cols){
+    switch (layout) {
+        case Layout::RowMajor:
+            return i * cols + j;
+        case Layout::ColMajor:
+            return j * rows + i;
+        case Layout::Tiled: {
+            // the rows of tiles before, the tiles before in this row of tiles (all tile_rows high), the element
+            const std::size_t i0 = i - i % layout_tile, j0 = j - j % layout_tile;
+            const std::size_t tile_rows = std::min(layout_tile, rows - i0), tile_cols = std::min(layout_tile, cols - j0);
+            return i0 * cols + j0 * tile_rows + (i - i0) * tile_cols + (j - j0);
+        }
+    }
+    return 0;
+}
+
+
+#endif //LAYOUT_HPP
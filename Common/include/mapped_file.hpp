@@ -0,0 +1,169 @@
+#include "half.hpp"
+#include "layout.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+//**********************************************************************************************************************
+
+// Memory-mapped files, the file storage of MatrixFlat (MatrixFlat::map and MatrixFlat::save).
+//
+// A mapped matrix is not read at all when it is opened: the kernel pages the file in when the elements are first
+// touched, and keeps the pages in the page cache, so a process that restarts finds the weights already in memory and
+// several processes mapping the same file read-only share one copy of it. Larger than RAM files work too, the pages
+// that are not used are dropped and read again when needed.
+// The mapping can be populated up front (MAP_POPULATE, the whole file is read at open: no page faults during the
+// first products) and advised (madvise) of the access pattern, sequential for a pass over a dataset, random for the
+// lookups of an embedding.
+// The matrix files start with a MatrixFileHeader of 64 bytes (so the elements are aligned to a cache line), followed
+// by the rows * cols elements in the layout recorded in the header (layout.hpp), row-major for the older files. Files without a header (raw dumps) can be mapped with an offset.
+// It is header only, as numa_allocator.hpp, so that the programs that just use MatrixFlat do not need to link anything.
+
+//**********************************************************************************************************************
+
+
+//! Access to a mapped file
+enum class MapMode{
+    ReadOnly,       // PROT_READ: writing an element is an error (SIGSEGV). Pages shared with the other processes
+    CopyOnWrite,    // MAP_PRIVATE: the pages written are copied for this process, the file does not change
+    ReadWrite       // MAP_SHARED: the writes go to the file
+};
+
+//! Expected access pattern, passed to madvise
+enum class MapAdvice{ Normal, Sequential, Random, WillNeed };
+
+struct MapOptions{
+    MapMode mode = MapMode::ReadOnly;
+    MapAdvice advice = MapAdvice::Normal;
+    bool populate = false;      // read the whole file when it is mapped (MAP_POPULATE)
+};
+
+
+//! A file mapped in memory, unmapped by the destructor
+class MappedFile{
+    public:
+        //! Maps the whole file. Returns null, with an error message, if the file cannot be opened or mapped.
+        static std::shared_ptr<MappedFile> open(const std::string& path, const MapOptions& options = {}){
+            const int fd = ::open(path.c_str(), options.mode == MapMode::ReadWrite ? O_RDWR : O_RDONLY);
+            if (fd < 0) {
+                std::cout<<"Error: cannot open "<<path<<": "<<std::strerror(errno)<<std::endl;
+                return nullptr;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0) {
+                std::cout<<"Error: "<<path<<" is empty or cannot be read"<<std::endl;
+                ::close(fd);
+                return nullptr;
+            }
+            const std::size_t bytes = static_cast<std::size_t>(st.st_size);
+            const int prot = options.mode == MapMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+            int flags = options.mode == MapMode::ReadWrite ? MAP_SHARED : MAP_PRIVATE;
+            if (options.populate)
+                flags |= MAP_POPULATE;
+            void* p = mmap(nullptr, bytes, prot, flags, fd, 0);
+            ::close(fd);    // the mapping keeps its own reference to the file
+            if (p == MAP_FAILED) {
+                std::cout<<"Error: cannot map "<<path<<": "<<std::strerror(errno)<<std::endl;
+                return nullptr;
+            }
+            std::shared_ptr<MappedFile> file(new MappedFile(p, bytes, options.mode));
+            file->advise(options.advice);
+            return file;
+        }
+
+        const void* data() const {return m_data;}
+        void* data() {return m_data;}
+        std::size_t size() const {return m_size;}
+        MapMode mode() const {return m_mode;}
+
+        //! Tells the kernel how the bytes [offset, offset + length) will be read (all the file when length is 0)
+        void advise(MapAdvice advice, std::size_t offset = 0, std::size_t length = 0) const {
+            int flag = MADV_NORMAL;
+            switch (advice) {
+                case MapAdvice::Sequential: flag = MADV_SEQUENTIAL; break;
+                case MapAdvice::Random:     flag = MADV_RANDOM;     break;
+                case MapAdvice::WillNeed:   flag = MADV_WILLNEED;   break;
+                default: break;
+            }
+            // madvise wants a page aligned start
+            const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            const std::size_t begin = offset / page * page;
+            const std::size_t end = length == 0 ? m_size : std::min(m_size, offset + length);
+            if (begin < end)
+                madvise(static_cast<char*>(m_data) + begin, end - begin, flag);
+        }
+
+        //! Writes the modified pages of a ReadWrite mapping to the file
+        void sync() const {
+            if (m_mode == MapMode::ReadWrite)
+                msync(m_data, m_size, MS_SYNC);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile(){munmap(m_data, m_size);}
+
+    private:
+        MappedFile(void* data, std::size_t size, MapMode mode): m_data(data), m_size(size), m_mode(mode) {}
+
+        void* m_data;
+        std::size_t m_size;
+        MapMode m_mode;
+};
+
+
+//! Type of the elements of a matrix file
+template<typename T> constexpr std::uint32_t matrix_file_type();
+template<> constexpr std::uint32_t matrix_file_type<float>(){return 1;}
+template<> constexpr std::uint32_t matrix_file_type<double>(){return 2;}
+template<> constexpr std::uint32_t matrix_file_type<bf16_t>(){return 3;}
+template<> constexpr std::uint32_t matrix_file_type<fp16_t>(){return 4;}
+
+//! First 64 bytes of a matrix file
+struct MatrixFileHeader{
+    char magic[8] = {'N', 'N', 'E', 'T', 'M', 'A', 'T', '1'};
+    std::uint32_t type = 0;             // matrix_file_type of the elements
+    std::uint32_t element_size = 0;
+    std::uint64_t rows = 0, cols = 0;
+    std::uint32_t layout = 0;           // Layout of the elements, 0 (RowMajor) in the files written before it
+    char padding[28] = {};
+
+    //! True if the header is valid for a matrix of T and the file of the given size holds all its elements
+    template<typename T>
+    bool check(std::size_t file_size, const std::string& path) const {
+        if (std::memcmp(magic, MatrixFileHeader().magic, sizeof(magic)) != 0) {
+            std::cout<<"Error: "<<path<<" is not a matrix file"<<std::endl;
+            return false;
+        }
+        if (type != matrix_file_type<T>() || element_size != sizeof(T)) {
+            std::cout<<"Error: "<<path<<" holds elements of another type"<<std::endl;
+            return false;
+        }
+        if (layout > static_cast<std::uint32_t>(Layout::Tiled)) {
+            std::cout<<"Error: "<<path<<" holds the elements in an unknown layout"<<std::endl;
+            return false;
+        }
+        if (file_size < sizeof(MatrixFileHeader) + rows * cols * sizeof(T)) {
+            std::cout<<"Error: "<<path<<" is shorter than a "<<rows<<"X"<<cols<<" matrix"<<std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "the elements of a matrix file start at byte 64");
+
+
+#endif //MAPPED_FILE_HPP
@@ -1,6 +1,7 @@
 #ifndef MATRIXPROD_AVX_H
 #define MATRIXPROD_AVX_H
 
+#include "transpose.hpp"
 #include <immintrin.h> //intrinsics intel per SIMD
 #include <vector>
 
@@ -20,6 +21,62 @@ int matrixMult_Avx(const std::vector<T>& a, const std::vector<T>& b,std::vector<
 
 ////************************************************
 
+//Same as matrixMult_Avx on 128 bit (SSE4) and 512 bit (AVX-512) registers.
+//matrixMult_Simd checks at runtime which instruction sets are available and calls the widest version,
+//it returns 0 if the CPU has no SIMD extension supported by these kernels.
+//The number of columns of b must be a multiple of matrixMult_SimdWidth<T>() (16 floats, 8 doubles).
+
+//***********************************************
+
+template<typename T>
+int matrixMult_Sse(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+int matrixMult_Avx512(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+int matrixMult_Simd(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+constexpr size_t matrixMult_SimdWidth(){ return 64 / sizeof(T); }
+
+////************************************************
+
+//Same algorithm as matrixMult_Simd, but for any shape and in place: c += a*b with a ma x na, b na x nb and c ma x nb,
+//read and written directly in the caller's vectors (no zero padding, no copies).
+//The last columns of every row, which do not fill a vector register, are loaded and stored with a mask
+//(_mm256_maskload / _mm256_maskstore on AVX2, opmask registers on AVX-512), so nothing outside the matrices is touched.
+//SSE4 has no masked loads: its version finishes the rows with scalar code.
+//matrixMultMasked_Simd returns 0 if the CPU has no SIMD extension supported by these kernels.
+
+//***********************************************
+
+template<typename T>
+int matrixMultMasked_Sse(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+int matrixMultMasked_Avx(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+int matrixMultMasked_Avx512(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+int matrixMultMasked_Simd(const std::vector<T>& a, const std::vector<T>& b,std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+////************************************************
+
+//Same kernels as matrixMultMasked_Simd on raw pointers with leading dimensions: c += op(a)*b with op(a) ma x na,
+//b na x nb and c ma x nb, each row of a matrix ld elements after the previous one, so a sub-block of a larger matrix
+//is multiplied in place. A transposed a (stored na x ma) is read through its strides, b is always read by rows.
+//It is the "avx" provider of gemm.hpp. Returns 0 if the CPU has no SIMD extension supported by these kernels.
+
+//***********************************************
+
+template<typename T>
+int matrixMultStrided_Simd(Transpose transA, size_t ma, size_t na, size_t nb, const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc);
+
+////************************************************
+
 //Take as input 3 Matrix saved as one dimensional std::vector: a mxq,the transpose of b qxn, and a reference to an empty
 //std::vector c where the function will store the result of the product a*b, plus a reference to a int64_t that returns
 // the time spent for the function
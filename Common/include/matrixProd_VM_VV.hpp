@@ -1,4 +1,6 @@
 #include "matrix_VM_VV.hpp"
+#include "transpose.hpp"
+#include "matrix_transpose.hpp"
 #include<chrono>
 #ifndef MATRIXPROD_VM_VV_H
 #define MATRIXPROD_VM_VV_H
@@ -60,6 +62,30 @@ MatrixVect<T> matrixProdVect(MatrixVect<T>& a, MatrixVect<T>& b, int64_t& dt_01)
 }
 
 
+//************************************************
+
+//Generic c += a*b on any matrices of the MatrixSkltn interface (MatrixFlat, MatrixView, Matrix, ...), written with
+//operator(). The access policy of every matrix is applied at compile time: on unchecked views (see MatrixView.hpp)
+//the accesses are inlined and the loops compile as the ones on raw pointers
+
+//***********************************************
+
+template<typename TA, typename DA, typename AA, typename TB, typename DB, typename AB, typename TC, typename DC, typename AC>
+void matrixProd(const MatrixSkltn<TA, DA, AA>& a, const MatrixSkltn<TB, DB, AB>& b, MatrixSkltn<TC, DC, AC>& c){
+  if(a.ncols() != b.nrows() || a.nrows() != c.nrows() || b.ncols() != c.ncols()){
+    std::cout << "matrici non moltiplicabili: errore nel numero righe-colonne" << std::endl;
+    return;
+  }
+  for(size_t i = 0; i < a.nrows(); i++){
+    for(size_t r = 0; r < a.ncols(); r++){
+      const TC air = a(i,r);
+      for(size_t j = 0; j < b.ncols(); j++){
+        c(i,j) += air*b(r,j);
+      }
+    }
+  }
+}
+
 //************************************************
 
 //Take as input 3 Matrix saved as one dimensional std::vector: a mxq, b qxn, and a reference to an empty
@@ -154,6 +180,64 @@ int MatrixBTransposeOptimised(std::vector<T>& a, std::vector<T>& b_transpose, st
   return 304;
 }
 
+//************************************************
+
+//Take as input 3 Matrix saved as one dimensional std::vector and computes c += op(a)*op(b), where op(a) is mxn and
+//op(b) is nxnb (see transpose.hpp): a transposed a is stored nxm and a transposed b is stored nbxn, both are read in
+//place without building the transpose. The first one is the naive version (reference), the second one chooses for
+//every combination of flags the loop order whose innermost loop runs on contiguous memory
+
+//***********************************************
+
+template<typename T>
+int MatrixNaiveTrans(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c, size_t m, size_t n,  size_t nb,
+                     Transpose transA, Transpose transB, int64_t& dt_01){
+  const auto t0 = std::chrono::high_resolution_clock::now();
+  const size_t rsa = transA == Trans ? 1 : n, csa = transA == Trans ? m : 1;
+  const size_t rsb = transB == Trans ? 1 : nb, csb = transB == Trans ? n : 1;
+  for (size_t row = 0; row < m; row++) {
+    for (size_t col = 0; col < nb; col++) {
+      for (size_t inner = 0; inner < n; inner++) {
+        c[row * nb + col] +=
+            a[row * rsa + inner * csa] * b[inner * rsb + col * csb];
+} } }
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+  return 309;
+}
+
+template<typename T>
+int MatrixCaheOptimisedTrans(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c, size_t m, size_t n,  size_t nb,
+                             Transpose transA, Transpose transB, int64_t& dt_01){
+  const auto t0 = std::chrono::high_resolution_clock::now();
+  if (transA == NoTrans && transB == NoTrans) {
+    //rows of b and c are contiguous
+    for (size_t row = 0; row < m; row++)
+      for (size_t inner = 0; inner < n; inner++)
+        for (size_t col = 0; col < nb; col++)
+          c[row * nb + col] += a[row * n + inner] * b[inner * nb + col];
+  } else if (transA == Trans && transB == NoTrans) {
+    //a^T b: the rows of the stored a are the columns of op(a), so the outer loop runs on them
+    for (size_t inner = 0; inner < n; inner++)
+      for (size_t row = 0; row < m; row++)
+        for (size_t col = 0; col < nb; col++)
+          c[row * nb + col] += a[inner * m + row] * b[inner * nb + col];
+  } else {
+    //b^T: every element of c is a dot product between a row of the stored b and a row (or column) of a
+    const size_t rsa = transA == Trans ? 1 : n, csa = transA == Trans ? m : 1;
+    for (size_t row = 0; row < m; row++)
+      for (size_t col = 0; col < nb; col++) {
+        T acc = 0;
+        for (size_t inner = 0; inner < n; inner++)
+          acc += a[row * rsa + inner * csa] * b[col * n + inner];
+        c[row * nb + col] += acc;
+      }
+  }
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+  return 310;
+}
+
 //*********************************************************************
 
 //this function take a Matrix mxn savede in a one dimensions std::vector and his and return his transpose
@@ -163,13 +247,10 @@ int MatrixBTransposeOptimised(std::vector<T>& a, std::vector<T>& b_transpose, st
 
 template<typename T>
 std::vector<T> MatrixTranspose( const std::vector<T>& a, size_t m, size_t n){
+  // cache tiles of 8x8 register blocks, see matrix_transpose.hpp
   std::vector<T> a_transpose;
   a_transpose.resize(m*n);
-  for(size_t i = 0; i<m; i++){
-    for(size_t j = 0; j<n; j++){
-      a_transpose[j*m+i] = a[i*n+j];
-    }
-  }
+  transpose(m, n, a.data(), n, a_transpose.data(), m);
   return a_transpose;
 }
 
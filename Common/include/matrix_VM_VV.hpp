@@ -9,30 +9,30 @@
 
 
 
+//! The matrices below grow when an element out of them is written: no index check (UncheckedAccess)
 template<typename T>
-class Matrix : public MatrixSkltn<T> {
+class Matrix : public MatrixSkltn<T, Matrix<T>, UncheckedAccess> {
+    friend class MatrixSkltn<T, Matrix<T>, UncheckedAccess>;
 public:
-    virtual T& operator()(size_t i, size_t j) override {
+    T& element(size_t i, size_t j) {
     if (m_data.size() < i + 1) {
       m_data.resize(i + 1);
-      MatrixSkltn<T>::n_rows = i + 1;
+      this->n_rows = i + 1;
     }
     const auto it = m_data[i].find(j);
     if (it == m_data[i].end()) {
-      MatrixSkltn<T>::n_cols = std::max(MatrixSkltn<T>::n_cols, j + 1);
-      MatrixSkltn<T>::n_nzrs++;
+      this->n_cols = std::max(this->n_cols, j + 1);
+      this->n_nzrs++;
       return (*m_data[i].emplace(j, 0).first).second;
     }
     return (*it).second;
   }
-  virtual const T& operator()(size_t i, size_t j) const override {
+  const T& element(size_t i, size_t j) const {
     return m_data[i].at(j);
   }
 
-    virtual ~Matrix() override = default;
-
 protected:
-    virtual void _print(std::ostream &os) const{
+    void _print(std::ostream &os) const{
         for (size_t i = 0; i < m_data.size(); ++i) {
                 for (const auto& [j, v] : m_data[i]) {
                     os <<std::fixed << std::setprecision(2) << v << " ";
@@ -47,31 +47,30 @@ private:
 };
 
 template<typename T>
-class MatrixVect : public MatrixSkltn<T> {
+class MatrixVect : public MatrixSkltn<T, MatrixVect<T>, UncheckedAccess> {
+    friend class MatrixSkltn<T, MatrixVect<T>, UncheckedAccess>;
   public:
 
-    MatrixVect(std::size_t rows, std::size_t cols, std::size_t nnz) : MatrixSkltn<T>(rows, cols, nnz){};
+    MatrixVect(std::size_t rows, std::size_t cols, std::size_t nnz) : MatrixSkltn<T, MatrixVect<T>, UncheckedAccess>(rows, cols, nnz){};
 
-    virtual T& operator()(size_t i, size_t j) override {
+    T& element(size_t i, size_t j) {
     if (m_data.size() < i + 1) {
       m_data.resize(i + 1);
-      MatrixSkltn<T>::n_rows = i + 1;
+      this->n_rows = i + 1;
     }
     if (m_data[i].size() < j + 1) {
       m_data[i].resize(j+1);
-      MatrixSkltn<T>::n_cols = j+1;
-      MatrixSkltn<T>::n_nzrs++;
+      this->n_cols = j+1;
+      this->n_nzrs++;
     }
     return m_data[i][j];
   }
-  virtual const T& operator()(size_t i, size_t j) const override {
+  const T& element(size_t i, size_t j) const {
     return m_data[i].at(j);
   }
 
-  virtual ~MatrixVect() override = default;
-
   protected:
-    virtual void _print(std::ostream &os) const{
+    void _print(std::ostream &os) const{
         for (size_t i = 0; i < m_data.size(); ++i) {
                 for (size_t j = 0; j < m_data[i].size(); ++j) {
                     os <<std::fixed << std::setprecision(2) << m_data[i][j] << " ";
@@ -0,0 +1,42 @@
+#include "MatrixFlat.hpp"
+#include "layout.hpp"
+#include <cstddef>
+
+#ifndef MATRIX_LAYOUT_HPP
+#define MATRIX_LAYOUT_HPP
+
+//**********************************************************************************************************************
+
+// Conversions between the layouts of layout.hpp. The body is defined in /src/matrix_layout.cpp
+//
+// Row-major <-> column-major is a transpose of the storage (the blocked kernels of matrix_transpose.hpp), to and from
+// Tiled the tiles are copied row by row (or transposed, from and to column-major), one tile per task of the pool.
+// The products of matrices in any layout are computed by gemm (gemm.hpp): a column-major operand is read in place as
+// a transposed row-major one, and the tiled matrices are multiplied tile by tile.
+
+//**********************************************************************************************************************
+
+
+//! Stores the rows x cols matrix held at src in layout from into dst, in layout to (dst != src).
+//! numThreads <= 0 uses all the cores.
+template<typename T>
+void convert_layout(std::size_t rows, std::size_t cols, Layout from, const T* src, Layout to, T* dst,
+                    int numThreads = 0);
+
+//! A copy of A stored in layout
+template<typename T>
+MatrixFlat<T> to_layout(const MatrixFlat<T>& A, Layout layout, int numThreads = 0){
+    MatrixFlat<T> B(A.nrows(), A.ncols(), layout);
+    convert_layout(A.nrows(), A.ncols(), A.layout(), A.get_ptr(), layout, B.get_ptr(), numThreads);
+    return B;
+}
+
+//! Stores A in layout, through a copy: A keeps its elements, in a different order
+template<typename T>
+void set_layout(MatrixFlat<T>& A, Layout layout, int numThreads = 0){
+    if (A.layout() != layout)
+        A = to_layout(A, layout, numThreads);
+}
+
+
+#endif //MATRIX_LAYOUT_HPP
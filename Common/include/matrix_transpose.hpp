@@ -0,0 +1,55 @@
+#include "MatrixFlat.hpp"
+#include <cstddef>
+#include <utility>
+
+#ifndef MATRIX_TRANSPOSE_HPP
+#define MATRIX_TRANSPOSE_HPP
+
+//**********************************************************************************************************************
+
+// Matrix transpose kernels. The body is defined in /src/matrix_transpose.cpp
+//
+// Walking the source by columns (the plain double loop) makes every store, or every load, jump a whole row ahead:
+// on large matrices each element costs a cache line and often a TLB entry. Here the matrix is cut in 64 x 64 cache
+// tiles, the source and the destination of a tile fit in L1 together, and each tile is transposed in 8 x 8 blocks
+// held in registers (the unpack / shuffle / permute sequence on AVX, four 4 x 4 blocks for double), chosen at run
+// time as the other SIMD kernels (see cpu_features.hpp). The tiles are distributed among the threads of the pool.
+//
+// With streaming the out-of-place version writes the transposed rows with non-temporal stores, which do not bring
+// the destination in cache: worth it when the result is larger than the last level cache and is not read right
+// away. It needs a destination aligned to 32 bytes with rows of a multiple of 32 bytes, otherwise it is ignored.
+
+//**********************************************************************************************************************
+
+
+//! B = A^T, where A is rows x cols with leading dimension lda and B is cols x rows with leading dimension ldb.
+//! numThreads <= 0 uses all the cores; small matrices are transposed by the calling thread.
+template<typename T>
+void transpose(std::size_t rows, std::size_t cols, const T* A, std::size_t lda, T* B, std::size_t ldb,
+               int numThreads = 0, bool streaming = false);
+
+//! A = A^T in place. A square matrix is transposed by swapping the tiles across the diagonal and can have any
+//! leading dimension; a rectangular one must be contiguous (lda = cols), it becomes cols x rows and goes through a
+//! temporary copy.
+template<typename T>
+void transpose_inplace(std::size_t rows, std::size_t cols, T* A, std::size_t lda, int numThreads = 0);
+
+//! A^T in a new matrix
+template<typename T>
+MatrixFlat<T> transposed(const MatrixFlat<T>& A, int numThreads = 0, bool streaming = false){
+    MatrixFlat<T> B(A.ncols(), A.nrows());
+    transpose(A.nrows(), A.ncols(), A.get_ptr(), A.ncols(), B.get_ptr(), B.ncols(), numThreads, streaming);
+    return B;
+}
+
+//! A = A^T: in place when A is square, otherwise A is replaced by its transpose
+template<typename T>
+void transpose_inplace(MatrixFlat<T>& A, int numThreads = 0){
+    if (A.nrows() == A.ncols())
+        transpose_inplace(A.nrows(), A.ncols(), A.get_ptr(), A.ncols(), numThreads);
+    else
+        A = transposed(A, numThreads);
+}
+
+
+#endif //MATRIX_TRANSPOSE_HPP
@@ -1,4 +1,6 @@
 #include "MatrixFlat.hpp"
+#include "MatrixSparse.hpp"
+#include "transpose.hpp"
 #include <string>
 
 #ifndef MMM_HPP
@@ -10,6 +12,11 @@ void mmm_naive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixF
 
 void mmm_naive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time);
 
+//! Reference C += op(A)*op(B), see transpose.hpp
+void mmm_naive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, Transpose transA, Transpose transB);
+
+void mmm_naive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, Transpose transA, Transpose transB);
+
 void mmm_naive_RegisterAcc(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time);
 
 void mmm_naive_RegisterAcc(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time);
@@ -18,6 +25,7 @@ void mmm_loopI(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixF
 
 void mmm_loopI(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time);
 
+//! tileSize <= 0 uses the inner tile found by the Autotuner (see autotuner.hpp)
 void mmm_tiling(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int tileSize);
 
 void mmm_tiling(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int tileSize);
@@ -25,11 +33,70 @@ void mmm_tiling(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFl
 void appendCSVRow(const std::vector<std::string>& rowData, bool newline = false);
 
 
+//! Outer tiles and threads come from the tuning file (256 x 256 tiles on all the threads of the pool, see
+//! thread_pool.hpp, for shapes never tuned)
 void mmm_multiT(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int tileSize);
 void mmm_multiT(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int tileSize);
 
-void mmm_gmultiT(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int tileSize, int numThreads = 8);
-void mmm_gmultiT(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int tileSize, int numThreads = 8);
+//! Outer tiles come from the tuning file (rows/4 for shapes never tuned), tileSize <= 0 and numThreads <= 0 use
+//! the tuned values as well
+void mmm_gmultiT(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int tileSize, int numThreads = 0);
+void mmm_gmultiT(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int tileSize, int numThreads = 0);
+
+//! Parallel kernel shared by mmm_multiT and mmm_gmultiT, without printing nor timing (it is what the Autotuner
+//! benchmarks): C is split in tileSize x tileSize tiles distributed among numThreads threads (numThreads <= 0 uses
+//! all of them), the inner dimension is tiled by inner_tileSize
+template<typename T>
+void mmm_tiled_kernel(const MatrixFlat<T>& A, const MatrixFlat<T>& B, MatrixFlat<T>& C, int tileSize, int inner_tileSize, int numThreads);
+
+//! Packed-panel GEMM with register-blocked micro-kernels (see gemm_packed.hpp), works for any M, N, K.
+//! numThreads <= 0 uses the tuned number of threads (all the cores for shapes never tuned).
+//! The body is defined in /src/mmm_packed.cpp
+void mmm_packed(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+void mmm_packed(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads = 0);
+
+//! C += op(A)*op(B) with the transposed operands read in place, see transpose.hpp
+void mmm_packed(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, Transpose transA, Transpose transB, int numThreads = 0);
+void mmm_packed(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, Transpose transA, Transpose transB, int numThreads = 0);
+
+//! 16 bit operands (see half.hpp), converted while packing and accumulated in fp32
+void mmm_packed(const MatrixFlat<bf16_t>& A, const MatrixFlat<bf16_t>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+void mmm_packed(const MatrixFlat<fp16_t>& A, const MatrixFlat<fp16_t>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+
+//! Strassen-Winograd recursion down to a tuned crossover size, then the packed engine (see gemm_strassen.hpp),
+//! for very large products. numThreads <= 0 uses the tuned number of threads (at most 7 are used).
+//! The body is defined in /src/mmm_strassen.cpp
+void mmm_strassen(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+void mmm_strassen(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads = 0);
+
+//! Cache-oblivious product (see gemm_recursive.hpp): splits the largest of M, N and K in half down to a small
+//! register-blocked base case, with no tile size to tune. The halves along M and N run in parallel.
+//! numThreads <= 0 uses all the cores. The body is defined in /src/mmm_recursive.cpp
+void mmm_recursive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+void mmm_recursive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads = 0);
+
+//! C = A*B on matrix files that do not fit in memory (see gemm_out_of_core.hpp): the panels of A and B are read
+//! while the previous ones are multiplied, the type comes from the header of A. memory_budget is in bytes (0 uses a
+//! quarter of the physical memory). The body is defined in /src/mmm_out_of_core.cpp
+void mmm_out_of_core(const std::string& A, const std::string& B, const std::string& C, int64_t& time,
+                     std::size_t memory_budget = 0, int numThreads = 0);
+
+//! C += A*B with the GEMM provider named provider ("packed", "avx", "naive", "blas" when OpenBLAS is linked, see
+//! gemm.hpp), to compare the backends in one program. The body is defined in /src/gemm.cpp
+void mmm_gemm(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, const std::string& provider);
+void mmm_gemm(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, const std::string& provider);
+
+//! C[p] += A[p]*B[p] for every p: many independent small products in one call (see gemm_batched.hpp), the products
+//! are distributed among the threads. numThreads <= 0 uses all the cores. The body is defined in /src/mmm_batched.cpp
+void mmm_batched(const std::vector<MatrixFlat<float>>& A, const std::vector<MatrixFlat<float>>& B, std::vector<MatrixFlat<float>>& C, int64_t& time, int numThreads = 0);
+void mmm_batched(const std::vector<MatrixFlat<double>>& A, const std::vector<MatrixFlat<double>>& B, std::vector<MatrixFlat<double>>& C, int64_t& time, int numThreads = 0);
+
+//! C += A*B with one sparse operand (see MatrixSparse.hpp and gemm_sparse.hpp): the time is proportional to its
+//! stored elements. numThreads <= 0 uses all the cores. The body is defined in /src/mmm_sparse.cpp
+void mmm_sparse(const MatrixCSR<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+void mmm_sparse(const MatrixCSR<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads = 0);
+void mmm_sparse(const MatrixFlat<float>& A, const MatrixCSC<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads = 0);
+void mmm_sparse(const MatrixFlat<double>& A, const MatrixCSC<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads = 0);
 
 
 #endif
\ No newline at end of file
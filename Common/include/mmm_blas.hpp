@@ -1,12 +1,21 @@
 #include "MatrixFlat.hpp"
+#include "transpose.hpp"
 //#include <cblas-openblas.h>
 #include <chrono>
 
 #ifndef MMM_BLAS_HPP
 #define MMM_BLAS_HPP
 
-void mmm_blas(MatrixFlat<float>& A, MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time);
+//! The programs that link mmm_blas.cpp also get the "blas" provider of gemm (see gemm.hpp): OpenBLAS with alpha,
+//! beta and the leading dimensions, selectable by name as the internal kernels
 
-void mmm_blas(MatrixFlat<double>& A, MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time);
+void mmm_blas(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time);
+
+void mmm_blas(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time);
+
+//! C = op(A)*op(B), see transpose.hpp
+void mmm_blas(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, Transpose transA, Transpose transB);
+
+void mmm_blas(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, Transpose transA, Transpose transB);
 
 #endif //MMM_BLAS_HPP
\ No newline at end of file
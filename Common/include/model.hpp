@@ -1,7 +1,13 @@
 #ifndef ACTIVATION_MODEL_HPP
 #define ACTIVATION_MODEL_HPP
 
+#include "block_sparse.hpp"
+#include "epilogue.hpp"
+#include "gemm.hpp"
+#include "kernel_dispatch.hpp"
 #include "network.hpp"
+#include "quantized.hpp"
+#include <array>
 #include <fstream>
 
 //*********************************************************************************************************************
@@ -47,17 +53,42 @@ class Model{
     }
     void printAllWeightsToFile() const ;
     //@note: making a prediction should not change the input***********
-        //re-@note: in the way we build the function the input is resized to add the bias constant, so is not possible to declare it const
-    void predict(std::vector<T>& input, const int& selection); //this version need to be called only after the resizing of the weights
+        //re-@note: the input is no longer resized to add the bias constant, the bias is added by the epilogue of the products (see epilogue.hpp)
+    void predict(std::vector<T>& input, const int& selection); //this version also fills dAct_z for the backPropagation
     void predict(std::vector<T>& input, const int& selection, const int flag);
+    //quantized inference: int8 copy of the weights, see quantized.hpp
+    void quantizeWeights(QuantGranularity granularity = QuantGranularity::PerChannel);
+    void predictQuantized(const std::vector<T>& input);
+    float evaluateQuantized();
+    //block pruning of the weights between hidden layers, see block_sparse.hpp: the pruned layers are trained and
+    //evaluated on the blocks left
+    void pruneWeights(float sparsity, int block_rows = 4, int block_cols = 8);
     void backPropagation(const std::vector<T>& input, std::vector<T>& dE_dy, const int& selection);
+    //selection is the kernel of the dense products, as in mul_funct: 3 plans the products of the layers (see kernel_dispatch.hpp)
     void train(int& selection);
-    void extendMatrix();
-    void reduceMatrix();
+    //products of the dense layers through gemm (see gemm.hpp) with the provider named name ("packed", "avx", "naive", ...),
+    //"" goes back to the kernels selected by matrix_mul_optimisation. buildModel takes it from NNET_GEMM when it is set,
+    //so the backend can be changed without recompiling
+    bool setGemmProvider(const std::string& name){
+        if(!name.empty() && !find_gemm_provider(name)){
+            std::cout << "Error: no GEMM provider named " << name << std::endl;
+            return false;
+        }
+        gemm_backend = name;
+        return true;
+    }
+    const std::string& getGemmProvider() const {return gemm_backend;}
     void initialiseVector(std::vector<std::vector<T>>& default_weights, const std::string& weights_model);
     
     Input<T> getInput() const {return model_input;}
     Output<T> getOutput() const {return model_output;}
+    //trained parameters of the product l (layers + 1 of them): dense weights (in x out, without bias), bias and activation,
+    //to copy the model in a ModelFixed (see model_fixed.hpp)
+    int getNumProducts() const {return weights.size();}
+    std::vector<int> getWeightsShape(int l) const {return weights_shape[l];}
+    std::vector<T> getWeights(int l) const {return denseWeights(weights[l], l);}
+    std::vector<T> getBias(int l) const {return bias[l];}
+    Activation getActivation(int l) const {return activations[l];}
 
     protected:
     std::vector<std::vector<T>> dE_dw, z, h, dAct_z, dE_dx, dE_db;
@@ -72,9 +103,24 @@ class Model{
     float model_learning_rate;
     T default_weight = 0.3;
     std::string model_name, model_loss_fun, model_stop_cryteria, weights_initialisation = "Normal_Distribution";
+    std::string gemm_backend;
     std::vector<std::vector<T>> weights, bias;
+    std::vector<QuantizedMatrix> quantized_weights;
     std::vector<std::vector<int>> weights_shape;
+    std::vector<Activation> activations;
+    //kernel and threads of the products of layer l, planned by train with selection 3 for their shapes:
+    //[0] forward (1 x in * in x out), [1] weights gradient (in x 1 * 1 x out), [2] input gradient (1 x out * (in x out)^T)
+    std::vector<std::array<MulPlan, 3>> product_plans;
     std::vector<T> input_layer, output_layer;
+    //pattern of the blocks of the pruned layers (weights[l] and dE_dw[l] hold the values of the blocks), empty for the dense ones
+    std::vector<BlockPattern> weights_pattern;
+
+    bool isPruned(int l) const {return l >= 0 && static_cast<std::size_t>(l) < weights_pattern.size() && weights_pattern[l].rows != 0;}
+    std::vector<T> denseWeights(const std::vector<T>& values, int l) const;
+    void planProducts();
+    void forwardLayer(std::vector<T>& input, int l);
+    void weightsGradient(const std::vector<T>& input, int l);
+    void inputGradient(int l);
 };
 
 
@@ -0,0 +1,123 @@
+#include "MatrixFixed.hpp"
+#include "model.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#ifndef MODEL_FIXED_HPP
+#define MODEL_FIXED_HPP
+
+//**********************************************************************************************************************
+
+// Inference with the layer sizes known at compile time, for small networks. A trained Model is copied in a
+// ModelFixed with the same layers:
+//
+//     ModelFixed<float, 4, FixedLayer<128, Activation::ReLu>, FixedLayer<3, Activation::SoftMax>> fixed;
+//     fixed.load(model);
+//     fixed.evaluate(testSet, testOut);
+//
+// The weights are MatrixFixed members and predict chains the dense_fixed kernels (MatrixFixed.hpp): the whole
+// forward pass is one function with constant loop bounds, the activations between the layers stay on the stack,
+// and a sample costs no allocation. Only the inference is fixed-size, the training stays in Model.
+// It is header only, the model is instantiated for the shapes of each program.
+
+//**********************************************************************************************************************
+
+
+//! A dense layer of ModelFixed: number of neurons and activation
+template<std::size_t Neurons, Activation A>
+struct FixedLayer{
+    static constexpr std::size_t neurons = Neurons;
+    static constexpr Activation activation = A;
+};
+
+//! Network with In inputs followed by the Layers (the last one is the output layer)
+template<typename T, std::size_t In, typename... Layers>
+class ModelFixed;
+
+//! No layer left: the output is the input
+template<typename T, std::size_t In>
+class ModelFixed<T, In>{
+    public:
+        static constexpr std::size_t inputs = In, outputs = In, products = 0;
+
+        MatrixFixed<T, 1, In> predict(const MatrixFixed<T, 1, In>& x) const {return x;}
+        bool set_layer(std::size_t, const T*, const T*) {return false;}
+        template<typename Source>
+        bool check_layers(const Source&, int) const {return true;}
+};
+
+template<typename T, std::size_t In, typename Layer, typename... Rest>
+class ModelFixed<T, In, Layer, Rest...>{
+    public:
+        static constexpr std::size_t inputs = In;
+        static constexpr std::size_t outputs = ModelFixed<T, Layer::neurons, Rest...>::outputs;
+        static constexpr std::size_t products = 1 + sizeof...(Rest);
+
+        //! Forward pass of one sample
+        MatrixFixed<T, 1, outputs> predict(const MatrixFixed<T, 1, In>& x) const {
+            MatrixFixed<T, 1, Layer::neurons> h;
+            dense_fixed<Layer::activation>(x, m_weights, m_bias, h);
+            return m_next.predict(h);
+        }
+
+        MatrixFixed<T, 1, outputs> predict(const std::vector<T>& x) const {
+            MatrixFixed<T, 1, In> input;
+            std::copy(x.begin(), x.begin() + std::min(x.size(), In), input.get_ptr());
+            return predict(input);
+        }
+
+        //! Copies the weights (In x neurons, row-major) and the bias of the product l
+        bool set_layer(std::size_t l, const T* weights, const T* bias){
+            if (l > 0)
+                return m_next.set_layer(l - 1, weights, bias);
+            std::copy(weights, weights + In * Layer::neurons, m_weights.get_ptr());
+            std::copy(bias, bias + Layer::neurons, m_bias.get_ptr());
+            return true;
+        }
+
+        //! Copies the weights of a trained Model, which must have the same layers.
+        //! Returns false, with an error message, if it does not.
+        bool load(const Model<T>& model){
+            if (model.getNumProducts() != static_cast<int>(products) || !check_layers(model, 0)) {
+                std::cout << "Error: the model does not have the layers of the ModelFixed" << std::endl;
+                return false;
+            }
+            for (int l = 0; l < model.getNumProducts(); l++)
+                set_layer(l, model.getWeights(l).data(), model.getBias(l).data());
+            return true;
+        }
+
+        //! True if the product l of model and the following ones have the shapes and activations of these layers
+        template<typename Source>
+        bool check_layers(const Source& model, int l) const {
+            const std::vector<int> shape = model.getWeightsShape(l);
+            return shape[0] == static_cast<int>(In) && shape[1] == static_cast<int>(Layer::neurons) &&
+                   model.getActivation(l) == Layer::activation && m_next.check_layers(model, l + 1);
+        }
+
+        //! Accuracy on a set (the index of the largest output against the one of the target), as Model::evaluateQuantized
+        float evaluate(const std::vector<std::vector<T>>& set, const std::vector<std::vector<T>>& target) const {
+            int correct = 0;
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (std::size_t i = 0; i < set.size(); i++) {
+                const MatrixFixed<T, 1, outputs> y = predict(set[i]);
+                const std::size_t predicted = std::max_element(y.get_ptr(), y.get_ptr() + outputs) - y.get_ptr();
+                correct += predicted == static_cast<std::size_t>(std::max_element(target[i].begin(), target[i].end()) - target[i].begin());
+            }
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            const float accuracy = set.empty() ? 0 : (float)correct / set.size();
+            const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+            std::cout << "Fixed-size Accuracy on the TestSet: " << accuracy << " (" << (set.empty() ? 0 : ns / (int64_t)set.size())
+                      << " ns per sample)" << std::endl;
+            return accuracy;
+        }
+
+    private:
+        MatrixFixed<T, In, Layer::neurons> m_weights;
+        MatrixFixed<T, 1, Layer::neurons> m_bias;
+        ModelFixed<T, Layer::neurons, Rest...> m_next;
+};
+
+
+#endif //MODEL_FIXED_HPP
@@ -0,0 +1,100 @@
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef NUMA_ALLOCATOR_HPP
+#define NUMA_ALLOCATOR_HPP
+
+//**********************************************************************************************************************
+
+// Allocator of the storage of MatrixFlat: the large buffers get their pages interleaved on the NUMA nodes.
+//
+// The tiles of a product are taken dynamically by the threads of the pool (thread_pool.hpp), so no page of A, B or
+// C has a fixed owner. With the default first-touch policy all the pages of a matrix land on the node of the thread
+// that constructed it, and the threads of the other socket read every tile remotely through the bandwidth of a
+// single memory controller. Interleaving spreads the pages over all the nodes, so every thread sees the same mix of
+// local and remote pages and the bandwidth of all the controllers is used.
+// On machines with more than one node, buffers of at least numa_interleave_bytes are mapped with mmap and bound with
+// mbind(MPOL_INTERLEAVE) before being touched (the kernel keeps only the nodes the process may use). The smaller
+// ones, and all of them on a single node machine, are allocated as usual; if mbind is not allowed the pages simply
+// follow the first-touch policy.
+// It is header only, so that the programs that just use MatrixFlat do not need to link anything.
+
+//**********************************************************************************************************************
+
+
+//! Smallest buffer whose pages are interleaved: below it a matrix lives in the caches anyway
+constexpr std::size_t numa_interleave_bytes = std::size_t(1) << 20;
+
+//! Mask of the online NUMA nodes (the first 64), read once from /sys/devices/system/node/online ("0-1", "0,2", ...)
+inline unsigned long numa_online_nodes(){
+    static const unsigned long mask = []{
+        std::ifstream file("/sys/devices/system/node/online");
+        std::string list;
+        unsigned long nodes = 0;
+        if (!std::getline(file, list))
+            return 1ul;
+        for (std::size_t pos = 0; pos < list.size(); pos = list.find(',', pos) + 1) {
+            const int first = std::atoi(list.c_str() + pos);
+            const std::size_t dash = list.find('-', pos), comma = list.find(',', pos);
+            const int last = dash < comma ? std::atoi(list.c_str() + dash + 1) : first;
+            for (int node = first; node <= last && node < 64; node++)
+                nodes |= 1ul << node;
+            if (comma == std::string::npos)
+                break;
+        }
+        return nodes ? nodes : 1ul;
+    }();
+    return mask;
+}
+
+//! True if the buffers of the given size are interleaved
+inline bool numa_interleaved(std::size_t bytes){
+    const unsigned long nodes = numa_online_nodes();
+    return bytes >= numa_interleave_bytes && (nodes & (nodes - 1)) != 0;
+}
+
+template<typename T>
+class NumaAllocator{
+    public:
+    using value_type = T;
+
+    NumaAllocator() noexcept = default;
+    template<typename U>
+    NumaAllocator(const NumaAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n){
+        const std::size_t bytes = n * sizeof(T);
+        if (!numa_interleaved(bytes))
+            return static_cast<T*>(::operator new(bytes));
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        const unsigned long nodes = numa_online_nodes();
+        constexpr int interleave = 3;   // MPOL_INTERLEAVE of <numaif.h>, which is not installed everywhere
+        syscall(SYS_mbind, p, bytes, interleave, &nodes, sizeof(nodes) * 8 + 1, 0);
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        const std::size_t bytes = n * sizeof(T);
+        if (!numa_interleaved(bytes))
+            ::operator delete(p);
+        else
+            munmap(p, bytes);
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const NumaAllocator<T>&, const NumaAllocator<U>&) noexcept {return true;}
+
+template<typename T, typename U>
+bool operator!=(const NumaAllocator<T>&, const NumaAllocator<U>&) noexcept {return false;}
+
+
+#endif //NUMA_ALLOCATOR_HPP
@@ -0,0 +1,90 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef QUANTIZED_HPP
+#define QUANTIZED_HPP
+
+//**********************************************************************************************************************
+
+// INT8 quantized products for inference. The body is defined in /src/quantized.cpp
+//
+// The weights are quantized once, after the training, to int8 with a float scale per output channel (or one for the
+// whole matrix): w ~ scale * q, q in [-127, 127]. The activations are quantized on the fly at every call with a
+// single scale, the products are accumulated exactly in int32 and the result is scaled back to float:
+//
+//     y[j] += scale_x * scale_w[j] * sum_k qx[k] * qw[j][k]
+//
+// The values of the weights take a quarter of the memory of float (the forward pass is memory bound), plus a float
+// scale per output channel, so a layer with few inputs saves less; the integer dot products run on the widest
+// instructions available, selected at runtime (see cpu_features.hpp):
+//     - AVX-512 VNNI / AVX-VNNI: vpdpbusd, 4 multiply-adds per 32 bit lane in one instruction
+//     - AVX2 / SSE4: vpmaddubsw + vpmaddwd
+// Both instructions multiply an unsigned byte by a signed one: the sign of the weight is moved onto the activation
+// (|w| * sign(w) * x), so with both operands in [-127, 127] the 16 bit pairs of vpmaddubsw never saturate.
+// Only the products are quantized: this is an inference path, the training keeps working in float.
+
+//**********************************************************************************************************************
+
+
+enum class QuantGranularity{ PerTensor, PerChannel };
+
+//! Quantized weight matrix W, K x N (the right operand of x * W, as the weights are stored by Model).
+//! It is stored transposed, one output channel per row, so that the dot products read contiguous bytes; the rows
+//! are zero padded to a multiple of the vector loop of the kernel (32 bytes for AVX2, 16 for SSE4), none for the
+//! rows shorter than one vector and for the AVX-512 kernel, which reads the tails with masks.
+class QuantizedMatrix{
+    public:
+    QuantizedMatrix() = default;
+
+    //! Quantizes the K x N row-major matrix W
+    template<typename T>
+    QuantizedMatrix(const T* W, std::size_t K, std::size_t N, QuantGranularity granularity = QuantGranularity::PerChannel);
+
+    std::size_t inputs() const {return n_inputs;}
+    std::size_t outputs() const {return n_outputs;}
+    std::size_t ld() const {return stride;}
+    QuantGranularity granularity() const {return mode;}
+
+    //! Quantized weights of the output channel j (ld() bytes)
+    const std::int8_t* channel(std::size_t j) const {return values.data() + j * stride;}
+
+    float scale(std::size_t j) const {return mode == QuantGranularity::PerChannel ? scales[j] : scales[0];}
+
+    //! Dequantized element (k, j) of W
+    float operator()(std::size_t k, std::size_t j) const {return scale(j) * channel(j)[k];}
+
+    std::size_t bytes() const {return values.size() + scales.size() * sizeof(float);}
+
+    private:
+    std::size_t n_inputs = 0, n_outputs = 0, stride = 0;
+    QuantGranularity mode = QuantGranularity::PerChannel;
+    std::vector<std::int8_t> values;
+    std::vector<float> scales;
+};
+
+
+//! C += A * B^T in integers: A is M x K, B is N x K (so both operands are read along K), C is M x N, all row-major
+//! with leading dimensions lda, ldb, ldc. The values of A and B must lie in [-127, 127].
+void gemm_int8(std::size_t M, std::size_t N, std::size_t K,
+               const std::int8_t* A, std::size_t lda,
+               const std::int8_t* B, std::size_t ldb,
+               std::int32_t* C, std::size_t ldc);
+
+//! y += x * W, where x has W.inputs() elements and y has W.outputs().
+//! numThreads <= 0 uses all the available cores; small products always run on the calling thread.
+template<typename T>
+void gemv_quantized(const QuantizedMatrix& W, const T* x, T* y, int numThreads = 0);
+
+//! C += A * W, where A is M x W.inputs() and C is M x W.outputs(), row-major with leading dimensions lda and ldc.
+//! Every row of A is quantized with its own scale.
+template<typename T>
+void gemm_quantized(std::size_t M, const T* A, std::size_t lda, const QuantizedMatrix& W, T* C, std::size_t ldc,
+                    int numThreads = 0);
+
+//! Name of the instruction set used by the integer kernels on this machine
+std::string int8_kernel_name();
+
+
+#endif //QUANTIZED_HPP
@@ -0,0 +1,124 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+//**********************************************************************************************************************
+
+// Persistent work-stealing thread pool shared by all the parallel kernels of the library. The body is defined in
+// /src/thread_pool.cpp
+//
+// The workers are started once, at the first parallel call, and live until the end of the program. Their number
+// is the parallelism actually granted to the process: the CPUs of its affinity mask, capped by the cgroup CPU quota
+// (v2 cpu.max or v1 cpu.cfs_quota_us, e.g. the --cpus of a container). It can be set with the environment variable
+// NNET_NUM_THREADS. Each worker is pinned to its own CPU, on as few NUMA nodes as possible (see topology.hpp).
+//
+// A parallel loop is split in chunks of items and run by a few tasks, one per thread it may use; the tasks take the
+// chunks one at a time from a shared counter, so ragged tiles are balanced dynamically. Every worker keeps its tasks
+// in its own deque and the idle ones steal from the others. The thread that starts a loop runs one of its tasks and,
+// while waiting for the others, runs any queued task: a loop started inside another one (a kernel called from a
+// parallel training step) reuses the same workers instead of spawning new threads, so the machine is never
+// oversubscribed.
+
+//**********************************************************************************************************************
+
+
+class ThreadPool{
+    public:
+    //! Body of a loop: processes the items [begin, end) on the task number slot (0 <= slot < number of tasks)
+    using RangeTask = std::function<void(std::size_t begin, std::size_t end, int slot)>;
+
+    //! The pool of the process, started at the first call
+    static ThreadPool& instance();
+
+    //! Threads available to a loop: the workers plus the calling thread
+    int size() const {return static_cast<int>(m_workers.size()) + 1;}
+
+    //! Runs task on the items [0, count), split in chunks of grain items, on at most numThreads threads
+    //! (numThreads <= 0 uses all of them). Returns when all the items are done.
+    void run(std::size_t count, std::size_t grain, int numThreads, const RangeTask& task);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    private:
+    struct Loop;
+    struct Queue;
+
+    explicit ThreadPool(int threads);
+
+    void worker(int index, int cpu);
+    bool run_one(int self);
+    void push(int self, Loop* loop, int slot);
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<Queue>> m_queues;       // one per worker
+    std::atomic<unsigned> m_next_queue{0};              // queue of the next task pushed from outside the pool
+    std::atomic<long> m_queued{0};                      // tasks waiting in the queues
+    std::mutex m_sleep;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+
+
+//! Number of threads granted to the process (see above), computed once
+int pool_concurrency();
+
+//! numThreads if positive, all the threads of the pool otherwise
+int resolve_threads(int numThreads);
+
+//! body(i) for i in [0, count) on at most numThreads threads, grain consecutive items per chunk
+template<typename F>
+void parallel_for(std::size_t count, int numThreads, F body, std::size_t grain = 1){
+    if (count == 0)
+        return;
+    if (numThreads == 1 || count <= grain) {
+        for (std::size_t i = 0; i < count; i++)
+            body(i);
+        return;
+    }
+    ThreadPool::instance().run(count, grain, numThreads, [&body](std::size_t begin, std::size_t end, int){
+        for (std::size_t i = begin; i < end; i++)
+            body(i);
+    });
+}
+
+//! As parallel_for, with body(i, slot): the items of the same slot never run at the same time, so slot can index a
+//! per-thread workspace of numThreads entries
+template<typename F>
+void parallel_for_slot(std::size_t count, int numThreads, F body, std::size_t grain = 1){
+    if (count == 0)
+        return;
+    ThreadPool::instance().run(count, grain, numThreads, [&body](std::size_t begin, std::size_t end, int slot){
+        for (std::size_t i = begin; i < end; i++)
+            body(i, slot);
+    });
+}
+
+//! Sum of body(begin, end) over the chunks of [0, count). The partial sums are added in the order of the chunks,
+//! so the result does not depend on the number of threads nor on the scheduling.
+template<typename T, typename F>
+T parallel_reduce(std::size_t count, int numThreads, F body, std::size_t grain){
+    if (count == 0)
+        return T(0);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    std::vector<T> partial(chunks, T(0));
+    ThreadPool::instance().run(count, grain, numThreads, [&](std::size_t begin, std::size_t end, int){
+        partial[begin / grain] = body(begin, end);
+    });
+    T result = 0;
+    for (const T& p : partial)
+        result += p;
+    return result;
+}
+
+
+#endif //THREAD_POOL_HPP
@@ -0,0 +1,53 @@
+#include <string>
+#include <vector>
+
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+//**********************************************************************************************************************
+
+// CPU and NUMA topology of the machine, read from /sys/devices/system/node and /sys/devices/system/cpu, and thread
+// pinning. The body is defined in /src/topology.cpp
+//
+// Used by the thread pool (thread_pool.hpp) to pin every worker to its own CPU, so that the threads of a product do
+// not migrate between sockets and keep their caches and their node-local memory. The workers are placed on the
+// nodes one after the other, one thread per physical core first (the hyper-threads only when the cores are all
+// taken): a pool smaller than the machine stays on as few nodes as possible, next to the memory of the thread that
+// allocated the matrices. The workers are pinned only on machines with more than one NUMA node: on a single socket
+// two processes pinned to the same CPUs could not be moved apart by the scheduler. NNET_PIN_THREADS=1 or 0 forces
+// pinning on or off.
+// Only the CPUs of the affinity mask of the process are used (taskset, cpusets of a container).
+
+//**********************************************************************************************************************
+
+
+struct CpuInfo{
+    int cpu = 0;        // logical CPU number
+    int core = 0;       // physical core, unique in the machine (hyper-threads of the same core share it)
+    int node = 0;       // NUMA node
+};
+
+struct Topology{
+    std::vector<CpuInfo> cpus;      // CPUs the process may run on, by increasing number
+    int nodes = 1;                  // NUMA nodes with at least one of those CPUs
+    int cores = 1;                  // physical cores with at least one of those CPUs
+};
+
+//! Topology of the machine, detected once at the first call (a single node when /sys is not available)
+const Topology& topology();
+
+//! CPUs for the threads of a pool of the given size, in the order described above; the list is repeated when there
+//! are more threads than CPUs
+std::vector<int> thread_placement(int threads);
+
+//! Binds the calling thread to cpu, returns false if the system refused it
+bool pin_current_thread(int cpu);
+
+//! NNET_PIN_THREADS=0 or 1 if set, otherwise true when the process runs on more than one NUMA node
+bool pinning_enabled();
+
+//! One line description, e.g. "2 NUMA nodes, 32 cores, 64 CPUs"
+std::string topology_summary();
+
+
+#endif //TOPOLOGY_HPP
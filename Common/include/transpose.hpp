@@ -0,0 +1,21 @@
+#ifndef TRANSPOSE_HPP
+#define TRANSPOSE_HPP
+
+//**********************************************************************************************************************
+
+// Transpose flags of the matrix products, as in BLAS: the kernels compute C += op(A)*op(B) with op(X) = X or X^T and
+// read the transposed operands in place (through their strides) instead of materializing the transpose.
+//
+// The dimensions passed to the kernels are always the ones of op(A) (m x n) and op(B) (n x nb): a transposed A is
+// stored n x m, a transposed B is stored nb x n.
+
+//**********************************************************************************************************************
+
+
+enum Transpose{
+    NoTrans = 0,
+    Trans = 1
+};
+
+
+#endif //TRANSPOSE_HPP
@@ -0,0 +1,175 @@
+#include "../include/autotuner.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/gemm_strassen.hpp"
+#include "../include/mmm.hpp"
+#include "../include/thread_pool.hpp"
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <vector>
+
+
+namespace {
+
+    //! Runs the kernel once with the given (fully specified) configuration
+    template<typename T>
+    void run(TunedKernel kernel, const MatrixFlat<T>& A, const MatrixFlat<T>& B, MatrixFlat<T>& C, const TuningConfig& config){
+        const std::size_t M = A.nrows(), N = B.ncols(), K = A.ncols();
+        if (kernel == TunedKernel::Packed)
+            gemm_packed(M, N, K, A.get_ptr(), K, B.get_ptr(), N, C.get_ptr(), N, config);
+        else if (kernel == TunedKernel::Strassen)
+            gemm_strassen(M, N, K, A.get_ptr(), K, B.get_ptr(), N, C.get_ptr(), N, config);
+        else
+            mmm_tiled_kernel(A, B, C, config.outer_tile, config.inner_tile, config.threads);
+    }
+
+    //! Best time [us] out of `repetitions` runs, after a warm up run (page faults, thread creation, frequency)
+    template<typename T>
+    double benchmark(TunedKernel kernel, const MatrixFlat<T>& A, const MatrixFlat<T>& B, MatrixFlat<T>& C,
+                     const TuningConfig& config, int repetitions){
+        run(kernel, A, B, C, config);
+        double best = -1;
+        for (int r = 0; r < repetitions; r++) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            run(kernel, A, B, C, config);
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            const double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+            if (best < 0 || us < best)
+                best = us;
+        }
+        return best;
+    }
+
+    //! Configuration the kernel runs with when nothing is tuned, used as starting point of the search
+    template<typename T>
+    TuningConfig default_config(TunedKernel kernel, int threads){
+        TuningConfig config;
+        if (kernel == TunedKernel::Packed) {
+            const PackedBlocking<T> blk = packed_default_blocking<T>();
+            config.outer_tile = blk.mc;
+            config.inner_tile = blk.kc;
+        } else if (kernel == TunedKernel::Strassen) {
+            config.outer_tile = 1024;
+        } else {
+            config.outer_tile = 256;
+            config.inner_tile = 64;
+        }
+        config.threads = threads;
+        return config;
+    }
+
+    //! Candidate tiles: the values larger than the matrix are all equivalent to the matrix size, so only the
+    //! first of them is kept
+    std::vector<int> tile_candidates(const std::vector<int>& values, std::size_t dim){
+        std::vector<int> candidates;
+        for (int value : values) {
+            candidates.push_back(value);
+            if (value >= static_cast<int>(dim))
+                break;
+        }
+        return candidates;
+    }
+
+    void print(const std::string& step, const TuningConfig& config, double time_us){
+        std::cout << "  " << step << ": outer " << config.outer_tile << ", inner " << config.inner_tile
+                  << ", threads " << config.threads << ", order " << config.loop_order
+                  << " -> " << time_us << " [us]" << std::endl;
+    }
+
+}
+
+
+Autotuner::Autotuner(int max_threads, int repetitions, bool verbose) :
+        m_table(*tuning_table()),
+        m_max_threads(resolve_threads(max_threads)),
+        m_repetitions(std::max(1, repetitions)),
+        m_verbose(verbose) {}
+
+
+template<typename T>
+TuningConfig Autotuner::tune(TunedKernel kernel, std::size_t M, std::size_t N, std::size_t K){
+
+    std::cout << "Tuning " << tuned_kernel_name(kernel) << " for " << M << "X" << K << " * " << K << "X" << N
+              << " (" << sizeof(T) << " bytes)" << std::endl;
+
+    MatrixFlat<T> A(M, K, -1, 1);
+    MatrixFlat<T> B(K, N, -1, 1);
+    MatrixFlat<T> C(M, N);
+
+    TuningConfig best = default_config<T>(kernel, m_max_threads);
+    double best_time = benchmark(kernel, A, B, C, best, m_repetitions);
+    if (m_verbose)
+        print("default", best, best_time);
+
+    auto consider = [&](const TuningConfig& candidate, const std::string& step){
+        const double time_us = benchmark(kernel, A, B, C, candidate, m_repetitions);
+        if (m_verbose)
+            print(step, candidate, time_us);
+        if (time_us < best_time) {
+            best_time = time_us;
+            best = candidate;
+        }
+    };
+
+    // 1) number of threads: powers of two up to the maximum, plus the maximum itself
+    std::set<int> threads;
+    for (int t = 1; t < m_max_threads; t *= 2)
+        threads.insert(t);
+    threads.insert(m_max_threads);
+    const TuningConfig start = best;
+    for (int t : threads) {
+        if (t == start.threads)
+            continue;
+        TuningConfig candidate = start;
+        candidate.threads = t;
+        consider(candidate, "threads");
+    }
+
+    // 2) tiles. The outer tiles of the packed engine are multiples of every micro-tile height (4, 6 and 8 rows),
+    //    for Strassen the outer tile is the crossover and there is no inner tile
+    std::vector<int> outer, inner;
+    if (kernel == TunedKernel::Packed) {
+        outer = tile_candidates({24, 48, 72, 120, 168, 240, 336, 480}, M);
+        inner = tile_candidates({64, 128, 192, 256, 384, 512}, K);
+    } else if (kernel == TunedKernel::Strassen) {
+        outer = tile_candidates({128, 256, 512, 1024, 2048, 4096}, std::min({M, N, K}));
+        inner = {0};
+    } else {
+        outer = tile_candidates({32, 64, 128, 256, 512, 1024}, std::max(M, N));
+        inner = tile_candidates({16, 32, 64, 128, 256}, K);
+    }
+    const TuningConfig with_threads = best;
+    for (int o : outer) {
+        for (int i : inner) {
+            if (o == with_threads.outer_tile && i == with_threads.inner_tile)
+                continue;
+            TuningConfig candidate = with_threads;
+            candidate.outer_tile = o;
+            candidate.inner_tile = i;
+            consider(candidate, "tiles");
+        }
+    }
+
+    // 3) loop order, only the packed engine has more than one
+    if (kernel == TunedKernel::Packed) {
+        TuningConfig candidate = best;
+        candidate.loop_order = 1 - best.loop_order;
+        consider(candidate, "order");
+    }
+
+    print("best", best, best_time);
+
+    const TuningKey key{kernel, static_cast<int>(sizeof(T)), tuning_bucket(M), tuning_bucket(N), tuning_bucket(K)};
+    m_table.set(key, best, best_time);
+
+    return best;
+}
+
+template TuningConfig Autotuner::tune<float>(TunedKernel kernel, std::size_t M, std::size_t N, std::size_t K);
+template TuningConfig Autotuner::tune<double>(TunedKernel kernel, std::size_t M, std::size_t N, std::size_t K);
+
+
+void Autotuner::install() const{
+    install_tuning_table(std::make_shared<const TuningTable>(m_table));
+}
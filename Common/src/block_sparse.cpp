@@ -0,0 +1,383 @@
+#include "../include/block_sparse.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <immintrin.h>
+
+
+namespace {
+
+    //! Pattern of the blocks flagged in keep (block_row_count x block_col_count, row-major), with the index by columns
+    BlockPattern pattern_from_mask(std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols,
+                                   const std::vector<char>& keep){
+        BlockPattern p;
+        p.rows = rows; p.cols = cols; p.block_rows = block_rows; p.block_cols = block_cols;
+        const std::size_t brows = p.block_row_count(), bcols = p.block_col_count();
+        p.row_ptr.push_back(0);
+        for (std::size_t b = 0; b < brows; b++) {
+            for (std::size_t c = 0; c < bcols; c++)
+                if (keep[b * bcols + c])
+                    p.col_idx.push_back(static_cast<std::uint32_t>(c));
+            p.row_ptr.push_back(p.col_idx.size());
+        }
+        // counting sort of the blocks by column, the blocks of a column stay in the order of their rows
+        p.col_ptr.assign(bcols + 1, 0);
+        for (std::uint32_t c : p.col_idx)
+            p.col_ptr[c + 1]++;
+        std::partial_sum(p.col_ptr.begin(), p.col_ptr.end(), p.col_ptr.begin());
+        p.col_blocks.resize(p.nblocks());
+        p.col_rows.resize(p.nblocks());
+        std::vector<std::size_t> next(p.col_ptr.begin(), p.col_ptr.end() - 1);
+        for (std::size_t b = 0; b < brows; b++)
+            for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+                const std::size_t slot = next[p.col_idx[q]]++;
+                p.col_blocks[slot] = static_cast<std::uint32_t>(q);
+                p.col_rows[slot] = static_cast<std::uint32_t>(b);
+            }
+        return p;
+    }
+
+    //! Rows and columns of block (b, c) inside the matrix (smaller than the block on the last ones)
+    inline std::size_t rows_in(const BlockPattern& p, std::size_t b){return std::min(p.block_rows, p.rows - b * p.block_rows);}
+    inline std::size_t cols_in(const BlockPattern& p, std::size_t c){return std::min(p.block_cols, p.cols - c * p.block_cols);}
+
+
+    //******************************************************************************************************************
+    // Kernels on one block column (forward) or one block row (backward, gradient), the unit of work of a thread.
+    // The AVX2 versions keep a row of the blocks, R registers, in registers; R is a template parameter so that the
+    // loops over the registers are fully unrolled.
+    //******************************************************************************************************************
+
+    // y[c-th block column] += x * W[:, c-th block column]
+    template<typename T>
+    void forward_scalar(const BlockPattern& p, const T* values, const T* x, std::size_t c, T* y){
+        const std::size_t bc = p.block_cols, width = cols_in(p, c);
+        T* out = y + c * bc;
+        for (std::size_t k = p.col_ptr[c]; k < p.col_ptr[c + 1]; k++) {
+            const std::size_t b = p.col_rows[k];
+            const T* block = values + p.col_blocks[k] * p.block_size();
+            const T* xb = x + b * p.block_rows;
+            for (std::size_t r = 0; r < rows_in(p, b); r++)
+                for (std::size_t j = 0; j < width; j++)
+                    out[j] += xb[r] * block[r * bc + j];
+        }
+    }
+
+    // y[b-th block row] += W[b-th block row, :] * x
+    template<typename T>
+    void backward_scalar(const BlockPattern& p, const T* values, const T* x, std::size_t b, T* y){
+        const std::size_t bc = p.block_cols;
+        for (std::size_t r = 0; r < rows_in(p, b); r++) {
+            T acc = 0;
+            for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+                const T* row = values + q * p.block_size() + r * bc;
+                const T* xc = x + p.col_idx[q] * bc;
+                for (std::size_t j = 0; j < cols_in(p, p.col_idx[q]); j++)
+                    acc += row[j] * xc[j];
+            }
+            y[b * p.block_rows + r] += acc;
+        }
+    }
+
+    // W[b-th block row, stored blocks] += alpha * x[b-th block row] * y^T
+    template<typename T>
+    void gradient_scalar(const BlockPattern& p, T alpha, const T* x, const T* y, std::size_t b, T* values){
+        const std::size_t bc = p.block_cols;
+        for (std::size_t r = 0; r < rows_in(p, b); r++) {
+            const T a = alpha * x[b * p.block_rows + r];
+            if (a == T(0))
+                continue;
+            for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+                T* row = values + q * p.block_size() + r * bc;
+                const T* yc = y + p.col_idx[q] * bc;
+                for (std::size_t j = 0; j < cols_in(p, p.col_idx[q]); j++)
+                    row[j] += a * yc[j];
+            }
+        }
+    }
+
+
+    // AVX2 + FMA register operations, overloaded on float / double
+    __attribute__((target("avx2,fma"))) inline __m256  load256(const float* p){return _mm256_loadu_ps(p);}
+    __attribute__((target("avx2,fma"))) inline __m256d load256(const double* p){return _mm256_loadu_pd(p);}
+    __attribute__((target("avx2,fma"))) inline __m256  set256(float a){return _mm256_set1_ps(a);}
+    __attribute__((target("avx2,fma"))) inline __m256d set256(double a){return _mm256_set1_pd(a);}
+    __attribute__((target("avx2,fma"))) inline void store256(float* p, __m256 r){_mm256_storeu_ps(p, r);}
+    __attribute__((target("avx2,fma"))) inline void store256(double* p, __m256d r){_mm256_storeu_pd(p, r);}
+    __attribute__((target("avx2,fma"))) inline __m256  add256(__m256 a, __m256 b){return _mm256_add_ps(a, b);}
+    __attribute__((target("avx2,fma"))) inline __m256d add256(__m256d a, __m256d b){return _mm256_add_pd(a, b);}
+    __attribute__((target("avx2,fma"))) inline __m256  fma256(__m256 a, __m256 b, __m256 c){return _mm256_fmadd_ps(a, b, c);}
+    __attribute__((target("avx2,fma"))) inline __m256d fma256(__m256d a, __m256d b, __m256d c){return _mm256_fmadd_pd(a, b, c);}
+    __attribute__((target("avx2,fma"))) inline void zero256(__m256& r){r = _mm256_setzero_ps();}
+    __attribute__((target("avx2,fma"))) inline void zero256(__m256d& r){r = _mm256_setzero_pd();}
+
+    __attribute__((target("avx2,fma")))
+    inline float hsum256(__m256 r){
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(r), _mm256_extractf128_ps(r, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        return _mm_cvtss_f32(sum);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline double hsum256(__m256d r){
+        __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(r), _mm256_extractf128_pd(r, 1));
+        sum = _mm_hadd_pd(sum, sum);
+        return _mm_cvtsd_f64(sum);
+    }
+
+    template<typename T>
+    using reg256 = decltype(load256(static_cast<const T*>(nullptr)));
+
+    template<typename T, int R>
+    __attribute__((target("avx2,fma")))
+    void forward_avx2(const BlockPattern& p, const T* values, const T* x, std::size_t c, T* y){
+        constexpr std::size_t w = 32 / sizeof(T), bc = R * w;
+        reg256<T> acc[R];
+        for (int i = 0; i < R; i++)
+            zero256(acc[i]);
+        for (std::size_t k = p.col_ptr[c]; k < p.col_ptr[c + 1]; k++) {
+            const std::size_t b = p.col_rows[k];
+            const T* block = values + p.col_blocks[k] * p.block_size();
+            const T* xb = x + b * p.block_rows;
+            for (std::size_t r = 0; r < rows_in(p, b); r++) {
+                // the inputs after a ReLU are often 0
+                if (xb[r] == T(0))
+                    continue;
+                const auto a = set256(xb[r]);
+                for (int i = 0; i < R; i++)
+                    acc[i] = fma256(a, load256(block + r * bc + i * w), acc[i]);
+            }
+        }
+        T* out = y + c * bc;
+        if (cols_in(p, c) == bc) {
+            for (int i = 0; i < R; i++)
+                store256(out + i * w, add256(load256(out + i * w), acc[i]));
+        } else {
+            // last block column: the padding columns of the blocks are 0, only the columns of y are written
+            alignas(32) T partial[bc];
+            for (int i = 0; i < R; i++)
+                store256(partial + i * w, acc[i]);
+            for (std::size_t j = 0; j < cols_in(p, c); j++)
+                out[j] += partial[j];
+        }
+    }
+
+    template<typename T, int R>
+    __attribute__((target("avx2,fma")))
+    void backward_avx2(const BlockPattern& p, const T* values, const T* x, std::size_t b, T* y){
+        constexpr std::size_t w = 32 / sizeof(T), bc = R * w;
+        for (std::size_t r = 0; r < rows_in(p, b); r++) {
+            reg256<T> acc[R];
+            for (int i = 0; i < R; i++)
+                zero256(acc[i]);
+            T tail = 0;
+            for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+                const T* row = values + q * p.block_size() + r * bc;
+                const T* xc = x + p.col_idx[q] * bc;
+                const std::size_t width = cols_in(p, p.col_idx[q]);
+                if (width == bc) {
+                    for (int i = 0; i < R; i++)
+                        acc[i] = fma256(load256(row + i * w), load256(xc + i * w), acc[i]);
+                } else {
+                    for (std::size_t j = 0; j < width; j++)
+                        tail += row[j] * xc[j];
+                }
+            }
+            for (int i = 1; i < R; i++)
+                acc[0] = add256(acc[0], acc[i]);
+            y[b * p.block_rows + r] += hsum256(acc[0]) + tail;
+        }
+    }
+
+    template<typename T, int R>
+    __attribute__((target("avx2,fma")))
+    void gradient_avx2(const BlockPattern& p, T alpha, const T* x, const T* y, std::size_t b, T* values){
+        constexpr std::size_t w = 32 / sizeof(T), bc = R * w;
+        for (std::size_t r = 0; r < rows_in(p, b); r++) {
+            const T a = alpha * x[b * p.block_rows + r];
+            if (a == T(0))
+                continue;
+            const auto va = set256(a);
+            for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+                T* row = values + q * p.block_size() + r * bc;
+                const T* yc = y + p.col_idx[q] * bc;
+                const std::size_t width = cols_in(p, p.col_idx[q]);
+                if (width == bc) {
+                    for (int i = 0; i < R; i++)
+                        store256(row + i * w, fma256(va, load256(yc + i * w), load256(row + i * w)));
+                } else {
+                    // the padding of the last block column stays 0
+                    for (std::size_t j = 0; j < width; j++)
+                        row[j] += a * yc[j];
+                }
+            }
+        }
+    }
+
+
+    template<typename T>
+    struct BsrKernels{
+        void (*forward)(const BlockPattern& p, const T* values, const T* x, std::size_t c, T* y);
+        void (*backward)(const BlockPattern& p, const T* values, const T* x, std::size_t b, T* y);
+        void (*gradient)(const BlockPattern& p, T alpha, const T* x, const T* y, std::size_t b, T* values);
+    };
+
+    template<typename T, int R>
+    BsrKernels<T> avx2_kernels(){
+        return {forward_avx2<T, R>, backward_avx2<T, R>, gradient_avx2<T, R>};
+    }
+
+    //! Kernels for the blocks of the pattern: AVX2 when the CPU has it (checked once), scalar otherwise
+    template<typename T>
+    BsrKernels<T> select_bsr_kernels(const BlockPattern& p){
+        static const bool avx2 = simd_level() >= SimdLevel::AVX2;
+        if (avx2)
+            switch (p.block_cols / (32 / sizeof(T))) {
+                case 1: return avx2_kernels<T, 1>();
+                case 2: return avx2_kernels<T, 2>();
+                case 4: return avx2_kernels<T, 4>();
+                case 8: return avx2_kernels<T, 8>();
+            }
+        return {forward_scalar<T>, backward_scalar<T>, gradient_scalar<T>};
+    }
+
+
+    //! Below this number of stored elements the cost of waking up the threads is larger than the product itself
+    constexpr std::size_t parallel_threshold = 1 << 15;
+
+}
+
+
+double BlockPattern::density() const {
+    const double blocks = static_cast<double>(block_row_count()) * block_col_count();
+    return blocks == 0 ? 0 : nblocks() / blocks;
+}
+
+bool valid_block_shape(std::size_t block_rows, std::size_t block_cols){
+    return block_rows >= 1 && (block_cols == 8 || block_cols == 16 || block_cols == 32);
+}
+
+template<typename T>
+BlockPattern block_pattern(const T* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols){
+    const std::size_t brows = (rows + block_rows - 1) / block_rows, bcols = (cols + block_cols - 1) / block_cols;
+    std::vector<char> keep(brows * bcols, 0);
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t j = 0; j < cols; j++)
+            if (W[i * cols + j] != T(0))
+                keep[(i / block_rows) * bcols + j / block_cols] = 1;
+    return pattern_from_mask(rows, cols, block_rows, block_cols, keep);
+}
+
+template<typename T>
+BlockPattern prune_blocks(T* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols,
+                          float sparsity){
+    if (!valid_block_shape(block_rows, block_cols)) {
+        std::cout<<"Error: blocks of "<<block_rows<<" x "<<block_cols<<" are not supported, the columns must be 8, 16 or 32"<<std::endl;
+        return BlockPattern();
+    }
+    const std::size_t brows = (rows + block_rows - 1) / block_rows, bcols = (cols + block_cols - 1) / block_cols;
+    std::vector<double> norm(brows * bcols, 0);
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t j = 0; j < cols; j++)
+            norm[(i / block_rows) * bcols + j / block_cols] += double(W[i * cols + j]) * double(W[i * cols + j]);
+
+    // the blocks with the largest norms, ties broken by position so that the result does not depend on the sort
+    const std::size_t total = norm.size();
+    const std::size_t kept = std::clamp<std::size_t>(std::llround((1.0 - sparsity) * total), 1, total);
+    std::vector<std::size_t> order(total);
+    std::iota(order.begin(), order.end(), 0);
+    std::nth_element(order.begin(), order.begin() + (kept - 1), order.end(), [&norm](std::size_t a, std::size_t b){
+        return norm[a] > norm[b] || (norm[a] == norm[b] && a < b);
+    });
+    std::vector<char> keep(total, 0);
+    for (std::size_t k = 0; k < kept; k++)
+        keep[order[k]] = 1;
+
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t j = 0; j < cols; j++)
+            if (!keep[(i / block_rows) * bcols + j / block_cols])
+                W[i * cols + j] = 0;
+    return pattern_from_mask(rows, cols, block_rows, block_cols, keep);
+}
+
+template<typename T>
+std::vector<T> pack_blocks(const BlockPattern& p, const T* W, std::size_t ldw){
+    std::vector<T> values(p.values_size(), T(0));
+    for (std::size_t b = 0; b < p.block_row_count(); b++)
+        for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+            const std::size_t c = p.col_idx[q];
+            for (std::size_t r = 0; r < rows_in(p, b); r++)
+                std::copy_n(W + (b * p.block_rows + r) * ldw + c * p.block_cols, cols_in(p, c),
+                            values.data() + q * p.block_size() + r * p.block_cols);
+        }
+    return values;
+}
+
+template<typename T>
+void unpack_blocks(const BlockPattern& p, const T* values, T* W, std::size_t ldw){
+    for (std::size_t b = 0; b < p.block_row_count(); b++)
+        for (std::size_t q = p.row_ptr[b]; q < p.row_ptr[b + 1]; q++) {
+            const std::size_t c = p.col_idx[q];
+            for (std::size_t r = 0; r < rows_in(p, b); r++)
+                std::copy_n(values + q * p.block_size() + r * p.block_cols, cols_in(p, c),
+                            W + (b * p.block_rows + r) * ldw + c * p.block_cols);
+        }
+}
+
+template<typename T>
+void bsr_gemv(Transpose trans, const BlockPattern& p, const T* values, const T* x, T* y, int numThreads){
+
+    if (p.nblocks() == 0)
+        return;
+
+    const BsrKernels<T> k = select_bsr_kernels<T>(p);
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && p.values_size() >= parallel_threshold;
+
+    if (trans == Trans) {
+        // one block column of y per item: the blocks of a column are reached through the index by columns
+        const std::size_t bcols = p.block_col_count();
+        parallel_for(bcols, parallel ? numThreads : 1, [&](std::size_t c){
+            k.forward(p, values, x, c, y);
+        }, std::max<std::size_t>(1, bcols / (4 * numThreads)));
+    } else {
+        const std::size_t brows = p.block_row_count();
+        parallel_for(brows, parallel ? numThreads : 1, [&](std::size_t b){
+            k.backward(p, values, x, b, y);
+        }, std::max<std::size_t>(1, brows / (4 * numThreads)));
+    }
+}
+
+template<typename T>
+void bsr_ger(const BlockPattern& p, T alpha, const T* x, const T* y, T* values, int numThreads){
+
+    if (p.nblocks() == 0 || alpha == T(0))
+        return;
+
+    const BsrKernels<T> k = select_bsr_kernels<T>(p);
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && p.values_size() >= parallel_threshold;
+
+    const std::size_t brows = p.block_row_count();
+    parallel_for(brows, parallel ? numThreads : 1, [&](std::size_t b){
+        k.gradient(p, alpha, x, y, b, values);
+    }, std::max<std::size_t>(1, brows / (4 * numThreads)));
+}
+
+
+template BlockPattern block_pattern<float>(const float* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols);
+template BlockPattern block_pattern<double>(const double* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols);
+template BlockPattern prune_blocks<float>(float* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols, float sparsity);
+template BlockPattern prune_blocks<double>(double* W, std::size_t rows, std::size_t cols, std::size_t block_rows, std::size_t block_cols, float sparsity);
+template std::vector<float> pack_blocks<float>(const BlockPattern& p, const float* W, std::size_t ldw);
+template std::vector<double> pack_blocks<double>(const BlockPattern& p, const double* W, std::size_t ldw);
+template void unpack_blocks<float>(const BlockPattern& p, const float* values, float* W, std::size_t ldw);
+template void unpack_blocks<double>(const BlockPattern& p, const double* values, double* W, std::size_t ldw);
+template void bsr_gemv<float>(Transpose trans, const BlockPattern& p, const float* values, const float* x, float* y, int numThreads);
+template void bsr_gemv<double>(Transpose trans, const BlockPattern& p, const double* values, const double* x, double* y, int numThreads);
+template void bsr_ger<float>(const BlockPattern& p, float alpha, const float* x, const float* y, float* values, int numThreads);
+template void bsr_ger<double>(const BlockPattern& p, double alpha, const double* x, const double* y, double* values, int numThreads);
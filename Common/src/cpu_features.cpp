@@ -0,0 +1,125 @@
+#include "../include/cpu_features.hpp"
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPU_FEATURES_X86
+#endif
+
+
+namespace {
+
+#ifdef CPU_FEATURES_X86
+
+    //! Reads the XCR0 register, which tells which register files the OS saves on context switches
+    unsigned long long read_xcr0(){
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<unsigned long long>(edx) << 32) | eax;
+    }
+
+    CpuFeatures detect(){
+
+        CpuFeatures f;
+        unsigned int eax, ebx, ecx, edx;
+
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return f;
+
+        f.sse4_1 = ecx & bit_SSE4_1;
+        f.sse4_2 = ecx & bit_SSE4_2;
+
+        // The AVX registers can be used only if the OS enabled them (OSXSAVE + XCR0 bits for xmm and ymm state)
+        const bool osxsave = ecx & bit_OSXSAVE;
+        const unsigned long long xcr0 = osxsave ? read_xcr0() : 0;
+        const bool os_avx = (xcr0 & 0x6) == 0x6;
+        const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+        f.avx = os_avx && (ecx & bit_AVX);
+        f.fma = os_avx && (ecx & bit_FMA);
+        f.f16c = os_avx && (ecx & bit_F16C);
+
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            f.avx2 = os_avx && (ebx & bit_AVX2);
+            f.avx512f = os_avx512 && (ebx & bit_AVX512F);
+            f.avx512bw = os_avx512 && (ebx & bit_AVX512BW);
+            f.avx512dq = os_avx512 && (ebx & bit_AVX512DQ);
+            f.avx512vl = os_avx512 && (ebx & bit_AVX512VL);
+            f.avx512_vnni = os_avx512 && (ecx & bit_AVX512VNNI);
+        }
+
+        if (__get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx)) {
+            f.avx_vnni = os_avx && (eax & bit_AVXVNNI);
+            f.avx512_bf16 = os_avx512 && (eax & bit_AVX512BF16);
+        }
+
+        return f;
+    }
+
+#else
+
+    CpuFeatures detect(){
+        return {};
+    }
+
+#endif
+
+    SimdLevel detect_level(){
+
+        const CpuFeatures& f = cpu_features();
+
+        SimdLevel level = SimdLevel::Scalar;
+        if (f.sse4_1 && f.sse4_2)
+            level = SimdLevel::SSE4;
+        if (f.avx2 && f.fma)
+            level = SimdLevel::AVX2;
+        if (level == SimdLevel::AVX2 && f.avx512f)
+            level = SimdLevel::AVX512;
+
+        if (const char* env = std::getenv("NNET_SIMD")) {
+            const std::string requested(env);
+            SimdLevel cap = level;
+            if (requested == "scalar")
+                cap = SimdLevel::Scalar;
+            else if (requested == "sse4")
+                cap = SimdLevel::SSE4;
+            else if (requested == "avx2")
+                cap = SimdLevel::AVX2;
+            else if (requested == "avx512")
+                cap = SimdLevel::AVX512;
+            else
+                std::cerr << "Warning: NNET_SIMD=" << requested << " not recognized, ignored" << std::endl;
+
+            if (cap < level)
+                level = cap;
+        }
+
+        return level;
+    }
+
+}
+
+
+const CpuFeatures& cpu_features(){
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+SimdLevel simd_level(){
+    static const SimdLevel level = detect_level();
+    return level;
+}
+
+std::string simd_level_name(SimdLevel level){
+    switch (level) {
+        case SimdLevel::SSE4:
+            return "sse4";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,81 @@
+#include "../include/epilogue.hpp"
+#include <cmath>
+#include <iostream>
+
+
+namespace {
+
+    // Same definitions as ActivationFunctions.cpp. Every activation has its own loop over the row, so that the
+    // compiler can vectorize the simple ones (linear, ReLU). The SoftMax of the network is applied element by element.
+    template<typename T>
+    void activate_row(Activation activation, std::size_t n, const T* z, T* h, T* dact){
+        switch (activation) {
+            case Activation::Linear:
+                for (std::size_t j = 0; j < n; j++) {
+                    if (h) h[j] = z[j];
+                    if (dact) dact[j] = T(1);
+                }
+                break;
+            case Activation::ReLu:
+                for (std::size_t j = 0; j < n; j++) {
+                    if (h) h[j] = z[j] > 0 ? z[j] : T(0);
+                    if (dact) dact[j] = z[j] > 0 ? T(1) : T(0);
+                }
+                break;
+            case Activation::Sigmoid:
+            case Activation::SoftMax:
+                for (std::size_t j = 0; j < n; j++) {
+                    const T s = activation == Activation::Sigmoid ? 1 / (1 + std::exp(-z[j]))
+                                                                   : std::exp(z[j]) / (1 + std::exp(z[j]));
+                    if (h) h[j] = s;
+                    if (dact) dact[j] = s * (1 - s);
+                }
+                break;
+            case Activation::Tanh:
+                for (std::size_t j = 0; j < n; j++) {
+                    const T t = std::tanh(z[j]);
+                    if (h) h[j] = t;
+                    if (dact) dact[j] = 1 - t * t;
+                }
+                break;
+        }
+    }
+
+}
+
+
+Activation activation_from_name(const std::string& name){
+    if (name == "linear")
+        return Activation::Linear;
+    if (name == "sigmoid")
+        return Activation::Sigmoid;
+    if (name == "tanh")
+        return Activation::Tanh;
+    if (name == "ReLu")
+        return Activation::ReLu;
+    if (name == "SoftMax")
+        return Activation::SoftMax;
+    std::cout << "Activation function not implemented" << std::endl;
+    return Activation::Linear;
+}
+
+template<typename T>
+void apply_epilogue(const Epilogue<T>& epilogue, std::size_t rows, std::size_t cols, std::size_t i0, std::size_t j0,
+                    T* z, std::size_t ldz){
+    const std::size_t ldh = epilogue.ldh > 0 ? epilogue.ldh : ldz;
+    for (std::size_t i = 0; i < rows; i++) {
+        T* row = z + i * ldz;
+        if (epilogue.bias)
+            for (std::size_t j = 0; j < cols; j++)
+                row[j] += epilogue.bias[j0 + j];
+        if (epilogue.h || epilogue.dact)
+            activate_row(epilogue.activation, cols, row,
+                         epilogue.h ? epilogue.h + (i0 + i) * ldh + j0 : nullptr,
+                         epilogue.dact ? epilogue.dact + (i0 + i) * ldh + j0 : nullptr);
+    }
+}
+
+template void apply_epilogue<float>(const Epilogue<float>& epilogue, std::size_t rows, std::size_t cols,
+                                    std::size_t i0, std::size_t j0, float* z, std::size_t ldz);
+template void apply_epilogue<double>(const Epilogue<double>& epilogue, std::size_t rows, std::size_t cols,
+                                     std::size_t i0, std::size_t j0, double* z, std::size_t ldz);
@@ -2,24 +2,26 @@
 // Created by filippo on 10/01/24.
 //
 #include "functions_utilities.hpp"
+#include "thread_pool.hpp"
 #include <cmath>
 
+namespace {
+
+    //! Elements per task of the element-wise loops: below it a loop runs on the calling thread
+    constexpr std::size_t element_grain = 1 << 14;
+
+}
+
+
 template<typename T>
 std::vector<T> operator+(const std::vector<T>& a, const std::vector<T>& b){
 
-    int num_threads;
-    int n = a.size();
+    const std::size_t n = a.size();
     std::vector<T> c(n);
 
-#ifdef _OPENMP
-    num_threads = 8;
-#else
-    num_threads = 1;
-#endif
-
-#pragma omp parallel for num_threads(num_threads) shared(a, b, c, n)
-    for (int i=0; i<n; i++)
-        c[i]= a[i] + b[i];
+    parallel_for(n, 0, [&](std::size_t i){
+        c[i] = a[i] + b[i];
+    }, element_grain);
 
     return c;
 }
@@ -32,15 +34,12 @@ template std::vector<float> operator+(const std::vector<float>& a, const std::ve
 template<typename T>
 T mse(const std::vector<T>& y, const std::vector<T>& target, int num_threads) {
 
-#ifdef _OPENMP
-    omp_set_num_threads(num_threads);
-#endif
-
-    T result = 0;
-#pragma omp parallel for shared(y, target) reduction(+:result)
-    for(int i = 0; i < y.size(); i++){
-        result += pow(y[i] - target[i], 2);
-    }
+    T result = parallel_reduce<T>(y.size(), num_threads, [&](std::size_t begin, std::size_t end){
+        T partial = 0;
+        for (std::size_t i = begin; i < end; i++)
+            partial += (y[i] - target[i]) * (y[i] - target[i]);
+        return partial;
+    }, element_grain);
     result = result / y.size();
     return result;
 
@@ -49,4 +48,4 @@ T mse(const std::vector<T>& y, const std::vector<T>& target, int num_threads) {
 
 
 template float mse<float>(const std::vector<float>& y,const std::vector<float>& target, int num_threads);
-template double mse<double>(const std::vector<double>& y,const std::vector<double>& target, int num_threads);
\ No newline at end of file
+template double mse<double>(const std::vector<double>& y,const std::vector<double>& target, int num_threads);
@@ -0,0 +1,283 @@
+#include "../include/gemm.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/matrixProd_AVX.hpp"
+#include "../include/mmm.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/matrix_layout.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+namespace {
+
+    //! C = beta * C. With beta = 0 C is not read, as in BLAS: a NaN left in C does not reach the result.
+    template<typename T>
+    void scale(std::size_t M, std::size_t N, T beta, T* C, std::size_t ldc){
+        if (beta == T(1))
+            return;
+        for (std::size_t i = 0; i < M; i++) {
+            T* c = C + i * ldc;
+            if (beta == T(0))
+                std::fill(c, c + N, T(0));
+            else
+                for (std::size_t j = 0; j < N; j++)
+                    c[j] *= beta;
+        }
+    }
+
+    //! C = alpha * op(A) * op(B) + beta * C with a kernel(D, ldd) that computes D += op(A) * op(B). With alpha = 1
+    //! the kernel accumulates in C scaled by beta; otherwise the product goes to a temporary, added to beta * C
+    //! scaled by alpha, so C is never divided by alpha (1 / alpha overflows for a tiny alpha)
+    template<typename T, typename Kernel>
+    void scaled_product(std::size_t M, std::size_t N, std::size_t K, T alpha, T beta, T* C, std::size_t ldc,
+                        Kernel kernel){
+        if (alpha == T(0) || K == 0) {
+            scale(M, N, beta, C, ldc);
+            return;
+        }
+        if (alpha == T(1)) {
+            scale(M, N, beta, C, ldc);
+            kernel(C, ldc);
+            return;
+        }
+        std::vector<T> product(M * N, T(0));
+        kernel(product.data(), N);
+        for (std::size_t i = 0; i < M; i++) {
+            T* c = C + i * ldc;
+            const T* p = product.data() + i * N;
+            if (beta == T(0))
+                for (std::size_t j = 0; j < N; j++)
+                    c[j] = alpha * p[j];
+            else
+                for (std::size_t j = 0; j < N; j++)
+                    c[j] = alpha * p[j] + beta * c[j];
+        }
+    }
+
+    //! Reference product, one dot product per element of C
+    template<typename T>
+    void gemm_naive(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                    T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                    T beta, T* C, std::size_t ldc){
+        for (std::size_t i = 0; i < M; i++)
+            for (std::size_t j = 0; j < N; j++) {
+                T acc = 0;
+                for (std::size_t k = 0; k < K; k++) {
+                    const T a = transA == Trans ? A[k * lda + i] : A[i * lda + k];
+                    const T b = transB == Trans ? B[j * ldb + k] : B[k * ldb + j];
+                    acc += a * b;
+                }
+                T& c = C[i * ldc + j];
+                c = beta == T(0) ? alpha * acc : alpha * acc + beta * c;
+            }
+    }
+
+    template<typename T>
+    void gemm_packed_provider(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                              T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                              T beta, T* C, std::size_t ldc){
+        scaled_product(M, N, K, alpha, beta, C, ldc, [&](T* D, std::size_t ldd){
+            gemm_packed<T>(transA, transB, M, N, K, A, lda, B, ldb, D, ldd);
+        });
+    }
+
+    //! The masked kernels read B by rows: a transposed B goes to the packed engine, as in mul_funct
+    template<typename T>
+    void gemm_avx_provider(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                           T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                           T beta, T* C, std::size_t ldc){
+        scaled_product(M, N, K, alpha, beta, C, ldc, [&](T* D, std::size_t ldd){
+            if (transB == Trans || matrixMultStrided_Simd<T>(transA, M, K, N, A, lda, B, ldb, D, ldd) == 0)
+                gemm_packed<T>(transA, transB, M, N, K, A, lda, B, ldb, D, ldd);
+        });
+    }
+
+    //! C = alpha * A * B + beta * C on tiled matrices (layout.hpp), one tile of C per task: the tiles of a row of A
+    //! and of a column of B are contiguous row-major blocks, multiplied in place by the micro-kernels of the packed
+    //! engine (gemm_packed.hpp) with the tile widths as leading dimensions
+    template<typename T>
+    void gemm_tiled(std::size_t M, std::size_t N, std::size_t K, T alpha, const T* A, const T* B, T beta, T* C){
+        const std::size_t tiles_down = (M + layout_tile - 1) / layout_tile;
+        const std::size_t tiles_across = (N + layout_tile - 1) / layout_tile;
+        parallel_for(tiles_down * tiles_across, 0, [&](std::size_t t){
+            const std::size_t i0 = t / tiles_across * layout_tile, j0 = t % tiles_across * layout_tile;
+            const std::size_t tr = std::min(layout_tile, M - i0), tc = std::min(layout_tile, N - j0);
+            T* c = C + layout_index(Layout::Tiled, i0, j0, M, N);
+            scaled_product(tr, tc, K, alpha, beta, c, tc, [&](T* D, std::size_t ldd){
+                for (std::size_t p0 = 0; p0 < K; p0 += layout_tile) {
+                    const std::size_t tp = std::min(layout_tile, K - p0);
+                    gemm_packed<T>(NoTrans, NoTrans, tr, tc, tp, A + layout_index(Layout::Tiled, i0, p0, M, K), tp,
+                                   B + layout_index(Layout::Tiled, p0, j0, K, N), tc, D, ldd);
+                }
+            });
+        });
+    }
+
+    //! op(X) as an array in a layout: op of a row-major matrix is a row- or column-major array, op of a tiled one is
+    //! tiled, or copied when transposed (X in column-major is op(X) in row-major)
+    template<typename T>
+    struct LayoutOperand{
+        const T* data;
+        Layout layout;
+        std::size_t rows, cols;         // of op(X)
+        std::vector<T> copy;            // the elements, when op(X) cannot be read in place
+
+        LayoutOperand(const MatrixFlat<T>& X, Transpose trans):
+            data(X.get_ptr()),
+            layout(X.layout()),
+            rows(trans == Trans ? X.ncols() : X.nrows()),
+            cols(trans == Trans ? X.nrows() : X.ncols())
+            {
+                if (trans == NoTrans)
+                    return;
+                if (layout == Layout::Tiled) {
+                    copy.resize(rows * cols);
+                    convert_layout(X.nrows(), X.ncols(), Layout::Tiled, data, Layout::ColMajor, copy.data());
+                    data = copy.data();
+                    layout = Layout::RowMajor;
+                }
+                else
+                    layout = layout == Layout::ColMajor ? Layout::RowMajor : Layout::ColMajor;
+            }
+
+        void convert(Layout target){
+            if (layout == target)
+                return;
+            std::vector<T> converted(rows * cols);
+            convert_layout(rows, cols, layout, data, target, converted.data());
+            copy.swap(converted);
+            data = copy.data();
+            layout = target;
+        }
+
+        //! The flag and leading dimension of gemm on the array
+        Transpose trans() const {return layout == Layout::ColMajor ? Trans : NoTrans;}
+        std::size_t ld() const {return layout == Layout::ColMajor ? rows : cols;}
+    };
+
+    const bool builtin_providers = register_gemm_provider({"packed", "packed-panel engine, gemm_packed.hpp",
+                                                           gemm_packed_provider<float>, gemm_packed_provider<double>}) &&
+                                   register_gemm_provider({"avx", "masked SIMD kernels, matrixProd_AVX.hpp",
+                                                           gemm_avx_provider<float>, gemm_avx_provider<double>}) &&
+                                   register_gemm_provider({"naive", "reference triple loop",
+                                                           gemm_naive<float>, gemm_naive<double>});
+
+}
+
+
+template<typename T>
+bool gemm(const std::string& provider, Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+          T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+          T beta, T* C, std::size_t ldc){
+
+    const GemmProvider* p = find_gemm_provider(provider);
+    if (!p) {
+        std::cout<<"Error: no GEMM provider named "<<provider<<std::endl;
+        return false;
+    }
+    if (!p->kernel<T>()) {
+        std::cout<<"Error: the GEMM provider "<<provider<<" has no kernel for this type"<<std::endl;
+        return false;
+    }
+    // the stored rows of A and B are op(A) and op(B) rows, or their columns when transposed
+    const std::size_t colsA = transA == Trans ? M : K, colsB = transB == Trans ? K : N;
+    if (lda < colsA || ldb < colsB || ldc < N) {
+        std::cout<<"Error: gemm with lda = "<<lda<<", ldb = "<<ldb<<", ldc = "<<ldc<<" on rows of "<<colsA<<", "
+                 <<colsB<<" and "<<N<<" elements"<<std::endl;
+        return false;
+    }
+    if (M == 0 || N == 0)
+        return true;
+
+    p->kernel<T>()(transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    return true;
+}
+
+template<typename T>
+bool gemm(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+          T alpha, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+          T beta, T* C, std::size_t ldc){
+    return gemm<T>(gemm_provider(), transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+template<typename T>
+bool gemm(Transpose transA, Transpose transB, T alpha, const MatrixFlat<T>& A, const MatrixFlat<T>& B,
+          T beta, MatrixFlat<T>& C){
+
+    if (A.layout() == Layout::RowMajor && B.layout() == Layout::RowMajor && C.layout() == Layout::RowMajor)
+        return gemm<T>(transA, transB, alpha, A.view(), B.view(), beta, C.view());
+
+    const std::size_t M = transA == Trans ? A.ncols() : A.nrows(), K = transA == Trans ? A.nrows() : A.ncols();
+    const std::size_t KB = transB == Trans ? B.ncols() : B.nrows(), N = transB == Trans ? B.nrows() : B.ncols();
+    if (K != KB || C.nrows() != M || C.ncols() != N) {
+        std::cerr<<"Error: cannot compute the "<<C.nrows()<<"X"<<C.ncols()<<" product of op(A) "<<M<<"X"<<K
+                 <<" by op(B) "<<KB<<"X"<<N<<". Stopping execution. "<<std::endl;
+        std::exit(-1);
+    }
+    LayoutOperand<T> a(A, transA), b(B, transB);
+
+    if (C.layout() == Layout::Tiled) {
+        a.convert(Layout::Tiled);
+        b.convert(Layout::Tiled);
+        gemm_tiled(M, N, K, alpha, a.data, b.data, beta, C.get_ptr());
+        return true;
+    }
+    if (a.layout == Layout::Tiled)
+        a.convert(Layout::RowMajor);
+    if (b.layout == Layout::Tiled)
+        b.convert(Layout::RowMajor);
+    if (C.layout() == Layout::RowMajor)
+        return gemm<T>(a.trans(), b.trans(), M, N, K, alpha, a.data, a.ld(), b.data, b.ld(), beta, C.get_ptr(), N);
+
+    // a column-major C is the row-major C^T = op(B)^T * op(A)^T, and the transpose of an array flips its layout
+    const Transpose transBt = b.trans() == Trans ? NoTrans : Trans, transAt = a.trans() == Trans ? NoTrans : Trans;
+    return gemm<T>(transBt, transAt, N, M, K, alpha, b.data, b.ld(), a.data, a.ld(), beta, C.get_ptr(), M);
+}
+
+template bool gemm<float>(const std::string& provider, Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                          float alpha, const float* A, std::size_t lda, const float* B, std::size_t ldb,
+                          float beta, float* C, std::size_t ldc);
+template bool gemm<double>(const std::string& provider, Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                           double alpha, const double* A, std::size_t lda, const double* B, std::size_t ldb,
+                           double beta, double* C, std::size_t ldc);
+template bool gemm<float>(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                          float alpha, const float* A, std::size_t lda, const float* B, std::size_t ldb,
+                          float beta, float* C, std::size_t ldc);
+template bool gemm<double>(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                           double alpha, const double* A, std::size_t lda, const double* B, std::size_t ldb,
+                           double beta, double* C, std::size_t ldc);
+template bool gemm<float>(Transpose transA, Transpose transB, float alpha, const MatrixFlat<float>& A, const MatrixFlat<float>& B,
+                          float beta, MatrixFlat<float>& C);
+template bool gemm<double>(Transpose transA, Transpose transB, double alpha, const MatrixFlat<double>& A, const MatrixFlat<double>& B,
+                           double beta, MatrixFlat<double>& C);
+
+
+void mmm_gemm(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, const std::string& provider){
+
+    //! Performs C += A*B in single precision with the GEMM provider named provider (see gemm.hpp)
+
+    std::cout<<"Performing mmm_gemm ("<<provider<<") in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    gemm(provider, NoTrans, NoTrans, A.nrows(), B.ncols(), A.ncols(), 1.0f, A.get_ptr(), A.ncols(),
+         B.get_ptr(), B.ncols(), 1.0f, C.get_ptr(), C.ncols());
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_gemm(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, const std::string& provider){
+
+    //! Performs C += A*B in double precision with the GEMM provider named provider (see gemm.hpp)
+
+    std::cout<<"Performing mmm_gemm ("<<provider<<") in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    gemm(provider, NoTrans, NoTrans, A.nrows(), B.ncols(), A.ncols(), 1.0, A.get_ptr(), A.ncols(),
+         B.get_ptr(), B.ncols(), 1.0, C.get_ptr(), C.ncols());
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
@@ -0,0 +1,479 @@
+#include "../include/gemv.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <immintrin.h>
+
+
+namespace {
+
+    //******************************************************************************************************************
+    // Vector primitives: dot(n, a, b) = sum a[i]*b[i] and axpy(n, alpha, x, y): y += alpha*x.
+    // One variant per SIMD tier, compiled for its own target and picked at runtime by select_vector_kernels().
+    // The dot products keep several independent accumulators so that the loop is limited by the memory bandwidth
+    // and not by the latency of the additions.
+    //******************************************************************************************************************
+
+    // The scalar versions also take the matrix in a 16 bit storage type S (see half.hpp), converted element by element
+    template<typename T, typename S>
+    T dot_scalar(std::size_t n, const S* a, const T* b){
+        T acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            acc0 += T(a[i]) * b[i];
+            acc1 += T(a[i + 1]) * b[i + 1];
+            acc2 += T(a[i + 2]) * b[i + 2];
+            acc3 += T(a[i + 3]) * b[i + 3];
+        }
+        for (; i < n; i++)
+            acc0 += T(a[i]) * b[i];
+        return (acc0 + acc1) + (acc2 + acc3);
+    }
+
+    template<typename T, typename S>
+    void axpy_scalar(std::size_t n, T alpha, const S* x, T* y){
+        for (std::size_t i = 0; i < n; i++)
+            y[i] += alpha * T(x[i]);
+    }
+
+
+    // SSE4
+    __attribute__((target("sse4.2")))
+    float dot_sse4(std::size_t n, const float* a, const float* b){
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),     _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        acc0 = _mm_add_ps(acc0, acc1);
+        acc0 = _mm_hadd_ps(acc0, acc0);
+        acc0 = _mm_hadd_ps(acc0, acc0);
+        float result = _mm_cvtss_f32(acc0);
+        for (; i < n; i++)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    __attribute__((target("sse4.2")))
+    double dot_sse4(std::size_t n, const double* a, const double* b){
+        __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i),     _mm_loadu_pd(b + i)));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+        }
+        acc0 = _mm_add_pd(acc0, acc1);
+        acc0 = _mm_hadd_pd(acc0, acc0);
+        double result = _mm_cvtsd_f64(acc0);
+        for (; i < n; i++)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    __attribute__((target("sse4.2")))
+    void axpy_sse4(std::size_t n, float alpha, const float* x, float* y){
+        const __m128 a = _mm_set1_ps(alpha);
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(a, _mm_loadu_ps(x + i))));
+        for (; i < n; i++)
+            y[i] += alpha * x[i];
+    }
+
+    __attribute__((target("sse4.2")))
+    void axpy_sse4(std::size_t n, double alpha, const double* x, double* y){
+        const __m128d a = _mm_set1_pd(alpha);
+        std::size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+        for (; i < n; i++)
+            y[i] += alpha * x[i];
+    }
+
+
+    // AVX2 + FMA
+    __attribute__((target("avx2,fma")))
+    float dot_avx2(std::size_t n, const float* a, const float* b){
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i),      _mm256_loadu_ps(b + i),      acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8),  _mm256_loadu_ps(b + i + 8),  acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+        }
+        for (; i + 8 <= n; i += 8)
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        const __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        float result = _mm_cvtss_f32(sum);
+        for (; i < n; i++)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    __attribute__((target("avx2,fma")))
+    double dot_avx2(std::size_t n, const double* a, const double* b){
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+        __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i),      _mm256_loadu_pd(b + i),      acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4),  _mm256_loadu_pd(b + i + 4),  acc1);
+            acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8),  _mm256_loadu_pd(b + i + 8),  acc2);
+            acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), acc3);
+        }
+        for (; i + 4 <= n; i += 4)
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        const __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+        __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum = _mm_hadd_pd(sum, sum);
+        double result = _mm_cvtsd_f64(sum);
+        for (; i < n; i++)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    __attribute__((target("avx2,fma")))
+    void axpy_avx2(std::size_t n, float alpha, const float* x, float* y){
+        const __m256 a = _mm256_set1_ps(alpha);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        for (; i < n; i++)
+            y[i] += alpha * x[i];
+    }
+
+    __attribute__((target("avx2,fma")))
+    void axpy_avx2(std::size_t n, double alpha, const double* x, double* y){
+        const __m256d a = _mm256_set1_pd(alpha);
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        for (; i < n; i++)
+            y[i] += alpha * x[i];
+    }
+
+
+    // AVX-512
+    __attribute__((target("avx512f")))
+    float dot_avx512(std::size_t n, const float* a, const float* b){
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i),      _mm512_loadu_ps(b + i),      acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+            acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), acc2);
+            acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), acc3);
+        }
+        for (; i + 16 <= n; i += 16)
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        float result = _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+        for (; i < n; i++)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    __attribute__((target("avx512f")))
+    double dot_avx512(std::size_t n, const double* a, const double* b){
+        __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+        __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i),      _mm512_loadu_pd(b + i),      acc0);
+            acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8),  _mm512_loadu_pd(b + i + 8),  acc1);
+            acc2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), acc2);
+            acc3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), acc3);
+        }
+        for (; i + 8 <= n; i += 8)
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+        double result = _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+        for (; i < n; i++)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    __attribute__((target("avx512f")))
+    void axpy_avx512(std::size_t n, float alpha, const float* x, float* y){
+        const __m512 a = _mm512_set1_ps(alpha);
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(y + i, _mm512_fmadd_ps(a, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+        for (; i < n; i++)
+            y[i] += alpha * x[i];
+    }
+
+    __attribute__((target("avx512f")))
+    void axpy_avx512(std::size_t n, double alpha, const double* x, double* y){
+        const __m512d a = _mm512_set1_pd(alpha);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+        for (; i < n; i++)
+            y[i] += alpha * x[i];
+    }
+
+
+
+
+    //******************************************************************************************************************
+    // Primitives with the matrix stored in 16 bit and the vectors in float: the rows are widened to fp32 right after
+    // the load (bfloat16 with a shift, float16 with F16C / AVX-512) and everything else is the same as above.
+    //******************************************************************************************************************
+
+    __attribute__((target("avx512f")))
+    inline __m512 load_avx512(const bf16_t* p){
+        const __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512 load_avx512(const fp16_t* p){
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    }
+
+    __attribute__((target("avx2,fma,f16c")))
+    inline __m256 load_avx2(const bf16_t* p){
+        const __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+    }
+
+    __attribute__((target("avx2,fma,f16c")))
+    inline __m256 load_avx2(const fp16_t* p){
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    template<typename S>
+    __attribute__((target("avx512f")))
+    float dot_half_avx512(std::size_t n, const S* a, const float* b){
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            acc0 = _mm512_fmadd_ps(load_avx512(a + i),      _mm512_loadu_ps(b + i),      acc0);
+            acc1 = _mm512_fmadd_ps(load_avx512(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+            acc2 = _mm512_fmadd_ps(load_avx512(a + i + 32), _mm512_loadu_ps(b + i + 32), acc2);
+            acc3 = _mm512_fmadd_ps(load_avx512(a + i + 48), _mm512_loadu_ps(b + i + 48), acc3);
+        }
+        for (; i + 16 <= n; i += 16)
+            acc0 = _mm512_fmadd_ps(load_avx512(a + i), _mm512_loadu_ps(b + i), acc0);
+        float result = _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+        for (; i < n; i++)
+            result += float(a[i]) * b[i];
+        return result;
+    }
+
+    template<typename S>
+    __attribute__((target("avx512f")))
+    void axpy_half_avx512(std::size_t n, float alpha, const S* x, float* y){
+        const __m512 a = _mm512_set1_ps(alpha);
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(y + i, _mm512_fmadd_ps(a, load_avx512(x + i), _mm512_loadu_ps(y + i)));
+        for (; i < n; i++)
+            y[i] += alpha * float(x[i]);
+    }
+
+    template<typename S>
+    __attribute__((target("avx2,fma,f16c")))
+    float dot_half_avx2(std::size_t n, const S* a, const float* b){
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            acc0 = _mm256_fmadd_ps(load_avx2(a + i),      _mm256_loadu_ps(b + i),      acc0);
+            acc1 = _mm256_fmadd_ps(load_avx2(a + i + 8),  _mm256_loadu_ps(b + i + 8),  acc1);
+            acc2 = _mm256_fmadd_ps(load_avx2(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+            acc3 = _mm256_fmadd_ps(load_avx2(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+        }
+        for (; i + 8 <= n; i += 8)
+            acc0 = _mm256_fmadd_ps(load_avx2(a + i), _mm256_loadu_ps(b + i), acc0);
+        const __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        float result = _mm_cvtss_f32(sum);
+        for (; i < n; i++)
+            result += float(a[i]) * b[i];
+        return result;
+    }
+
+    template<typename S>
+    __attribute__((target("avx2,fma,f16c")))
+    void axpy_half_avx2(std::size_t n, float alpha, const S* x, float* y){
+        const __m256 a = _mm256_set1_ps(alpha);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, load_avx2(x + i), _mm256_loadu_ps(y + i)));
+        for (; i < n; i++)
+            y[i] += alpha * float(x[i]);
+    }
+
+
+    //! dot and axpy of one tier, for vectors of T and a matrix stored as S
+    template<typename T, typename S = T>
+    struct VectorKernels{
+        T (*dot)(std::size_t n, const S* a, const T* b);
+        void (*axpy)(std::size_t n, T alpha, const S* x, T* y);
+    };
+
+    template<typename T, typename S>
+    VectorKernels<T, S> vector_kernels_for(SimdLevel level){
+        if constexpr (!std::is_same_v<T, S>) {
+            // 16 bit matrix: the AVX2 tier needs F16C as well, SSE4 falls back to the scalar conversion
+            if (level == SimdLevel::AVX512)
+                return {dot_half_avx512<S>, axpy_half_avx512<S>};
+            if (level == SimdLevel::AVX2 && cpu_features().f16c)
+                return {dot_half_avx2<S>, axpy_half_avx2<S>};
+            return {dot_scalar<T, S>, axpy_scalar<T, S>};
+        }
+        else {
+            switch (level) {
+                case SimdLevel::AVX512:
+                    return {dot_avx512, axpy_avx512};
+                case SimdLevel::AVX2:
+                    return {dot_avx2, axpy_avx2};
+                case SimdLevel::SSE4:
+                    return {dot_sse4, axpy_sse4};
+                default:
+                    return {dot_scalar<T, T>, axpy_scalar<T, T>};
+            }
+        }
+    }
+
+    //! Primitives of the best SIMD tier available on this machine, chosen once at the first call
+    template<typename T, typename S = T>
+    const VectorKernels<T, S>& select_vector_kernels(){
+        static const VectorKernels<T, S> kernels = vector_kernels_for<T, S>(simd_level());
+        return kernels;
+    }
+
+
+    //! Below this number of matrix elements the cost of waking up the threads is larger than the product itself
+    constexpr std::size_t parallel_threshold = 1 << 15;
+
+    //! Rows shorter than this do not fill a vector register: they are processed by the inlined scalar loops, which
+    //! avoids an indirect call per row (e.g. the 3 outputs of the iris network)
+    constexpr std::size_t narrow_rows = 16;
+
+
+    //! Body of gemv, for vectors of T and a matrix stored as S. The epilogue, if any, is applied to y seen as a row.
+    template<typename T, typename S>
+    void gemv_impl(Transpose trans, std::size_t M, std::size_t N, const S* A, std::size_t lda, const T* x, T* y,
+                   int numThreads, const Epilogue<T>* epilogue = nullptr){
+
+        if (M == 0 || N == 0)
+            return;
+
+        const std::size_t ny = trans == NoTrans ? M : N;
+
+        if (N < narrow_rows) {
+            if (trans == NoTrans)
+                for (std::size_t i = 0; i < M; i++)
+                    y[i] += dot_scalar(N, A + i * lda, x);
+            else
+                for (std::size_t i = 0; i < M; i++)
+                    axpy_scalar(N, x[i], A + i * lda, y);
+            if (epilogue)
+                apply_epilogue(*epilogue, 1, ny, 0, 0, y, ny);
+            return;
+        }
+
+        const VectorKernels<T, S>& k = select_vector_kernels<T, S>();
+        numThreads = resolve_threads(numThreads);
+        const bool parallel = numThreads > 1 && M * N >= parallel_threshold;
+
+        if (trans == NoTrans) {
+            // y[i] += <row i of A, x>: every row is read once, contiguously
+            parallel_for(M, parallel ? numThreads : 1, [&](std::size_t i){
+                y[i] += k.dot(N, A + i * lda, x);
+            }, std::max<std::size_t>(1, M / (4 * numThreads)));
+            if (epilogue)
+                apply_epilogue(*epilogue, 1, ny, 0, 0, y, ny);
+        } else {
+            // y += sum_i x[i] * (row i of A). Every thread owns a chunk of y, which stays in cache while the rows of
+            // its columns stream by, so no reduction is needed. Rows multiplied by a zero (e.g. after a ReLU) are skipped.
+            // The epilogue is applied to the chunk by the same thread, before it leaves the cache.
+            const std::size_t per_thread = (N + numThreads - 1) / numThreads;
+            const std::size_t chunk = std::min<std::size_t>(2048, std::max<std::size_t>(64, ((per_thread + 15) / 16) * 16));
+            const std::size_t n_chunks = (N + chunk - 1) / chunk;
+            parallel_for(n_chunks, parallel ? numThreads : 1, [&](std::size_t c){
+                const std::size_t j0 = c * chunk;
+                const std::size_t len = std::min(chunk, N - j0);
+                for (std::size_t i = 0; i < M; i++)
+                    if (x[i] != T(0))
+                        k.axpy(len, x[i], A + i * lda + j0, y + j0);
+                if (epilogue)
+                    apply_epilogue(*epilogue, 1, len, 0, j0, y + j0, ny);
+            });
+        }
+    }
+
+}
+
+
+template<typename T>
+void gemv(Transpose trans, std::size_t M, std::size_t N, const T* A, std::size_t lda, const T* x, T* y, int numThreads){
+    gemv_impl<T, T>(trans, M, N, A, lda, x, y, numThreads);
+}
+
+template void gemv<float>(Transpose trans, std::size_t M, std::size_t N, const float* A, std::size_t lda,
+                          const float* x, float* y, int numThreads);
+template void gemv<double>(Transpose trans, std::size_t M, std::size_t N, const double* A, std::size_t lda,
+                           const double* x, double* y, int numThreads);
+
+template<typename T>
+void gemv(Transpose trans, std::size_t M, std::size_t N, const T* A, std::size_t lda, const T* x, T* y,
+          const Epilogue<T>& epilogue, int numThreads){
+    gemv_impl<T, T>(trans, M, N, A, lda, x, y, numThreads, &epilogue);
+}
+
+template void gemv<float>(Transpose trans, std::size_t M, std::size_t N, const float* A, std::size_t lda,
+                          const float* x, float* y, const Epilogue<float>& epilogue, int numThreads);
+template void gemv<double>(Transpose trans, std::size_t M, std::size_t N, const double* A, std::size_t lda,
+                           const double* x, double* y, const Epilogue<double>& epilogue, int numThreads);
+
+void gemv(Transpose trans, std::size_t M, std::size_t N, const bf16_t* A, std::size_t lda, const float* x, float* y,
+          int numThreads){
+    gemv_impl<float, bf16_t>(trans, M, N, A, lda, x, y, numThreads);
+}
+
+void gemv(Transpose trans, std::size_t M, std::size_t N, const fp16_t* A, std::size_t lda, const float* x, float* y,
+          int numThreads){
+    gemv_impl<float, fp16_t>(trans, M, N, A, lda, x, y, numThreads);
+}
+
+
+template<typename T>
+void ger(std::size_t M, std::size_t N, T alpha, const T* x, const T* y, T* A, std::size_t lda, int numThreads){
+
+    if (M == 0 || N == 0 || alpha == T(0))
+        return;
+
+    if (N < narrow_rows) {
+        for (std::size_t i = 0; i < M; i++)
+            axpy_scalar(N, alpha * x[i], y, A + i * lda);
+        return;
+    }
+
+    const VectorKernels<T>& k = select_vector_kernels<T>();
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && M * N >= parallel_threshold;
+
+    // row i of A += (alpha * x[i]) * y, the rows with x[i] == 0 are left untouched
+    parallel_for(M, parallel ? numThreads : 1, [&](std::size_t i){
+        if (x[i] != T(0))
+            k.axpy(N, alpha * x[i], y, A + i * lda);
+    }, std::max<std::size_t>(1, M / (4 * numThreads)));
+}
+
+template void ger<float>(std::size_t M, std::size_t N, float alpha, const float* x, const float* y, float* A,
+                         std::size_t lda, int numThreads);
+template void ger<double>(std::size_t M, std::size_t N, double alpha, const double* x, const double* y, double* A,
+                          std::size_t lda, int numThreads);
@@ -0,0 +1,123 @@
+#include "../include/half.hpp"
+#include "../include/cpu_features.hpp"
+#include <immintrin.h>
+
+
+namespace {
+
+    //******************************************************************************************************************
+    // SIMD conversions, one per instruction set, each compiled for its own target. The tails are converted with the
+    // scalar functions of half.hpp.
+    //******************************************************************************************************************
+
+    __attribute__((target("avx512f,avx512bf16")))
+    void float_to_bf16_avx512(const float* src, bf16_t* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), (__m256i)_mm512_cvtneps_pbh(_mm512_loadu_ps(src + i)));
+        for (; i < n; i++)
+            dst[i] = bf16_t(src[i]);
+    }
+
+    __attribute__((target("avx512f")))
+    void bf16_to_float_avx512(const bf16_t* src, float* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+            _mm512_storeu_ps(dst + i, _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16)));
+        }
+        for (; i < n; i++)
+            dst[i] = src[i];
+    }
+
+    __attribute__((target("avx2")))
+    void bf16_to_float_avx2(const bf16_t* src, float* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)));
+        }
+        for (; i < n; i++)
+            dst[i] = src[i];
+    }
+
+    __attribute__((target("avx512f")))
+    void float_to_fp16_avx512(const float* src, fp16_t* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                                _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        for (; i < n; i++)
+            dst[i] = fp16_t(src[i]);
+    }
+
+    __attribute__((target("avx512f")))
+    void fp16_to_float_avx512(const fp16_t* src, float* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i))));
+        for (; i < n; i++)
+            dst[i] = src[i];
+    }
+
+    __attribute__((target("avx,f16c")))
+    void float_to_fp16_f16c(const float* src, fp16_t* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                             _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        for (; i < n; i++)
+            dst[i] = fp16_t(src[i]);
+    }
+
+    __attribute__((target("avx,f16c")))
+    void fp16_to_float_f16c(const fp16_t* src, float* dst, std::size_t n){
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+        for (; i < n; i++)
+            dst[i] = src[i];
+    }
+
+    template<typename S, typename D>
+    void convert_scalar(const S* src, D* dst, std::size_t n){
+        for (std::size_t i = 0; i < n; i++)
+            dst[i] = D(static_cast<float>(src[i]));
+    }
+
+}
+
+
+void convert(const float* src, bf16_t* dst, std::size_t n){
+    if (simd_level() >= SimdLevel::AVX512 && cpu_features().avx512_bf16)
+        float_to_bf16_avx512(src, dst, n);
+    else
+        convert_scalar(src, dst, n);
+}
+
+void convert(const bf16_t* src, float* dst, std::size_t n){
+    if (simd_level() >= SimdLevel::AVX512)
+        bf16_to_float_avx512(src, dst, n);
+    else if (simd_level() >= SimdLevel::AVX2)
+        bf16_to_float_avx2(src, dst, n);
+    else
+        convert_scalar(src, dst, n);
+}
+
+void convert(const float* src, fp16_t* dst, std::size_t n){
+    if (simd_level() >= SimdLevel::AVX512)
+        float_to_fp16_avx512(src, dst, n);
+    else if (simd_level() >= SimdLevel::AVX2 && cpu_features().f16c)
+        float_to_fp16_f16c(src, dst, n);
+    else
+        convert_scalar(src, dst, n);
+}
+
+void convert(const fp16_t* src, float* dst, std::size_t n){
+    if (simd_level() >= SimdLevel::AVX512)
+        fp16_to_float_avx512(src, dst, n);
+    else if (simd_level() >= SimdLevel::AVX2 && cpu_features().f16c)
+        fp16_to_float_f16c(src, dst, n);
+    else
+        convert_scalar(src, dst, n);
+}
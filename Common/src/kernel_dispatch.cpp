@@ -0,0 +1,278 @@
+#include "../include/kernel_dispatch.hpp"
+#include "../include/matrixProd_VM_VV.hpp"
+#include "../include/matrixProd_AVX.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/gemv.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <tuple>
+
+
+namespace {
+
+    double product_flops(std::size_t m, std::size_t n, std::size_t nb){
+        return 2.0 * double(m) * double(n) * double(nb);
+    }
+
+    //! Best time [us] of the plan on the shape out of `repetitions` runs, after a warm up run, on random operands
+    template<typename T>
+    double benchmark(const MulPlan& plan, std::size_t m, std::size_t n, std::size_t nb,
+                     Transpose transA, Transpose transB, int repetitions){
+        std::mt19937 gen(44);
+        std::uniform_real_distribution<T> dist(-1, 1);
+        std::vector<T> a(m * n), b(n * nb), c(m * nb, 0);
+        for (T& x : a)
+            x = dist(gen);
+        for (T& x : b)
+            x = dist(gen);
+        run_product(plan, a, b, c, m, n, nb, transA, transB);
+        double best = -1;
+        for (int r = 0; r < repetitions; r++) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            run_product(plan, a, b, c, m, n, nb, transA, transB);
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            const double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+            if (best < 0 || us < best)
+                best = us;
+        }
+        return best;
+    }
+
+    //! Shape of a product, key of the plan cache
+    struct PlanKey{
+        int dtype_size;
+        std::size_t m, n, nb;
+        Transpose transA, transB;
+
+        bool operator<(const PlanKey& other) const{
+            return std::tie(dtype_size, m, n, nb, transA, transB)
+                 < std::tie(other.dtype_size, other.m, other.n, other.nb, other.transA, other.transB);
+        }
+    };
+
+    // the calibration holds cost_mutex while it runs products, the planning only takes plan_mutex to read and
+    // write the cache, so two threads can plan at the same time
+    std::mutex cost_mutex, plan_mutex;
+    // (dtype size, kernel, threads, shape, transA, transB)
+    std::map<std::tuple<int, MulKernel, int, ShapeClass, Transpose, Transpose>, KernelCost> costs;
+    std::map<PlanKey, MulPlan> plans;
+
+}
+
+
+std::string mul_kernel_name(MulKernel kernel){
+    switch (kernel) {
+        case MulKernel::Vector:
+            return "gemv/ger";
+        case MulKernel::CacheOptimised:
+            return "cache optimised";
+        case MulKernel::Simd:
+            return "simd";
+        case MulKernel::Packed:
+            return "packed";
+    }
+    return "unknown";
+}
+
+ShapeClass shape_class(std::size_t m, std::size_t n, std::size_t nb){
+    if (m == 1)
+        return ShapeClass::Row;
+    if (n == 1)
+        return ShapeClass::Outer;
+    if (nb == 1)
+        return ShapeClass::Column;
+    return ShapeClass::Matrix;
+}
+
+DispatchMode dispatch_mode(){
+    const char* env = std::getenv("NNET_DISPATCH");
+    return env && std::string(env) == "benchmark" ? DispatchMode::Benchmark : DispatchMode::CostModel;
+}
+
+
+template<typename T>
+std::vector<MulPlan> mul_candidates(std::size_t m, std::size_t n, std::size_t nb){
+    const int pool = pool_concurrency();
+    std::vector<MulPlan> candidates;
+    if (shape_class(m, n, nb) != ShapeClass::Matrix) {
+        candidates.push_back({MulKernel::Vector, 1});
+        if (pool > 1)
+            candidates.push_back({MulKernel::Vector, pool});
+    }
+    candidates.push_back({MulKernel::CacheOptimised, 1});
+    if (simd_level() != SimdLevel::Scalar)
+        candidates.push_back({MulKernel::Simd, 1});
+    if (pool > 1)
+        candidates.push_back({MulKernel::Packed, pool});
+    return candidates;
+}
+
+template<typename T>
+KernelCost kernel_cost(const MulPlan& candidate, ShapeClass shape, Transpose transA, Transpose transB){
+
+    std::lock_guard<std::mutex> lock(cost_mutex);
+    const auto key = std::make_tuple(static_cast<int>(sizeof(T)), candidate.kernel, candidate.threads, shape, transA, transB);
+    const auto it = costs.find(key);
+    if (it != costs.end())
+        return it->second;
+
+    // a small product gives the cost of a call, a large one the rate: the vector shapes are timed on a matrix that
+    // fits in L2 (the layers of a model), the others on cubes, larger for the whole pool so that all its threads get
+    // work. The transpose flags are the ones of the product: they change the kernel (Simd runs a transposed product
+    // on the packed engine) and the order in which the operands are read
+    std::size_t small[3] = {8, 8, 8}, large[3] = {128, 128, 128};
+    if (shape != ShapeClass::Matrix) {
+        const int unit = static_cast<int>(shape) - 1;      // the dimension that is 1
+        for (int d = 0; d < 3; d++) {
+            small[d] = d == unit ? 1 : 32;
+            large[d] = d == unit ? 1 : 256;
+        }
+    }
+    else if (candidate.threads > 1) {
+        large[0] = large[1] = large[2] = 256;
+    }
+    const double t_small = benchmark<T>(candidate, small[0], small[1], small[2], transA, transB, 5);
+    const double t_large = benchmark<T>(candidate, large[0], large[1], large[2], transA, transB, 3);
+    const double f_small = product_flops(small[0], small[1], small[2]), f_large = product_flops(large[0], large[1], large[2]);
+
+    KernelCost cost;
+    cost.flops_per_us = (f_large - f_small) / std::max(t_large - t_small, 1e-3);
+    cost.overhead_us = std::max(0.0, t_small - f_small / cost.flops_per_us);
+    costs[key] = cost;
+    return cost;
+}
+
+template<typename T>
+MulPlan plan_product(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB,
+                     DispatchMode mode){
+
+    std::vector<MulPlan> candidates = mul_candidates<T>(m, n, nb);
+    const ShapeClass shape = shape_class(m, n, nb);
+    MulPlan* best = &candidates[0];
+    for (MulPlan& candidate : candidates) {
+        const KernelCost cost = kernel_cost<T>(candidate, shape, transA, transB);
+        candidate.time_us = cost.overhead_us + product_flops(m, n, nb) / cost.flops_per_us;
+        if (candidate.time_us < best->time_us)
+            best = &candidate;
+    }
+    if (mode == DispatchMode::CostModel)
+        return *best;
+
+    // only the candidates within 4x of the prediction of the best are timed, so a large product never runs on the
+    // slow kernels
+    const double bound = 4 * best->time_us;
+    MulPlan* measured = nullptr;
+    for (MulPlan& candidate : candidates) {
+        if (candidate.time_us > bound)
+            continue;
+        candidate.time_us = benchmark<T>(candidate, m, n, nb, transA, transB, 3);
+        if (!measured || candidate.time_us < measured->time_us)
+            measured = &candidate;
+    }
+    return *measured;
+}
+
+template<typename T>
+MulPlan product_plan(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB){
+    const PlanKey key{static_cast<int>(sizeof(T)), m, n, nb, transA, transB};
+    {
+        std::lock_guard<std::mutex> lock(plan_mutex);
+        const auto it = plans.find(key);
+        if (it != plans.end())
+            return it->second;
+    }
+    const MulPlan plan = plan_product<T>(m, n, nb, transA, transB);
+    std::lock_guard<std::mutex> lock(plan_mutex);
+    // if another thread planned the same shape meanwhile its plan is kept, so all the callers agree
+    return plans.emplace(key, plan).first->second;
+}
+
+
+template<typename T>
+bool mul_vector(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c,
+                std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB, int numThreads){
+    //a column times a row: rank-1 update, accumulated in c (the transpose of a vector has the same memory layout)
+    if (n == 1) {
+        ger<T>(m, nb, T(1), a.data(), b.data(), c.data(), nb, numThreads);
+        return true;
+    }
+    //a row vector times op(b)
+    if (m == 1) {
+        if (transB == NoTrans)
+            gemv<T>(Trans, n, nb, b.data(), nb, a.data(), c.data(), numThreads);
+        else
+            gemv<T>(NoTrans, nb, n, b.data(), n, a.data(), c.data(), numThreads);
+        return true;
+    }
+    //op(a) times a column vector
+    if (nb == 1) {
+        if (transA == NoTrans)
+            gemv<T>(NoTrans, m, n, a.data(), n, b.data(), c.data(), numThreads);
+        else
+            gemv<T>(Trans, n, m, a.data(), m, b.data(), c.data(), numThreads);
+        return true;
+    }
+    return false;
+}
+
+template<typename T>
+void run_product(const MulPlan& plan, const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c,
+                 std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB){
+    int64_t t;
+    const std::size_t lda = transA == Trans ? m : n, ldb = transB == Trans ? n : nb;
+    const bool plain = transA == NoTrans && transB == NoTrans;
+    switch (plan.kernel) {
+        case MulKernel::Vector:
+            if (mul_vector(a, b, c, m, n, nb, transA, transB, plan.threads))
+                return;
+            break;
+        case MulKernel::Simd:
+            //the masked kernels read b by rows, the transposed operands go to the packed engine
+            if (!plain)
+                gemm_packed<T>(transA, transB, m, nb, n, a.data(), lda, b.data(), ldb, c.data(), nb, 1);
+            else if (matrixMultMasked_Simd<T>(a, b, c, m, n, nb, t) == 0)
+                break;
+            return;
+        case MulKernel::Packed:
+            gemm_packed<T>(transA, transB, m, nb, n, a.data(), lda, b.data(), ldb, c.data(), nb, plan.threads);
+            return;
+        case MulKernel::CacheOptimised:
+            break;
+    }
+    //the cache optimised kernels, also when the planned one cannot run the product
+    if (plain)
+        MatrixCaheOptimised<T>(const_cast<std::vector<T>&>(a), const_cast<std::vector<T>&>(b), c, m, n, nb, t);
+    else
+        MatrixCaheOptimisedTrans<T>(a, b, c, m, n, nb, transA, transB, t);
+}
+
+
+template std::vector<MulPlan> mul_candidates<float>(std::size_t m, std::size_t n, std::size_t nb);
+template std::vector<MulPlan> mul_candidates<double>(std::size_t m, std::size_t n, std::size_t nb);
+
+template KernelCost kernel_cost<float>(const MulPlan& candidate, ShapeClass shape, Transpose transA, Transpose transB);
+template KernelCost kernel_cost<double>(const MulPlan& candidate, ShapeClass shape, Transpose transA, Transpose transB);
+
+template MulPlan plan_product<float>(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB,
+                                     DispatchMode mode);
+template MulPlan plan_product<double>(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB,
+                                      DispatchMode mode);
+
+template MulPlan product_plan<float>(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB);
+template MulPlan product_plan<double>(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB);
+
+template bool mul_vector<float>(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c,
+                                std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB, int numThreads);
+template bool mul_vector<double>(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c,
+                                 std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB, int numThreads);
+
+template void run_product<float>(const MulPlan& plan, const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c,
+                                 std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB);
+template void run_product<double>(const MulPlan& plan, const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c,
+                                  std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB);
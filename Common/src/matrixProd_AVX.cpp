@@ -1,7 +1,16 @@
 #include "../include/matrixProd_AVX.hpp"
+#include "../include/cpu_features.hpp"
 #include<chrono>
 #include<iostream>
 
+//******************************************************************************************
+
+//Every kernel of this file is compiled for its own instruction set through the target attribute, so the file does
+//not need -mavx2 -mfma: the caller has to check cpu_features() / simd_level() before calling them, or go through
+//matrixMult_Simd that does it
+
+//******************************************************************************************
+
 
 
 /**
@@ -115,13 +124,14 @@ int matrixMultTransposeOpt_Avx(std::vector<float>& a, std::vector<float>& b_tran
 **/
 
 template<>
+__attribute__((target("avx2,fma")))
     int matrixMult_Avx(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c,size_t ma, size_t na, size_t nb, int64_t& dt_01){
         const auto t0 = std::chrono::high_resolution_clock::now();
   //prova su double
     __m256d A,B,result;
     for (size_t i =0; i<ma; i++){
        //result = _mm256_setzero_pd();
-       for(size_t q = 0; q <= na; q +=4){
+       for(size_t q = 0; q < nb; q +=4){
         result = _mm256_setzero_pd();
           for(size_t j=0; j<na; j++){
             A = _mm256_broadcast_sd(&a[j+i*na]);
@@ -138,13 +148,14 @@ template<>
 
 
 template<>
+__attribute__((target("avx2,fma")))
 int matrixMult_Avx(const std::vector<float>& a,const  std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
     const auto t0 = std::chrono::high_resolution_clock::now();
   //prova su double
     __m256 A,B,result;
     for (size_t i =0; i<ma; i++){
        //result = _mm256_setzero_pd();
-       for(size_t q = 0; q <= na; q +=8){
+       for(size_t q = 0; q < nb; q +=8){
         result = _mm256_setzero_ps();
           for(size_t j=0; j<na; j++){
             A = _mm256_broadcast_ss(&a[j+i*na]);
@@ -163,6 +174,7 @@ int matrixMult_Avx(const std::vector<float>& a,const  std::vector<float>& b, std
 
 
 template<>
+__attribute__((target("avx2,fma")))
 int matrixMultTransposeOpt_Avx(std::vector<double>& a, std::vector<double>& b_transpose, std::vector<double>& c, size_t ma, size_t na, size_t nb,  int64_t& dt_01){
         const auto t0 = std::chrono::high_resolution_clock::now();
   //prova su double
@@ -192,6 +204,7 @@ int matrixMultTransposeOpt_Avx(std::vector<double>& a, std::vector<double>& b_tr
 }
 
 template<>
+__attribute__((target("avx2,fma")))
 int matrixMultTransposeOpt_Avx(std::vector<float>& a, std::vector<float>& b_transpose, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
     const auto t0 = std::chrono::high_resolution_clock::now();
   //prova su double
@@ -225,4 +238,436 @@ int matrixMultTransposeOpt_Avx(std::vector<float>& a, std::vector<float>& b_tran
 
 
 
+//******************************************************************************************
+//SSE4 and AVX-512 versions of matrixMult_Avx, same algorithm on 128 and 512 bit registers
+
+template<>
+__attribute__((target("sse4.2")))
+int matrixMult_Sse(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    __m128d A,B,result;
+    for (size_t i =0; i<ma; i++){
+       for(size_t q = 0; q < nb; q +=2){
+        result = _mm_setzero_pd();
+          for(size_t j=0; j<na; j++){
+            A = _mm_set1_pd(a[j+i*na]);
+            B = _mm_loadu_pd(&b[j*nb+q]);
+            result =  _mm_add_pd(result, _mm_mul_pd(A, B));
+          }
+          _mm_storeu_pd(&c[i*nb+q], result);
+        }
+    }
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 307;
+}
+
+template<>
+__attribute__((target("sse4.2")))
+int matrixMult_Sse(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    __m128 A,B,result;
+    for (size_t i =0; i<ma; i++){
+       for(size_t q = 0; q < nb; q +=4){
+        result = _mm_setzero_ps();
+          for(size_t j=0; j<na; j++){
+            A = _mm_set1_ps(a[j+i*na]);
+            B = _mm_loadu_ps(&b[j*nb+q]);
+            result =  _mm_add_ps(result, _mm_mul_ps(A, B));
+          }
+          _mm_storeu_ps(&c[i*nb+q], result);
+        }
+    }
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 307;
+}
+
+template<>
+__attribute__((target("avx512f")))
+int matrixMult_Avx512(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    __m512d A,B,result;
+    for (size_t i =0; i<ma; i++){
+       for(size_t q = 0; q < nb; q +=8){
+        result = _mm512_setzero_pd();
+          for(size_t j=0; j<na; j++){
+            A = _mm512_set1_pd(a[j+i*na]);
+            B = _mm512_loadu_pd(&b[j*nb+q]);
+            result =  _mm512_fmadd_pd(A, B, result);
+          }
+          _mm512_storeu_pd(&c[i*nb+q], result);
+        }
+    }
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 308;
+}
+
+template<>
+__attribute__((target("avx512f")))
+int matrixMult_Avx512(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    __m512 A,B,result;
+    for (size_t i =0; i<ma; i++){
+       for(size_t q = 0; q < nb; q +=16){
+        result = _mm512_setzero_ps();
+          for(size_t j=0; j<na; j++){
+            A = _mm512_set1_ps(a[j+i*na]);
+            B = _mm512_loadu_ps(&b[j*nb+q]);
+            result =  _mm512_fmadd_ps(A, B, result);
+          }
+          _mm512_storeu_ps(&c[i*nb+q], result);
+        }
+    }
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 308;
+}
+
+
+
+//******************************************************************************************
+//Runtime dispatcher: calls the widest version supported by the CPU, returns 0 on CPUs without SSE4 so that the
+//caller can fall back to a scalar algorithm
+
+template<typename T>
+int matrixMult_Simd(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    switch(simd_level()){
+        case SimdLevel::AVX512:
+            return matrixMult_Avx512<T>(a, b, c, ma, na, nb, dt_01);
+        case SimdLevel::AVX2:
+            return matrixMult_Avx<T>(a, b, c, ma, na, nb, dt_01);
+        case SimdLevel::SSE4:
+            return matrixMult_Sse<T>(a, b, c, ma, na, nb, dt_01);
+        default:
+            return 0;
+    }
+}
+
+template int matrixMult_Simd<float>(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+template int matrixMult_Simd<double>(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+
+
+//******************************************************************************************
+//Masked versions: c += a*b on the caller's vectors, for any ma, na, nb.
+//Every row of c is computed in blocks of 4 registers (4 independent accumulators, so the broadcast of a[i][j] is
+//reused 4 times), then one register at a time, then the last nb % width columns with a masked load/store.
+//The kernels read a[i][j] at a[i*ars + j*acs] and the rows of b and c through their leading dimensions, so the same
+//code serves the vectors (ars = na, acs = 1), the sub-blocks and a transposed a (ars = 1, acs = lda)
+
+namespace {
+
+    __attribute__((target("sse4.2")))
+    void masked_sse(const double* a, size_t ars, size_t acs, const double* b, size_t ldb, double* c, size_t ldc, size_t ma, size_t na, size_t nb){
+        const size_t full = nb - nb % 2;
+        __m128d A,result;
+        for (size_t i =0; i<ma; i++){
+            const double* arow = a + i*ars;
+            double* crow = c + i*ldc;
+            for(size_t q = 0; q < full; q +=2){
+                result = _mm_loadu_pd(crow + q);
+                for(size_t j=0; j<na; j++){
+                    A = _mm_set1_pd(arow[j*acs]);
+                    result = _mm_add_pd(result, _mm_mul_pd(A, _mm_loadu_pd(b + j*ldb + q)));
+                }
+                _mm_storeu_pd(crow + q, result);
+            }
+            for(size_t q = full; q < nb; q++){
+                double acc = crow[q];
+                for(size_t j=0; j<na; j++)
+                    acc += arow[j*acs] * b[j*ldb+q];
+                crow[q] = acc;
+            }
+        }
+    }
+
+    __attribute__((target("sse4.2")))
+    void masked_sse(const float* a, size_t ars, size_t acs, const float* b, size_t ldb, float* c, size_t ldc, size_t ma, size_t na, size_t nb){
+        const size_t full = nb - nb % 4;
+        __m128 A,result;
+        for (size_t i =0; i<ma; i++){
+            const float* arow = a + i*ars;
+            float* crow = c + i*ldc;
+            for(size_t q = 0; q < full; q +=4){
+                result = _mm_loadu_ps(crow + q);
+                for(size_t j=0; j<na; j++){
+                    A = _mm_set1_ps(arow[j*acs]);
+                    result = _mm_add_ps(result, _mm_mul_ps(A, _mm_loadu_ps(b + j*ldb + q)));
+                }
+                _mm_storeu_ps(crow + q, result);
+            }
+            for(size_t q = full; q < nb; q++){
+                float acc = crow[q];
+                for(size_t j=0; j<na; j++)
+                    acc += arow[j*acs] * b[j*ldb+q];
+                crow[q] = acc;
+            }
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void masked_avx(const double* a, size_t ars, size_t acs, const double* b, size_t ldb, double* c, size_t ldc, size_t ma, size_t na, size_t nb){
+        const size_t full = nb - nb % 4;
+        //lane l is active if l < nb % 4 (the sign bit of every 64 bit lane selects it)
+        const __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(nb % 4), _mm256_setr_epi64x(0, 1, 2, 3));
+        __m256d A,r0,r1,r2,r3;
+        for (size_t i =0; i<ma; i++){
+            const double* arow = a + i*ars;
+            double* crow = c + i*ldc;
+            size_t q = 0;
+            for(; q + 16 <= nb; q += 16){
+                r0 = _mm256_loadu_pd(crow + q);
+                r1 = _mm256_loadu_pd(crow + q + 4);
+                r2 = _mm256_loadu_pd(crow + q + 8);
+                r3 = _mm256_loadu_pd(crow + q + 12);
+                for(size_t j=0; j<na; j++){
+                    A = _mm256_broadcast_sd(arow + j*acs);
+                    const double* brow = b + j*ldb + q;
+                    r0 = _mm256_fmadd_pd(A, _mm256_loadu_pd(brow),      r0);
+                    r1 = _mm256_fmadd_pd(A, _mm256_loadu_pd(brow + 4),  r1);
+                    r2 = _mm256_fmadd_pd(A, _mm256_loadu_pd(brow + 8),  r2);
+                    r3 = _mm256_fmadd_pd(A, _mm256_loadu_pd(brow + 12), r3);
+                }
+                _mm256_storeu_pd(crow + q,      r0);
+                _mm256_storeu_pd(crow + q + 4,  r1);
+                _mm256_storeu_pd(crow + q + 8,  r2);
+                _mm256_storeu_pd(crow + q + 12, r3);
+            }
+            for(; q < full; q += 4){
+                r0 = _mm256_loadu_pd(crow + q);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm256_fmadd_pd(_mm256_broadcast_sd(arow + j*acs), _mm256_loadu_pd(b + j*ldb + q), r0);
+                _mm256_storeu_pd(crow + q, r0);
+            }
+            if(q < nb){
+                r0 = _mm256_maskload_pd(crow + q, mask);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm256_fmadd_pd(_mm256_broadcast_sd(arow + j*acs), _mm256_maskload_pd(b + j*ldb + q, mask), r0);
+                _mm256_maskstore_pd(crow + q, mask, r0);
+            }
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void masked_avx(const float* a, size_t ars, size_t acs, const float* b, size_t ldb, float* c, size_t ldc, size_t ma, size_t na, size_t nb){
+        const size_t full = nb - nb % 8;
+        //lane l is active if l < nb % 8 (the sign bit of every 32 bit lane selects it)
+        const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(nb % 8), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256 A,r0,r1,r2,r3;
+        for (size_t i =0; i<ma; i++){
+            const float* arow = a + i*ars;
+            float* crow = c + i*ldc;
+            size_t q = 0;
+            for(; q + 32 <= nb; q += 32){
+                r0 = _mm256_loadu_ps(crow + q);
+                r1 = _mm256_loadu_ps(crow + q + 8);
+                r2 = _mm256_loadu_ps(crow + q + 16);
+                r3 = _mm256_loadu_ps(crow + q + 24);
+                for(size_t j=0; j<na; j++){
+                    A = _mm256_broadcast_ss(arow + j*acs);
+                    const float* brow = b + j*ldb + q;
+                    r0 = _mm256_fmadd_ps(A, _mm256_loadu_ps(brow),      r0);
+                    r1 = _mm256_fmadd_ps(A, _mm256_loadu_ps(brow + 8),  r1);
+                    r2 = _mm256_fmadd_ps(A, _mm256_loadu_ps(brow + 16), r2);
+                    r3 = _mm256_fmadd_ps(A, _mm256_loadu_ps(brow + 24), r3);
+                }
+                _mm256_storeu_ps(crow + q,      r0);
+                _mm256_storeu_ps(crow + q + 8,  r1);
+                _mm256_storeu_ps(crow + q + 16, r2);
+                _mm256_storeu_ps(crow + q + 24, r3);
+            }
+            for(; q < full; q += 8){
+                r0 = _mm256_loadu_ps(crow + q);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm256_fmadd_ps(_mm256_broadcast_ss(arow + j*acs), _mm256_loadu_ps(b + j*ldb + q), r0);
+                _mm256_storeu_ps(crow + q, r0);
+            }
+            if(q < nb){
+                r0 = _mm256_maskload_ps(crow + q, mask);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm256_fmadd_ps(_mm256_broadcast_ss(arow + j*acs), _mm256_maskload_ps(b + j*ldb + q, mask), r0);
+                _mm256_maskstore_ps(crow + q, mask, r0);
+            }
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void masked_avx512(const double* a, size_t ars, size_t acs, const double* b, size_t ldb, double* c, size_t ldc, size_t ma, size_t na, size_t nb){
+        const size_t full = nb - nb % 8;
+        const __mmask8 mask = (__mmask8)((1u << (nb % 8)) - 1);
+        __m512d A,r0,r1,r2,r3;
+        for (size_t i =0; i<ma; i++){
+            const double* arow = a + i*ars;
+            double* crow = c + i*ldc;
+            size_t q = 0;
+            for(; q + 32 <= nb; q += 32){
+                r0 = _mm512_loadu_pd(crow + q);
+                r1 = _mm512_loadu_pd(crow + q + 8);
+                r2 = _mm512_loadu_pd(crow + q + 16);
+                r3 = _mm512_loadu_pd(crow + q + 24);
+                for(size_t j=0; j<na; j++){
+                    A = _mm512_set1_pd(arow[j*acs]);
+                    const double* brow = b + j*ldb + q;
+                    r0 = _mm512_fmadd_pd(A, _mm512_loadu_pd(brow),      r0);
+                    r1 = _mm512_fmadd_pd(A, _mm512_loadu_pd(brow + 8),  r1);
+                    r2 = _mm512_fmadd_pd(A, _mm512_loadu_pd(brow + 16), r2);
+                    r3 = _mm512_fmadd_pd(A, _mm512_loadu_pd(brow + 24), r3);
+                }
+                _mm512_storeu_pd(crow + q,      r0);
+                _mm512_storeu_pd(crow + q + 8,  r1);
+                _mm512_storeu_pd(crow + q + 16, r2);
+                _mm512_storeu_pd(crow + q + 24, r3);
+            }
+            for(; q < full; q += 8){
+                r0 = _mm512_loadu_pd(crow + q);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm512_fmadd_pd(_mm512_set1_pd(arow[j*acs]), _mm512_loadu_pd(b + j*ldb + q), r0);
+                _mm512_storeu_pd(crow + q, r0);
+            }
+            if(q < nb){
+                r0 = _mm512_maskz_loadu_pd(mask, crow + q);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm512_fmadd_pd(_mm512_set1_pd(arow[j*acs]), _mm512_maskz_loadu_pd(mask, b + j*ldb + q), r0);
+                _mm512_mask_storeu_pd(crow + q, mask, r0);
+            }
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void masked_avx512(const float* a, size_t ars, size_t acs, const float* b, size_t ldb, float* c, size_t ldc, size_t ma, size_t na, size_t nb){
+        const size_t full = nb - nb % 16;
+        const __mmask16 mask = (__mmask16)((1u << (nb % 16)) - 1);
+        __m512 A,r0,r1,r2,r3;
+        for (size_t i =0; i<ma; i++){
+            const float* arow = a + i*ars;
+            float* crow = c + i*ldc;
+            size_t q = 0;
+            for(; q + 64 <= nb; q += 64){
+                r0 = _mm512_loadu_ps(crow + q);
+                r1 = _mm512_loadu_ps(crow + q + 16);
+                r2 = _mm512_loadu_ps(crow + q + 32);
+                r3 = _mm512_loadu_ps(crow + q + 48);
+                for(size_t j=0; j<na; j++){
+                    A = _mm512_set1_ps(arow[j*acs]);
+                    const float* brow = b + j*ldb + q;
+                    r0 = _mm512_fmadd_ps(A, _mm512_loadu_ps(brow),      r0);
+                    r1 = _mm512_fmadd_ps(A, _mm512_loadu_ps(brow + 16), r1);
+                    r2 = _mm512_fmadd_ps(A, _mm512_loadu_ps(brow + 32), r2);
+                    r3 = _mm512_fmadd_ps(A, _mm512_loadu_ps(brow + 48), r3);
+                }
+                _mm512_storeu_ps(crow + q,      r0);
+                _mm512_storeu_ps(crow + q + 16, r1);
+                _mm512_storeu_ps(crow + q + 32, r2);
+                _mm512_storeu_ps(crow + q + 48, r3);
+            }
+            for(; q < full; q += 16){
+                r0 = _mm512_loadu_ps(crow + q);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm512_fmadd_ps(_mm512_set1_ps(arow[j*acs]), _mm512_loadu_ps(b + j*ldb + q), r0);
+                _mm512_storeu_ps(crow + q, r0);
+            }
+            if(q < nb){
+                r0 = _mm512_maskz_loadu_ps(mask, crow + q);
+                for(size_t j=0; j<na; j++)
+                    r0 = _mm512_fmadd_ps(_mm512_set1_ps(arow[j*acs]), _mm512_maskz_loadu_ps(mask, b + j*ldb + q), r0);
+                _mm512_mask_storeu_ps(crow + q, mask, r0);
+            }
+        }
+    }
+
+}
+
+template<>
+int matrixMultMasked_Sse(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    masked_sse(a.data(), na, 1, b.data(), nb, c.data(), nb, ma, na, nb);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 311;
+}
+
+template<>
+int matrixMultMasked_Sse(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    masked_sse(a.data(), na, 1, b.data(), nb, c.data(), nb, ma, na, nb);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 311;
+}
+
+template<>
+int matrixMultMasked_Avx(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    masked_avx(a.data(), na, 1, b.data(), nb, c.data(), nb, ma, na, nb);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 312;
+}
+
+template<>
+int matrixMultMasked_Avx(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    masked_avx(a.data(), na, 1, b.data(), nb, c.data(), nb, ma, na, nb);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 312;
+}
+
+template<>
+int matrixMultMasked_Avx512(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    masked_avx512(a.data(), na, 1, b.data(), nb, c.data(), nb, ma, na, nb);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 313;
+}
+
+template<>
+int matrixMultMasked_Avx512(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    masked_avx512(a.data(), na, 1, b.data(), nb, c.data(), nb, ma, na, nb);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    dt_01 = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    return 313;
+}
+
+template<typename T>
+int matrixMultMasked_Simd(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01){
+    switch(simd_level()){
+        case SimdLevel::AVX512:
+            return matrixMultMasked_Avx512<T>(a, b, c, ma, na, nb, dt_01);
+        case SimdLevel::AVX2:
+            return matrixMultMasked_Avx<T>(a, b, c, ma, na, nb, dt_01);
+        case SimdLevel::SSE4:
+            return matrixMultMasked_Sse<T>(a, b, c, ma, na, nb, dt_01);
+        default:
+            return 0;
+    }
+}
+
+template int matrixMultMasked_Simd<float>(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+template int matrixMultMasked_Simd<double>(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t ma, size_t na, size_t nb, int64_t& dt_01);
+
+template<typename T>
+int matrixMultStrided_Simd(Transpose transA, size_t ma, size_t na, size_t nb, const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc){
+    const size_t ars = transA == Trans ? 1 : lda;
+    const size_t acs = transA == Trans ? lda : 1;
+    switch(simd_level()){
+        case SimdLevel::AVX512:
+            masked_avx512(a, ars, acs, b, ldb, c, ldc, ma, na, nb);
+            return 313;
+        case SimdLevel::AVX2:
+            masked_avx(a, ars, acs, b, ldb, c, ldc, ma, na, nb);
+            return 312;
+        case SimdLevel::SSE4:
+            masked_sse(a, ars, acs, b, ldb, c, ldc, ma, na, nb);
+            return 311;
+        default:
+            return 0;
+    }
+}
 
+template int matrixMultStrided_Simd<float>(Transpose transA, size_t ma, size_t na, size_t nb, const float* a, size_t lda, const float* b, size_t ldb, float* c, size_t ldc);
+template int matrixMultStrided_Simd<double>(Transpose transA, size_t ma, size_t na, size_t nb, const double* a, size_t lda, const double* b, size_t ldb, double* c, size_t ldc);
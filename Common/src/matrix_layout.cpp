@@ -0,0 +1,67 @@
+#include "../include/matrix_layout.hpp"
+#include "../include/matrix_transpose.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+
+
+namespace {
+
+    //! Calls body(i0, j0, tile_rows, tile_cols, offset) for every tile of the Tiled layout, offset being the
+    //! position of its first element, in parallel
+    template<typename F>
+    void for_each_tile(std::size_t rows, std::size_t cols, int numThreads, F body){
+        const std::size_t tiles_down = (rows + layout_tile - 1) / layout_tile;
+        const std::size_t tiles_across = (cols + layout_tile - 1) / layout_tile;
+        parallel_for(tiles_down * tiles_across, numThreads, [&](std::size_t t){
+            const std::size_t i0 = t / tiles_across * layout_tile, j0 = t % tiles_across * layout_tile;
+            body(i0, j0, std::min(layout_tile, rows - i0), std::min(layout_tile, cols - j0),
+                 layout_index(Layout::Tiled, i0, j0, rows, cols));
+        });
+    }
+
+}
+
+
+template<typename T>
+void convert_layout(std::size_t rows, std::size_t cols, Layout from, const T* src, Layout to, T* dst,
+                    int numThreads){
+
+    if (rows == 0 || cols == 0)
+        return;
+    if (from == to) {
+        std::copy(src, src + rows * cols, dst);
+        return;
+    }
+    // a column-major matrix is the row-major storage of its transpose
+    if (from != Layout::Tiled && to != Layout::Tiled) {
+        if (from == Layout::RowMajor)
+            transpose(rows, cols, src, cols, dst, rows, numThreads);
+        else
+            transpose(cols, rows, src, rows, dst, cols, numThreads);
+        return;
+    }
+
+    // one side is tiled: the tile at (i0, j0) is a tile_rows x tile_cols row-major block at offset, the other side
+    // holds it as a block of the row-major matrix or of the transpose
+    const Layout other = from == Layout::Tiled ? to : from;
+    for_each_tile(rows, cols, numThreads, [&](std::size_t i0, std::size_t j0, std::size_t tr, std::size_t tc,
+                                              std::size_t offset){
+        if (other == Layout::RowMajor) {
+            for (std::size_t r = 0; r < tr; r++) {
+                if (from == Layout::Tiled)
+                    std::copy(src + offset + r * tc, src + offset + (r + 1) * tc, dst + (i0 + r) * cols + j0);
+                else
+                    std::copy(src + (i0 + r) * cols + j0, src + (i0 + r) * cols + j0 + tc, dst + offset + r * tc);
+            }
+        }
+        else if (from == Layout::Tiled)
+            transpose(tr, tc, src + offset, tc, dst + j0 * rows + i0, rows, 1);
+        else
+            transpose(tc, tr, src + j0 * rows + i0, rows, dst + offset, tc, 1);
+    });
+}
+
+template void convert_layout<float>(std::size_t rows, std::size_t cols, Layout from, const float* src, Layout to, float* dst,
+                                    int numThreads);
+template void convert_layout<double>(std::size_t rows, std::size_t cols, Layout from, const double* src, Layout to, double* dst,
+                                     int numThreads);
@@ -0,0 +1,211 @@
+#include "../include/matrix_transpose.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+#include <iostream>
+#include <vector>
+
+
+namespace {
+
+    //! Side of the cache tiles and of the register blocks
+    constexpr std::size_t tile = 64;
+    constexpr std::size_t block = 8;
+
+    //! Elements below which the transpose runs on the calling thread
+    constexpr std::size_t parallel_threshold = 1 << 16;
+
+    //******************************************************************************************************************
+    // 8 x 8 block kernels: dst[j * ldd + i] = src[i * lds + j] for i, j < 8. With stream the rows of dst are written
+    // with non-temporal stores (dst aligned, see transpose).
+    //******************************************************************************************************************
+
+    template<typename T>
+    void block_scalar(const T* src, std::size_t lds, T* dst, std::size_t ldd, bool){
+        for (std::size_t i = 0; i < block; i++)
+            for (std::size_t j = 0; j < block; j++)
+                dst[j * ldd + i] = src[i * lds + j];
+    }
+
+    __attribute__((target("avx")))
+    void block_avx(const float* src, std::size_t lds, float* dst, std::size_t ldd, bool stream){
+        __m256 r0 = _mm256_loadu_ps(src),           r1 = _mm256_loadu_ps(src + lds);
+        __m256 r2 = _mm256_loadu_ps(src + 2 * lds), r3 = _mm256_loadu_ps(src + 3 * lds);
+        __m256 r4 = _mm256_loadu_ps(src + 4 * lds), r5 = _mm256_loadu_ps(src + 5 * lds);
+        __m256 r6 = _mm256_loadu_ps(src + 6 * lds), r7 = _mm256_loadu_ps(src + 7 * lds);
+
+        // pairs of rows interleaved, then groups of four, then the 128 bit halves: column k ends up in r[k]
+        const __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+        const __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+        const __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+        const __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+        const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+        r0 = _mm256_permute2f128_ps(s0, s4, 0x20);
+        r1 = _mm256_permute2f128_ps(s1, s5, 0x20);
+        r2 = _mm256_permute2f128_ps(s2, s6, 0x20);
+        r3 = _mm256_permute2f128_ps(s3, s7, 0x20);
+        r4 = _mm256_permute2f128_ps(s0, s4, 0x31);
+        r5 = _mm256_permute2f128_ps(s1, s5, 0x31);
+        r6 = _mm256_permute2f128_ps(s2, s6, 0x31);
+        r7 = _mm256_permute2f128_ps(s3, s7, 0x31);
+
+        if (stream) {
+            _mm256_stream_ps(dst,           r0);
+            _mm256_stream_ps(dst + ldd,     r1);
+            _mm256_stream_ps(dst + 2 * ldd, r2);
+            _mm256_stream_ps(dst + 3 * ldd, r3);
+            _mm256_stream_ps(dst + 4 * ldd, r4);
+            _mm256_stream_ps(dst + 5 * ldd, r5);
+            _mm256_stream_ps(dst + 6 * ldd, r6);
+            _mm256_stream_ps(dst + 7 * ldd, r7);
+        } else {
+            _mm256_storeu_ps(dst,           r0);
+            _mm256_storeu_ps(dst + ldd,     r1);
+            _mm256_storeu_ps(dst + 2 * ldd, r2);
+            _mm256_storeu_ps(dst + 3 * ldd, r3);
+            _mm256_storeu_ps(dst + 4 * ldd, r4);
+            _mm256_storeu_ps(dst + 5 * ldd, r5);
+            _mm256_storeu_ps(dst + 6 * ldd, r6);
+            _mm256_storeu_ps(dst + 7 * ldd, r7);
+        }
+    }
+
+    //! 4 x 4 doubles, the quarter of an 8 x 8 block
+    __attribute__((target("avx")))
+    void quarter_avx(const double* src, std::size_t lds, double* dst, std::size_t ldd, bool stream){
+        const __m256d r0 = _mm256_loadu_pd(src),           r1 = _mm256_loadu_pd(src + lds);
+        const __m256d r2 = _mm256_loadu_pd(src + 2 * lds), r3 = _mm256_loadu_pd(src + 3 * lds);
+        const __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+        const __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+        const __m256d c0 = _mm256_permute2f128_pd(t0, t2, 0x20), c1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+        const __m256d c2 = _mm256_permute2f128_pd(t0, t2, 0x31), c3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+        if (stream) {
+            _mm256_stream_pd(dst,           c0);
+            _mm256_stream_pd(dst + ldd,     c1);
+            _mm256_stream_pd(dst + 2 * ldd, c2);
+            _mm256_stream_pd(dst + 3 * ldd, c3);
+        } else {
+            _mm256_storeu_pd(dst,           c0);
+            _mm256_storeu_pd(dst + ldd,     c1);
+            _mm256_storeu_pd(dst + 2 * ldd, c2);
+            _mm256_storeu_pd(dst + 3 * ldd, c3);
+        }
+    }
+
+    __attribute__((target("avx")))
+    void block_avx(const double* src, std::size_t lds, double* dst, std::size_t ldd, bool stream){
+        quarter_avx(src,                lds, dst,                ldd, stream);
+        quarter_avx(src + 4,            lds, dst + 4 * ldd,      ldd, stream);
+        quarter_avx(src + 4 * lds,      lds, dst + 4,            ldd, stream);
+        quarter_avx(src + 4 * lds + 4,  lds, dst + 4 * ldd + 4,  ldd, stream);
+    }
+
+    __attribute__((target("avx")))
+    void fence_avx(){
+        _mm_sfence();
+    }
+
+    template<typename T>
+    using BlockKernel = void (*)(const T*, std::size_t, T*, std::size_t, bool);
+
+    template<typename T>
+    BlockKernel<T> select_block_kernel(){
+        if (simd_level() >= SimdLevel::AVX2)
+            return block_avx;
+        return block_scalar<T>;
+    }
+
+    //! dst = src^T on a rows x cols tile: the full 8 x 8 blocks in registers, the ragged edges element by element
+    template<typename T>
+    void transpose_tile(BlockKernel<T> kernel, std::size_t rows, std::size_t cols, const T* src, std::size_t lds,
+                        T* dst, std::size_t ldd, bool stream){
+        const std::size_t rows8 = rows - rows % block, cols8 = cols - cols % block;
+        for (std::size_t i = 0; i < rows8; i += block)
+            for (std::size_t j = 0; j < cols8; j += block)
+                kernel(src + i * lds + j, lds, dst + j * ldd + i, ldd, stream);
+        for (std::size_t i = 0; i < rows; i++)
+            for (std::size_t j = i < rows8 ? cols8 : 0; j < cols; j++)
+                dst[j * ldd + i] = src[i * lds + j];
+    }
+
+}
+
+
+template<typename T>
+void transpose(std::size_t rows, std::size_t cols, const T* A, std::size_t lda, T* B, std::size_t ldb,
+               int numThreads, bool streaming){
+
+    if (rows == 0 || cols == 0)
+        return;
+    const BlockKernel<T> kernel = select_block_kernel<T>();
+    // the non-temporal stores write whole aligned registers: every row of B must start on 32 bytes
+    const bool stream = streaming && kernel != block_scalar<T> &&
+                        reinterpret_cast<std::uintptr_t>(B) % 32 == 0 && (ldb * sizeof(T)) % 32 == 0;
+
+    const std::size_t tile_rows = (rows + tile - 1) / tile, tile_cols = (cols + tile - 1) / tile;
+    if (rows * cols < parallel_threshold)
+        numThreads = 1;
+
+    parallel_for(tile_rows * tile_cols, numThreads, [&](std::size_t t){
+        const std::size_t i0 = t / tile_cols * tile, j0 = t % tile_cols * tile;
+        transpose_tile(kernel, std::min(tile, rows - i0), std::min(tile, cols - j0), A + i0 * lda + j0, lda,
+                       B + j0 * ldb + i0, ldb, stream);
+        if (stream)
+            fence_avx();
+    });
+}
+
+template<typename T>
+void transpose_inplace(std::size_t rows, std::size_t cols, T* A, std::size_t lda, int numThreads){
+
+    if (rows == 0 || cols == 0)
+        return;
+    if (rows != cols) {
+        if (lda != cols) {
+            std::cout<<"Error: the in place transpose of a "<<rows<<"X"<<cols<<" matrix needs lda = "<<cols<<std::endl;
+            return;
+        }
+        std::vector<T> copy(A, A + rows * cols);
+        transpose(rows, cols, copy.data(), cols, A, rows, numThreads);
+        return;
+    }
+
+    // the pairs of tiles (I, J) with I <= J: tile (J, I)^T goes to (I, J) and tile (I, J)^T, kept in a buffer, to (J, I)
+    const BlockKernel<T> kernel = select_block_kernel<T>();
+    const std::size_t n = rows, tiles = (n + tile - 1) / tile;
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    for (std::size_t I = 0; I < tiles; I++)
+        for (std::size_t J = I; J < tiles; J++)
+            pairs.emplace_back(I, J);
+    if (n * n < parallel_threshold)
+        numThreads = 1;
+
+    parallel_for(pairs.size(), numThreads, [&](std::size_t p){
+        alignas(64) T buffer[tile * tile];
+        const std::size_t i0 = pairs[p].first * tile, j0 = pairs[p].second * tile;
+        const std::size_t ni = std::min(tile, n - i0), nj = std::min(tile, n - j0);
+        T* upper = A + i0 * lda + j0;       // ni x nj
+        T* lower = A + j0 * lda + i0;       // nj x ni
+        transpose_tile(kernel, ni, nj, upper, lda, buffer, tile, false);
+        if (i0 != j0)
+            transpose_tile(kernel, nj, ni, lower, lda, upper, lda, false);
+        for (std::size_t j = 0; j < nj; j++)
+            std::copy(buffer + j * tile, buffer + j * tile + ni, lower + j * lda);
+    });
+}
+
+template void transpose<float>(std::size_t rows, std::size_t cols, const float* A, std::size_t lda, float* B, std::size_t ldb,
+                               int numThreads, bool streaming);
+template void transpose<double>(std::size_t rows, std::size_t cols, const double* A, std::size_t lda, double* B, std::size_t ldb,
+                                int numThreads, bool streaming);
+template void transpose_inplace<float>(std::size_t rows, std::size_t cols, float* A, std::size_t lda, int numThreads);
+template void transpose_inplace<double>(std::size_t rows, std::size_t cols, double* A, std::size_t lda, int numThreads);
@@ -1,4 +1,6 @@
 #include "../include/mmm.hpp"
+#include "../include/autotuner.hpp"
+#include "../include/thread_pool.hpp"
 #include <cblas.h>
 #include <chrono>
 #include <algorithm>
@@ -7,6 +9,29 @@
 #include <sstream>
 
 
+namespace {
+
+    //! Parameters of the tiled kernels: the caller's value when positive, otherwise the one found by the Autotuner
+    //! for this shape (see autotuner.hpp), otherwise the default
+    template<typename T>
+    TuningConfig tiled_config(std::size_t rows, std::size_t columns, std::size_t inners,
+                              const TuningConfig& requested, const TuningConfig& defaults){
+        TuningConfig tuned;
+        tuned_config<T>(TunedKernel::Tiled, rows, columns, inners, tuned);
+
+        auto pick = [](int requested, int tuned, int fallback){
+            return requested > 0 ? requested : (tuned > 0 ? tuned : fallback);
+        };
+
+        TuningConfig config;
+        config.outer_tile = pick(requested.outer_tile, tuned.outer_tile, defaults.outer_tile);
+        config.inner_tile = pick(requested.inner_tile, tuned.inner_tile, defaults.inner_tile);
+        config.threads = pick(requested.threads, tuned.threads, defaults.threads);
+        return config;
+    }
+
+}
+
 
 void mmm_naive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time){
 
@@ -20,7 +45,7 @@ void mmm_naive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixF
         for (std::size_t col = 0; col < columns; col++) {
             for (std::size_t inner = 0; inner < inners; inner++) {
                 C[row * columns + col] +=
-                        A[row * columns + inner] * B[inner * columns + col];
+                        A[row * inners + inner] * B[inner * columns + col];
             }
         }
     }
@@ -43,7 +68,35 @@ void mmm_naive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFla
         for (std::size_t col = 0; col < columns; col++) {
             for (std::size_t inner = 0; inner < inners; inner++) {
                 C[row * columns + col] +=
-                        A[row * columns + inner] * B[inner * columns + col];
+                        A[row * inners + inner] * B[inner * columns + col];
+            }
+        }
+    }
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+
+};
+
+void mmm_naive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, Transpose transA, Transpose transB){
+
+    std::cout<<"Performing naive mmm (op(A)*op(B)) in double precision (double)"<<std::endl;
+    std::size_t rows = transA == Trans ? A.ncols() : A.nrows();
+    std::size_t inners = transA == Trans ? A.nrows() : A.ncols();
+    std::size_t columns = transB == Trans ? B.nrows() : B.ncols();
+
+    // op(A)(row, inner) = A[row * rsa + inner * csa], op(B)(inner, col) = B[inner * rsb + col * csb]
+    std::size_t rsa = transA == Trans ? 1 : inners, csa = transA == Trans ? rows : 1;
+    std::size_t rsb = transB == Trans ? 1 : columns, csb = transB == Trans ? inners : 1;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    for (std::size_t row = 0; row < rows; row++) {
+        for (std::size_t col = 0; col < columns; col++) {
+            for (std::size_t inner = 0; inner < inners; inner++) {
+                C[row * columns + col] +=
+                        A[row * rsa + inner * csa] * B[inner * rsb + col * csb];
             }
         }
     }
@@ -51,6 +104,32 @@ void mmm_naive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFla
     const auto t1 = std::chrono::high_resolution_clock::now();
     time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
 
+};
+
+void mmm_naive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, Transpose transA, Transpose transB){
+
+    std::cout<<"Performing naive mmm (op(A)*op(B)) in single precision (float)"<<std::endl;
+    std::size_t rows = transA == Trans ? A.ncols() : A.nrows();
+    std::size_t inners = transA == Trans ? A.nrows() : A.ncols();
+    std::size_t columns = transB == Trans ? B.nrows() : B.ncols();
+
+    // op(A)(row, inner) = A[row * rsa + inner * csa], op(B)(inner, col) = B[inner * rsb + col * csb]
+    std::size_t rsa = transA == Trans ? 1 : inners, csa = transA == Trans ? rows : 1;
+    std::size_t rsb = transB == Trans ? 1 : columns, csb = transB == Trans ? inners : 1;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    for (std::size_t row = 0; row < rows; row++) {
+        for (std::size_t col = 0; col < columns; col++) {
+            for (std::size_t inner = 0; inner < inners; inner++) {
+                C[row * columns + col] +=
+                        A[row * rsa + inner * csa] * B[inner * rsb + col * csb];
+            }
+        }
+    }
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
 
 };
 
@@ -67,7 +146,7 @@ void mmm_naive_RegisterAcc(const MatrixFlat<double>& A, const MatrixFlat<double>
         for (std::size_t col = 0; col < columns; col++) {
             double acc = 0;
             for (std::size_t inner = 0; inner < inners; inner++) {
-                acc += A[row * columns + inner] * B[inner * columns + col];
+                acc += A[row * inners + inner] * B[inner * columns + col];
             }
             C[row * columns + col] =  acc;
         }
@@ -93,7 +172,7 @@ void mmm_naive_RegisterAcc(const MatrixFlat<float>& A, const MatrixFlat<float>&
         for (std::size_t col = 0; col < columns; col++) {
             float acc = 0;
             for (std::size_t inner = 0; inner < inners; inner++) {
-                acc += A[row * columns + inner] * B[inner * columns + col];
+                acc += A[row * inners + inner] * B[inner * columns + col];
             }
             C[row * columns + col] =  acc;
         }
@@ -118,7 +197,7 @@ void mmm_loopI(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixF
         for (std::size_t inner = 0; inner < inners; inner++){
             for (std::size_t col = 0; col < columns; col++)
              {
-                C[row * columns + col] += A[row * columns + inner] * B[inner * columns + col];
+                C[row * columns + col] += A[row * inners + inner] * B[inner * columns + col];
             }
         }
     }
@@ -142,7 +221,7 @@ void mmm_loopI(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFla
         for (std::size_t inner = 0; inner < inners; inner++){
             for (std::size_t col = 0; col < columns; col++)
             {
-                C[row * columns + col] += A[row * columns + inner] * B[inner * columns + col];
+                C[row * columns + col] += A[row * inners + inner] * B[inner * columns + col];
             }
         }
     }
@@ -159,13 +238,16 @@ void mmm_tiling(const MatrixFlat<double>& A, const MatrixFlat<double>& B, Matrix
 
     std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
 
+    // A non positive tileSize means "use the tuned inner tile"
+    tileSize = tiled_config<double>(rows, columns, inners, {0, tileSize, 1}, {0, 64, 1}).inner_tile;
+
     const auto t0 = std::chrono::high_resolution_clock::now();
 
-        for (int innerTile = 0; innerTile < inners; innerTile += tileSize) {
-            for (int row = 0; row < rows; row++) {
-                int innerTileEnd = std::min<int>(inners, innerTile + tileSize);
-                for (int inner = innerTile; inner < innerTileEnd; inner++) {
-                    for (int column = 0; column < columns; column++) {
+        for (std::size_t innerTile = 0; innerTile < inners; innerTile += tileSize) {
+            for (std::size_t row = 0; row < rows; row++) {
+                std::size_t innerTileEnd = std::min<std::size_t>(inners, innerTile + tileSize);
+                for (std::size_t inner = innerTile; inner < innerTileEnd; inner++) {
+                    for (std::size_t column = 0; column < columns; column++) {
                         C[row * columns + column] +=
                                 A[row * inners + inner] * B[inner * columns + column];
                     }
@@ -184,13 +266,16 @@ void mmm_tiling(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFl
 
     std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
 
+    // A non positive tileSize means "use the tuned inner tile"
+    tileSize = tiled_config<float>(rows, columns, inners, {0, tileSize, 1}, {0, 64, 1}).inner_tile;
+
     const auto t0 = std::chrono::high_resolution_clock::now();
 
-    for (int innerTile = 0; innerTile < inners; innerTile += tileSize) {
-        for (int row = 0; row < rows; row++) {
-            int innerTileEnd = std::min<int>(inners, innerTile + tileSize);
-            for (int inner = innerTile; inner < innerTileEnd; inner++) {
-                for (int column = 0; column < columns; column++) {
+    for (std::size_t innerTile = 0; innerTile < inners; innerTile += tileSize) {
+        for (std::size_t row = 0; row < rows; row++) {
+            std::size_t innerTileEnd = std::min<std::size_t>(inners, innerTile + tileSize);
+            for (std::size_t inner = innerTile; inner < innerTileEnd; inner++) {
+                for (std::size_t column = 0; column < columns; column++) {
                     C[row * columns + column] +=
                             A[row * inners + inner] * B[inner * columns + column];
                 }
@@ -203,29 +288,48 @@ void mmm_tiling(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFl
 
 };
 
+template<typename T>
+void mmm_tiled_kernel(const MatrixFlat<T>& A, const MatrixFlat<T>& B, MatrixFlat<T>& C, int tileSize, int inner_tileSize, int num_threads){
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const std::size_t row_tiles = (rows + tileSize - 1) / tileSize, column_tiles = (columns + tileSize - 1) / tileSize;
+
+    // one task per tile of C, taken one at a time by the threads so that the edge tiles do not leave cores idle
+    parallel_for(row_tiles * column_tiles, num_threads, [&](std::size_t tile){
+        const std::size_t rowTile = (tile / column_tiles) * tileSize, columnTile = (tile % column_tiles) * tileSize;
+        const std::size_t rowEnd = std::min<std::size_t>(rowTile + tileSize, rows);
+        const std::size_t columnEnd = std::min<std::size_t>(columnTile + tileSize, columns);
+        for (std::size_t innerTile = 0; innerTile < inners; innerTile += inner_tileSize) {
+            const std::size_t innerTileEnd = std::min<std::size_t>(inners, innerTile + inner_tileSize);
+            for (std::size_t row = rowTile; row < rowEnd; row++) {
+                for (std::size_t inner = innerTile; inner < innerTileEnd; inner++) {
+                    for (std::size_t col = columnTile; col < columnEnd; col++) {
+                        C[row * columns + col] +=
+                                A[row * inners + inner] * B[inner * columns + col];
+                    } } } }
+    });
+}
+
+template void mmm_tiled_kernel<float>(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C,
+                                      int tileSize, int inner_tileSize, int num_threads);
+template void mmm_tiled_kernel<double>(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C,
+                                       int tileSize, int inner_tileSize, int num_threads);
+
+
 void mmm_multiT(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int tileSize){
 
     std::cout<<"Performing mmm_multiT in single precision (single)"<<std::endl;
 
     std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
 
+    // 256 x 256 tiles of C on all the threads of the pool unless the Autotuner found something better for this shape
+    const TuningConfig config = tiled_config<float>(rows, columns, inners, {0, tileSize, 0}, {256, 64, 0});
+
     const auto t0 = std::chrono::high_resolution_clock::now();
 
-//@note: do not hard code the number of threads
-#pragma omp parallel for shared(A, B, C, rows, columns, inners, tileSize) default(none) \
-  collapse(2) num_threads(8)
-
-
-    for (int rowTile = 0; rowTile < rows; rowTile += 256) {
-        for (int columnTile = 0; columnTile < columns; columnTile += 256) {
-            for (int innerTile = 0; innerTile < inners; innerTile += tileSize) {
-                for (int row = rowTile; row < rowTile + 256; row++) {
-                    int innerTileEnd = std::min<int>(inners, innerTile + tileSize);
-                    for (int inner = innerTile; inner < innerTileEnd; inner++) {
-                        for (int col = columnTile; col < columnTile + 256; col++) {
-                            C[row * columns + col] +=
-                                    A[row * inners + inner] * B[inner * columns + col];
-                        } } } } } }
+    mmm_tiled_kernel(A, B, C, config.outer_tile, config.inner_tile, config.threads);
+
     const auto t1 = std::chrono::high_resolution_clock::now();
     time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
 };
@@ -237,23 +341,12 @@ void mmm_multiT(const MatrixFlat<double>& A, const MatrixFlat<double>& B, Matrix
 
     std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
 
-    const auto t0 = std::chrono::high_resolution_clock::now();
-
-    #pragma omp parallel for shared(A, B, C, rows, columns, inners, tileSize) default(none) \
-      collapse(2) num_threads(8)
-
+    // 256 x 256 tiles of C on all the threads of the pool unless the Autotuner found something better for this shape
+    const TuningConfig config = tiled_config<double>(rows, columns, inners, {0, tileSize, 0}, {256, 64, 0});
 
+    const auto t0 = std::chrono::high_resolution_clock::now();
 
-    for (int rowTile = 0; rowTile < rows; rowTile += 256) {
-        for (int columnTile = 0; columnTile < columns; columnTile += 256) {
-            for (int innerTile = 0; innerTile < inners; innerTile += tileSize) {
-                for (int row = rowTile; row < rowTile + 256; row++) {
-                    int innerTileEnd = std::min<int>(inners, innerTile + tileSize);
-                    for (int inner = innerTile; inner < innerTileEnd; inner++) {
-                        for (int col = columnTile; col < columnTile + 256; col++) {
-                            C[row * columns + col] +=
-                                    A[row * inners + inner] * B[inner * columns + col];
-                        } } } } } }
+    mmm_tiled_kernel(A, B, C, config.outer_tile, config.inner_tile, config.threads);
 
     const auto t1 = std::chrono::high_resolution_clock::now();
     time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
@@ -266,27 +359,16 @@ void mmm_gmultiT(const MatrixFlat<double>& A, const MatrixFlat<double>& B, Matri
 
 
     std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
-    int tileSize = rows/4;
+
+    // Without a tuned configuration C is split in 4 x 4 tiles
+    const TuningConfig config = tiled_config<double>(rows, columns, inners, {0, inner_tileSize, num_threads},
+                                                     {std::max<int>(rows / 4, 1), 64, 0});
+    int tileSize = config.outer_tile;
 
     std::cout<<"Tile Size: "<<(tileSize)<<std::endl;
     const auto t0 = std::chrono::high_resolution_clock::now();
 
-
-#pragma omp parallel for shared(A, B, C, rows, columns, inners, inner_tileSize, tileSize) default(none) \
-      collapse(2) num_threads(num_threads)
-
-
-    for (int rowTile = 0; rowTile < rows; rowTile += tileSize) {
-        for (int columnTile = 0; columnTile < columns; columnTile += tileSize) {
-            for (int innerTile = 0; innerTile < inners; innerTile += inner_tileSize) {
-                for (int row = rowTile; row < std::min<int>(rowTile + tileSize , rows); row++) {
-                    int innerTileEnd = std::min<int>(inners, innerTile + inner_tileSize);
-                    for (int inner = innerTile; inner < innerTileEnd; inner++) {
-                        for (int col = columnTile; col < std::min<int>(columnTile + tileSize, columns); col++) {
-                            C[row * columns + col] +=
-                                    A[row * inners + inner] * B[inner * columns + col];
-                        } } } } } }
-
+    mmm_tiled_kernel(A, B, C, tileSize, config.inner_tile, config.threads);
 
     const auto t1 = std::chrono::high_resolution_clock::now();
     time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
@@ -301,27 +383,16 @@ void mmm_gmultiT(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixF
 
 
     std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
-    int tileSize = rows/4;
+
+    // Without a tuned configuration C is split in 4 x 4 tiles
+    const TuningConfig config = tiled_config<float>(rows, columns, inners, {0, inner_tileSize, num_threads},
+                                                    {std::max<int>(rows / 4, 1), 64, 0});
+    int tileSize = config.outer_tile;
 
     std::cout<<"Tile Size: "<<(tileSize)<<std::endl;
     const auto t0 = std::chrono::high_resolution_clock::now();
 
-
-#pragma omp parallel for shared(A, B, C, rows, columns, inners, inner_tileSize, tileSize) default(none) \
-      collapse(2) num_threads(num_threads)
-
-
-    for (int rowTile = 0; rowTile < rows; rowTile += tileSize) {
-        for (int columnTile = 0; columnTile < columns; columnTile += tileSize) {
-            for (int innerTile = 0; innerTile < inners; innerTile += inner_tileSize) {
-                for (int row = rowTile; row < std::min<int>(rowTile + tileSize , rows); row++) {
-                    int innerTileEnd = std::min<int>(inners, innerTile + inner_tileSize);
-                    for (int inner = innerTile; inner < innerTileEnd; inner++) {
-                        for (int col = columnTile; col < std::min<int>(columnTile + tileSize, columns); col++) {
-                            C[row * columns + col] +=
-                                    A[row * inners + inner] * B[inner * columns + col];
-                        } } } } } }
-
+    mmm_tiled_kernel(A, B, C, tileSize, config.inner_tile, config.threads);
 
     const auto t1 = std::chrono::high_resolution_clock::now();
     time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
@@ -0,0 +1,258 @@
+#include "../include/mmm.hpp"
+#include "../include/gemm_batched.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+
+namespace {
+
+    //! Widest block of C handled by one small kernel
+    constexpr int max_width = 16;
+
+    //! Below this number of multiply-adds in the whole batch the cost of waking up the threads is larger than the work
+    constexpr std::size_t parallel_threshold = 1 << 16;
+
+
+    //******************************************************************************************************************
+    // Small kernels: C[:, 0:NB] += A * B[:, 0:NB] with NB a compile time constant. The NB columns of B are copied once
+    // into NV zero padded SIMD vectors of W elements per row (W is the width of the tier), so the K loop only does full
+    // vector loads from L1 and the ragged width costs nothing inside it. MR rows of C are kept in MR * NV vector
+    // registers along the whole K loop, with MR chosen so that the accumulators never take more than 8 registers
+    // (no spills on the 16 registers of AVX2 and SSE4). The same body is compiled once per SIMD tier through the target
+    // wrappers below, with GCC vector types of the tier width.
+    //******************************************************************************************************************
+
+    template<typename T, int NB, int W>
+    __attribute__((always_inline))
+    inline void small_kernel_body(std::size_t M, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                                  T* C, std::size_t ldc){
+        typedef T V __attribute__((vector_size(W * sizeof(T))));
+        constexpr int NV = (NB + W - 1) / W;
+        constexpr std::size_t MR = NV >= 8 ? 1 : NV >= 4 ? 2 : 4;
+
+        V b[small_dimension][NV];
+        for (std::size_t k = 0; k < K; k++)
+            for (int v = 0; v < NV; v++) {
+                b[k][v] = V{};
+                for (int j = 0; j < W && v * W + j < NB; j++)
+                    b[k][v][j] = B[k * ldb + v * W + j];
+            }
+
+        std::size_t i = 0;
+        for (; i + MR <= M; i += MR) {
+            V acc[MR][NV] = {};
+            for (std::size_t r = 0; r < MR; r++)
+                for (int v = 0; v < NV; v++)
+                    for (int j = 0; j < W && v * W + j < NB; j++)
+                        acc[r][v][j] = C[(i + r) * ldc + v * W + j];
+            for (std::size_t k = 0; k < K; k++)
+                for (std::size_t r = 0; r < MR; r++) {
+                    const T a = A[(i + r) * lda + k];
+                    for (int v = 0; v < NV; v++)
+                        acc[r][v] += a * b[k][v];
+                }
+            for (std::size_t r = 0; r < MR; r++)
+                for (int v = 0; v < NV; v++)
+                    for (int j = 0; j < W && v * W + j < NB; j++)
+                        C[(i + r) * ldc + v * W + j] = acc[r][v][j];
+        }
+        for (; i < M; i++) {
+            V acc[NV] = {};
+            for (int v = 0; v < NV; v++)
+                for (int j = 0; j < W && v * W + j < NB; j++)
+                    acc[v][j] = C[i * ldc + v * W + j];
+            for (std::size_t k = 0; k < K; k++) {
+                const T a = A[i * lda + k];
+                for (int v = 0; v < NV; v++)
+                    acc[v] += a * b[k][v];
+            }
+            for (int v = 0; v < NV; v++)
+                for (int j = 0; j < W && v * W + j < NB; j++)
+                    C[i * ldc + v * W + j] = acc[v][j];
+        }
+    }
+
+    template<typename T, int NB>
+    __attribute__((target("avx512f")))
+    void small_kernel_avx512(std::size_t M, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                             T* C, std::size_t ldc){
+        small_kernel_body<T, NB, 64 / sizeof(T)>(M, K, A, lda, B, ldb, C, ldc);
+    }
+
+    template<typename T, int NB>
+    __attribute__((target("avx2,fma")))
+    void small_kernel_avx2(std::size_t M, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                           T* C, std::size_t ldc){
+        small_kernel_body<T, NB, 32 / sizeof(T)>(M, K, A, lda, B, ldb, C, ldc);
+    }
+
+    template<typename T, int NB>
+    __attribute__((target("sse4.2")))
+    void small_kernel_sse4(std::size_t M, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                           T* C, std::size_t ldc){
+        small_kernel_body<T, NB, 16 / sizeof(T)>(M, K, A, lda, B, ldb, C, ldc);
+    }
+
+    //! SSE2 is part of x86-64, so even the scalar tier gets 16 byte vectors
+    template<typename T, int NB>
+    void small_kernel_scalar(std::size_t M, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                             T* C, std::size_t ldc){
+        small_kernel_body<T, NB, 16 / sizeof(T)>(M, K, A, lda, B, ldb, C, ldc);
+    }
+
+
+    //! Small kernels of one tier, indexed by the width of C - 1
+    template<typename T>
+    using SmallKernels = std::array<void (*)(std::size_t M, std::size_t K, const T* A, std::size_t lda, const T* B,
+                                             std::size_t ldb, T* C, std::size_t ldc), max_width>;
+
+    template<typename T, int... W>
+    SmallKernels<T> small_kernels_for(SimdLevel level, std::integer_sequence<int, W...>){
+        switch (level) {
+            case SimdLevel::AVX512:
+                return {small_kernel_avx512<T, W + 1>...};
+            case SimdLevel::AVX2:
+                return {small_kernel_avx2<T, W + 1>...};
+            case SimdLevel::SSE4:
+                return {small_kernel_sse4<T, W + 1>...};
+            default:
+                return {small_kernel_scalar<T, W + 1>...};
+        }
+    }
+
+    //! Kernels of the best SIMD tier available on this machine, chosen once at the first call
+    template<typename T>
+    const SmallKernels<T>& select_small_kernels(){
+        static const SmallKernels<T> kernels = small_kernels_for<T>(simd_level(), std::make_integer_sequence<int, max_width>());
+        return kernels;
+    }
+
+
+    //! One product of the batch, on the calling thread
+    template<typename T>
+    void run_product(const GemmDescriptor<T>& d, const SmallKernels<T>& kernels){
+        if (d.M == 0 || d.N == 0 || d.K == 0)
+            return;
+        if (d.M <= small_dimension && d.N <= small_dimension && d.K <= small_dimension) {
+            for (std::size_t j0 = 0; j0 < d.N; j0 += max_width) {
+                const std::size_t width = std::min<std::size_t>(max_width, d.N - j0);
+                kernels[width - 1](d.M, d.K, d.A, d.lda, d.B + j0, d.ldb, d.C + j0, d.ldc);
+            }
+        } else {
+            gemm_packed<T>(d.M, d.N, d.K, d.A, d.lda, d.B, d.ldb, d.C, d.ldc, 1);
+        }
+    }
+
+    //! Runs the count products returned by descriptor(p), as independent work items. The chunks taken by the
+    //! threads are small enough to balance products of different sizes and large enough to make the scheduling
+    //! negligible for the tiny ones.
+    template<typename T, typename Descriptor>
+    void run_batch(std::size_t count, std::size_t work, int numThreads, Descriptor descriptor){
+        const SmallKernels<T>& kernels = select_small_kernels<T>();
+        numThreads = resolve_threads(numThreads);
+        const bool parallel = numThreads > 1 && count > 1 && work >= parallel_threshold;
+        const std::size_t chunk = std::max<std::size_t>(1, count / (16 * numThreads));
+
+        parallel_for(count, parallel ? numThreads : 1, [&](std::size_t p){
+            run_product<T>(descriptor(p), kernels);
+        }, chunk);
+    }
+
+}
+
+
+template<typename T>
+void gemm_batched(const GemmDescriptor<T>* batch, std::size_t count, int numThreads){
+    std::size_t work = 0;
+    for (std::size_t p = 0; p < count; p++)
+        work += batch[p].M * batch[p].N * batch[p].K;
+    run_batch<T>(count, work, numThreads, [batch](std::size_t p) -> const GemmDescriptor<T>& {return batch[p];});
+}
+
+template<typename T>
+void gemm_batched(const std::vector<GemmDescriptor<T>>& batch, int numThreads){
+    gemm_batched<T>(batch.data(), batch.size(), numThreads);
+}
+
+template<typename T>
+void gemm_batched(std::size_t M, std::size_t N, std::size_t K,
+                  const T* A, std::size_t lda, std::size_t strideA,
+                  const T* B, std::size_t ldb, std::size_t strideB,
+                  T* C, std::size_t ldc, std::size_t strideC,
+                  std::size_t count, int numThreads){
+    run_batch<T>(count, count * M * N * K, numThreads, [=](std::size_t p){
+        GemmDescriptor<T> d;
+        d.M = M; d.N = N; d.K = K;
+        d.A = A + p * strideA; d.lda = lda;
+        d.B = B + p * strideB; d.ldb = ldb;
+        d.C = C + p * strideC; d.ldc = ldc;
+        return d;
+    });
+}
+
+template void gemm_batched<float>(const GemmDescriptor<float>* batch, std::size_t count, int numThreads);
+template void gemm_batched<double>(const GemmDescriptor<double>* batch, std::size_t count, int numThreads);
+template void gemm_batched<float>(const std::vector<GemmDescriptor<float>>& batch, int numThreads);
+template void gemm_batched<double>(const std::vector<GemmDescriptor<double>>& batch, int numThreads);
+template void gemm_batched<float>(std::size_t M, std::size_t N, std::size_t K, const float* A, std::size_t lda,
+                                  std::size_t strideA, const float* B, std::size_t ldb, std::size_t strideB, float* C,
+                                  std::size_t ldc, std::size_t strideC, std::size_t count, int numThreads);
+template void gemm_batched<double>(std::size_t M, std::size_t N, std::size_t K, const double* A, std::size_t lda,
+                                   std::size_t strideA, const double* B, std::size_t ldb, std::size_t strideB, double* C,
+                                   std::size_t ldc, std::size_t strideC, std::size_t count, int numThreads);
+
+
+namespace {
+
+    //! Descriptors of the products A[p] * B[p] -> C[p], or an empty batch if the three lists differ in length
+    template<typename T>
+    std::vector<GemmDescriptor<T>> describe(const std::vector<MatrixFlat<T>>& A, const std::vector<MatrixFlat<T>>& B,
+                                            std::vector<MatrixFlat<T>>& C){
+        std::vector<GemmDescriptor<T>> batch;
+        if (A.size() != B.size() || A.size() != C.size()) {
+            std::cout<<"Error: mmm_batched needs as many A, B and C, got "<<A.size()<<", "<<B.size()<<" and "<<C.size()<<std::endl;
+            return batch;
+        }
+        batch.resize(A.size());
+        for (std::size_t p = 0; p < A.size(); p++) {
+            GemmDescriptor<T>& d = batch[p];
+            d.M = A[p].nrows(); d.N = B[p].ncols(); d.K = A[p].ncols();
+            d.A = A[p].get_ptr(); d.lda = d.K;
+            d.B = B[p].get_ptr(); d.ldb = d.N;
+            d.C = C[p].get_ptr(); d.ldc = d.N;
+        }
+        return batch;
+    }
+
+}
+
+
+void mmm_batched(const std::vector<MatrixFlat<float>>& A, const std::vector<MatrixFlat<float>>& B, std::vector<MatrixFlat<float>>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_batched of "<<A.size()<<" products in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_batched(describe(A, B, C), numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_batched(const std::vector<MatrixFlat<double>>& A, const std::vector<MatrixFlat<double>>& B, std::vector<MatrixFlat<double>>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_batched of "<<A.size()<<" products in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_batched(describe(A, B, C), numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
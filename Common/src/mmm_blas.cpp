@@ -1,8 +1,34 @@
 #include "../include/mmm_blas.hpp"
+#include "../include/gemm.hpp"
 #include <cblas.h>
 
 
-void mmm_blas(MatrixFlat<float>& A, MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time) {
+namespace {
+
+    CBLAS_TRANSPOSE cblas_transpose(Transpose trans){
+        return trans == Trans ? CblasTrans : CblasNoTrans;
+    }
+
+    void gemm_blas(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                   float alpha, const float* A, std::size_t lda, const float* B, std::size_t ldb,
+                   float beta, float* C, std::size_t ldc){
+        cblas_sgemm(CblasRowMajor, cblas_transpose(transA), cblas_transpose(transB), M, N, K,
+                    alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+
+    void gemm_blas(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                   double alpha, const double* A, std::size_t lda, const double* B, std::size_t ldb,
+                   double beta, double* C, std::size_t ldc){
+        cblas_dgemm(CblasRowMajor, cblas_transpose(transA), cblas_transpose(transB), M, N, K,
+                    alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+
+    const bool blas_provider = register_gemm_provider({"blas", "OpenBLAS, cblas_sgemm / cblas_dgemm", gemm_blas, gemm_blas});
+
+}
+
+
+void mmm_blas(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time) {
 
     //! Performs C = A*B in single precision using openblas optimized mm multiplication and returns the latency of the operation in variable time
 
@@ -42,7 +68,7 @@ void mmm_blas(MatrixFlat<float>& A, MatrixFlat<float>& B, MatrixFlat<float>& C,
 
 }
 
-void mmm_blas(MatrixFlat<double>& A, MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time) {
+void mmm_blas(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time) {
 
     //! Performs C = A*B in double precision using openblas optimized mm multiplication and returns the latency of the operation
 
@@ -80,3 +106,63 @@ void mmm_blas(MatrixFlat<double>& A, MatrixFlat<double>& B, MatrixFlat<double>&
 
 }
 
+
+void mmm_blas(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, Transpose transA, Transpose transB) {
+
+    //! Performs C = op(A)*op(B) using openblas, the reference of the kernels with transpose flags
+
+    std::size_t m, n, k;
+
+    m = transA == Trans ? A.ncols() : A.nrows();
+    n = transB == Trans ? B.nrows() : B.ncols();
+    k = transA == Trans ? A.nrows() : A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    cblas_sgemm(
+            CblasRowMajor,
+            transA == Trans ? CblasTrans : CblasNoTrans,
+            transB == Trans ? CblasTrans : CblasNoTrans,
+            m, n, k,
+            1.0f,
+            A.get_ptr(), A.ncols(),        // leading dimensions are the stored row lengths
+            B.get_ptr(), B.ncols(),
+            0.0f,
+            C.get_ptr(), n
+    );
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+}
+
+void mmm_blas(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, Transpose transA, Transpose transB) {
+
+    //! Performs C = op(A)*op(B) using openblas, the reference of the kernels with transpose flags
+
+    std::size_t m, n, k;
+
+    m = transA == Trans ? A.ncols() : A.nrows();
+    n = transB == Trans ? B.nrows() : B.ncols();
+    k = transA == Trans ? A.nrows() : A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    cblas_dgemm(
+            CblasRowMajor,
+            transA == Trans ? CblasTrans : CblasNoTrans,
+            transB == Trans ? CblasTrans : CblasNoTrans,
+            m, n, k,
+            1.0,
+            A.get_ptr(), A.ncols(),        // leading dimensions are the stored row lengths
+            B.get_ptr(), B.ncols(),
+            0.0,
+            C.get_ptr(), n
+    );
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+}
@@ -0,0 +1,301 @@
+#include "../include/mmm.hpp"
+#include "../include/gemm_out_of_core.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/mapped_file.hpp"
+#include "../include/cpu_features.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace {
+
+    //! Panels are multiples of this size (the NR and MR of every micro-kernel divide it)
+    constexpr std::size_t panel_align = 64;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    int64_t elapsed_us(Clock::time_point t0){
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+    }
+
+    //! pread of all the bytes, pread may return less than asked
+    bool read_all(int fd, void* dst, std::size_t bytes, std::uint64_t offset){
+        char* p = static_cast<char*>(dst);
+        while (bytes > 0) {
+            const ssize_t n = pread(fd, p, bytes, static_cast<off_t>(offset));
+            if (n <= 0)
+                return false;
+            p += n;
+            bytes -= static_cast<std::size_t>(n);
+            offset += static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+    bool write_all(int fd, const void* src, std::size_t bytes, std::uint64_t offset){
+        const char* p = static_cast<const char*>(src);
+        while (bytes > 0) {
+            const ssize_t n = pwrite(fd, p, bytes, static_cast<off_t>(offset));
+            if (n <= 0)
+                return false;
+            p += n;
+            bytes -= static_cast<std::size_t>(n);
+            offset += static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+    //! A matrix file open for pread / pwrite
+    template<typename T>
+    struct MatrixFile{
+        int fd = -1;
+        std::uint64_t rows = 0, cols = 0;
+
+        ~MatrixFile(){ if (fd >= 0) ::close(fd); }
+
+        //! Opens an existing matrix file of T and checks its header
+        bool open(const std::string& path, bool write){
+            fd = ::open(path.c_str(), write ? O_RDWR : O_RDONLY);
+            if (fd < 0) {
+                std::cout<<"Error: cannot open "<<path<<std::endl;
+                return false;
+            }
+            struct stat st;
+            MatrixFileHeader header;
+            if (fstat(fd, &st) != 0 || !read_all(fd, &header, sizeof(header), 0) ||
+                !header.check<T>(static_cast<std::size_t>(st.st_size), path))
+                return false;
+            rows = header.rows;
+            cols = header.cols;
+            return true;
+        }
+
+        //! Creates (or truncates) the file of a rows x cols matrix of T, its elements are zero
+        bool create(const std::string& path, std::uint64_t r, std::uint64_t c){
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            MatrixFileHeader header;
+            header.type = matrix_file_type<T>();
+            header.element_size = sizeof(T);
+            header.rows = rows = r;
+            header.cols = cols = c;
+            if (fd < 0 || !write_all(fd, &header, sizeof(header), 0) ||
+                ftruncate(fd, static_cast<off_t>(sizeof(header) + r * c * sizeof(T))) != 0) {
+                std::cout<<"Error: cannot create "<<path<<std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        std::uint64_t offset(std::uint64_t row, std::uint64_t col) const {
+            return sizeof(MatrixFileHeader) + (row * cols + col) * sizeof(T);
+        }
+
+        //! Reads the block of nrows x ncols elements at (row, col) into dst (nrows x ncols, row-major)
+        bool read_block(std::uint64_t row, std::uint64_t col, std::size_t nrows, std::size_t ncols, T* dst) const {
+            if (ncols == cols)      // whole rows: one contiguous read
+                return read_all(fd, dst, nrows * ncols * sizeof(T), offset(row, 0));
+            for (std::size_t i = 0; i < nrows; i++)
+                if (!read_all(fd, dst + i * ncols, ncols * sizeof(T), offset(row + i, col)))
+                    return false;
+            return true;
+        }
+
+        bool write_block(std::uint64_t row, std::uint64_t col, std::size_t nrows, std::size_t ncols, const T* src) const {
+            if (ncols == cols)
+                return write_all(fd, src, nrows * ncols * sizeof(T), offset(row, 0));
+            for (std::size_t i = 0; i < nrows; i++)
+                if (!write_all(fd, src + i * ncols, ncols * sizeof(T), offset(row + i, col)))
+                    return false;
+            return true;
+        }
+    };
+
+    //! Side of the panels: the 6 buffers (A, B and C, twice) take at most the budget
+    template<typename T>
+    std::size_t panel_size(const OutOfCoreOptions& options){
+        if (options.panel > 0)
+            return options.panel;
+        std::size_t budget = options.memory_budget;
+        if (budget == 0)
+            budget = static_cast<std::size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) / 4;
+        const std::size_t side = static_cast<std::size_t>(std::sqrt(static_cast<double>(budget) / (6 * sizeof(T))));
+        return std::max(panel_align, side / panel_align * panel_align);
+    }
+
+}
+
+
+template<typename T>
+bool gemm_out_of_core(const std::string& pathA, const std::string& pathB, const std::string& pathC,
+                      const OutOfCoreOptions& options, OutOfCoreStats* stats){
+
+    MatrixFile<T> A, B, C;
+    if (!A.open(pathA, false) || !B.open(pathB, false))
+        return false;
+    if (A.cols != B.rows) {
+        std::cout<<"Error: cannot multiply a "<<A.rows<<"X"<<A.cols<<" matrix by a "<<B.rows<<"X"<<B.cols<<" one"<<std::endl;
+        return false;
+    }
+    const std::uint64_t M = A.rows, N = B.cols, K = A.cols;
+    if (options.accumulate) {
+        if (!C.open(pathC, true))
+            return false;
+        if (C.rows != M || C.cols != N) {
+            std::cout<<"Error: "<<pathC<<" is not a "<<M<<"X"<<N<<" matrix"<<std::endl;
+            return false;
+        }
+    } else if (!C.create(pathC, M, N)) {
+        return false;
+    }
+
+    // an empty product leaves C as it is (zero when it was just created)
+    if (M == 0 || N == 0 || K == 0)
+        return true;
+
+    const std::size_t side = panel_size<T>(options);
+    const std::size_t mb = std::min<std::uint64_t>(side, M), nb = std::min<std::uint64_t>(side, N);
+    const std::size_t kb = std::min<std::uint64_t>(side, K);
+    const std::uint64_t mblocks = (M + mb - 1) / mb, nblocks = (N + nb - 1) / nb, kblocks = (K + kb - 1) / kb;
+    const std::uint64_t tasks = mblocks * nblocks * kblocks;
+
+    OutOfCoreStats local;
+    OutOfCoreStats& s = stats ? *stats : local;
+    s = OutOfCoreStats();
+    s.panel_rows = mb;
+    s.panel_inners = kb;
+    s.panel_columns = nb;
+
+    // task t computes the product of panels k of block (i, j) of C, blocks in row-major order and k the fastest.
+    // The panels of A and B alternate between the two buffers at every task, the blocks of C at every block.
+    std::vector<T> a[2], b[2], c[2];
+    for (int i = 0; i < 2; i++) {
+        a[i].resize(mb * kb);
+        b[i].resize(kb * nb);
+        c[i].resize(mb * nb);
+    }
+    struct Task{
+        std::uint64_t row, col, inner, block;
+        std::size_t rows, cols, inners;
+    };
+    auto task = [&](std::uint64_t t){
+        Task k;
+        k.block = t / kblocks;
+        k.row = k.block / nblocks * mb;
+        k.col = k.block % nblocks * nb;
+        k.inner = t % kblocks * kb;
+        k.rows = std::min<std::uint64_t>(mb, M - k.row);
+        k.cols = std::min<std::uint64_t>(nb, N - k.col);
+        k.inners = std::min<std::uint64_t>(kb, K - k.inner);
+        return k;
+    };
+
+    // run on the reader thread: the panels of task t, and the block of C when the task starts one
+    auto load = [&](std::uint64_t t){
+        const Task k = task(t);
+        bool ok = A.read_block(k.row, k.inner, k.rows, k.inners, a[t % 2].data()) &&
+                  B.read_block(k.inner, k.col, k.inners, k.cols, b[t % 2].data());
+        if (ok && k.inner == 0) {
+            T* block = c[k.block % 2].data();
+            if (options.accumulate)
+                ok = C.read_block(k.row, k.col, k.rows, k.cols, block);
+            else
+                std::fill(block, block + k.rows * k.cols, T(0));
+        }
+        if (!ok)
+            std::cout<<"Error: cannot read the panels of block "<<k.block<<std::endl;
+        return ok;
+    };
+    auto store = [&](std::uint64_t t){
+        const Task k = task(t);
+        const bool ok = C.write_block(k.row, k.col, k.rows, k.cols, c[k.block % 2].data());
+        if (!ok)
+            std::cout<<"Error: cannot write block "<<k.block<<" of "<<pathC<<std::endl;
+        return ok;
+    };
+
+    bool ok = true;
+    std::future<bool> written;
+    std::future<bool> next = std::async(std::launch::async, load, 0);
+    for (std::uint64_t t = 0; t < tasks && ok; t++) {
+        auto t0 = Clock::now();
+        ok = next.get();
+        if (ok && t + 1 < tasks) {
+            // a new block of C goes in the buffer of the block before this one, it must be written first
+            if ((t + 1) % kblocks == 0 && written.valid())
+                ok = written.get();
+            next = std::async(std::launch::async, load, t + 1);
+        }
+        s.wait_us += elapsed_us(t0);
+        if (!ok)
+            break;
+
+        const Task k = task(t);
+        t0 = Clock::now();
+        gemm_packed(k.rows, k.cols, k.inners, a[t % 2].data(), k.inners, b[t % 2].data(), k.cols,
+                    c[k.block % 2].data(), k.cols, options.numThreads);
+        s.compute_us += elapsed_us(t0);
+        s.bytes_read += (k.rows * k.inners + k.inners * k.cols) * sizeof(T);
+
+        if (k.inner + k.inners == K) {
+            t0 = Clock::now();
+            if (written.valid())
+                ok = written.get();
+            s.wait_us += elapsed_us(t0);
+            written = std::async(std::launch::async, store, t);
+            s.bytes_written += k.rows * k.cols * sizeof(T);
+            if (options.accumulate)
+                s.bytes_read += k.rows * k.cols * sizeof(T);
+        }
+    }
+    // the reads and writes still running use the buffers: wait for them before returning
+    if (next.valid())
+        next.wait();
+    if (written.valid())
+        ok = written.get() && ok;
+    return ok;
+}
+
+template bool gemm_out_of_core<float>(const std::string& pathA, const std::string& pathB, const std::string& pathC,
+                                      const OutOfCoreOptions& options, OutOfCoreStats* stats);
+template bool gemm_out_of_core<double>(const std::string& pathA, const std::string& pathB, const std::string& pathC,
+                                       const OutOfCoreOptions& options, OutOfCoreStats* stats);
+
+
+void mmm_out_of_core(const std::string& A, const std::string& B, const std::string& C, int64_t& time,
+                     std::size_t memory_budget, int numThreads){
+
+    MatrixFileHeader header;
+    std::ifstream file(A, std::ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file) {
+        std::cout<<"Error: cannot read "<<A<<std::endl;
+        return;
+    }
+
+    OutOfCoreOptions options;
+    options.memory_budget = memory_budget;
+    options.numThreads = numThreads;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    if (header.type == matrix_file_type<float>()) {
+        std::cout<<"Performing mmm_out_of_core in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+        gemm_out_of_core<float>(A, B, C, options);
+    } else if (header.type == matrix_file_type<double>()) {
+        std::cout<<"Performing mmm_out_of_core in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+        gemm_out_of_core<double>(A, B, C, options);
+    } else {
+        std::cout<<"Error: "<<A<<" is not a matrix of float or double"<<std::endl;
+        return;
+    }
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
@@ -0,0 +1,643 @@
+#include "../include/mmm.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <immintrin.h>
+#include <type_traits>
+#include <vector>
+
+
+namespace {
+
+    //! Allocates a 64 bytes aligned buffer (cache line / AVX-512 register size), released with std::free
+    template<typename T>
+    T* aligned_buffer(std::size_t n){
+        std::size_t bytes = ((n * sizeof(T) + 63) / 64) * 64;
+        return static_cast<T*>(std::aligned_alloc(64, bytes == 0 ? 64 : bytes));
+    }
+
+
+    //******************************************************************************************************************
+    // Micro-kernels: compute the MR x NR tile c += a*b, where a is an MR-tall packed sliver of A and b is an NR-wide
+    // packed sliver of B, both kc long. ldc is the leading dimension of the (row-major) tile c.
+    // One variant per SIMD tier; each one is compiled for its own target so that the translation unit does not
+    // need any -m flag, and the right one is picked at runtime by select_micro_kernel().
+    //******************************************************************************************************************
+
+    // Portable fallback: the accumulator tile is small enough to be kept in registers and the inner loop over the
+    // NR columns is auto-vectorized by the compiler for the baseline ISA.
+    template<typename T, std::size_t MR, std::size_t NR>
+    void micro_kernel_scalar(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc){
+        T acc[MR][NR] = {};
+        for (std::size_t p = 0; p < kc; p++) {
+            for (std::size_t i = 0; i < MR; i++)
+                for (std::size_t j = 0; j < NR; j++)
+                    acc[i][j] += a[i] * b[j];
+            a += MR;
+            b += NR;
+        }
+        for (std::size_t i = 0; i < MR; i++)
+            for (std::size_t j = 0; j < NR; j++)
+                c[i * ldc + j] += acc[i][j];
+    }
+
+
+    // SSE4: 4 x 8 floats / 4 x 4 doubles, 8 xmm accumulators
+    __attribute__((target("sse4.2")))
+    void micro_kernel_sse4(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc){
+        __m128 acc[4][2];
+        for (auto& row : acc)
+            row[0] = row[1] = _mm_setzero_ps();
+        for (std::size_t p = 0; p < kc; p++) {
+            const __m128 b0 = _mm_load_ps(b);
+            const __m128 b1 = _mm_load_ps(b + 4);
+            for (std::size_t i = 0; i < 4; i++) {
+                const __m128 ai = _mm_set1_ps(a[i]);
+                acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(ai, b0));
+                acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(ai, b1));
+            }
+            a += 4;
+            b += 8;
+        }
+        for (std::size_t i = 0; i < 4; i++) {
+            float* row = c + i * ldc;
+            _mm_storeu_ps(row,     _mm_add_ps(_mm_loadu_ps(row),     acc[i][0]));
+            _mm_storeu_ps(row + 4, _mm_add_ps(_mm_loadu_ps(row + 4), acc[i][1]));
+        }
+    }
+
+    __attribute__((target("sse4.2")))
+    void micro_kernel_sse4(std::size_t kc, const double* a, const double* b, double* c, std::size_t ldc){
+        __m128d acc[4][2];
+        for (auto& row : acc)
+            row[0] = row[1] = _mm_setzero_pd();
+        for (std::size_t p = 0; p < kc; p++) {
+            const __m128d b0 = _mm_load_pd(b);
+            const __m128d b1 = _mm_load_pd(b + 2);
+            for (std::size_t i = 0; i < 4; i++) {
+                const __m128d ai = _mm_set1_pd(a[i]);
+                acc[i][0] = _mm_add_pd(acc[i][0], _mm_mul_pd(ai, b0));
+                acc[i][1] = _mm_add_pd(acc[i][1], _mm_mul_pd(ai, b1));
+            }
+            a += 4;
+            b += 4;
+        }
+        for (std::size_t i = 0; i < 4; i++) {
+            double* row = c + i * ldc;
+            _mm_storeu_pd(row,     _mm_add_pd(_mm_loadu_pd(row),     acc[i][0]));
+            _mm_storeu_pd(row + 2, _mm_add_pd(_mm_loadu_pd(row + 2), acc[i][1]));
+        }
+    }
+
+
+    // AVX2 + FMA: 6 x 16 floats / 6 x 8 doubles, 12 ymm accumulators + 2 for B + 1 for the broadcast of A
+    __attribute__((target("avx2,fma")))
+    void micro_kernel_avx2(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc){
+
+        __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+        __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+        __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+        __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+        __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+        __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+        for (std::size_t p = 0; p < kc; p++) {
+            const __m256 b0 = _mm256_load_ps(b);
+            const __m256 b1 = _mm256_load_ps(b + 8);
+            __m256 ai;
+            ai = _mm256_broadcast_ss(a + 0); c00 = _mm256_fmadd_ps(ai, b0, c00); c01 = _mm256_fmadd_ps(ai, b1, c01);
+            ai = _mm256_broadcast_ss(a + 1); c10 = _mm256_fmadd_ps(ai, b0, c10); c11 = _mm256_fmadd_ps(ai, b1, c11);
+            ai = _mm256_broadcast_ss(a + 2); c20 = _mm256_fmadd_ps(ai, b0, c20); c21 = _mm256_fmadd_ps(ai, b1, c21);
+            ai = _mm256_broadcast_ss(a + 3); c30 = _mm256_fmadd_ps(ai, b0, c30); c31 = _mm256_fmadd_ps(ai, b1, c31);
+            ai = _mm256_broadcast_ss(a + 4); c40 = _mm256_fmadd_ps(ai, b0, c40); c41 = _mm256_fmadd_ps(ai, b1, c41);
+            ai = _mm256_broadcast_ss(a + 5); c50 = _mm256_fmadd_ps(ai, b0, c50); c51 = _mm256_fmadd_ps(ai, b1, c51);
+            a += 6;
+            b += 16;
+        }
+
+        const __m256 acc[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+        for (std::size_t i = 0; i < 6; i++) {
+            float* row = c + i * ldc;
+            _mm256_storeu_ps(row,     _mm256_add_ps(_mm256_loadu_ps(row),     acc[i][0]));
+            _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[i][1]));
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    void micro_kernel_avx2(std::size_t kc, const double* a, const double* b, double* c, std::size_t ldc){
+
+        __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+        __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+        __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+        __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+        __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+        __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+        for (std::size_t p = 0; p < kc; p++) {
+            const __m256d b0 = _mm256_load_pd(b);
+            const __m256d b1 = _mm256_load_pd(b + 4);
+            __m256d ai;
+            ai = _mm256_broadcast_sd(a + 0); c00 = _mm256_fmadd_pd(ai, b0, c00); c01 = _mm256_fmadd_pd(ai, b1, c01);
+            ai = _mm256_broadcast_sd(a + 1); c10 = _mm256_fmadd_pd(ai, b0, c10); c11 = _mm256_fmadd_pd(ai, b1, c11);
+            ai = _mm256_broadcast_sd(a + 2); c20 = _mm256_fmadd_pd(ai, b0, c20); c21 = _mm256_fmadd_pd(ai, b1, c21);
+            ai = _mm256_broadcast_sd(a + 3); c30 = _mm256_fmadd_pd(ai, b0, c30); c31 = _mm256_fmadd_pd(ai, b1, c31);
+            ai = _mm256_broadcast_sd(a + 4); c40 = _mm256_fmadd_pd(ai, b0, c40); c41 = _mm256_fmadd_pd(ai, b1, c41);
+            ai = _mm256_broadcast_sd(a + 5); c50 = _mm256_fmadd_pd(ai, b0, c50); c51 = _mm256_fmadd_pd(ai, b1, c51);
+            a += 6;
+            b += 8;
+        }
+
+        const __m256d acc[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+        for (std::size_t i = 0; i < 6; i++) {
+            double* row = c + i * ldc;
+            _mm256_storeu_pd(row,     _mm256_add_pd(_mm256_loadu_pd(row),     acc[i][0]));
+            _mm256_storeu_pd(row + 4, _mm256_add_pd(_mm256_loadu_pd(row + 4), acc[i][1]));
+        }
+    }
+
+
+    // AVX-512: 8 x 32 floats / 8 x 16 doubles, 16 zmm accumulators (out of the 32 available)
+    __attribute__((target("avx512f")))
+    void micro_kernel_avx512(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc){
+        __m512 acc[8][2];
+        for (auto& row : acc)
+            row[0] = row[1] = _mm512_setzero_ps();
+        for (std::size_t p = 0; p < kc; p++) {
+            const __m512 b0 = _mm512_load_ps(b);
+            const __m512 b1 = _mm512_load_ps(b + 16);
+            for (std::size_t i = 0; i < 8; i++) {
+                const __m512 ai = _mm512_set1_ps(a[i]);
+                acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+            }
+            a += 8;
+            b += 32;
+        }
+        for (std::size_t i = 0; i < 8; i++) {
+            float* row = c + i * ldc;
+            _mm512_storeu_ps(row,      _mm512_add_ps(_mm512_loadu_ps(row),      acc[i][0]));
+            _mm512_storeu_ps(row + 16, _mm512_add_ps(_mm512_loadu_ps(row + 16), acc[i][1]));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void micro_kernel_avx512(std::size_t kc, const double* a, const double* b, double* c, std::size_t ldc){
+        __m512d acc[8][2];
+        for (auto& row : acc)
+            row[0] = row[1] = _mm512_setzero_pd();
+        for (std::size_t p = 0; p < kc; p++) {
+            const __m512d b0 = _mm512_load_pd(b);
+            const __m512d b1 = _mm512_load_pd(b + 8);
+            for (std::size_t i = 0; i < 8; i++) {
+                const __m512d ai = _mm512_set1_pd(a[i]);
+                acc[i][0] = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+                acc[i][1] = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+            }
+            a += 8;
+            b += 16;
+        }
+        for (std::size_t i = 0; i < 8; i++) {
+            double* row = c + i * ldc;
+            _mm512_storeu_pd(row,     _mm512_add_pd(_mm512_loadu_pd(row),     acc[i][0]));
+            _mm512_storeu_pd(row + 8, _mm512_add_pd(_mm512_loadu_pd(row + 8), acc[i][1]));
+        }
+    }
+
+
+    //! A micro-kernel together with the shape of the tile it computes
+    template<typename T>
+    struct MicroKernel{
+        std::size_t mr, nr;
+        void (*compute)(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc);
+    };
+
+    template<typename T>
+    MicroKernel<T> micro_kernel_for(SimdLevel level);
+
+    template<>
+    MicroKernel<float> micro_kernel_for<float>(SimdLevel level){
+        switch (level) {
+            case SimdLevel::AVX512:
+                return {8, 32, micro_kernel_avx512};
+            case SimdLevel::AVX2:
+                return {6, 16, micro_kernel_avx2};
+            case SimdLevel::SSE4:
+                return {4, 8, micro_kernel_sse4};
+            default:
+                return {4, 8, micro_kernel_scalar<float, 4, 8>};
+        }
+    }
+
+    template<>
+    MicroKernel<double> micro_kernel_for<double>(SimdLevel level){
+        switch (level) {
+            case SimdLevel::AVX512:
+                return {8, 16, micro_kernel_avx512};
+            case SimdLevel::AVX2:
+                return {6, 8, micro_kernel_avx2};
+            case SimdLevel::SSE4:
+                return {4, 4, micro_kernel_sse4};
+            default:
+                return {4, 4, micro_kernel_scalar<double, 4, 4>};
+        }
+    }
+
+    //! Micro-kernel of the best SIMD tier available on this machine, chosen once at the first call
+    template<typename T>
+    const MicroKernel<T>& select_micro_kernel(){
+        static const MicroKernel<T> kernel = micro_kernel_for<T>(simd_level());
+        return kernel;
+    }
+
+
+    //******************************************************************************************************************
+    // Packing routines. Both read the operand through a (row stride, column stride) pair so that the same code can
+    // pack a row-major block, a column-major block or a sub-block of a bigger matrix.
+    //******************************************************************************************************************
+
+    //! dst[0:n] = src[0:n] converted to T. The 16 bit types are widened with the SIMD conversions of half.hpp
+    //! (F16C / AVX-512 for fp16, a shift for bf16), the other types with a plain cast.
+    template<typename T, typename S>
+    inline void widen(const S* src, T* dst, std::size_t n){
+        for (std::size_t i = 0; i < n; i++)
+            dst[i] = static_cast<T>(src[i]);
+    }
+
+    inline void widen(const bf16_t* src, float* dst, std::size_t n){
+        convert(src, dst, n);
+    }
+
+    inline void widen(const fp16_t* src, float* dst, std::size_t n){
+        convert(src, dst, n);
+    }
+
+    //! Packs the mc x kc block of A starting at A into MR-tall slivers, zero padding the last one.
+    //! The operand can be stored in a narrower type S (see half.hpp), converted to T while packing: the rows of a
+    //! row-major A are widened whole, then spread over the slivers; a strided A is converted element by element.
+    template<typename T, typename S>
+    void pack_A(std::size_t mc, std::size_t kc, const S* A, std::size_t rsa, std::size_t csa, std::size_t MR, T* buffer){
+        // pack_A is called once per sliver: the widened row is kept by the thread instead of allocated every time
+        thread_local std::vector<T> row;
+        const bool widen_rows = !std::is_same<S, T>::value && csa == 1;
+        if (widen_rows && row.size() < kc)
+            row.resize(kc);
+        for (std::size_t ir = 0; ir < mc; ir += MR) {
+            const std::size_t mr = std::min(MR, mc - ir);
+            const S* sliver = A + ir * rsa;
+            if (widen_rows) {
+                for (std::size_t i = 0; i < MR; i++) {
+                    if (i < mr)
+                        widen(sliver + i * rsa, row.data(), kc);
+                    for (std::size_t p = 0; p < kc; p++)
+                        buffer[p * MR + i] = i < mr ? row[p] : T(0);
+                }
+                buffer += kc * MR;
+                continue;
+            }
+            for (std::size_t p = 0; p < kc; p++) {
+                std::size_t i = 0;
+                for (; i < mr; i++)
+                    buffer[i] = static_cast<T>(sliver[i * rsa + p * csa]);
+                for (; i < MR; i++)
+                    buffer[i] = T(0);
+                buffer += MR;
+            }
+        }
+    }
+
+    //! Packs one NR-wide sliver of the kc x nr block of B starting at B, zero padding the missing columns. The rows
+    //! of a row-major B in a narrower type are widened with widen, a strided B element by element.
+    template<typename T, typename S>
+    void pack_B_sliver(std::size_t kc, std::size_t nr, const S* B, std::size_t rsb, std::size_t csb, std::size_t NR, T* buffer){
+        for (std::size_t p = 0; p < kc; p++) {
+            const S* row = B + p * rsb;
+            std::size_t j = 0;
+            if (!std::is_same<S, T>::value && csb == 1) {
+                widen(row, buffer, nr);
+                j = nr;
+            }
+            for (; j < nr; j++)
+                buffer[j] = static_cast<T>(row[j * csb]);
+            for (; j < NR; j++)
+                buffer[j] = T(0);
+            buffer += NR;
+        }
+    }
+
+
+    //******************************************************************************************************************
+    // Macro-kernel: multiplies a packed mc x kc block of A by the packed slivers [jr_begin, jr_end) of B
+    //******************************************************************************************************************
+
+    template<typename T>
+    void macro_kernel(std::size_t mc, std::size_t nc, std::size_t kc, const T* packedA, const T* packedB,
+                      std::size_t jr_begin, std::size_t jr_end, T* C, std::size_t ldc, const MicroKernel<T>& kernel){
+
+        const std::size_t MR = kernel.mr, NR = kernel.nr;
+
+        // Edge tiles are computed in a local buffer and only the valid part is added to C
+        alignas(64) T edge[16 * 32];
+
+        for (std::size_t jr = jr_begin; jr < jr_end; jr += NR) {
+            const std::size_t nr = std::min(NR, nc - jr);
+            const T* b = packedB + jr * kc;
+            for (std::size_t ir = 0; ir < mc; ir += MR) {
+                const std::size_t mr = std::min(MR, mc - ir);
+                const T* a = packedA + ir * kc;
+                T* c = C + ir * ldc + jr;
+                if (mr == MR && nr == NR) {
+                    kernel.compute(kc, a, b, c, ldc);
+                } else {
+                    std::fill(edge, edge + MR * NR, T(0));
+                    kernel.compute(kc, a, b, edge, NR);
+                    for (std::size_t i = 0; i < mr; i++)
+                        for (std::size_t j = 0; j < nr; j++)
+                            c[i * ldc + j] += edge[i * NR + j];
+                }
+            }
+        }
+    }
+
+
+    //! Core of the engine: C += op(A)*op(B), where the operands are addressed through row and column strides.
+    //! A and B are stored as S and computed as T: the packing does the conversion, so only the packing routines
+    //! ever see S and the micro-kernels always run (and accumulate) in T.
+    //! The epilogue, if any, is applied to every tile of C by the task that computes its last KC block.
+    template<typename T, typename S = T>
+    void gemm_packed_strided(std::size_t M, std::size_t N, std::size_t K,
+                             const S* A, std::size_t rsa, std::size_t csa,
+                             const S* B, std::size_t rsb, std::size_t csb,
+                             T* C, std::size_t ldc, const TuningConfig& config,
+                             const Epilogue<T>* epilogue = nullptr){
+
+        if (M == 0 || N == 0 || K == 0)
+            return;
+
+        const MicroKernel<T>& kernel = select_micro_kernel<T>();
+        const PackedBlocking<T> blk = packed_default_blocking<T>();
+        const std::size_t MR = kernel.mr, NR = kernel.nr;
+        const std::size_t KC = std::min<std::size_t>(config.inner_tile > 0 ? config.inner_tile : blk.kc, K);
+        const std::size_t NC = std::min(blk.nc, ((N + NR - 1) / NR) * NR);
+        // A tuned MC is rounded up to a whole number of micro-tiles
+        const std::size_t MC = config.outer_tile > 0 ? ((config.outer_tile + MR - 1) / MR) * MR : blk.mc;
+        const bool by_b_chunk = config.loop_order == 1;
+
+        // The whole M x KC panel of A is packed once per pc iteration and shared among threads, this lets every
+        // thread pick any (A block, B chunk) pair without re-packing.
+        const std::size_t M_padded = ((M + MR - 1) / MR) * MR;
+        T* packedA = aligned_buffer<T>(M_padded * KC);
+        T* packedB = aligned_buffer<T>(NC * KC);
+
+        // B chunk processed by a single task: a few slivers, so that ragged edges still give work to every thread
+        const std::size_t NCHUNK = NR * 16;
+
+        const int numThreads = resolve_threads(config.threads);
+
+        for (std::size_t jc = 0; jc < N; jc += NC) {
+            const std::size_t nc = std::min(NC, N - jc);
+            const std::size_t n_slivers = (nc + NR - 1) / NR;
+
+            for (std::size_t pc = 0; pc < K; pc += KC) {
+                const std::size_t kc = std::min(KC, K - pc);
+                const std::size_t m_slivers = (M + MR - 1) / MR;
+
+                parallel_for(n_slivers, numThreads, [&](std::size_t s){
+                    const std::size_t jr = s * NR;
+                    pack_B_sliver(kc, std::min(NR, nc - jr), B + pc * rsb + (jc + jr) * csb, rsb, csb, NR,
+                                  packedB + jr * kc);
+                }, (n_slivers + numThreads - 1) / numThreads);
+
+                parallel_for(m_slivers, numThreads, [&](std::size_t s){
+                    const std::size_t ir = s * MR;
+                    pack_A(std::min(MR, M - ir), kc, A + ir * rsa + pc * csa, rsa, csa, MR, packedA + ir * kc);
+                }, (m_slivers + numThreads - 1) / numThreads);
+
+                const std::size_t m_blocks = (M + MC - 1) / MC;
+                const std::size_t n_chunks = (nc + NCHUNK - 1) / NCHUNK;
+
+                // Consecutive tasks share their A block (loop order 0) or their B chunk (loop order 1), which
+                // one is better depends on the shape and on the cache sizes, so it is left to the Autotuner
+                parallel_for(m_blocks * n_chunks, numThreads, [&](std::size_t t){
+                    const std::size_t ib = by_b_chunk ? t % m_blocks : t / n_chunks;
+                    const std::size_t jb = by_b_chunk ? t / m_blocks : t % n_chunks;
+                    const std::size_t ic = ib * MC;
+                    const std::size_t mc = std::min(MC, M - ic);
+                    const std::size_t jr_begin = jb * NCHUNK;
+                    const std::size_t jr_end = std::min(nc, jr_begin + NCHUNK);
+                    macro_kernel(mc, nc, kc, packedA + ic * kc, packedB, jr_begin, jr_end,
+                                 C + ic * ldc + jc, ldc, kernel);
+                    if (epilogue && pc + kc == K)
+                        apply_epilogue(*epilogue, mc, jr_end - jr_begin, ic, jc + jr_begin,
+                                       C + ic * ldc + jc + jr_begin, ldc);
+                });
+            }
+        }
+
+        std::free(packedA);
+        std::free(packedB);
+    }
+
+}
+
+
+// The cache blocks are multiples of every micro-tile shape (4, 6 and 8 rows, up to 32 columns)
+template<>
+PackedBlocking<float> packed_default_blocking<float>(){
+    const MicroKernel<float>& kernel = select_micro_kernel<float>();
+    return {kernel.mr, kernel.nr, 168, 256, 4096};
+}
+
+template<>
+PackedBlocking<double> packed_default_blocking<double>(){
+    const MicroKernel<double>& kernel = select_micro_kernel<double>();
+    return {kernel.mr, kernel.nr, 72, 256, 4096};
+}
+
+
+template<typename T>
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                 T* C, std::size_t ldc, const TuningConfig& config){
+    gemm_packed_strided(M, N, K, A, lda, 1, B, ldb, 1, C, ldc, config);
+}
+
+template<typename T>
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                 T* C, std::size_t ldc, int numThreads){
+    TuningConfig config;
+    tuned_config<T>(TunedKernel::Packed, M, N, K, config);
+    if (numThreads > 0)
+        config.threads = numThreads;
+    gemm_packed_strided(M, N, K, A, lda, 1, B, ldb, 1, C, ldc, config);
+}
+
+template<typename T>
+void gemm_packed(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                 const T* A, std::size_t lda, const T* B, std::size_t ldb, T* C, std::size_t ldc, int numThreads){
+    TuningConfig config;
+    tuned_config<T>(TunedKernel::Packed, M, N, K, config);
+    if (numThreads > 0)
+        config.threads = numThreads;
+    // op(A)(i, p) = A[i * rsa + p * csa], op(B)(p, j) = B[p * rsb + j * csb]
+    const std::size_t rsa = transA == Trans ? 1 : lda, csa = transA == Trans ? lda : 1;
+    const std::size_t rsb = transB == Trans ? 1 : ldb, csb = transB == Trans ? ldb : 1;
+    gemm_packed_strided(M, N, K, A, rsa, csa, B, rsb, csb, C, ldc, config);
+}
+
+template<typename T>
+void gemm_packed(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                 const T* A, std::size_t lda, const T* B, std::size_t ldb, T* C, std::size_t ldc,
+                 const Epilogue<T>& epilogue, int numThreads){
+    if (K == 0) {
+        // nothing to multiply, C is already final
+        apply_epilogue(epilogue, M, N, 0, 0, C, ldc);
+        return;
+    }
+    TuningConfig config;
+    tuned_config<T>(TunedKernel::Packed, M, N, K, config);
+    if (numThreads > 0)
+        config.threads = numThreads;
+    const std::size_t rsa = transA == Trans ? 1 : lda, csa = transA == Trans ? lda : 1;
+    const std::size_t rsb = transB == Trans ? 1 : ldb, csb = transB == Trans ? ldb : 1;
+    gemm_packed_strided(M, N, K, A, rsa, csa, B, rsb, csb, C, ldc, config, &epilogue);
+}
+
+template void gemm_packed<float>(std::size_t M, std::size_t N, std::size_t K, const float* A, std::size_t lda,
+                                 const float* B, std::size_t ldb, float* C, std::size_t ldc, int numThreads);
+template void gemm_packed<double>(std::size_t M, std::size_t N, std::size_t K, const double* A, std::size_t lda,
+                                  const double* B, std::size_t ldb, double* C, std::size_t ldc, int numThreads);
+template void gemm_packed<float>(std::size_t M, std::size_t N, std::size_t K, const float* A, std::size_t lda,
+                                 const float* B, std::size_t ldb, float* C, std::size_t ldc, const TuningConfig& config);
+template void gemm_packed<double>(std::size_t M, std::size_t N, std::size_t K, const double* A, std::size_t lda,
+                                  const double* B, std::size_t ldb, double* C, std::size_t ldc, const TuningConfig& config);
+template void gemm_packed<float>(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                                 const float* A, std::size_t lda, const float* B, std::size_t ldb,
+                                 float* C, std::size_t ldc, int numThreads);
+template void gemm_packed<double>(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                                  const double* A, std::size_t lda, const double* B, std::size_t ldb,
+                                  double* C, std::size_t ldc, int numThreads);
+template void gemm_packed<float>(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                                 const float* A, std::size_t lda, const float* B, std::size_t ldb,
+                                 float* C, std::size_t ldc, const Epilogue<float>& epilogue, int numThreads);
+template void gemm_packed<double>(Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+                                  const double* A, std::size_t lda, const double* B, std::size_t ldb,
+                                  double* C, std::size_t ldc, const Epilogue<double>& epilogue, int numThreads);
+
+
+
+// 16 bit operands: same engine as float (blocking and tuning of float), the packing converts them to fp32
+
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K, const bf16_t* A, std::size_t lda,
+                 const bf16_t* B, std::size_t ldb, float* C, std::size_t ldc, int numThreads){
+    TuningConfig config;
+    tuned_config<float>(TunedKernel::Packed, M, N, K, config);
+    if (numThreads > 0)
+        config.threads = numThreads;
+    gemm_packed_strided<float, bf16_t>(M, N, K, A, lda, 1, B, ldb, 1, C, ldc, config);
+}
+
+void gemm_packed(std::size_t M, std::size_t N, std::size_t K, const fp16_t* A, std::size_t lda,
+                 const fp16_t* B, std::size_t ldb, float* C, std::size_t ldc, int numThreads){
+    TuningConfig config;
+    tuned_config<float>(TunedKernel::Packed, M, N, K, config);
+    if (numThreads > 0)
+        config.threads = numThreads;
+    gemm_packed_strided<float, fp16_t>(M, N, K, A, lda, 1, B, ldb, 1, C, ldc, config);
+}
+
+
+void mmm_packed(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_packed in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_packed(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_packed(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_packed in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_packed(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_packed(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time,
+                Transpose transA, Transpose transB, int numThreads){
+
+    std::cout<<"Performing mmm_packed (op(A)*op(B)) in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = transA == Trans ? A.ncols() : A.nrows();
+    std::size_t inners = transA == Trans ? A.nrows() : A.ncols();
+    std::size_t columns = transB == Trans ? B.nrows() : B.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_packed(transA, transB, rows, columns, inners, A.get_ptr(), A.ncols(), B.get_ptr(), B.ncols(),
+                C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_packed(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time,
+                Transpose transA, Transpose transB, int numThreads){
+
+    std::cout<<"Performing mmm_packed (op(A)*op(B)) in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = transA == Trans ? A.ncols() : A.nrows();
+    std::size_t inners = transA == Trans ? A.nrows() : A.ncols();
+    std::size_t columns = transB == Trans ? B.nrows() : B.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_packed(transA, transB, rows, columns, inners, A.get_ptr(), A.ncols(), B.get_ptr(), B.ncols(),
+                C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+
+void mmm_packed(const MatrixFlat<bf16_t>& A, const MatrixFlat<bf16_t>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_packed in bfloat16 with fp32 accumulation ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_packed(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_packed(const MatrixFlat<fp16_t>& A, const MatrixFlat<fp16_t>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_packed in float16 with fp32 accumulation ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_packed(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
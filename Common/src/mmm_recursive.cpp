@@ -0,0 +1,274 @@
+#include "../include/mmm.hpp"
+#include "../include/gemm_recursive.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <immintrin.h>
+
+
+namespace {
+
+    //! The recursion stops when M, N and K are all at most this size: the three blocks of the base case fit in L1/L2
+    constexpr std::size_t base_size = 64;
+
+    //! Sub-products with less multiply-adds than this run on the thread that reached them
+    constexpr std::size_t parallel_work = std::size_t(1) << 21;
+
+
+    //******************************************************************************************************************
+    // Base case: C += A*B on blocks of at most base_size. C is covered by strips of 4 rows x W columns, and each
+    // strip is kept in registers for the whole k loop: every step loads one row of B (W elements) and multiplies it
+    // by the 4 elements of A in the same column, so a strip costs 4 * W loads and stores of C for 4 * W * k
+    // multiply-adds. The last columns (narrower than a strip) and the last rows (less than 4) are plain loops.
+    //******************************************************************************************************************
+
+    template<typename T>
+    using StripKernel = void (*)(std::size_t k, const T* A, std::size_t lda, const T* B, std::size_t ldb, T* C,
+                                 std::size_t ldc);
+
+    // AVX-512 register operations, overloaded on float / double
+    __attribute__((target("avx512f"))) inline __m512  load512(const float* p){return _mm512_loadu_ps(p);}
+    __attribute__((target("avx512f"))) inline __m512d load512(const double* p){return _mm512_loadu_pd(p);}
+    __attribute__((target("avx512f"))) inline __m512  set512(float a){return _mm512_set1_ps(a);}
+    __attribute__((target("avx512f"))) inline __m512d set512(double a){return _mm512_set1_pd(a);}
+    __attribute__((target("avx512f"))) inline void store512(float* p, __m512 r){_mm512_storeu_ps(p, r);}
+    __attribute__((target("avx512f"))) inline void store512(double* p, __m512d r){_mm512_storeu_pd(p, r);}
+    __attribute__((target("avx512f"))) inline __m512  fma512(__m512 a, __m512 b, __m512 c){return _mm512_fmadd_ps(a, b, c);}
+    __attribute__((target("avx512f"))) inline __m512d fma512(__m512d a, __m512d b, __m512d c){return _mm512_fmadd_pd(a, b, c);}
+
+    // AVX2 + FMA register operations
+    __attribute__((target("avx2,fma"))) inline __m256  load256(const float* p){return _mm256_loadu_ps(p);}
+    __attribute__((target("avx2,fma"))) inline __m256d load256(const double* p){return _mm256_loadu_pd(p);}
+    __attribute__((target("avx2,fma"))) inline __m256  set256(float a){return _mm256_set1_ps(a);}
+    __attribute__((target("avx2,fma"))) inline __m256d set256(double a){return _mm256_set1_pd(a);}
+    __attribute__((target("avx2,fma"))) inline void store256(float* p, __m256 r){_mm256_storeu_ps(p, r);}
+    __attribute__((target("avx2,fma"))) inline void store256(double* p, __m256d r){_mm256_storeu_pd(p, r);}
+    __attribute__((target("avx2,fma"))) inline __m256  fma256(__m256 a, __m256 b, __m256 c){return _mm256_fmadd_ps(a, b, c);}
+    __attribute__((target("avx2,fma"))) inline __m256d fma256(__m256d a, __m256d b, __m256d c){return _mm256_fmadd_pd(a, b, c);}
+
+    template<typename T>
+    using reg512 = decltype(load512(static_cast<const T*>(nullptr)));
+    template<typename T>
+    using reg256 = decltype(load256(static_cast<const T*>(nullptr)));
+
+    //! Strip of 4 rows x R registers, R = 4 takes 16 of the 32 registers
+    template<typename T, int R>
+    __attribute__((target("avx512f")))
+    void strip_avx512(std::size_t k, const T* A, std::size_t lda, const T* B, std::size_t ldb, T* C, std::size_t ldc){
+        constexpr std::size_t w = 64 / sizeof(T);
+        reg512<T> acc[4][R];
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < R; i++)
+                acc[r][i] = load512(C + r * ldc + i * w);
+        for (std::size_t p = 0; p < k; p++) {
+            reg512<T> b[R];
+            for (int i = 0; i < R; i++)
+                b[i] = load512(B + p * ldb + i * w);
+            for (int r = 0; r < 4; r++) {
+                const auto a = set512(A[r * lda + p]);
+                for (int i = 0; i < R; i++)
+                    acc[r][i] = fma512(a, b[i], acc[r][i]);
+            }
+        }
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < R; i++)
+                store512(C + r * ldc + i * w, acc[r][i]);
+    }
+
+    //! Strip of 4 rows x R registers, R = 2 takes 8 of the 16 registers (the others hold the row of B and A)
+    template<typename T, int R>
+    __attribute__((target("avx2,fma")))
+    void strip_avx2(std::size_t k, const T* A, std::size_t lda, const T* B, std::size_t ldb, T* C, std::size_t ldc){
+        constexpr std::size_t w = 32 / sizeof(T);
+        reg256<T> acc[4][R];
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < R; i++)
+                acc[r][i] = load256(C + r * ldc + i * w);
+        for (std::size_t p = 0; p < k; p++) {
+            reg256<T> b[R];
+            for (int i = 0; i < R; i++)
+                b[i] = load256(B + p * ldb + i * w);
+            for (int r = 0; r < 4; r++) {
+                const auto a = set256(A[r * lda + p]);
+                for (int i = 0; i < R; i++)
+                    acc[r][i] = fma256(a, b[i], acc[r][i]);
+            }
+        }
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < R; i++)
+                store256(C + r * ldc + i * w, acc[r][i]);
+    }
+
+    //! Strip of 4 rows x W elements in local accumulators, vectorized by the compiler where it can
+    template<typename T, std::size_t W>
+    void strip_scalar(std::size_t k, const T* A, std::size_t lda, const T* B, std::size_t ldb, T* C, std::size_t ldc){
+        T acc[4][W];
+        for (std::size_t r = 0; r < 4; r++)
+            for (std::size_t j = 0; j < W; j++)
+                acc[r][j] = C[r * ldc + j];
+        for (std::size_t p = 0; p < k; p++)
+            for (std::size_t r = 0; r < 4; r++) {
+                const T a = A[r * lda + p];
+                for (std::size_t j = 0; j < W; j++)
+                    acc[r][j] += a * B[p * ldb + j];
+            }
+        for (std::size_t r = 0; r < 4; r++)
+            for (std::size_t j = 0; j < W; j++)
+                C[r * ldc + j] = acc[r][j];
+    }
+
+    //! Base case with strips of W columns computed by strip
+    template<typename T, std::size_t W, StripKernel<T> strip>
+    void base_kernel(std::size_t m, std::size_t n, std::size_t k, const T* A, std::size_t lda, const T* B,
+                     std::size_t ldb, T* C, std::size_t ldc){
+        std::size_t i = 0;
+        for (; i + 4 <= m; i += 4) {
+            std::size_t j0 = 0;
+            for (; j0 + W <= n; j0 += W)
+                strip(k, A + i * lda, lda, B + j0, ldb, C + i * ldc + j0, ldc);
+            // last columns, narrower than a strip
+            if (j0 < n)
+                for (std::size_t r = i; r < i + 4; r++)
+                    for (std::size_t p = 0; p < k; p++) {
+                        const T arp = A[r * lda + p];
+                        for (std::size_t j = j0; j < n; j++)
+                            C[r * ldc + j] += arp * B[p * ldb + j];
+                    }
+        }
+        // last rows, less than 4
+        for (; i < m; i++)
+            for (std::size_t p = 0; p < k; p++) {
+                const T aip = A[i * lda + p];
+                for (std::size_t j = 0; j < n; j++)
+                    C[i * ldc + j] += aip * B[p * ldb + j];
+            }
+    }
+
+    template<typename T>
+    using BaseKernel = void (*)(std::size_t m, std::size_t n, std::size_t k, const T* A, std::size_t lda,
+                                const T* B, std::size_t ldb, T* C, std::size_t ldc);
+
+    //! Base case of the best SIMD tier available on this machine, chosen once at the first call
+    template<typename T>
+    BaseKernel<T> select_base_kernel(){
+        static const BaseKernel<T> kernel = []() -> BaseKernel<T> {
+            switch (simd_level()) {
+                case SimdLevel::AVX512:
+                    return base_kernel<T, 4 * 64 / sizeof(T), strip_avx512<T, 4>>;
+                case SimdLevel::AVX2:
+                    return base_kernel<T, 2 * 32 / sizeof(T), strip_avx2<T, 2>>;
+                case SimdLevel::SSE4:
+                    return base_kernel<T, 32 / sizeof(T), strip_scalar<T, 32 / sizeof(T)>>;
+                default:
+                    return base_kernel<T, 4, strip_scalar<T, 4>>;
+            }
+        }();
+        return kernel;
+    }
+
+
+    //******************************************************************************************************************
+    // Recursion
+    //******************************************************************************************************************
+
+    //! Size of the first half of a split of n > align, a multiple of align so that the base cases work on whole
+    //! strips (the columns are split at multiples of base_size, the widest strip)
+    inline std::size_t half(std::size_t n, std::size_t align){
+        return std::max(align, n / 2 / align * align);
+    }
+
+    template<typename T>
+    void recurse(BaseKernel<T> kernel, std::size_t M, std::size_t N, std::size_t K, const T* A, std::size_t lda,
+                 const T* B, std::size_t ldb, T* C, std::size_t ldc, int numThreads){
+
+        if (M <= base_size && N <= base_size && K <= base_size) {
+            kernel(M, N, K, A, lda, B, ldb, C, ldc);
+            return;
+        }
+
+        // K: both halves add to the whole C, one after the other
+        if (K > M && K > N) {
+            const std::size_t k1 = half(K, 8);
+            recurse(kernel, M, N, k1, A, lda, B, ldb, C, ldc, numThreads);
+            recurse(kernel, M, N, K - k1, A + k1, lda, B + k1 * ldb, ldb, C, ldc, numThreads);
+            return;
+        }
+
+        // M or N: the halves write different blocks of C and are independent
+        auto part = [&](std::size_t h){
+            if (M >= N) {
+                const std::size_t m1 = half(M, 4);
+                if (h == 0)
+                    recurse(kernel, m1, N, K, A, lda, B, ldb, C, ldc, numThreads);
+                else
+                    recurse(kernel, M - m1, N, K, A + m1 * lda, lda, B, ldb, C + m1 * ldc, ldc, numThreads);
+            }
+            else {
+                const std::size_t n1 = half(N, base_size);
+                if (h == 0)
+                    recurse(kernel, M, n1, K, A, lda, B, ldb, C, ldc, numThreads);
+                else
+                    recurse(kernel, M, N - n1, K, A, lda, B + n1, ldb, C + n1, ldc, numThreads);
+            }
+        };
+
+        if (numThreads > 1 && M * N * K >= parallel_work)
+            ThreadPool::instance().run(2, 1, numThreads, [&](std::size_t begin, std::size_t end, int){
+                for (std::size_t h = begin; h < end; h++)
+                    part(h);
+            });
+        else {
+            part(0);
+            part(1);
+        }
+    }
+
+}
+
+
+template<typename T>
+void gemm_recursive(std::size_t M, std::size_t N, std::size_t K, const T* A, std::size_t lda, const T* B,
+                    std::size_t ldb, T* C, std::size_t ldc, int numThreads){
+
+    if (M == 0 || N == 0 || K == 0)
+        return;
+
+    recurse(select_base_kernel<T>(), M, N, K, A, lda, B, ldb, C, ldc, resolve_threads(numThreads));
+}
+
+template void gemm_recursive<float>(std::size_t M, std::size_t N, std::size_t K, const float* A, std::size_t lda,
+                                    const float* B, std::size_t ldb, float* C, std::size_t ldc, int numThreads);
+template void gemm_recursive<double>(std::size_t M, std::size_t N, std::size_t K, const double* A, std::size_t lda,
+                                     const double* B, std::size_t ldb, double* C, std::size_t ldc, int numThreads);
+
+
+
+void mmm_recursive(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_recursive in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_recursive(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_recursive(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_recursive in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_recursive(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
@@ -0,0 +1,487 @@
+#include "../include/mmm.hpp"
+#include "../include/gemm_sparse.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <immintrin.h>
+
+
+namespace {
+
+    //******************************************************************************************************************
+    // Sparse primitives, for a line of n stored elements with positions idx and values v:
+    //   combine(n, idx, v, B, ldb, N, c): c[0:N) += sum_p v[p] * B[idx[p]][0:N)
+    //   dot(n, idx, v, x) = sum_p v[p] * x[idx[p]]
+    // One variant per SIMD tier, compiled for its own target and picked at runtime by select_sparse_kernels().
+    //******************************************************************************************************************
+
+    template<typename T>
+    void combine_scalar(std::size_t n, const std::uint32_t* idx, const T* v, const T* B, std::size_t ldb,
+                        std::size_t N, T* c){
+        for (std::size_t p = 0; p < n; p++) {
+            const T* b = B + idx[p] * ldb;
+            for (std::size_t j = 0; j < N; j++)
+                c[j] += v[p] * b[j];
+        }
+    }
+
+    template<typename T>
+    T dot_scalar(std::size_t n, const std::uint32_t* idx, const T* v, const T* x){
+        T acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        std::size_t p = 0;
+        for (; p + 4 <= n; p += 4) {
+            acc0 += v[p] * x[idx[p]];
+            acc1 += v[p + 1] * x[idx[p + 1]];
+            acc2 += v[p + 2] * x[idx[p + 2]];
+            acc3 += v[p + 3] * x[idx[p + 3]];
+        }
+        for (; p < n; p++)
+            acc0 += v[p] * x[idx[p]];
+        return (acc0 + acc1) + (acc2 + acc3);
+    }
+
+
+    // Register operations of every tier, overloaded on float / double so that combine is written once per tier
+
+    // SSE4 (no FMA)
+    __attribute__((target("sse4.2"))) inline __m128  load128(const float* p){return _mm_loadu_ps(p);}
+    __attribute__((target("sse4.2"))) inline __m128d load128(const double* p){return _mm_loadu_pd(p);}
+    __attribute__((target("sse4.2"))) inline __m128  set128(float a){return _mm_set1_ps(a);}
+    __attribute__((target("sse4.2"))) inline __m128d set128(double a){return _mm_set1_pd(a);}
+    __attribute__((target("sse4.2"))) inline void store128(float* p, __m128 r){_mm_storeu_ps(p, r);}
+    __attribute__((target("sse4.2"))) inline void store128(double* p, __m128d r){_mm_storeu_pd(p, r);}
+    __attribute__((target("sse4.2"))) inline __m128  fma128(__m128 a, __m128 b, __m128 c){return _mm_add_ps(_mm_mul_ps(a, b), c);}
+    __attribute__((target("sse4.2"))) inline __m128d fma128(__m128d a, __m128d b, __m128d c){return _mm_add_pd(_mm_mul_pd(a, b), c);}
+
+    // AVX2 + FMA
+    __attribute__((target("avx2,fma"))) inline __m256  load256(const float* p){return _mm256_loadu_ps(p);}
+    __attribute__((target("avx2,fma"))) inline __m256d load256(const double* p){return _mm256_loadu_pd(p);}
+    __attribute__((target("avx2,fma"))) inline __m256  set256(float a){return _mm256_set1_ps(a);}
+    __attribute__((target("avx2,fma"))) inline __m256d set256(double a){return _mm256_set1_pd(a);}
+    __attribute__((target("avx2,fma"))) inline void store256(float* p, __m256 r){_mm256_storeu_ps(p, r);}
+    __attribute__((target("avx2,fma"))) inline void store256(double* p, __m256d r){_mm256_storeu_pd(p, r);}
+    __attribute__((target("avx2,fma"))) inline __m256  fma256(__m256 a, __m256 b, __m256 c){return _mm256_fmadd_ps(a, b, c);}
+    __attribute__((target("avx2,fma"))) inline __m256d fma256(__m256d a, __m256d b, __m256d c){return _mm256_fmadd_pd(a, b, c);}
+
+    // AVX-512
+    __attribute__((target("avx512f"))) inline __m512  load512(const float* p){return _mm512_loadu_ps(p);}
+    __attribute__((target("avx512f"))) inline __m512d load512(const double* p){return _mm512_loadu_pd(p);}
+    __attribute__((target("avx512f"))) inline __m512  set512(float a){return _mm512_set1_ps(a);}
+    __attribute__((target("avx512f"))) inline __m512d set512(double a){return _mm512_set1_pd(a);}
+    __attribute__((target("avx512f"))) inline void store512(float* p, __m512 r){_mm512_storeu_ps(p, r);}
+    __attribute__((target("avx512f"))) inline void store512(double* p, __m512d r){_mm512_storeu_pd(p, r);}
+    __attribute__((target("avx512f"))) inline __m512  fma512(__m512 a, __m512 b, __m512 c){return _mm512_fmadd_ps(a, b, c);}
+    __attribute__((target("avx512f"))) inline __m512d fma512(__m512d a, __m512d b, __m512d c){return _mm512_fmadd_pd(a, b, c);}
+
+
+    // combine: strips of 4 registers of c stay in registers for the whole line, then one register, then the scalar
+    // loop for the last columns
+
+    template<typename T>
+    __attribute__((target("sse4.2")))
+    void combine_sse4(std::size_t n, const std::uint32_t* idx, const T* v, const T* B, std::size_t ldb,
+                      std::size_t N, T* c){
+        constexpr std::size_t w = 16 / sizeof(T);
+        std::size_t j = 0;
+        for (; j + 4 * w <= N; j += 4 * w) {
+            auto c0 = load128(c + j), c1 = load128(c + j + w), c2 = load128(c + j + 2 * w), c3 = load128(c + j + 3 * w);
+            for (std::size_t p = 0; p < n; p++) {
+                const T* b = B + idx[p] * ldb + j;
+                const auto a = set128(v[p]);
+                c0 = fma128(a, load128(b), c0);
+                c1 = fma128(a, load128(b + w), c1);
+                c2 = fma128(a, load128(b + 2 * w), c2);
+                c3 = fma128(a, load128(b + 3 * w), c3);
+            }
+            store128(c + j, c0); store128(c + j + w, c1); store128(c + j + 2 * w, c2); store128(c + j + 3 * w, c3);
+        }
+        for (; j + w <= N; j += w) {
+            auto c0 = load128(c + j);
+            for (std::size_t p = 0; p < n; p++)
+                c0 = fma128(set128(v[p]), load128(B + idx[p] * ldb + j), c0);
+            store128(c + j, c0);
+        }
+        if (j < N)
+            combine_scalar(n, idx, v, B + j, ldb, N - j, c + j);
+    }
+
+    template<typename T>
+    __attribute__((target("avx2,fma")))
+    void combine_avx2(std::size_t n, const std::uint32_t* idx, const T* v, const T* B, std::size_t ldb,
+                      std::size_t N, T* c){
+        constexpr std::size_t w = 32 / sizeof(T);
+        std::size_t j = 0;
+        for (; j + 4 * w <= N; j += 4 * w) {
+            auto c0 = load256(c + j), c1 = load256(c + j + w), c2 = load256(c + j + 2 * w), c3 = load256(c + j + 3 * w);
+            for (std::size_t p = 0; p < n; p++) {
+                const T* b = B + idx[p] * ldb + j;
+                const auto a = set256(v[p]);
+                c0 = fma256(a, load256(b), c0);
+                c1 = fma256(a, load256(b + w), c1);
+                c2 = fma256(a, load256(b + 2 * w), c2);
+                c3 = fma256(a, load256(b + 3 * w), c3);
+            }
+            store256(c + j, c0); store256(c + j + w, c1); store256(c + j + 2 * w, c2); store256(c + j + 3 * w, c3);
+        }
+        for (; j + w <= N; j += w) {
+            auto c0 = load256(c + j);
+            for (std::size_t p = 0; p < n; p++)
+                c0 = fma256(set256(v[p]), load256(B + idx[p] * ldb + j), c0);
+            store256(c + j, c0);
+        }
+        if (j < N)
+            combine_scalar(n, idx, v, B + j, ldb, N - j, c + j);
+    }
+
+    template<typename T>
+    __attribute__((target("avx512f")))
+    void combine_avx512(std::size_t n, const std::uint32_t* idx, const T* v, const T* B, std::size_t ldb,
+                        std::size_t N, T* c){
+        constexpr std::size_t w = 64 / sizeof(T);
+        std::size_t j = 0;
+        for (; j + 4 * w <= N; j += 4 * w) {
+            auto c0 = load512(c + j), c1 = load512(c + j + w), c2 = load512(c + j + 2 * w), c3 = load512(c + j + 3 * w);
+            for (std::size_t p = 0; p < n; p++) {
+                const T* b = B + idx[p] * ldb + j;
+                const auto a = set512(v[p]);
+                c0 = fma512(a, load512(b), c0);
+                c1 = fma512(a, load512(b + w), c1);
+                c2 = fma512(a, load512(b + 2 * w), c2);
+                c3 = fma512(a, load512(b + 3 * w), c3);
+            }
+            store512(c + j, c0); store512(c + j + w, c1); store512(c + j + 2 * w, c2); store512(c + j + 3 * w, c3);
+        }
+        for (; j + w <= N; j += w) {
+            auto c0 = load512(c + j);
+            for (std::size_t p = 0; p < n; p++)
+                c0 = fma512(set512(v[p]), load512(B + idx[p] * ldb + j), c0);
+            store512(c + j, c0);
+        }
+        if (j < N)
+            combine_scalar(n, idx, v, B + j, ldb, N - j, c + j);
+    }
+
+
+    // dot: the elements of x are gathered one register at a time (the gathers are not available before AVX2, the
+    // SSE4 tier uses the scalar version)
+
+    __attribute__((target("avx2,fma")))
+    float dot_avx2(std::size_t n, const std::uint32_t* idx, const float* v, const float* x){
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        std::size_t p = 0;
+        for (; p + 16 <= n; p += 16) {
+            const __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + p));
+            const __m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + p + 8));
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(v + p),     _mm256_i32gather_ps(x, i0, 4), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(v + p + 8), _mm256_i32gather_ps(x, i1, 4), acc1);
+        }
+        for (; p + 8 <= n; p += 8) {
+            const __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + p));
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(v + p), _mm256_i32gather_ps(x, i0, 4), acc0);
+        }
+        const __m256 acc = _mm256_add_ps(acc0, acc1);
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        float result = _mm_cvtss_f32(sum);
+        for (; p < n; p++)
+            result += v[p] * x[idx[p]];
+        return result;
+    }
+
+    __attribute__((target("avx2,fma")))
+    double dot_avx2(std::size_t n, const std::uint32_t* idx, const double* v, const double* x){
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+        std::size_t p = 0;
+        for (; p + 8 <= n; p += 8) {
+            const __m128i i0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + p));
+            const __m128i i1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + p + 4));
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(v + p),     _mm256_i32gather_pd(x, i0, 8), acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(v + p + 4), _mm256_i32gather_pd(x, i1, 8), acc1);
+        }
+        for (; p + 4 <= n; p += 4) {
+            const __m128i i0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + p));
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(v + p), _mm256_i32gather_pd(x, i0, 8), acc0);
+        }
+        const __m256d acc = _mm256_add_pd(acc0, acc1);
+        __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum = _mm_hadd_pd(sum, sum);
+        double result = _mm_cvtsd_f64(sum);
+        for (; p < n; p++)
+            result += v[p] * x[idx[p]];
+        return result;
+    }
+
+    __attribute__((target("avx512f")))
+    float dot_avx512(std::size_t n, const std::uint32_t* idx, const float* v, const float* x){
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        std::size_t p = 0;
+        for (; p + 32 <= n; p += 32) {
+            const __m512i i0 = _mm512_loadu_si512(idx + p), i1 = _mm512_loadu_si512(idx + p + 16);
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(v + p),      _mm512_i32gather_ps(i0, x, 4), acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(v + p + 16), _mm512_i32gather_ps(i1, x, 4), acc1);
+        }
+        for (; p + 16 <= n; p += 16)
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(v + p), _mm512_i32gather_ps(_mm512_loadu_si512(idx + p), x, 4), acc0);
+        float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+        for (; p < n; p++)
+            result += v[p] * x[idx[p]];
+        return result;
+    }
+
+    __attribute__((target("avx512f")))
+    double dot_avx512(std::size_t n, const std::uint32_t* idx, const double* v, const double* x){
+        __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+        std::size_t p = 0;
+        for (; p + 16 <= n; p += 16) {
+            const __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + p));
+            const __m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + p + 8));
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(v + p),     _mm512_i32gather_pd(i0, x, 8), acc0);
+            acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(v + p + 8), _mm512_i32gather_pd(i1, x, 8), acc1);
+        }
+        for (; p + 8 <= n; p += 8) {
+            const __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + p));
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(v + p), _mm512_i32gather_pd(i0, x, 8), acc0);
+        }
+        double result = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+        for (; p < n; p++)
+            result += v[p] * x[idx[p]];
+        return result;
+    }
+
+
+    //! combine and dot of one tier
+    template<typename T>
+    struct SparseKernels{
+        void (*combine)(std::size_t n, const std::uint32_t* idx, const T* v, const T* B, std::size_t ldb,
+                        std::size_t N, T* c);
+        T (*dot)(std::size_t n, const std::uint32_t* idx, const T* v, const T* x);
+    };
+
+    template<typename T>
+    SparseKernels<T> sparse_kernels_for(SimdLevel level){
+        switch (level) {
+            case SimdLevel::AVX512:
+                return {combine_avx512<T>, dot_avx512};
+            case SimdLevel::AVX2:
+                return {combine_avx2<T>, dot_avx2};
+            case SimdLevel::SSE4:
+                return {combine_sse4<T>, dot_scalar<T>};
+            default:
+                return {combine_scalar<T>, dot_scalar<T>};
+        }
+    }
+
+    //! Primitives of the best SIMD tier available on this machine, chosen once at the first call
+    template<typename T>
+    const SparseKernels<T>& select_sparse_kernels(){
+        static const SparseKernels<T> kernels = sparse_kernels_for<T>(simd_level());
+        return kernels;
+    }
+
+
+    //! Below this number of multiply-adds the cost of waking up the threads is larger than the product itself
+    constexpr std::size_t parallel_threshold = 1 << 15;
+
+    //! Size of the block of B kept in cache by the CSR x dense product (half of a typical L2)
+    constexpr std::size_t l2_bytes = 1 << 18;
+
+    //! Columns of C computed by one task of the dense x CSC product, so that a few rows (spmv) are still split
+    //! among the threads
+    constexpr std::size_t column_chunk = 256;
+
+    //! Rows of A packed together by the dense x CSC product: one AVX-512 register of float
+    constexpr std::size_t panel_rows = 16;
+
+}
+
+
+template<typename T>
+void spmm(const MatrixCSR<T>& A, const T* B, std::size_t N, std::size_t ldb, T* C, std::size_t ldc, int numThreads){
+
+    const std::size_t M = A.nrows();
+    if (M == 0 || N == 0 || A.values().empty())
+        return;
+
+    const SparseKernels<T>& k = select_sparse_kernels<T>();
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && A.values().size() * N >= parallel_threshold;
+
+    const std::size_t* ptr = A.outer_ptr().data();
+    const std::uint32_t* idx = A.inner_idx().data();
+    const T* v = A.values().data();
+    // row i of C += the rows of B selected by row i of A; the empty rows of A (pruned neurons) cost nothing.
+    // B is read in blocks of columns that fit in L2, shared by all the rows of C: the rows of B are selected in a
+    // random order, which the prefetchers cannot follow on a matrix that lives in memory.
+    const std::size_t block = std::min(N, std::max<std::size_t>(64, (l2_bytes / (A.ncols() * sizeof(T))) / 64 * 64));
+    const std::size_t blocks = (N + block - 1) / block;
+    const std::size_t rows = std::max<std::size_t>(1, M * blocks / (8 * numThreads));
+    const std::size_t row_chunks = (M + rows - 1) / rows;
+    parallel_for(blocks * row_chunks, parallel ? numThreads : 1, [&](std::size_t item){
+        const std::size_t j0 = (item / row_chunks) * block, i0 = (item % row_chunks) * rows;
+        const std::size_t width = std::min(block, N - j0);
+        for (std::size_t i = i0; i < std::min(M, i0 + rows); i++)
+            if (ptr[i + 1] > ptr[i])
+                k.combine(ptr[i + 1] - ptr[i], idx + ptr[i], v + ptr[i], B + j0, ldb, width, C + i * ldc + j0);
+    });
+}
+
+template<typename T>
+void spmm(std::size_t M, const T* A, std::size_t lda, const MatrixCSC<T>& B, T* C, std::size_t ldc, int numThreads){
+
+    const std::size_t N = B.ncols(), K = B.nrows();
+    if (M == 0 || N == 0 || B.values().empty())
+        return;
+
+    const SparseKernels<T>& k = select_sparse_kernels<T>();
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && M * B.values().size() >= parallel_threshold;
+    const int threads = parallel ? numThreads : 1;
+
+    const std::size_t* ptr = B.outer_ptr().data();
+    const std::uint32_t* idx = B.inner_idx().data();
+    const T* v = B.values().data();
+
+    if (M < panel_rows / 2) {
+        // a few rows (spmv): C[i][j] += <row i of A, column j of B>, gathering the elements of the row
+        const std::size_t chunks = (N + column_chunk - 1) / column_chunk;
+        parallel_for(M * chunks, threads, [&](std::size_t item){
+            const std::size_t i = item / chunks, j0 = (item % chunks) * column_chunk;
+            const std::size_t j1 = std::min(N, j0 + column_chunk);
+            const T* a = A + i * lda;
+            T* c = C + i * ldc;
+            for (std::size_t j = j0; j < j1; j++)
+                if (ptr[j + 1] > ptr[j])
+                    c[j] += k.dot(ptr[j + 1] - ptr[j], idx + ptr[j], v + ptr[j], a);
+        });
+        return;
+    }
+
+    // panel_rows rows of A are packed transposed (K x panel_rows, zero padded), so that the elements of a column of
+    // B select contiguous rows of the panel: C[i0:i0+panel_rows][j] is computed by combine in registers, the same
+    // kernel as the CSR product. The columns are split in chunks only when there are not enough blocks of rows.
+    const std::size_t blocks = (M + panel_rows - 1) / panel_rows;
+    const std::size_t chunks = std::min<std::size_t>((N + column_chunk - 1) / column_chunk,
+                                                     (4 * threads + blocks - 1) / blocks);
+    const std::size_t chunk = (N + chunks - 1) / chunks;
+    std::vector<std::vector<T>> panels(threads, std::vector<T>(K * panel_rows));
+
+    parallel_for_slot(blocks * chunks, threads, [&](std::size_t item, int slot){
+        const std::size_t i0 = (item / chunks) * panel_rows, j0 = (item % chunks) * chunk;
+        const std::size_t rows = std::min(panel_rows, M - i0), j1 = std::min(N, j0 + chunk);
+        T* panel = panels[slot].data();
+        for (std::size_t r = 0; r < panel_rows; r++)
+            for (std::size_t kk = 0; kk < K; kk++)
+                panel[kk * panel_rows + r] = r < rows ? A[(i0 + r) * lda + kk] : T(0);
+        T column[panel_rows];
+        for (std::size_t j = j0; j < j1; j++) {
+            if (ptr[j + 1] == ptr[j])
+                continue;
+            std::fill(column, column + panel_rows, T(0));
+            k.combine(ptr[j + 1] - ptr[j], idx + ptr[j], v + ptr[j], panel, panel_rows, panel_rows, column);
+            for (std::size_t r = 0; r < rows; r++)
+                C[(i0 + r) * ldc + j] += column[r];
+        }
+    });
+}
+
+template<typename T>
+void spmv(const MatrixCSR<T>& A, const T* x, T* y, int numThreads){
+
+    const std::size_t M = A.nrows();
+    if (M == 0 || A.values().empty())
+        return;
+
+    const SparseKernels<T>& k = select_sparse_kernels<T>();
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && A.values().size() >= parallel_threshold;
+
+    const std::size_t* ptr = A.outer_ptr().data();
+    const std::uint32_t* idx = A.inner_idx().data();
+    const T* v = A.values().data();
+    parallel_for(M, parallel ? numThreads : 1, [&](std::size_t i){
+        if (ptr[i + 1] > ptr[i])
+            y[i] += k.dot(ptr[i + 1] - ptr[i], idx + ptr[i], v + ptr[i], x);
+    }, std::max<std::size_t>(1, M / (8 * numThreads)));
+}
+
+template<typename T>
+void spmv(const T* x, const MatrixCSC<T>& A, T* y, int numThreads){
+    spmm<T>(1, x, A.nrows(), A, y, A.ncols(), numThreads);
+}
+
+template void spmm<float>(const MatrixCSR<float>& A, const float* B, std::size_t N, std::size_t ldb, float* C,
+                          std::size_t ldc, int numThreads);
+template void spmm<double>(const MatrixCSR<double>& A, const double* B, std::size_t N, std::size_t ldb, double* C,
+                           std::size_t ldc, int numThreads);
+template void spmm<float>(std::size_t M, const float* A, std::size_t lda, const MatrixCSC<float>& B, float* C,
+                          std::size_t ldc, int numThreads);
+template void spmm<double>(std::size_t M, const double* A, std::size_t lda, const MatrixCSC<double>& B, double* C,
+                           std::size_t ldc, int numThreads);
+template void spmv<float>(const MatrixCSR<float>& A, const float* x, float* y, int numThreads);
+template void spmv<double>(const MatrixCSR<double>& A, const double* x, double* y, int numThreads);
+template void spmv<float>(const float* x, const MatrixCSC<float>& A, float* y, int numThreads);
+template void spmv<double>(const double* x, const MatrixCSC<double>& A, double* y, int numThreads);
+
+
+namespace {
+
+    template<typename MatrixB, typename MatrixC>
+    bool check_dimensions(std::size_t A_rows, std::size_t A_cols, const MatrixB& B, const MatrixC& C){
+        if (A_cols != B.nrows() || A_rows != C.nrows() || B.ncols() != C.ncols()) {
+            std::cout<<"Error: dimensions of the matrices are wrong: cannot compute mmm_sparse of "<<A_rows<<" x "
+                     <<A_cols<<" by "<<B.nrows()<<" x "<<B.ncols()<<" into "<<C.nrows()<<" x "<<C.ncols()<<std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    void mmm_sparse_impl(const MatrixCSR<T>& A, const MatrixFlat<T>& B, MatrixFlat<T>& C, int64_t& time, int numThreads){
+        if (!check_dimensions(A.nrows(), A.ncols(), B, C))
+            return;
+        const auto t0 = std::chrono::high_resolution_clock::now();
+
+        spmm(A, B.get_ptr(), B.ncols(), B.ncols(), C.get_ptr(), C.ncols(), numThreads);
+
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    }
+
+    template<typename T>
+    void mmm_sparse_impl(const MatrixFlat<T>& A, const MatrixCSC<T>& B, MatrixFlat<T>& C, int64_t& time, int numThreads){
+        if (!check_dimensions(A.nrows(), A.ncols(), B, C))
+            return;
+        const auto t0 = std::chrono::high_resolution_clock::now();
+
+        spmm(A.nrows(), A.get_ptr(), A.ncols(), B, C.get_ptr(), C.ncols(), numThreads);
+
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    }
+
+}
+
+
+void mmm_sparse(const MatrixCSR<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+    std::cout<<"Performing mmm_sparse (CSR x dense, density "<<A.density()<<") in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+    mmm_sparse_impl(A, B, C, time, numThreads);
+}
+
+void mmm_sparse(const MatrixCSR<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads){
+    std::cout<<"Performing mmm_sparse (CSR x dense, density "<<A.density()<<") in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+    mmm_sparse_impl(A, B, C, time, numThreads);
+}
+
+void mmm_sparse(const MatrixFlat<float>& A, const MatrixCSC<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+    std::cout<<"Performing mmm_sparse (dense x CSC, density "<<B.density()<<") in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+    mmm_sparse_impl(A, B, C, time, numThreads);
+}
+
+void mmm_sparse(const MatrixFlat<double>& A, const MatrixCSC<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads){
+    std::cout<<"Performing mmm_sparse (dense x CSC, density "<<B.density()<<") in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+    mmm_sparse_impl(A, B, C, time, numThreads);
+}
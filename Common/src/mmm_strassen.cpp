@@ -0,0 +1,352 @@
+#include "../include/mmm.hpp"
+#include "../include/gemm_strassen.hpp"
+#include "../include/gemm_packed.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+
+    //! Crossover used for the shapes that were never tuned
+    constexpr std::size_t default_crossover = 1024;
+
+    //! Below this size the recursion never pays off, whatever the tuning file says
+    constexpr std::size_t min_crossover = 32;
+
+    //! Number of products computed in parallel at the top level
+    constexpr int strassen_products = 7;
+
+
+    //******************************************************************************************************************
+    // Block additions on row-major blocks with their own leading dimensions. They are plain loops over contiguous
+    // rows, vectorized by the compiler.
+    //******************************************************************************************************************
+
+    //! Z = X + Y
+    template<typename T>
+    void add(std::size_t m, std::size_t n, const T* X, std::size_t ldx, const T* Y, std::size_t ldy, T* Z, std::size_t ldz){
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++)
+                Z[i * ldz + j] = X[i * ldx + j] + Y[i * ldy + j];
+    }
+
+    //! Z = X - Y
+    template<typename T>
+    void sub(std::size_t m, std::size_t n, const T* X, std::size_t ldx, const T* Y, std::size_t ldy, T* Z, std::size_t ldz){
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++)
+                Z[i * ldz + j] = X[i * ldx + j] - Y[i * ldy + j];
+    }
+
+    //! Z = X - Y - W + V
+    template<typename T>
+    void sub_sub_add(std::size_t m, std::size_t n, const T* X, std::size_t ldx, const T* Y, std::size_t ldy,
+                     const T* W, std::size_t ldw, const T* V, std::size_t ldv, T* Z, std::size_t ldz){
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++)
+                Z[i * ldz + j] = X[i * ldx + j] - Y[i * ldy + j] - W[i * ldw + j] + V[i * ldv + j];
+    }
+
+    //! Z += sign * X
+    template<typename T>
+    void accumulate(std::size_t m, std::size_t n, const T* X, std::size_t ldx, T* Z, std::size_t ldz, T sign = T(1)){
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++)
+                Z[i * ldz + j] += sign * X[i * ldx + j];
+    }
+
+    //! Z += X + Y
+    template<typename T>
+    void accumulate2(std::size_t m, std::size_t n, const T* X, std::size_t ldx, const T* Y, std::size_t ldy, T* Z, std::size_t ldz){
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++)
+                Z[i * ldz + j] += X[i * ldx + j] + Y[i * ldy + j];
+    }
+
+    template<typename T>
+    void zero(std::size_t m, std::size_t n, T* Z, std::size_t ldz){
+        for (std::size_t i = 0; i < m; i++)
+            std::fill(Z + i * ldz, Z + i * ldz + n, T(0));
+    }
+
+
+    //******************************************************************************************************************
+    // Recursion
+    //******************************************************************************************************************
+
+    struct StrassenPlan{
+        std::size_t crossover;
+        TuningConfig leaf;      // packed engine configuration of the products below the crossover
+    };
+
+    bool is_leaf(std::size_t m, std::size_t k, std::size_t n, std::size_t crossover){
+        return std::min({m, k, n}) <= crossover;
+    }
+
+    //! Workspace of the serial recursion: at every level W, V (m/2 x n/2), two blocks of A (m/2 x k/2) and two
+    //! blocks of B (k/2 x n/2), then the next level
+    std::size_t serial_workspace(std::size_t m, std::size_t k, std::size_t n, std::size_t crossover){
+        std::size_t size = 0;
+        while (!is_leaf(m, k, n, crossover)) {
+            m /= 2; k /= 2; n /= 2;
+            size += 2 * m * n + 2 * m * k + 2 * k * n;
+        }
+        return size;
+    }
+
+    //! Workspace of one thread of the parallel top level: its product (m/2 x n/2), its operands and the serial
+    //! recursion of the product
+    std::size_t task_workspace(std::size_t m, std::size_t k, std::size_t n, std::size_t crossover){
+        m /= 2; k /= 2; n /= 2;
+        return m * n + m * k + k * n + serial_workspace(m, k, n, crossover);
+    }
+
+    //! Adds the contributions of the odd last row, column and inner index, which the recursion leaves out:
+    //! the recursion computes C[0:me, 0:ne] += A[0:me, 0:ke] * B[0:ke, 0:ne]
+    template<typename T>
+    void peel(std::size_t m, std::size_t k, std::size_t n, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+              T* C, std::size_t ldc, const TuningConfig& config){
+        const std::size_t me = m & ~std::size_t(1), ke = k & ~std::size_t(1), ne = n & ~std::size_t(1);
+        if (k != ke)
+            gemm_packed(me, ne, 1, A + ke, lda, B + ke * ldb, ldb, C, ldc, config);
+        if (n != ne)
+            gemm_packed(me, 1, k, A, lda, B + ne, ldb, C + ne, ldc, config);
+        if (m != me)
+            gemm_packed(1, n, k, A + me * lda, lda, B, ldb, C + me * ldc, ldc, config);
+    }
+
+    //! C += A*B with the Winograd schedule, accumulating the products directly in C where possible so that only
+    //! two temporary products are needed per level:
+    //!     S1 = A21 + A22   S2 = S1 - A11   S3 = A11 - A21   S4 = A12 - S2
+    //!     T1 = B12 - B11   T2 = B22 - T1   T3 = B22 - B12   T4 = T2 - B21
+    //!     C11 += P1 + P2                   (P1 = A11 B11, P2 = A12 B21)
+    //!     C12 += U2 + P5 + P3              (U2 = P1 + P6, P6 = S2 T2, P5 = S1 T1, P3 = S4 B22)
+    //!     C21 += U2 + P7 - P4              (P7 = S3 T3, P4 = A22 T4)
+    //!     C22 += U2 + P7 + P5
+    template<typename T>
+    void strassen_serial(std::size_t m, std::size_t k, std::size_t n, const T* A, std::size_t lda,
+                         const T* B, std::size_t ldb, T* C, std::size_t ldc, T* ws, const StrassenPlan& plan){
+        if (is_leaf(m, k, n, plan.crossover)) {
+            gemm_packed(m, n, k, A, lda, B, ldb, C, ldc, plan.leaf);
+            return;
+        }
+        peel(m, k, n, A, lda, B, ldb, C, ldc, plan.leaf);
+
+        const std::size_t m2 = m / 2, k2 = k / 2, n2 = n / 2;
+        const T *A11 = A, *A12 = A + k2, *A21 = A + m2 * lda, *A22 = A21 + k2;
+        const T *B11 = B, *B12 = B + n2, *B21 = B + k2 * ldb, *B22 = B21 + n2;
+        T *C11 = C, *C12 = C + n2, *C21 = C + m2 * ldc, *C22 = C21 + n2;
+
+        T* W = ws;
+        T* V = W + m2 * n2;
+        T* Sa = V + m2 * n2;
+        T* Sb = Sa + m2 * k2;
+        T* Ta = Sb + m2 * k2;
+        T* Tb = Ta + k2 * n2;
+        T* next = Tb + k2 * n2;
+
+        // W = P1, C11 += P1 + P2
+        zero(m2, n2, W, n2);
+        strassen_serial(m2, k2, n2, A11, lda, B11, ldb, W, n2, next, plan);
+        accumulate(m2, n2, W, n2, C11, ldc);
+        strassen_serial(m2, k2, n2, A12, lda, B21, ldb, C11, ldc, next, plan);
+
+        // Sa = S1, Sb = S2, Ta = T1, Tb = T2, W = U2 = P1 + P6, V = P5
+        add(m2, k2, A21, lda, A22, lda, Sa, k2);
+        sub(m2, k2, Sa, k2, A11, lda, Sb, k2);
+        sub(k2, n2, B12, ldb, B11, ldb, Ta, n2);
+        sub(k2, n2, B22, ldb, Ta, n2, Tb, n2);
+        strassen_serial(m2, k2, n2, Sb, k2, Tb, n2, W, n2, next, plan);
+        zero(m2, n2, V, n2);
+        strassen_serial(m2, k2, n2, Sa, k2, Ta, n2, V, n2, next, plan);
+        accumulate2(m2, n2, W, n2, V, n2, C12, ldc);
+        accumulate2(m2, n2, W, n2, V, n2, C22, ldc);
+        accumulate(m2, n2, W, n2, C21, ldc);
+
+        // Sb = S4, C12 += P3;  Tb = -T4, C21 += A22 * (-T4) = -P4
+        sub(m2, k2, A12, lda, Sb, k2, Sb, k2);
+        strassen_serial(m2, k2, n2, Sb, k2, B22, ldb, C12, ldc, next, plan);
+        sub(k2, n2, B21, ldb, Tb, n2, Tb, n2);
+        strassen_serial(m2, k2, n2, A22, lda, Tb, n2, C21, ldc, next, plan);
+
+        // Sa = S3, Ta = T3, V = P7, C21 += P7, C22 += P7
+        sub(m2, k2, A11, lda, A21, lda, Sa, k2);
+        sub(k2, n2, B22, ldb, B12, ldb, Ta, n2);
+        zero(m2, n2, V, n2);
+        strassen_serial(m2, k2, n2, Sa, k2, Ta, n2, V, n2, next, plan);
+        accumulate(m2, n2, V, n2, C21, ldc);
+        accumulate(m2, n2, V, n2, C22, ldc);
+    }
+
+    //! Top level with the 7 products computed in parallel. Every product is formed in the workspace of the thread
+    //! that computes it (operands and result) and then added to the blocks of C it belongs to, under the lock of
+    //! the block:
+    //!     P1 = A11 B11                          -> C11, C12, C21, C22
+    //!     P2 = A12 B21                          -> C11
+    //!     P3 = (A12 - A21 - A22 + A11) B22      -> C12
+    //!     P4 = A22 (B22 - B12 + B11 - B21)      -> C21 (subtracted)
+    //!     P5 = (A21 + A22) (B12 - B11)          -> C12, C22
+    //!     P6 = (A21 + A22 - A11) (B22 - B12 + B11)  -> C12, C21, C22
+    //!     P7 = (A11 - A21) (B22 - B12)          -> C21, C22
+    template<typename T>
+    void strassen_parallel(std::size_t m, std::size_t k, std::size_t n, const T* A, std::size_t lda,
+                           const T* B, std::size_t ldb, T* C, std::size_t ldc, T* ws, int threads,
+                           const StrassenPlan& plan){
+        peel(m, k, n, A, lda, B, ldb, C, ldc, plan.leaf);
+
+        const std::size_t m2 = m / 2, k2 = k / 2, n2 = n / 2;
+        const T *A11 = A, *A12 = A + k2, *A21 = A + m2 * lda, *A22 = A21 + k2;
+        const T *B11 = B, *B12 = B + n2, *B21 = B + k2 * ldb, *B22 = B21 + n2;
+        T* Cq[4] = {C, C + n2, C + m2 * ldc, C + m2 * ldc + n2};
+        std::mutex locks[4];
+
+        const std::size_t slice = task_workspace(m, k, n, plan.crossover);
+
+        parallel_for_slot(strassen_products, threads, [&](std::size_t p, int slot){
+            T* P = ws + slot * slice;
+            T* S = P + m2 * n2;
+            T* Tt = S + m2 * k2;
+            T* next = Tt + k2 * n2;
+
+            const T *left = S, *right = Tt;
+            std::size_t ldl = k2, ldr = n2;
+            switch (p) {
+                case 0: left = A11; ldl = lda; right = B11; ldr = ldb; break;
+                case 1: left = A12; ldl = lda; right = B21; ldr = ldb; break;
+                case 2:
+                    sub_sub_add(m2, k2, A12, lda, A21, lda, A22, lda, A11, lda, S, k2);
+                    right = B22; ldr = ldb;
+                    break;
+                case 3:
+                    sub_sub_add(k2, n2, B22, ldb, B12, ldb, B21, ldb, B11, ldb, Tt, n2);
+                    left = A22; ldl = lda;
+                    break;
+                case 4:
+                    add(m2, k2, A21, lda, A22, lda, S, k2);
+                    sub(k2, n2, B12, ldb, B11, ldb, Tt, n2);
+                    break;
+                case 5:
+                    add(m2, k2, A21, lda, A22, lda, S, k2);
+                    sub(m2, k2, S, k2, A11, lda, S, k2);
+                    sub(k2, n2, B22, ldb, B12, ldb, Tt, n2);
+                    accumulate(k2, n2, B11, ldb, Tt, n2);
+                    break;
+                default:
+                    sub(m2, k2, A11, lda, A21, lda, S, k2);
+                    sub(k2, n2, B22, ldb, B12, ldb, Tt, n2);
+                    break;
+            }
+            zero(m2, n2, P, n2);
+            strassen_serial(m2, k2, n2, left, ldl, right, ldr, P, n2, next, plan);
+
+            // blocks of C that receive the product (bit q = block q), the sign is -1 only for P4
+            static constexpr int targets[strassen_products] = {0b1111, 0b0001, 0b0010, 0b0100, 0b1010, 0b1110, 0b1100};
+            const T sign = p == 3 ? T(-1) : T(1);
+            for (int q = 0; q < 4; q++) {
+                if (targets[p] & (1 << q)) {
+                    std::lock_guard<std::mutex> guard(locks[q]);
+                    accumulate(m2, n2, P, n2, Cq[q], ldc, sign);
+                }
+            }
+        });
+    }
+
+    //! Threads actually used for a product: only the top level is parallel
+    int strassen_threads(int threads){
+        return std::min(resolve_threads(threads), strassen_products);
+    }
+
+}
+
+
+std::size_t strassen_workspace_size(std::size_t M, std::size_t N, std::size_t K, std::size_t crossover, int threads){
+    crossover = std::max(crossover, min_crossover);
+    threads = strassen_threads(threads);
+    if (is_leaf(M, K, N, crossover))
+        return 0;
+    if (threads == 1)
+        return serial_workspace(M, K, N, crossover);
+    return threads * task_workspace(M, K, N, crossover);
+}
+
+
+template<typename T>
+void gemm_strassen(std::size_t M, std::size_t N, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                   T* C, std::size_t ldc, const TuningConfig& config){
+    StrassenPlan plan;
+    plan.crossover = std::max(config.outer_tile > 0 ? static_cast<std::size_t>(config.outer_tile) : default_crossover,
+                              min_crossover);
+    tuned_config<T>(TunedKernel::Packed, plan.crossover, plan.crossover, plan.crossover, plan.leaf);
+    plan.leaf.threads = 1;
+
+    const int threads = strassen_threads(config.threads);
+
+    if (is_leaf(M, K, N, plan.crossover)) {
+        TuningConfig packed;
+        tuned_config<T>(TunedKernel::Packed, M, N, K, packed);
+        if (config.threads > 0)
+            packed.threads = config.threads;
+        gemm_packed(M, N, K, A, lda, B, ldb, C, ldc, packed);
+        return;
+    }
+
+    std::vector<T> workspace(strassen_workspace_size(M, N, K, plan.crossover, threads));
+    if (threads == 1)
+        strassen_serial(M, K, N, A, lda, B, ldb, C, ldc, workspace.data(), plan);
+    else
+        strassen_parallel(M, K, N, A, lda, B, ldb, C, ldc, workspace.data(), threads, plan);
+}
+
+template<typename T>
+void gemm_strassen(std::size_t M, std::size_t N, std::size_t K, const T* A, std::size_t lda, const T* B, std::size_t ldb,
+                   T* C, std::size_t ldc, int numThreads){
+    TuningConfig config;
+    tuned_config<T>(TunedKernel::Strassen, M, N, K, config);
+    if (numThreads > 0)
+        config.threads = numThreads;
+    gemm_strassen(M, N, K, A, lda, B, ldb, C, ldc, config);
+}
+
+template void gemm_strassen<float>(std::size_t M, std::size_t N, std::size_t K, const float* A, std::size_t lda,
+                                   const float* B, std::size_t ldb, float* C, std::size_t ldc, int numThreads);
+template void gemm_strassen<double>(std::size_t M, std::size_t N, std::size_t K, const double* A, std::size_t lda,
+                                    const double* B, std::size_t ldb, double* C, std::size_t ldc, int numThreads);
+template void gemm_strassen<float>(std::size_t M, std::size_t N, std::size_t K, const float* A, std::size_t lda,
+                                   const float* B, std::size_t ldb, float* C, std::size_t ldc, const TuningConfig& config);
+template void gemm_strassen<double>(std::size_t M, std::size_t N, std::size_t K, const double* A, std::size_t lda,
+                                    const double* B, std::size_t ldb, double* C, std::size_t ldc, const TuningConfig& config);
+
+
+
+void mmm_strassen(const MatrixFlat<float>& A, const MatrixFlat<float>& B, MatrixFlat<float>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_strassen in single precision (float) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_strassen(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
+
+void mmm_strassen(const MatrixFlat<double>& A, const MatrixFlat<double>& B, MatrixFlat<double>& C, int64_t& time, int numThreads){
+
+    std::cout<<"Performing mmm_strassen in double precision (double) ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    std::size_t rows = A.nrows(), columns = B.ncols(), inners = A.ncols();
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    gemm_strassen(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, numThreads);
+
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    time = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+}
@@ -3,6 +3,12 @@
 #include "ActivationFunctions.hpp"
 #include "functions_utilities.hpp"
 #include "matrixProd_AVX.hpp"
+#include "cpu_features.hpp"
+#include "gemm_packed.hpp"
+#include "gemv.hpp"
+#include "kernel_dispatch.hpp"
+#include "matrix_transpose.hpp"
+#include "quantized.hpp"
 #include <algorithm>
 #include <random>
 #include <iomanip>
@@ -217,7 +223,14 @@ template std::vector<double> operator*(const std::vector<double>& a, const std::
  * modify the variable matrix_mul_optimisation to select the optimization:
  *      0) Cache Optimised  (default) use an optimization on the register to reduce the number of access to the cache
  *      1) A non optimized version of matrix mul, just for comparison
- *      2) Exploiting explicit Vectorize instructions throug AVX library
+ *      2) Exploiting explicit Vectorize instructions throug AVX library, the instruction set (SSE4, AVX2, AVX-512)
+ *         is chosen at runtime by matrixMultMasked_Simd, the ragged edges are handled with masked loads and stores
+ *         so the product runs on a, b and c without padded copies
+ *      3) Automatic: the kernel and the number of threads planned for the shape by the dispatcher (kernel_dispatch.hpp),
+ *         the first product of a shape plans it, the next ones reuse the plan
+ * when m, n or nb is 1 (e.g. the per-sample forward pass and the gradient outer product) selections 0 and 2 use the
+ * GEMV / GER kernels of gemv.hpp (mul_vector), which stream the matrix once without padding
+ * the Model can also select its products by name, with setGemmProvider (see gemm.hpp)
  * 
  * the other parameters are:
  *     a: first matrix
@@ -231,7 +244,15 @@ template std::vector<double> operator*(const std::vector<double>& a, const std::
 template<typename T>
 void mul_funct(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c, int m, int n, int nb, int selection){
     int64_t t;
-    int i=0,d=0,ib=0,db=0;
+    if(selection == 3){
+        run_product(product_plan<T>(m, n, nb, NoTrans, NoTrans), a, b, c, m, n, nb, NoTrans, NoTrans);
+        return;
+    }
+    //when one of the dimensions is 1 the product is a GEMV or a GER, which have their own kernels (gemv.hpp);
+    //the naive version is left as it is since it is there for comparison
+    if(selection != 1 && mul_vector<T>(a, b, c, m, n, nb, NoTrans, NoTrans)){
+        return;
+    }
     switch(selection){
         case 0:
             MatrixCaheOptimised<T>(a, b, c, m, n, nb, t);
@@ -240,52 +261,12 @@ void mul_funct(std::vector<T>& a, std::vector<T>& b, std::vector<T>& c, int m, i
             MatrixNaive<T>(a, b, c, m, n, nb, t);
             break;
         case 2:
-            std::vector<T> mat1AVX, mat1BAVX, res;
-            //resize the index to fit in vector reg.
-                while((m+i) % 8 != 0){
-                    i++;
-                }
-                while((n+d) % 8 != 0){
-                    d++;
-                }
-                while((nb+db) % 8 != 0){
-                    db++;
-                }
-                mat1AVX.resize((m+i)*(n+d));
-                mat1BAVX.resize((n+d)*(nb+db));
-                res.resize((m+i)*(nb+db));
-            //add zeros to fit the vector reg.
-            for(int y =0 ; y<m+i; y++){
-                for(int u =0; u<n+d; u++){
-                    if(u<n && y<m){
-                        mat1AVX[y*(n+d)+u] = a[y*n+u];
-                    }else{
-                        mat1AVX[y*(n+d)+u] = 0;
-                    }
-
-                }
+            //the masked SIMD kernels read a and b and accumulate in c directly, whatever the shape;
+            //on CPUs without SIMD extensions the cache optimised version is used instead
+            if(matrixMultMasked_Simd<T>(a, b, c, m, n, nb, t) == 0){
+                MatrixCaheOptimised<T>(a, b, c, m, n, nb, t);
             }
-            for(int y =0 ; y<n+d; y++){
-                for(int u =0; u<nb+db; u++){
-                    if(u<nb && y<n){
-                        mat1BAVX[y*(nb+db)+u] = b[y*nb+u];
-
-                    }else{
-                        mat1BAVX[y*(nb+db)+u] = 0;
-                    }
-
-                }
-            }
-            matrixMult_Avx<T>(mat1AVX, mat1BAVX, res, m+i, n+d, nb+db, t); //matrix multiplication
-            //remove zeros
-            for(int y =0 ; y<m; y++){
-                for(int u =0; u<nb; u++){  
-                    c[y*(nb)+u] = res[y*(nb+db)+u];
-                }
-            }
-
             break;
-       
 
     }    
 }
@@ -294,6 +275,75 @@ template void mul_funct<float>(std::vector<float>& a, std::vector<float>& b, std
 template void mul_funct<double>(std::vector<double>& a, std::vector<double>& b, std::vector<double>& c, int m, int n, int nb, int selection);
 
 
+//****************************************************************************************************************************************************
+/**
+ * Same as above but computes c += op(a)*op(b), where op(a) is m x n and op(b) is n x nb (see transpose.hpp).
+ * The transposed operands are read in place, so the callers (e.g. the backpropagation) never need to build a transpose.
+ * As above, the vector shapes go to the GEMV / GER kernels unless selection is 1:
+ *      0) Cache Optimised, with the loop order chosen for the combination of flags
+ *      1) Naive version, just for comparison
+ *      2) Packed SIMD engine (gemm_packed), which reads op(a) and op(b) through their strides while packing
+ *      3) Automatic, as above
+*/
+
+template<typename T>
+void mul_funct(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c, int m, int n, int nb, int selection, Transpose transA, Transpose transB){
+    if(transA == NoTrans && transB == NoTrans){
+        //the kernels of the plain version only read a and b
+        mul_funct(const_cast<std::vector<T>&>(a), const_cast<std::vector<T>&>(b), c, m, n, nb, selection);
+        return;
+    }
+    if(selection == 3){
+        run_product(product_plan<T>(m, n, nb, transA, transB), a, b, c, m, n, nb, transA, transB);
+        return;
+    }
+    if(selection != 1 && mul_vector<T>(a, b, c, m, n, nb, transA, transB)){
+        return;
+    }
+    int64_t t;
+    switch(selection){
+        case 0:
+            MatrixCaheOptimisedTrans<T>(a, b, c, m, n, nb, transA, transB, t);
+            break;
+        case 1:
+            MatrixNaiveTrans<T>(a, b, c, m, n, nb, transA, transB, t);
+            break;
+        case 2:
+            gemm_packed<T>(transA, transB, m, nb, n, a.data(), transA == Trans ? m : n, b.data(), transB == Trans ? n : nb,
+                           c.data(), nb, 1);
+            break;
+    }
+}
+
+template void mul_funct<float>(const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& c, int m, int n, int nb, int selection, Transpose transA, Transpose transB);
+template void mul_funct<double>(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, int m, int n, int nb, int selection, Transpose transA, Transpose transB);
+
+
+//****************************************************************************************************************************************************
+/**
+ * Inference only: c += a*b where b is a n x nb weight matrix quantized to int8 (see quantized.hpp), the rows of a are
+ * quantized on the fly and the products are accumulated in int32 with the integer SIMD kernels (VNNI, AVX2, SSE4).
+ * A single row (the per-sample forward pass) goes to the quantized GEMV, more rows to the quantized GEMM.
+*/
+
+template<typename T>
+void mul_funct(const std::vector<T>& a, const QuantizedMatrix& b, std::vector<T>& c, int m, int n, int nb){
+    if(n != b.inputs() || nb != b.outputs()){
+        std::cout << "Error: the quantized matrix is " << b.inputs() << " x " << b.outputs() << ", expected " << n << " x " << nb << std::endl;
+        return;
+    }
+    if(m == 1){
+        gemv_quantized<T>(b, a.data(), c.data());
+    }
+    else{
+        gemm_quantized<T>(m, a.data(), n, b, c.data(), nb);
+    }
+}
+
+template void mul_funct<float>(const std::vector<float>& a, const QuantizedMatrix& b, std::vector<float>& c, int m, int n, int nb);
+template void mul_funct<double>(const std::vector<double>& a, const QuantizedMatrix& b, std::vector<double>& c, int m, int n, int nb);
+
+
 //****************************************************************************************************************************************************
 /**
  * These two functions redirect the reference of the input to be evaluated to the correct activation function or its derivative
@@ -323,17 +373,14 @@ template void activationFunDerivative<double>(std::vector<double>& a, std::vecto
 
 //********************************************************************************************************************************************
 //These functions given a m x n matrix return the transpose matrix, the first one return a new matrix, the second one modify the input matrix
+//The blocked kernels of matrix_transpose.hpp do the work
 
 template<typename T>
 std::vector<T> transposeMatrix(const std::vector<T>& matrix, const int m, const int n){
     std::vector<T> transposed_matrix;
     transposed_matrix.resize(1);
     transposed_matrix.resize(m*n);
-    for(int i = 0; i < n; i++){
-        for(int j = 0; j < m; j++){        
-            transposed_matrix[j+i*m] = matrix[i+j*n];
-        }
-    }
+    transpose<T>(m, n, matrix.data(), n, transposed_matrix.data(), m);
     return transposed_matrix;
 }
 template std::vector<float> transposeMatrix(const std::vector<float>& matrix, const int m, const int n);
@@ -343,11 +390,7 @@ template<typename T>
 void transposeMatrix2(const std::vector<T>& matrix, std::vector<T>& transposed,  const int m, const int n){
     transposed.resize(1);
     transposed.resize(m*n);
-    for(int i=0; i<n; i++){
-        for(int j=0; j<m; j++){
-            transposed[j+i*m] = matrix[i+j*n];
-        }
-    }
+    transpose<T>(m, n, matrix.data(), n, transposed.data(), m);
 }
 template void transposeMatrix2<float>(const std::vector<float>& matrix, std::vector<float>& transposed,  const int m, const int n);
 template void transposeMatrix2<double>(const std::vector<double>& matrix, std::vector<double>& transposed,  const int m, const int n);
@@ -437,9 +480,10 @@ template<typename T>
 void Model<T>::printWeigts() const {
         for(int l=0; l <= layers.size(); l++){
             std::cout << "weights layer " << l+1 <<std::endl;
+            const std::vector<T> dense_weights = denseWeights(weights[l], l);
             for(int i = 0; i<weights_shape[l][0]; i++){
                 for(int j =0 ; j<weights_shape[l][1]; j++){
-                    std::cout << weights[l][j+i*weights_shape[l][1]] << " ";
+                    std::cout << dense_weights[j+i*weights_shape[l][1]] << " ";
 
                 }
                 std::cout << std::endl;
@@ -512,6 +556,14 @@ void Model<T>::buildModel(){
         std::cout << "Learning rate: " << model_learning_rate << std::endl;
         std::cout << "Loss function: " << model_loss_fun << std::endl;
         std::cout << "Stop cryteria: " << model_stop_cryteria << std::endl;
+        if(gemm_backend.empty()){
+            if(const char* env = std::getenv("NNET_GEMM")){
+                setGemmProvider(env);
+            }
+        }
+        if(!gemm_backend.empty()){
+            std::cout << "GEMM provider: " << gemm_backend << std::endl;
+        }
         std::cout << std::endl;
         std::cout << "Input layer: " << std::endl;
         std::cout << "Number of input introduced in the network: " << model_input.getShapeInputData() << std::endl;
@@ -574,6 +626,12 @@ void Model<T>::buildModel(){
         y.resize(model_output.getShapeOutputData());
         initialiseVector(weights, weights_initialisation);
         initialiseVector(bias, weights_initialisation);
+        //activation of every layer, applied by the epilogue of its product
+        activations.resize(layers.size()+1);
+        for(int i = 0; i < layers.size(); i++){
+            activations[i] = activation_from_name(layers[i].getActFun());
+        }
+        activations[layers.size()] = activation_from_name(model_output.getOutputAct_fun());
 
 
 
@@ -595,9 +653,10 @@ void Model<T>::printAllWeightsToFile() const {
             outputFile << "************* weights layer " << l+1 << " ****************" << std::endl;
             outputFile << std::endl;
             outputFile << "weigthts " << weights_shape[l][0] << " x " << weights_shape[l][1] << std::endl;
+            const std::vector<T> dense_weights = denseWeights(weights[l], l);
             for(int i = 0; i<weights_shape[l][0]; i++){
                 for(int j =0 ; j<weights_shape[l][1]; j++){
-                    outputFile << weights[l][j+i*weights_shape[l][1]] << " ";
+                    outputFile << dense_weights[j+i*weights_shape[l][1]] << " ";
 
                 }
                 outputFile << std::endl;
@@ -638,9 +697,10 @@ void Model<T>::printAllWeightsToFile() const {
             outputFile << std::endl;
             outputFile << std::endl;
             outputFile << "dE_dw layer " << l+1 << " size: " << weights_shape[l][0] << " x " << weights_shape[l][1] << std::endl;
+            const std::vector<T> dense_dE_dw = denseWeights(dE_dw[l], l);
             for(int i = 0; i<weights_shape[l][0]; i++){
                 for(int j =0 ; j<weights_shape[l][1]; j++){
-                    outputFile << dE_dw[l][j+i*weights_shape[l][1]] << " ";
+                    outputFile << dense_dE_dw[j+i*weights_shape[l][1]] << " ";
 
                 }
                 outputFile << std::endl;
@@ -746,148 +806,305 @@ template void Model<double>::initialiseVector(std::vector<std::vector<double>>&
 
 
 
-//****************************************************************************************************************************************************
-/**
- * These two function are used to build the matrix used in predict function:
- *     extendMatrix() add the vector of bias as last row in weight matrix, add 1 to the input vector to fix the dimensions
- *     reduceMatrix() remove the vector of bias as last row in weight matrix, remove 1 to the input vector to fix the dimensions
-*/
-
-template<typename T>
-void Model<T>::extendMatrix(){
-    weights[0].insert(weights[0].end(), bias[0].begin(), bias[0].end());
-    for(int loop = 0; loop < layers.size(); loop++){
-        h[loop].push_back(1);
-        weights[loop+1].insert(weights[loop+1].end(), bias[loop+1].begin(), bias[loop+1].end());
-    }
-}
-
-template void Model<float>::extendMatrix();
-template void Model<double>::extendMatrix();
-
-template<typename T>
-void Model<T>::reduceMatrix(){
-    weights[0].resize(weights_shape[0][0]*weights_shape[0][1]);
-    for(int loop = 0; loop < layers.size(); loop++){
-        h[loop].pop_back();
-        weights[loop+1].resize(weights_shape[loop+1][0]*weights_shape[loop+1][1]);
-    }
-}
-
-template void Model<float>::reduceMatrix();
-template void Model<double>::reduceMatrix();
-
-
-
 //****************************************************************************************************************************************************
 /**
  * These two functions compute the forward probagation of the input along the network, producing as output the variable y
- * the first one take as input the input vector and the selection of the activation function to use, 
- * note that can be called only after the resizing of the weights, the second one take as input the input vector, 
- * the selection of the activation function to use and a flag, if the flag is any integer the function will extend the matrix of weights and bias,
- * usefull to be used in the main() function.
+ * the first one take as input the input vector and the selection of the activation function to use,
+ * the second one take as input the input vector, the selection of the activation function to use and a flag,
+ * if the flag is any integer the function will also print the output, usefull to be used in the main() function.
+ * Every layer is computed by forwardLayer(): the product, the bias, the activation and its derivative in one pass,
+ * so predict() also fills dAct_z for the backPropagation.
  * 
  * ***************IMPORTANT****************
  * when this function is called remember to reset to 0 the z vector, otherwise it will be summed to the following iterations !!!!!!!!!!!
 */
 
-//this version need to be called only after the resizing of the weights
 template<typename T> 
 void Model<T>::predict(std::vector<T>& input, const int& selection){
-    input.push_back(1);
     const auto t0_0 = std::chrono::high_resolution_clock::now();
-    mul_funct(input, weights[0], z[0], 1, weights_shape[0][0]+1, weights_shape[0][1], matrix_mul_optimisation);  
+    forwardLayer(input, 0);
     const auto t0_1 = std::chrono::high_resolution_clock::now();
     int64_t dt_01 = std::chrono::duration_cast<std::chrono::microseconds>(t0_1 - t0_0).count();
     times[0] += dt_01;
-    activationFun(z[0], h[0], layers[0].getActFun());
     
     for(int loop = 0; loop < layers.size(); loop++){
         const auto t1_0 = std::chrono::high_resolution_clock::now();
-         mul_funct(h[loop], weights[loop+1], z[loop+1], 1, weights_shape[loop+1][0]+1, weights_shape[loop+1][1], matrix_mul_optimisation);
+        forwardLayer(h[loop], loop+1);
        const auto t1_1 = std::chrono::high_resolution_clock::now();
         int64_t dt_02 = std::chrono::duration_cast<std::chrono::microseconds>(t1_1 - t1_0).count();
         times[1+loop] += dt_02;
-        if(loop < layers.size()-1){
-            activationFun(z[loop+1], h[loop+1], layers[loop+1].getActFun());
-        }
     }
-    activationFun(z[layers.size()], y, model_output.getOutputAct_fun());
-    input.pop_back();
 }
 
 template void Model<float>::predict(std::vector<float>& input, const int& selection);
 template void Model<double>::predict(std::vector<double>& input, const int& selection);
 
-template<typename T> //this version contains the extension and reduction of the matrix
+template<typename T> //this version prints the output
 void Model<T>::predict(std::vector<T>& input, const int& selection, const int flag){
-    extendMatrix();
-    input.push_back(1);
-    mul_funct(input, weights[0], z[0], 1, weights_shape[0][0]+1, weights_shape[0][1], matrix_mul_optimisation);   //weights[0], input, z, weights_shape[0][0], weights_shape[0][1], 1, matrix_mul_optimisation);
-    activationFun(z[0], h[0], layers[0].getActFun());
+    forwardLayer(input, 0);
     
     for(int loop = 0; loop < layers.size(); loop++){
-        mul_funct(h[loop], weights[loop+1], z[loop+1], 1, weights_shape[loop+1][0]+1, weights_shape[loop+1][1], matrix_mul_optimisation);
-        if(loop < layers.size()-1){
-            activationFun(z[loop+1], h[loop+1], layers[loop+1].getActFun());
-        }
+        forwardLayer(h[loop], loop+1);
     }
-    activationFun(z[layers.size()], y, model_output.getOutputAct_fun());
     std::cout << "output: " << std::endl;
     for(int i = 0; i < y.size(); i++){
         std::cout << y[i] << " ";
     }
     std::cout << std::endl;
-    input.pop_back();
-    reduceMatrix();
 }
 
 template void Model<float>::predict(std::vector<float>& input, const int& selection, const int flag);
 template void Model<double>::predict(std::vector<double>& input, const int& selection, const int flag);
 
 
+//****************************************************************************************************************************************************
+/**
+ * Quantized inference, to be used once the model is trained:
+ *     quantizeWeights() stores a int8 copy of every weight matrix (one scale per neuron by default), the float weights are kept
+ *     predictQuantized() is the forward propagation with the int8 weights: the bias is added in float, so the weights do not need to be extended
+ *     evaluateQuantized() returns the accuracy of the quantized model on the test set, to be compared with the one of the float model
+*/
+
+template<typename T>
+void Model<T>::quantizeWeights(QuantGranularity granularity){
+    quantized_weights.clear();
+    std::size_t float_bytes = 0, int8_bytes = 0;
+    for(int i = 0; i < weights.size(); i++){
+        quantized_weights.emplace_back(denseWeights(weights[i], i).data(), weights_shape[i][0], weights_shape[i][1], granularity);
+        float_bytes += weights[i].size() * sizeof(T);
+        int8_bytes += quantized_weights[i].bytes();
+    }
+    std::cout << "Weights quantized to int8 [" << int8_kernel_name() << "]: " << int8_bytes << " bytes instead of " << float_bytes << std::endl;
+}
+
+template void Model<float>::quantizeWeights(QuantGranularity granularity);
+template void Model<double>::quantizeWeights(QuantGranularity granularity);
+
+template<typename T>
+void Model<T>::predictQuantized(const std::vector<T>& input){
+    z[0] = bias[0];
+    mul_funct(input, quantized_weights[0], z[0], 1, weights_shape[0][0], weights_shape[0][1]);
+    activationFun(z[0], h[0], layers[0].getActFun());
+
+    for(int loop = 0; loop < layers.size(); loop++){
+        z[loop+1] = bias[loop+1];
+        mul_funct(h[loop], quantized_weights[loop+1], z[loop+1], 1, weights_shape[loop+1][0], weights_shape[loop+1][1]);
+        if(loop < layers.size()-1){
+            activationFun(z[loop+1], h[loop+1], layers[loop+1].getActFun());
+        }
+    }
+    activationFun(z[layers.size()], y, model_output.getOutputAct_fun());
+}
+
+template void Model<float>::predictQuantized(const std::vector<float>& input);
+template void Model<double>::predictQuantized(const std::vector<double>& input);
+
+template<typename T>
+float Model<T>::evaluateQuantized(){
+    if(quantized_weights.size() != weights.size()){
+        quantizeWeights();
+    }
+    const std::vector<std::vector<T>> test = model_input.getTest(), test_target = model_output.getOutputTest();
+    int correct_test = 0;
+    for(int i = 0; i < test.size(); i++){
+        predictQuantized(test[i]);
+        const std::vector<T>& target = test_target[i];
+        if(std::max_element(y.begin(), y.end()) - y.begin() == std::max_element(target.begin(), target.end()) - target.begin()){
+            correct_test++;
+        }
+    }
+    resetVector(z);
+    float test_accuracy = (float)correct_test/test.size();
+    std::cout << "Quantized (int8) Accuracy on the TestSet: " << test_accuracy << std::endl;
+    return test_accuracy;
+}
+
+template float Model<float>::evaluateQuantized();
+template float Model<double>::evaluateQuantized();
+
+
+//****************************************************************************************************************************************************
+/**
+ * Block pruning of the model, see block_sparse.hpp:
+ *     pruneWeights() removes the sparsity fraction of the blocks with the smallest norm from the weights between hidden layers
+ *     (the first layer and the output one stay dense) and keeps only the values of the blocks left in weights and dE_dw,
+ *     train() can be called again to fine-tune the model on the blocks left
+ *     forwardLayer(), weightsGradient() and inputGradient() are the products of a layer in predict and backPropagation,
+ *     with the block-sparse kernels for the pruned layers
+ *     denseWeights() returns the dense matrix of a layer (without bias), to print or quantize the pruned layers
+*/
+
+template<typename T>
+void Model<T>::pruneWeights(float sparsity, int block_rows, int block_cols){
+    if(!valid_block_shape(block_rows, block_cols)){
+        std::cout << "Error: blocks of " << block_rows << " x " << block_cols << " are not supported, the columns must be 8, 16 or 32" << std::endl;
+        return;
+    }
+    weights_pattern.resize(weights.size());
+    for(int l = 1; l < layers.size(); l++){
+        std::vector<T> dense = denseWeights(weights[l], l);
+        weights_pattern[l] = prune_blocks(dense.data(), weights_shape[l][0], weights_shape[l][1], block_rows, block_cols, sparsity);
+        weights[l] = pack_blocks(weights_pattern[l], dense.data(), weights_shape[l][1]);
+        dE_dw[l].assign(weights[l].size(), 0);
+        std::cout << "Layer " << l+1 << " pruned: " << weights_pattern[l].nblocks() << " blocks of " << block_rows << " x " << block_cols
+                  << " kept (density " << weights_pattern[l].density() << ")" << std::endl;
+    }
+}
+
+template void Model<float>::pruneWeights(float sparsity, int block_rows, int block_cols);
+template void Model<double>::pruneWeights(float sparsity, int block_rows, int block_cols);
+
+template<typename T>
+std::vector<T> Model<T>::denseWeights(const std::vector<T>& values, int l) const {
+    if(!isPruned(l)){
+        return values;
+    }
+    std::vector<T> dense(weights_shape[l][0]*weights_shape[l][1], 0);
+    unpack_blocks(weights_pattern[l], values.data(), dense.data(), weights_shape[l][1]);
+    return dense;
+}
+
+template std::vector<float> Model<float>::denseWeights(const std::vector<float>& values, int l) const;
+template std::vector<double> Model<double>::denseWeights(const std::vector<double>& values, int l) const;
+
+//kernels of the dense products for selection 3 of train: one plan per shape, see kernel_dispatch.hpp. The dispatcher
+//calibrates its cost model at the first plan, so the other selections never pay for it
+template<typename T>
+void Model<T>::planProducts(){
+    std::cout << "Planning the products ("
+              << (dispatch_mode() == DispatchMode::Benchmark ? "benchmark" : "cost model") << ")..." << std::endl;
+    product_plans.resize(layers.size()+1);
+    for(int l = 0; l < product_plans.size(); l++){
+        const int in = weights_shape[l][0], out = weights_shape[l][1];
+        product_plans[l][0] = product_plan<T>(1, in, out, NoTrans, NoTrans);
+        product_plans[l][1] = product_plan<T>(in, 1, out, Trans, NoTrans);
+        product_plans[l][2] = product_plan<T>(1, out, in, NoTrans, Trans);
+        std::cout << "Product " << l+1 << " (" << in << " x " << out << "):";
+        const char* names[3] = {" forward ", ", weights gradient ", ", input gradient "};
+        for(int p = 0; p < 3; p++){
+            std::cout << names[p] << mul_kernel_name(product_plans[l][p].kernel) << " on " << product_plans[l][p].threads
+                      << (product_plans[l][p].threads == 1 ? " thread" : " threads");
+        }
+        std::cout << std::endl;
+    }
+}
+template void Model<float>::planProducts();
+template void Model<double>::planProducts();
+
+//z[l] += input * weights[l] + bias[l], then h[l] (y for the output layer) = act(z[l]) and dAct_z[l] = act'(z[l]), see epilogue.hpp:
+//the dense layers do it in the same pass of the gemv, the pruned layers and the naive version right after the product
+template<typename T>
+void Model<T>::forwardLayer(std::vector<T>& input, int l){
+    Epilogue<T> epilogue;
+    epilogue.bias = bias[l].data();
+    epilogue.activation = activations[l];
+    epilogue.h = l < layers.size() ? h[l].data() : y.data();
+    epilogue.dact = dAct_z[l].data();
+    const int in = weights_shape[l][0], out = weights_shape[l][1];
+    if(isPruned(l)){
+        bsr_gemv(Trans, weights_pattern[l], weights[l].data(), input.data(), z[l].data());
+        apply_epilogue(epilogue, 1, out, 0, 0, z[l].data(), out);
+    }
+    else if(!gemm_backend.empty()){
+        gemm<T>(gemm_backend, NoTrans, NoTrans, 1, out, in, T(1), input.data(), in, weights[l].data(), out, T(1), z[l].data(), out);
+        apply_epilogue(epilogue, 1, out, 0, 0, z[l].data(), out);
+    }
+    else if(matrix_mul_optimisation == 1){
+        mul_funct(input, weights[l], z[l], 1, in, out, matrix_mul_optimisation);
+        apply_epilogue(epilogue, 1, out, 0, 0, z[l].data(), out);
+    }
+    else if(matrix_mul_optimisation == 3 && product_plans[l][0].kernel != MulKernel::Vector){
+        run_product(product_plans[l][0], input, weights[l], z[l], 1, in, out, NoTrans, NoTrans);
+        apply_epilogue(epilogue, 1, out, 0, 0, z[l].data(), out);
+    }
+    else{
+        const int threads = matrix_mul_optimisation == 3 ? product_plans[l][0].threads : 0;
+        gemv(Trans, in, out, weights[l].data(), out, input.data(), z[l].data(), epilogue, threads);
+    }
+}
+
+template void Model<float>::forwardLayer(std::vector<float>& input, int l);
+template void Model<double>::forwardLayer(std::vector<double>& input, int l);
+
+//dE_dw[l] += input^T * dE_db[l], only on the blocks left for the pruned layers
+template<typename T>
+void Model<T>::weightsGradient(const std::vector<T>& input, int l){
+    if(isPruned(l)){
+        bsr_ger(weights_pattern[l], T(1), input.data(), dE_db[l].data(), dE_dw[l].data());
+        return;
+    }
+    if(!gemm_backend.empty()){
+        const std::size_t in = input.size(), out = dE_db[l].size();
+        gemm<T>(gemm_backend, Trans, NoTrans, in, out, 1, T(1), input.data(), in, dE_db[l].data(), out, T(1), dE_dw[l].data(), out);
+        return;
+    }
+    if(matrix_mul_optimisation == 3){
+        run_product(product_plans[l][1], input, dE_db[l], dE_dw[l], input.size(), 1, dE_db[l].size(), Trans, NoTrans);
+        return;
+    }
+    mul_funct(input, dE_db[l], dE_dw[l], input.size(), 1, dE_db[l].size(), matrix_mul_optimisation, Trans, NoTrans);
+}
+
+template void Model<float>::weightsGradient(const std::vector<float>& input, int l);
+template void Model<double>::weightsGradient(const std::vector<double>& input, int l);
+
+//dE_dx[l-1] += dE_db[l] * weights[l]^T
+template<typename T>
+void Model<T>::inputGradient(int l){
+    if(isPruned(l)){
+        bsr_gemv(NoTrans, weights_pattern[l], weights[l].data(), dE_db[l].data(), dE_dx[l-1].data());
+        return;
+    }
+    if(!gemm_backend.empty()){
+        const std::size_t in = weights_shape[l][0], out = weights_shape[l][1];
+        gemm<T>(gemm_backend, NoTrans, Trans, 1, in, out, T(1), dE_db[l].data(), out, weights[l].data(), out, T(1), dE_dx[l-1].data(), in);
+        return;
+    }
+    if(matrix_mul_optimisation == 3){
+        run_product(product_plans[l][2], dE_db[l], weights[l], dE_dx[l-1], 1, dE_db[l].size(), weights_shape[l][0], NoTrans, Trans);
+        return;
+    }
+    mul_funct(dE_db[l], weights[l], dE_dx[l-1], 1, dE_db[l].size(), weights_shape[l][0], matrix_mul_optimisation, NoTrans, Trans);
+}
+
+template void Model<float>::inputGradient(int l);
+template void Model<double>::inputGradient(int l);
+
+
 //****************************************************************************************************************************************************
 //This function defined in Model.hpp compute the backpropagation of the model using the chain rule and Gradient Descent
 
 template<typename T>
 void Model<T>::backPropagation(const std::vector<T>& input, std::vector<T>& dE_dy, const int& selection){
-    int one=1;
-    std::vector<T> temp;
-    activationFunDerivative(z[layers.size()], dAct_z[layers.size()], model_output.getOutputAct_fun());
+    //dAct_z has been computed by predict, together with z
     dE_db[layers.size()] = mul(dE_dy, dAct_z[layers.size()]);
-    temp = transposeMatrix(h[layers.size()-1], one, h[layers.size()-1].size());
     const auto t0_0 = std::chrono::high_resolution_clock::now();
-    mul_funct(temp , dE_db[layers.size()],dE_dw[layers.size()], h[layers.size()-1].size(), one, dE_db[layers.size()].size(), matrix_mul_optimisation);
+    //dE_dw = h^T * dE_db and dE_dx = dE_db * W^T, see weightsGradient() and inputGradient()
+    weightsGradient(h[layers.size()-1], layers.size());
     const auto t0_1 = std::chrono::high_resolution_clock::now();
     int64_t dt_01 = std::chrono::duration_cast<std::chrono::microseconds>(t0_1 - t0_0).count();
     times[1+layers.size()] += dt_01;
-    transposeMatrix2(weights[layers.size()], temp, weights_shape[layers.size()][0], weights_shape[layers.size()][1]);
    const auto t1_0 = std::chrono::high_resolution_clock::now();
-    mul_funct(dE_db[layers.size()], temp, dE_dx[layers.size()-1], one,  dE_db[layers.size()].size(), weights_shape[layers.size()][0], matrix_mul_optimisation);
+    inputGradient(layers.size());
     const auto t1_1 = std::chrono::high_resolution_clock::now();
     int64_t dt_02 = std::chrono::duration_cast<std::chrono::microseconds>(t1_1 - t1_0).count();    
     times[1+layers.size()+1] += dt_02;
     for (int i=layers.size()-1; i > 0; i--){
-        activationFunDerivative(z[i], dAct_z[i], layers[i].getActFun());
         dE_db[i] = mul(dE_dx[i], dAct_z[i]);
-        temp = transposeMatrix(h[i-1], one, h[i-1].size());
         const auto t2_0 = std::chrono::high_resolution_clock::now();
-        mul_funct(temp, dE_db[i], dE_dw[i], h[i-1].size(), one, dE_db[i].size(), matrix_mul_optimisation);
+        weightsGradient(h[i-1], i);
         const auto t2_1 = std::chrono::high_resolution_clock::now();
         int64_t dt_03 = std::chrono::duration_cast<std::chrono::microseconds>(t2_1 - t2_0).count();
         times[1+layers.size()+1+1+i] += dt_03;
-        transposeMatrix2(weights[i], temp, weights_shape[i][0], weights_shape[i][1]);
         const auto t3_0 = std::chrono::high_resolution_clock::now();
-        mul_funct(dE_db[i], temp, dE_dx[i-1], one,  dE_db[i].size(), weights_shape[i][0], matrix_mul_optimisation);
+        inputGradient(i);
         const auto t3_1 = std::chrono::high_resolution_clock::now();
         int64_t dt_04 = std::chrono::duration_cast<std::chrono::microseconds>(t3_1 - t3_0).count();
         times[1+layers.size()+1+1+i+layers.size()-1] += dt_04;
     }
-    activationFunDerivative(z[0], dAct_z[0], layers[0].getActFun());
     dE_db[0] = mul(dE_dx[0], dAct_z[0]);
-    temp = transposeMatrix(input, one, input.size());
     const auto t4_0 = std::chrono::high_resolution_clock::now();
-    mul_funct(temp, dE_db[0], dE_dw[0], input.size(), one, dE_db[0].size(), matrix_mul_optimisation);
+    weightsGradient(input, 0);
     const auto t4_1 = std::chrono::high_resolution_clock::now();
     int64_t dt_05 = std::chrono::duration_cast<std::chrono::microseconds>(t4_1 - t4_0).count();
     times[4 + 1*layers.size() + 2*(layers.size()-1)-1] += dt_05;
@@ -901,11 +1118,16 @@ template void Model<double>::backPropagation(const std::vector<double>& input, s
 //****************************************************************************************************************************************************
 /**
  * This function defined in Model.hpp take as input the chosen matrix multiplication algorithm chosen with "selection"
- * and train the parameters of the model using predict and backpropagation function
+ * (see mul_funct, 3 plans the kernel of each product with planProducts) and train the parameters of the model
+ * using predict and backpropagation function
  **/
 
 template<typename T>
 void Model<T>::train(int& selection){
+    matrix_mul_optimisation = selection;
+    if(matrix_mul_optimisation == 3){
+        planProducts();
+    }
     int time_seize = 4 + 1*layers.size() + 2*(layers.size()-1);
     times.resize(time_seize);
     for(int i = 0; i < time_seize; i++){
@@ -958,11 +1180,9 @@ void Model<T>::train(int& selection){
                     const auto tt0 = std::chrono::high_resolution_clock::now();
                     total_opp++;
                     temp = model_input.getTrain()[batch_loop*model_batch_size+i];
-                    extendMatrix();         //before predict call and for every predict in batch
                     const auto tt1 = std::chrono::high_resolution_clock::now();
                     predict(temp, selection);
                     const auto tt2 = std::chrono::high_resolution_clock::now();
-                    reduceMatrix();          //after predict call and for every predict in batch
                     applyLossFunction(y, model_output.getOutputTrain()[batch_loop*model_batch_size+i], dE_dy, model_loss_fun);
                     const auto tt3 = std::chrono::high_resolution_clock::now();
                     backPropagation(temp, dE_dy, selection);
@@ -1023,9 +1243,7 @@ void Model<T>::train(int& selection){
         int operations_validation = 0;
         for(int i = 0; i < model_input.getValidation().size(); i++){
             temp_validation = model_input.getValidation()[i];
-            extendMatrix(); //before predict call and for every predict in batch
             predict(temp_validation, selection);
-            reduceMatrix(); //after predict call and for every predict in batch
             resetVector(z);
             index_max_element_target = 0;
             float temp_1 = model_output.getOutputValidation()[i][0];
@@ -1075,9 +1293,7 @@ void Model<T>::train(int& selection){
     int operations_test = 0;
     for(int i = 0; i < model_input.getTest().size(); i++){
         temp_test = model_input.getTest()[i];
-        extendMatrix(); //before predict call and for every predict in batch
         predict(temp_test, selection);
-        reduceMatrix(); //after predict call and for every predict in batch
         resetVector(z);
         index_max_element_target = 0;
         float temp_1 = model_output.getOutputTest()[i][0];
@@ -99,7 +99,7 @@ void Profiler::profile_one(const std::string& algorithm, const std::string& prog
     std::cout << "Compiler optimization: " << compiler_flags << std::endl;
 
     std::string compiling_command =
-            "g++ " + program_filename + " ../../src/mmm.cpp ../../src/mmm_blas.cpp" + compiler_flags + " -o " + algorithm + openblas_flags;
+            "g++ " + program_filename + " ../../src/mmm.cpp ../../src/mmm_blas.cpp ../../src/mmm_recursive.cpp ../../src/gemm.cpp ../../src/matrix_transpose.cpp ../../src/matrix_layout.cpp ../../src/mmm_packed.cpp ../../src/matrixProd_AVX.cpp ../../src/epilogue.cpp ../../src/cpu_features.cpp ../../src/tuning_table.cpp ../../src/thread_pool.cpp ../../src/topology.cpp" + compiler_flags + " -o " + algorithm + openblas_flags;
     system(compiling_command.data());
 
     std::cout << "Profiling time complexity" << std::endl;
@@ -0,0 +1,300 @@
+#include "../include/quantized.hpp"
+#include "../include/cpu_features.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+
+namespace {
+
+    //******************************************************************************************************************
+    // Integer dot products: sum a[i]*b[i] of n int8 in [-127, 127], accumulated in int32.
+    // One variant per instruction set, compiled for its own target and picked at runtime by select_int8_kernel().
+    // vpmaddubsw / vpdpbusd take an unsigned and a signed operand: the unsigned one is |b| and the signed one is a
+    // with the sign of b (_mm_sign_epi8), which gives the same products.
+    //******************************************************************************************************************
+
+    std::int32_t dot_int8_scalar(std::size_t n, const std::int8_t* a, const std::int8_t* b){
+        std::int32_t acc = 0;
+        for (std::size_t i = 0; i < n; i++)
+            acc += std::int32_t(a[i]) * b[i];
+        return acc;
+    }
+
+    __attribute__((target("sse4.1")))
+    std::int32_t dot_int8_sse4(std::size_t n, const std::int8_t* a, const std::int8_t* b){
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i acc = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            const __m128i pairs = _mm_maddubs_epi16(_mm_abs_epi8(vb), _mm_sign_epi8(va, vb));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, ones));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+        std::int32_t result = _mm_cvtsi128_si32(acc);
+        for (; i < n; i++)
+            result += std::int32_t(a[i]) * b[i];
+        return result;
+    }
+
+    __attribute__((target("avx2")))
+    inline std::int32_t reduce_add_epi32(__m256i acc){
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    __attribute__((target("avx2")))
+    std::int32_t dot_int8_avx2(std::size_t n, const std::int8_t* a, const std::int8_t* b){
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            const __m256i va0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const __m256i va1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32));
+            const __m256i vb1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_abs_epi8(vb0), _mm256_sign_epi8(va0, vb0)), ones));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_abs_epi8(vb1), _mm256_sign_epi8(va1, vb1)), ones));
+        }
+        for (; i + 32 <= n; i += 32) {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_abs_epi8(vb), _mm256_sign_epi8(va, vb)), ones));
+        }
+        std::int32_t result = reduce_add_epi32(_mm256_add_epi32(acc0, acc1));
+        for (; i < n; i++)
+            result += std::int32_t(a[i]) * b[i];
+        return result;
+    }
+
+    __attribute__((target("avx2,avxvnni")))
+    std::int32_t dot_int8_avx_vnni(std::size_t n, const std::int8_t* a, const std::int8_t* b){
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            const __m256i va0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const __m256i va1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32));
+            const __m256i vb1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32));
+            acc0 = _mm256_dpbusd_avx_epi32(acc0, _mm256_abs_epi8(vb0), _mm256_sign_epi8(va0, vb0));
+            acc1 = _mm256_dpbusd_avx_epi32(acc1, _mm256_abs_epi8(vb1), _mm256_sign_epi8(va1, vb1));
+        }
+        for (; i + 32 <= n; i += 32) {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            acc0 = _mm256_dpbusd_avx_epi32(acc0, _mm256_abs_epi8(vb), _mm256_sign_epi8(va, vb));
+        }
+        std::int32_t result = reduce_add_epi32(_mm256_add_epi32(acc0, acc1));
+        for (; i < n; i++)
+            result += std::int32_t(a[i]) * b[i];
+        return result;
+    }
+
+    // AVX-512 has no vpsignb: the sign of b is applied to a with a masked subtraction, the tail with masked loads
+    __attribute__((target("avx512f,avx512bw,avx512vnni")))
+    std::int32_t dot_int8_avx512_vnni(std::size_t n, const std::int8_t* a, const std::int8_t* b){
+        const __m512i zero = _mm512_setzero_si512();
+        __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+        std::size_t i = 0;
+        for (; i + 128 <= n; i += 128) {
+            const __m512i va0 = _mm512_loadu_si512(a + i), vb0 = _mm512_loadu_si512(b + i);
+            const __m512i va1 = _mm512_loadu_si512(a + i + 64), vb1 = _mm512_loadu_si512(b + i + 64);
+            acc0 = _mm512_dpbusd_epi32(acc0, _mm512_abs_epi8(vb0), _mm512_mask_sub_epi8(va0, _mm512_movepi8_mask(vb0), zero, va0));
+            acc1 = _mm512_dpbusd_epi32(acc1, _mm512_abs_epi8(vb1), _mm512_mask_sub_epi8(va1, _mm512_movepi8_mask(vb1), zero, va1));
+        }
+        for (; i < n; i += 64) {
+            const __mmask64 mask = n - i >= 64 ? ~__mmask64(0) : (__mmask64(1) << (n - i)) - 1;
+            const __m512i va = _mm512_maskz_loadu_epi8(mask, a + i), vb = _mm512_maskz_loadu_epi8(mask, b + i);
+            acc0 = _mm512_dpbusd_epi32(acc0, _mm512_abs_epi8(vb), _mm512_mask_sub_epi8(va, _mm512_movepi8_mask(vb), zero, va));
+        }
+        return _mm512_reduce_add_epi32(_mm512_add_epi32(acc0, acc1));
+    }
+
+
+    using DotInt8 = std::int32_t (*)(std::size_t n, const std::int8_t* a, const std::int8_t* b);
+
+    struct Int8Kernel{
+        DotInt8 dot;
+        const char* name;
+        std::size_t width;      // bytes of the vector loop the rows are padded to, 0 if the tail costs nothing
+    };
+
+    Int8Kernel int8_kernel_for(SimdLevel level){
+        const CpuFeatures& f = cpu_features();
+        if (level >= SimdLevel::AVX512 && f.avx512_vnni)
+            return {dot_int8_avx512_vnni, "avx512_vnni", 0};
+        if (level >= SimdLevel::AVX2 && f.avx_vnni)
+            return {dot_int8_avx_vnni, "avx_vnni", 32};
+        if (level >= SimdLevel::AVX2)
+            return {dot_int8_avx2, "avx2", 32};
+        if (level >= SimdLevel::SSE4)
+            return {dot_int8_sse4, "sse4", 16};
+        return {dot_int8_scalar, "scalar", 0};
+    }
+
+    //! Kernel of the best instruction set available on this machine, chosen once at the first call
+    const Int8Kernel& select_int8_kernel(){
+        static const Int8Kernel kernel = int8_kernel_for(simd_level());
+        return kernel;
+    }
+
+
+    //******************************************************************************************************************
+    // Symmetric quantization: q = round(x / scale), scale = max|x| / 127
+    //******************************************************************************************************************
+
+    template<typename T>
+    float max_abs(std::size_t n, const T* x, std::size_t stride){
+        float m = 0;
+        for (std::size_t i = 0; i < n; i++)
+            m = std::max(m, std::abs(static_cast<float>(x[i * stride])));
+        return m;
+    }
+
+    template<typename T>
+    void quantize_values(std::size_t n, const T* x, std::size_t stride, float inverse_scale, std::int8_t* q){
+        for (std::size_t i = 0; i < n; i++) {
+            const long v = std::lrint(static_cast<float>(x[i * stride]) * inverse_scale);
+            q[i] = static_cast<std::int8_t>(std::clamp(v, -127L, 127L));
+        }
+    }
+
+    //! Quantizes n elements of x (read with the given stride) with their own scale, which is returned (0 if x is 0)
+    template<typename T>
+    float quantize_vector(std::size_t n, const T* x, std::size_t stride, std::int8_t* q){
+        const float m = max_abs(n, x, stride);
+        if (m == 0) {
+            std::fill(q, q + n, std::int8_t(0));
+            return 0;
+        }
+        quantize_values(n, x, stride, 127 / m, q);
+        return m / 127;
+    }
+
+    //! The rows of a QuantizedMatrix are zero padded to a multiple of the vector loop of the kernel, so that it never
+    //! runs its scalar tail. Rows shorter than one vector (e.g. the 4 inputs of the iris network) and the kernels
+    //! with masked tails (AVX-512) are not padded: the padding would cost more memory than the tail costs time.
+    std::size_t padded_row(std::size_t K){
+        const std::size_t width = select_int8_kernel().width;
+        if (width == 0 || K < width)
+            return K;
+        return (K + width - 1) / width * width;
+    }
+
+    //! Below this number of multiply-adds the cost of waking up the threads is larger than the product itself
+    constexpr std::size_t parallel_threshold = 1 << 16;
+
+    //! Output channels per block of gemm: a block of W (256 rows of K bytes) stays in cache for all the rows of A
+    constexpr std::size_t channel_block = 256;
+
+}
+
+
+template<typename T>
+QuantizedMatrix::QuantizedMatrix(const T* W, std::size_t K, std::size_t N, QuantGranularity granularity):
+    n_inputs(K), n_outputs(N), stride(padded_row(K)), mode(granularity),
+    values(N * stride, 0)
+{
+    // the column j of W becomes the row j of values
+    if (mode == QuantGranularity::PerChannel) {
+        scales.resize(N);
+        for (std::size_t j = 0; j < N; j++)
+            scales[j] = quantize_vector(K, W + j, N, values.data() + j * stride);
+    } else {
+        const float m = max_abs(K * N, W, 1);
+        scales.assign(1, m / 127);
+        if (m != 0)
+            for (std::size_t j = 0; j < N; j++)
+                quantize_values(K, W + j, N, 127 / m, values.data() + j * stride);
+    }
+}
+
+template QuantizedMatrix::QuantizedMatrix(const float* W, std::size_t K, std::size_t N, QuantGranularity granularity);
+template QuantizedMatrix::QuantizedMatrix(const double* W, std::size_t K, std::size_t N, QuantGranularity granularity);
+
+
+void gemm_int8(std::size_t M, std::size_t N, std::size_t K, const std::int8_t* A, std::size_t lda,
+               const std::int8_t* B, std::size_t ldb, std::int32_t* C, std::size_t ldc){
+    const DotInt8 dot = select_int8_kernel().dot;
+    for (std::size_t j0 = 0; j0 < N; j0 += channel_block) {
+        const std::size_t j1 = std::min(N, j0 + channel_block);
+        for (std::size_t i = 0; i < M; i++)
+            for (std::size_t j = j0; j < j1; j++)
+                C[i * ldc + j] += dot(K, A + i * lda, B + j * ldb);
+    }
+}
+
+
+template<typename T>
+void gemv_quantized(const QuantizedMatrix& W, const T* x, T* y, int numThreads){
+    const std::size_t K = W.inputs(), N = W.outputs(), ld = W.ld();
+    if (K == 0 || N == 0)
+        return;
+
+    // the padding of the activations is zero like the one of the weights, so the kernels run on whole rows
+    thread_local std::vector<std::int8_t> buffer;
+    buffer.assign(ld, 0);
+    const std::int8_t* qx = buffer.data();
+    const float sx = quantize_vector(K, x, 1, buffer.data());
+    if (sx == 0)
+        return;
+
+    const DotInt8 dot = select_int8_kernel().dot;
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && K * N >= parallel_threshold;
+
+    parallel_for(N, parallel ? numThreads : 1, [&](std::size_t j){
+        y[j] += static_cast<T>(sx * W.scale(j) * static_cast<float>(dot(ld, qx, W.channel(j))));
+    }, std::max<std::size_t>(1, N / (4 * numThreads)));
+}
+
+template void gemv_quantized<float>(const QuantizedMatrix& W, const float* x, float* y, int numThreads);
+template void gemv_quantized<double>(const QuantizedMatrix& W, const double* x, double* y, int numThreads);
+
+
+template<typename T>
+void gemm_quantized(std::size_t M, const T* A, std::size_t lda, const QuantizedMatrix& W, T* C, std::size_t ldc,
+                    int numThreads){
+    const std::size_t K = W.inputs(), N = W.outputs(), ld = W.ld();
+    if (M == 0 || K == 0 || N == 0)
+        return;
+
+    std::vector<std::int8_t> qa(M * ld, 0);
+    std::vector<float> sa(M);
+    for (std::size_t i = 0; i < M; i++)
+        sa[i] = quantize_vector(K, A + i * lda, 1, qa.data() + i * ld);
+
+    const DotInt8 dot = select_int8_kernel().dot;
+    numThreads = resolve_threads(numThreads);
+    const bool parallel = numThreads > 1 && M * K * N >= parallel_threshold;
+    const std::size_t n_blocks = (N + channel_block - 1) / channel_block;
+
+    // every thread owns a block of output channels, which stays in cache while all the rows of A go through it
+    parallel_for(n_blocks, parallel ? numThreads : 1, [&](std::size_t b){
+        const std::size_t j0 = b * channel_block;
+        const std::size_t j1 = std::min(N, j0 + channel_block);
+        for (std::size_t i = 0; i < M; i++) {
+            if (sa[i] == 0)
+                continue;
+            const std::int8_t* row = qa.data() + i * ld;
+            for (std::size_t j = j0; j < j1; j++)
+                C[i * ldc + j] += static_cast<T>(sa[i] * W.scale(j) * static_cast<float>(dot(ld, row, W.channel(j))));
+        }
+    });
+}
+
+template void gemm_quantized<float>(std::size_t M, const float* A, std::size_t lda, const QuantizedMatrix& W, float* C,
+                                    std::size_t ldc, int numThreads);
+template void gemm_quantized<double>(std::size_t M, const double* A, std::size_t lda, const QuantizedMatrix& W, double* C,
+                                     std::size_t ldc, int numThreads);
+
+
+std::string int8_kernel_name(){
+    return select_int8_kernel().name;
+}
@@ -0,0 +1,244 @@
+#include "../include/thread_pool.hpp"
+#include "../include/topology.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+
+namespace {
+
+    //! Index of the queue of the calling thread, -1 outside the pool
+    thread_local int current_worker = -1;
+
+    //! Whole CPUs allowed by a quota of quota microseconds every period microseconds (rounded up), 0 if unlimited
+    int quota_cpus(long quota, long period){
+        if (quota <= 0 || period <= 0)
+            return 0;
+        return static_cast<int>((quota + period - 1) / period);
+    }
+
+    //! Cgroup of the process for the given hierarchy (the "0::" line for v2, the line listing the cpu controller for
+    //! v1), "/" if not found
+    std::string cgroup_path(bool v2){
+        std::ifstream file("/proc/self/cgroup");
+        std::string line;
+        while (std::getline(file, line)) {
+            const std::size_t first = line.find(':'), second = line.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos)
+                continue;
+            const std::string controllers = line.substr(first + 1, second - first - 1);
+            std::stringstream list(controllers);
+            std::string controller;
+            bool cpu = false;
+            while (std::getline(list, controller, ','))
+                cpu |= controller == "cpu";
+            if ((v2 && line.compare(0, 3, "0::") == 0) || (!v2 && cpu))
+                return line.substr(second + 1);
+        }
+        return "/";
+    }
+
+    //! CPU limit of the cgroup v2 in directory, 0 if none
+    int cgroup_v2_cpus(const std::string& directory){
+        std::ifstream file(directory + "/cpu.max");
+        std::string quota;
+        long period = 0;
+        if (!(file >> quota >> period) || quota == "max")
+            return 0;
+        return quota_cpus(std::atol(quota.c_str()), period);
+    }
+
+    //! CPU limit of the cgroup v1 in directory, 0 if none
+    int cgroup_v1_cpus(const std::string& directory){
+        std::ifstream quota_file(directory + "/cpu.cfs_quota_us"), period_file(directory + "/cpu.cfs_period_us");
+        long quota = 0, period = 0;
+        if (!(quota_file >> quota) || !(period_file >> period))
+            return 0;
+        return quota_cpus(quota, period);
+    }
+
+    //! CPU quota of the cgroup of the process (the --cpus of docker, the CPU limit of kubernetes), 0 if unlimited.
+    //! Inside a container the cgroup is usually mounted as the root of /sys/fs/cgroup, so that is tried as well.
+    int cgroup_cpus(){
+        const std::string v2 = cgroup_path(true);
+        for (const std::string& directory : {"/sys/fs/cgroup" + v2, std::string("/sys/fs/cgroup")})
+            if (int cpus = cgroup_v2_cpus(directory))
+                return cpus;
+        const std::string v1 = cgroup_path(false);
+        for (const char* root : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"})
+            for (const std::string& directory : {root + v1, std::string(root)})
+                if (int cpus = cgroup_v1_cpus(directory))
+                    return cpus;
+        return 0;
+    }
+
+    int detect_concurrency(){
+        if (const char* env = std::getenv("NNET_NUM_THREADS")) {
+            const int threads = std::atoi(env);
+            if (threads > 0)
+                return threads;
+        }
+        // the CPUs of the affinity mask of the process
+        int threads = static_cast<int>(topology().cpus.size());
+        if (int quota = cgroup_cpus())
+            threads = std::min(threads, quota);
+        return std::max(1, threads);
+    }
+
+}
+
+
+int pool_concurrency(){
+    static const int threads = detect_concurrency();
+    return threads;
+}
+
+int resolve_threads(int numThreads){
+    return numThreads > 0 ? numThreads : pool_concurrency();
+}
+
+
+//! One parallel loop: its tasks share the counter of the next chunk; the loop lives on the stack of the thread that
+//! started it, which waits for pending to reach 0
+struct ThreadPool::Loop{
+    const RangeTask* task;
+    std::size_t count, grain;
+    std::atomic<std::size_t> next{0};
+    int pending;
+    std::mutex mutex;
+    std::condition_variable done;
+
+    void execute(int slot){
+        for (std::size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain))
+            (*task)(begin, std::min(count, begin + grain), slot);
+        // the last task wakes up the owner, under the lock so that the loop is not destroyed while notifying
+        std::lock_guard<std::mutex> guard(mutex);
+        if (--pending == 0)
+            done.notify_all();
+    }
+};
+
+//! Tasks of a worker: the owner takes the newest one (its data is still in cache), thieves take the oldest
+struct ThreadPool::Queue{
+    std::mutex mutex;
+    std::deque<std::pair<Loop*, int>> tasks;
+};
+
+
+ThreadPool& ThreadPool::instance(){
+    static ThreadPool pool(pool_concurrency());
+    return pool;
+}
+
+ThreadPool::ThreadPool(int threads){
+    // the first CPU of the placement is left to the thread that starts the loops, which is not pinned
+    const std::vector<int> placement = thread_placement(threads);
+    const bool pin = pinning_enabled();
+    for (int i = 0; i + 1 < threads; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+    for (int i = 0; i + 1 < threads; i++)
+        m_workers.emplace_back(&ThreadPool::worker, this, i, pin ? placement[i + 1] : -1);
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> guard(m_sleep);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+void ThreadPool::worker(int index, int cpu){
+    current_worker = index;
+    if (cpu >= 0)
+        pin_current_thread(cpu);
+    for (;;) {
+        if (run_one(index))
+            continue;
+        std::unique_lock<std::mutex> lock(m_sleep);
+        m_wake.wait(lock, [this]{return m_stop || m_queued.load() > 0;});
+        if (m_stop && m_queued.load() <= 0)
+            return;
+    }
+}
+
+bool ThreadPool::run_one(int self){
+    const int queues = static_cast<int>(m_queues.size());
+    std::pair<Loop*, int> task{nullptr, 0};
+    // own queue first (newest task), then steal the oldest task of the others
+    for (int q = 0; q < queues && !task.first; q++) {
+        const int victim = self >= 0 ? (self + q) % queues : q;
+        Queue& queue = *m_queues[victim];
+        std::lock_guard<std::mutex> guard(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        if (victim == self) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task.first)
+        return false;
+    m_queued--;
+    task.first->execute(task.second);
+    return true;
+}
+
+void ThreadPool::push(int self, Loop* loop, int slot){
+    const int queues = static_cast<int>(m_queues.size());
+    Queue& queue = *m_queues[self >= 0 ? self : static_cast<int>(m_next_queue++ % queues)];
+    {
+        std::lock_guard<std::mutex> guard(queue.mutex);
+        queue.tasks.emplace_back(loop, slot);
+    }
+    std::lock_guard<std::mutex> guard(m_sleep);
+    m_queued++;
+}
+
+void ThreadPool::run(std::size_t count, std::size_t grain, int numThreads, const RangeTask& task){
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    const int tasks = static_cast<int>(std::min<std::size_t>(chunks, std::min(resolve_threads(numThreads), size())));
+
+    if (tasks <= 1) {
+        for (std::size_t begin = 0; begin < count; begin += grain)
+            task(begin, std::min(count, begin + grain), 0);
+        return;
+    }
+
+    Loop loop;
+    loop.task = &task;
+    loop.count = count;
+    loop.grain = grain;
+    loop.pending = tasks;
+
+    const int self = current_worker;
+    for (int slot = 1; slot < tasks; slot++)
+        push(self, &loop, slot);
+    m_wake.notify_all();
+
+    loop.execute(0);
+
+    // help with the queued tasks (of this loop or of any other) while the other threads finish
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(loop.mutex);
+            if (loop.pending == 0)
+                return;
+        }
+        if (run_one(self))
+            continue;
+        std::unique_lock<std::mutex> lock(loop.mutex);
+        loop.done.wait_for(lock, std::chrono::microseconds(100), [&loop]{return loop.pending == 0;});
+    }
+}
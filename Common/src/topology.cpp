@@ -0,0 +1,154 @@
+#include "../include/topology.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <pthread.h>
+#include <sched.h>
+
+
+namespace {
+
+    //! CPUs of a list in the format of /sys, e.g. "0-3,8-11"
+    std::vector<int> parse_cpulist(const std::string& list){
+        std::vector<int> cpus;
+        std::stringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            if (range.empty() || range == "\n")
+                continue;
+            const std::size_t dash = range.find('-');
+            const int first = std::atoi(range.c_str());
+            const int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    int read_int(const std::string& path, int fallback){
+        std::ifstream file(path);
+        int value;
+        return file >> value ? value : fallback;
+    }
+
+    //! CPUs of the affinity mask of the process
+    std::vector<int> allowed_cpus(){
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+        }
+        if (cpus.empty())
+            for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); cpu++)
+                cpus.push_back(cpu);
+        return cpus;
+    }
+
+    //! NUMA node of every CPU listed in /sys/devices/system/node/node*/cpulist
+    std::map<int, int> node_of_cpus(){
+        std::map<int, int> node_of;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+            const std::string name = entry.path().filename().string();
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                !std::all_of(name.begin() + 4, name.end(), [](char c){return c >= '0' && c <= '9';}))
+                continue;
+            std::ifstream file(entry.path() / "cpulist");
+            std::string list;
+            std::getline(file, list);
+            for (int cpu : parse_cpulist(list))
+                node_of[cpu] = std::atoi(name.c_str() + 4);
+        }
+        return node_of;
+    }
+
+    Topology detect_topology(){
+        Topology topo;
+        const std::map<int, int> node_of = node_of_cpus();
+        std::map<std::pair<int, int>, int> core_index;      // (package, core id) -> core
+        std::set<int> nodes;
+
+        for (int cpu : allowed_cpus()) {
+            const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            const std::pair<int, int> core_key{read_int(path + "physical_package_id", 0), read_int(path + "core_id", cpu)};
+            const auto core = core_index.emplace(core_key, static_cast<int>(core_index.size())).first->second;
+            const auto node = node_of.find(cpu);
+
+            CpuInfo info;
+            info.cpu = cpu;
+            info.core = core;
+            info.node = node == node_of.end() ? 0 : node->second;
+            topo.cpus.push_back(info);
+            nodes.insert(info.node);
+        }
+        topo.nodes = std::max<int>(1, nodes.size());
+        topo.cores = std::max<int>(1, core_index.size());
+        return topo;
+    }
+
+}
+
+
+const Topology& topology(){
+    static const Topology topo = detect_topology();
+    return topo;
+}
+
+std::vector<int> thread_placement(int threads){
+    const Topology& topo = topology();
+
+    // nodes in the order of their first CPU, then one CPU per core before the hyper-threads
+    std::vector<int> node_order;
+    for (const CpuInfo& info : topo.cpus)
+        if (std::find(node_order.begin(), node_order.end(), info.node) == node_order.end())
+            node_order.push_back(info.node);
+
+    std::vector<int> order;
+    std::set<int> cores_taken, cpus_taken;
+    for (bool siblings : {false, true})
+        for (int node : node_order)
+            for (const CpuInfo& info : topo.cpus) {
+                if (info.node != node || cpus_taken.count(info.cpu) || (!siblings && cores_taken.count(info.core)))
+                    continue;
+                order.push_back(info.cpu);
+                cpus_taken.insert(info.cpu);
+                cores_taken.insert(info.core);
+            }
+
+    std::vector<int> placement(std::max(threads, 0));
+    for (std::size_t i = 0; i < placement.size(); i++)
+        placement[i] = order[i % order.size()];
+    return placement;
+}
+
+bool pin_current_thread(int cpu){
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool pinning_enabled(){
+    const char* env = std::getenv("NNET_PIN_THREADS");
+    if (env && *env)
+        return std::string(env) != "0";
+    return topology().nodes > 1;
+}
+
+std::string topology_summary(){
+    const Topology& topo = topology();
+    return std::to_string(topo.nodes) + (topo.nodes == 1 ? " NUMA node, " : " NUMA nodes, ") +
+           std::to_string(topo.cores) + (topo.cores == 1 ? " core, " : " cores, ") +
+           std::to_string(topo.cpus.size()) + (topo.cpus.size() == 1 ? " CPU" : " CPUs");
+}
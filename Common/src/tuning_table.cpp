@@ -0,0 +1,183 @@
+#include "../include/autotuner.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+
+namespace {
+
+    std::string dtype_name(int dtype_size){
+        switch (dtype_size) {
+            case 4:
+                return "float";
+            case 8:
+                return "double";
+            default:
+                return std::to_string(dtype_size);
+        }
+    }
+
+    int dtype_size_from_name(const std::string& name){
+        if (name == "float")
+            return 4;
+        if (name == "double")
+            return 8;
+        return std::stoi(name);
+    }
+
+    TunedKernel kernel_from_name(const std::string& name){
+        if (name == "packed")
+            return TunedKernel::Packed;
+        if (name == "tiled")
+            return TunedKernel::Tiled;
+        if (name == "strassen")
+            return TunedKernel::Strassen;
+        throw std::invalid_argument("unknown kernel " + name);
+    }
+
+    const char* csv_header = "kernel,dtype,m_bucket,n_bucket,k_bucket,outer_tile,inner_tile,threads,loop_order,time_us";
+
+
+    std::mutex table_mutex;
+    std::shared_ptr<const TuningTable> current_table;
+
+}
+
+
+std::string tuned_kernel_name(TunedKernel kernel){
+    switch (kernel) {
+        case TunedKernel::Packed:
+            return "packed";
+        case TunedKernel::Strassen:
+            return "strassen";
+        default:
+            return "tiled";
+    }
+}
+
+bool TuningKey::operator<(const TuningKey& other) const{
+    return std::tie(kernel, dtype_size, m_bucket, n_bucket, k_bucket) <
+           std::tie(other.kernel, other.dtype_size, other.m_bucket, other.n_bucket, other.k_bucket);
+}
+
+int tuning_bucket(std::size_t dim){
+    int bucket = 0;
+    while ((std::size_t(1) << bucket) < dim)
+        bucket++;
+    return bucket;
+}
+
+
+bool TuningTable::lookup(TunedKernel kernel, std::size_t dtype_size, std::size_t M, std::size_t N, std::size_t K,
+                         TuningConfig& config) const{
+
+    const TuningKey key{kernel, static_cast<int>(dtype_size), tuning_bucket(M), tuning_bucket(N), tuning_bucket(K)};
+
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        config = it->second.config;
+        return true;
+    }
+
+    // No entry for this bucket: the configuration of the nearest tuned shape is a better guess than the defaults
+    int best_distance = -1;
+    for (const auto& [other, entry] : entries) {
+        if (other.kernel != key.kernel || other.dtype_size != key.dtype_size)
+            continue;
+        const int distance = std::abs(other.m_bucket - key.m_bucket) + std::abs(other.n_bucket - key.n_bucket) +
+                             std::abs(other.k_bucket - key.k_bucket);
+        if (best_distance < 0 || distance < best_distance) {
+            best_distance = distance;
+            config = entry.config;
+        }
+    }
+    return best_distance >= 0;
+}
+
+void TuningTable::set(const TuningKey& key, const TuningConfig& config, double time_us){
+    entries[key] = {config, time_us};
+}
+
+bool TuningTable::load(const std::string& filename){
+
+    std::ifstream file(filename);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (line.empty() || line == csv_header)
+            continue;
+
+        std::vector<std::string> fields;
+        std::istringstream iss(line);
+        std::string field;
+        while (std::getline(iss, field, ','))
+            fields.push_back(field);
+
+        try {
+            if (fields.size() != 10)
+                throw std::invalid_argument("wrong number of fields");
+            const TuningKey key{kernel_from_name(fields[0]), dtype_size_from_name(fields[1]),
+                                std::stoi(fields[2]), std::stoi(fields[3]), std::stoi(fields[4])};
+            TuningConfig config;
+            config.outer_tile = std::stoi(fields[5]);
+            config.inner_tile = std::stoi(fields[6]);
+            config.threads = std::stoi(fields[7]);
+            config.loop_order = std::stoi(fields[8]);
+            set(key, config, std::stod(fields[9]));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Warning: " << filename << ":" << line_number << " ignored (" << e.what() << ")" << std::endl;
+        }
+    }
+    return true;
+}
+
+bool TuningTable::save(const std::string& filename) const{
+
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open file: " << filename << std::endl;
+        return false;
+    }
+
+    file << csv_header << "\n";
+    for (const auto& [key, entry] : entries) {
+        file << tuned_kernel_name(key.kernel) << "," << dtype_name(key.dtype_size) << ","
+             << key.m_bucket << "," << key.n_bucket << "," << key.k_bucket << ","
+             << entry.config.outer_tile << "," << entry.config.inner_tile << ","
+             << entry.config.threads << "," << entry.config.loop_order << "," << entry.time_us << "\n";
+    }
+    return true;
+}
+
+
+std::string tuning_filename(){
+    if (const char* env = std::getenv("NNET_TUNING_FILE"))
+        return env;
+    return "gemm_tuning.csv";
+}
+
+std::shared_ptr<const TuningTable> tuning_table(){
+    std::lock_guard<std::mutex> lock(table_mutex);
+    if (!current_table) {
+        auto table = std::make_shared<TuningTable>();
+        if (table->load(tuning_filename()))
+            std::cout << "Loaded " << table->size() << " tuned configurations from " << tuning_filename() << std::endl;
+        current_table = table;
+    }
+    return current_table;
+}
+
+void install_tuning_table(std::shared_ptr<const TuningTable> table){
+    std::lock_guard<std::mutex> lock(table_mutex);
+    current_table = std::move(table);
+}
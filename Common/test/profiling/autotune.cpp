@@ -0,0 +1,67 @@
+/*
+ * This program tunes the blocked matrix multiplication kernels (mmm_packed and mmm_multiT / mmm_gmultiT) on the
+ * current machine and writes the winners to the tuning file (gemm_tuning.csv, or $NNET_TUNING_FILE), which the
+ * kernels load at startup. It replaces the manual search with profile_list.txt for the tiles and the threads.
+ *
+ * This program takes as input:
+ * argv[1] = maximum number of threads (0 = all the available ones)
+ * argv[2...] = shapes to tune: a single number for a square product, or ROWSxINNERSxCOLUMNS
+ *
+ * Every shape is tuned for both kernels in single and double precision, the shapes whose dimensions are all at
+ * least 512 also for the Strassen crossover (mmm_strassen). Entries of the tuning file for shapes that are not
+ * tuned again are kept.
+ *
+ * To compile: make autotune
+ * Example: ./autotune 0 256 512 1024 16x5x3
+ */
+
+
+#include "../../include/autotuner.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+int main(int argc, char ** argv){
+
+    if(argc < 3)
+    {
+        std::cout<<"Error! Usage: ./autotune MAX_THREADS SHAPE [SHAPE ...]"<<std::endl;
+        return -1;
+    }
+
+    int max_threads = std::stoi(argv[1]);
+    Autotuner tuner(max_threads);
+
+    for (int arg = 2; arg < argc; arg++) {
+
+        std::string shape(argv[arg]);
+        std::size_t rows, inners, columns;
+        std::size_t x1 = shape.find('x'), x2 = shape.rfind('x');
+        if (x1 == std::string::npos) {
+            rows = inners = columns = std::stoul(shape);
+        } else if (x1 != x2) {
+            rows = std::stoul(shape.substr(0, x1));
+            inners = std::stoul(shape.substr(x1 + 1, x2 - x1 - 1));
+            columns = std::stoul(shape.substr(x2 + 1));
+        } else {
+            std::cout<<"Error! Shape "<<shape<<" must be DIM or ROWSxINNERSxCOLUMNS"<<std::endl;
+            return -1;
+        }
+
+        tuner.tune<float>(TunedKernel::Packed, rows, columns, inners);
+        tuner.tune<double>(TunedKernel::Packed, rows, columns, inners);
+        tuner.tune<float>(TunedKernel::Tiled, rows, columns, inners);
+        tuner.tune<double>(TunedKernel::Tiled, rows, columns, inners);
+        if (std::min({rows, inners, columns}) >= 512) {
+            tuner.tune<float>(TunedKernel::Strassen, rows, columns, inners);
+            tuner.tune<double>(TunedKernel::Strassen, rows, columns, inners);
+        }
+        std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+    }
+
+    if (!tuner.save())
+        return -1;
+    std::cout<<"Saved "<<tuner.table().size()<<" configurations to "<<tuning_filename()<<std::endl;
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * This script is needed by the class profiler to profile the providers of gemm (see gemm.hpp), all compiled in the
+ * same program: the provider is chosen by name at run time.
+ * This program takes as input:
+ * argv[1] = matrix dimensions
+ * argv[2] = datatype: 0 for float, otherwise double
+ * argv[3] = optimization flags, needed for id
+ * argv[4] = the name of the provider: packed, avx, naive or blas
+ * argv[5] = bool: true if we are running the script with valgrind - cachegrind
+ *
+ * The provider has no tile size: the tile column of the csv is left empty.
+ */
+
+
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include <string>
+#include <fstream>
+
+int main(int argc, char ** argv){
+
+    if(argc != 6)
+    {
+        std::cout<<"Error! Wrong # of parameters"<<std::endl;
+        return -1;
+    }
+
+    size_t dim = std::stoi(argv[1]);
+    size_t T = std::stoi(argv[2]); // 0 = float  else = double
+    std::string id = std::string (argv[3]);
+    std::string provider = std::string (argv[4]);
+    bool cache_grind_run = std::stoi(argv[5]);
+
+    int64_t time;
+
+    if (T == 0) {
+        std::cout<<"Float Version"<<std::endl;
+        MatrixFlat<float> Af(dim, dim, -10, 10);
+        MatrixFlat<float> Bf(dim, dim, -10, 10);
+        MatrixFlat<float> Cf(dim, dim);
+
+        mmm_gemm(Af, Bf, Cf, time, provider);
+
+    }else {
+        std::cout << "Double Version" << std::endl;
+        MatrixFlat<double> A(dim, dim, -10, 10);
+        MatrixFlat<double> B(dim, dim, -10, 10);
+        MatrixFlat<double> C(dim, dim);
+        mmm_gemm(A, B, C, time, provider);
+    }
+
+    if(!cache_grind_run) {
+        std::string type = (T == 0) ? "float" : "double";
+        std::string matrixDim = std::to_string(dim) + "X" + std::to_string(dim);
+        appendCSVRow({"FM", id, matrixDim, type, std::to_string(time),
+                      "", "1"});
+    }
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "../../include/MatrixFlat.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the expression templates of MatrixFlat (MatrixExpr.hpp).
+ * The element-wise expressions are compared with the same computation written as a loop, in both double & single
+ * precision:
+ *     W = W - lr * dW / n                     (update of the weights, W is also an operand)
+ *     D = A + B % C - 2 * A + 1               (% is the element-wise product)
+ *     D = -A, (A - B).nnzrs()
+ * The time of the weight update is compared with the same update written with MatrixFlat temporaries.
+ * The products are compared with openBlas:
+ *     A * B * x                               (chain: evaluated as A * (B * x), whatever the parenthesis)
+ *     S = S * Q                               (the destination is one of the factors)
+ *     C += A * B, C -= A * B, C = C + A * B, (A + A) * B, M = A * B with M of another shape
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_MatrixExpr
+ *
+ * To run this test you have to pass the rows and the columns of the matrices
+ *
+ */
+
+//! Microseconds taken by f
+template<typename F>
+int64_t time_us(F f){
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+//! C = A*B with openBlas
+template<typename T>
+MatrixFlat<T> blas_product(MatrixFlat<T>& A, MatrixFlat<T>& B){
+    int64_t time;
+    MatrixFlat<T> C(A.nrows(), B.ncols());
+    mmm_blas(A, B, C, time);
+    return C;
+}
+
+template<typename T>
+int report(const std::string& name, T err, T tolerance){
+    std::cout<<name<<": max relative error "<<err<<std::endl;
+    return err > tolerance;
+}
+
+template<typename T>
+int check_elementwise(std::size_t rows, std::size_t columns, T tolerance){
+
+    int errors = 0;
+    const float lr = 0.05;
+    const int n = 16;
+
+    MatrixFlat<T> W(rows, columns, -10, 10);
+    MatrixFlat<T> dW(rows, columns, -10, 10);
+    MatrixFlat<T> Wref = W;
+    for (std::size_t i = 0; i < rows * columns; i++)
+        Wref[i] = Wref[i] - lr * dW[i] / n;
+    MatrixFlat<T> Wtemp = W;
+    const int64_t time = time_us([&]{W = W - lr * dW / n;});
+    errors += report("W = W - lr * dW / n", max_relative_error(W, Wref), tolerance);
+
+    // the same update with a temporary per operation
+    const int64_t time_temp = time_us([&]{
+        MatrixFlat<T> scaled(rows, columns);
+        for (std::size_t i = 0; i < rows * columns; i++)
+            scaled[i] = lr * dW[i];
+        MatrixFlat<T> divided(rows, columns);
+        for (std::size_t i = 0; i < rows * columns; i++)
+            divided[i] = scaled[i] / n;
+        MatrixFlat<T> diff(rows, columns);
+        for (std::size_t i = 0; i < rows * columns; i++)
+            diff[i] = Wtemp[i] - divided[i];
+        Wtemp = diff;
+    });
+    std::cout<<"Update in "<<time<<" us, with temporaries "<<time_temp<<" us"<<std::endl;
+
+    MatrixFlat<T> A(rows, columns, -10, 10);
+    MatrixFlat<T> B(rows, columns, -10, 10);
+    MatrixFlat<T> C(rows, columns, -10, 10);
+    MatrixFlat<T> D = A + B % C - 2 * A + 1;
+    MatrixFlat<T> Dref(rows, columns);
+    for (std::size_t i = 0; i < rows * columns; i++)
+        Dref[i] = A[i] + B[i] * C[i] - 2 * A[i] + 1;
+    errors += report("D = A + B % C - 2 * A + 1", max_relative_error(D, Dref), tolerance);
+
+    D = -A;
+    for (std::size_t i = 0; i < rows * columns; i++)
+        Dref[i] = -A[i];
+    errors += report("D = -A", max_relative_error(D, Dref), tolerance);
+
+    MatrixFlat<T> diff = A - B;
+    const std::size_t nnz = (A - B).nnzrs();
+    std::cout<<"nnz(A-B): "<<nnz<<" nnz(A-A): "<<(A - A).nnzrs()<<std::endl;
+    errors += nnz != diff.nnzrs() || (A - A).nnzrs() != 0;
+
+    return errors;
+}
+
+template<typename T>
+int check_products(std::size_t rows, std::size_t columns, T tolerance){
+
+    int errors = 0;
+
+    MatrixFlat<T> A(rows, columns, -1, 1);
+    MatrixFlat<T> B(columns, rows, -1, 1);
+    MatrixFlat<T> x(rows, 1, -1, 1);
+
+    // written left to right, computed as A * (B * x): two products with a vector instead of a full one
+    MatrixFlat<T> y(rows, 1);
+    const int64_t time = time_us([&]{y = A * B * x;});
+    MatrixFlat<T> yref(rows, 1);
+    const int64_t time_ref = time_us([&]{MatrixFlat<T> AB = blas_product(A, B); yref = blas_product(AB, x);});
+    errors += report("y = A * B * x", max_relative_error(y, yref), tolerance);
+    std::cout<<"Chain in "<<time<<" us, (A * B) * x with openBlas "<<time_ref<<" us"<<std::endl;
+
+    MatrixFlat<T> S(rows, rows, -1, 1);
+    MatrixFlat<T> Q(rows, rows, -1, 1);
+    MatrixFlat<T> Sref = blas_product(S, Q);
+    S = S * Q;
+    errors += report("S = S * Q", max_relative_error(S, Sref), tolerance);
+
+    MatrixFlat<T> C(rows, rows, -10, 10);
+    MatrixFlat<T> AB = blas_product(A, B);
+    MatrixFlat<T> Cref(rows, rows);
+    for (std::size_t i = 0; i < rows * rows; i++)
+        Cref[i] = C[i] + AB[i];
+    MatrixFlat<T> C2 = C;
+    C += A * B;
+    errors += report("C += A * B", max_relative_error(C, Cref), tolerance);
+    C2 = C2 + A * B;
+    errors += report("C = C + A * B", max_relative_error(C2, Cref), tolerance);
+    C -= A * B;
+    for (std::size_t i = 0; i < rows * rows; i++)
+        Cref[i] = Cref[i] - AB[i];
+    errors += report("C -= A * B", max_relative_error(C, Cref), tolerance);
+    C2 = (A + A) * B;
+    for (std::size_t i = 0; i < rows * rows; i++)
+        Cref[i] = 2 * AB[i];
+    errors += report("C = (A + A) * B", max_relative_error(C2, Cref), tolerance);
+
+    MatrixFlat<T> M(1, 1);
+    M = A * B;
+    errors += M.nrows() != rows || M.ncols() != rows;
+    errors += report("M = A * B (new shape)", max_relative_error(M, AB), tolerance);
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 3)
+    {
+        std::cout<<"Error! You must pass two positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t columns = std::stoi(argv[2]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_elementwise<double>(rows, columns, 1e-14);
+    errors += check_products<double>(rows, columns, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_elementwise<float>(rows, columns, 1e-6);
+    errors += check_products<float>(rows, columns, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
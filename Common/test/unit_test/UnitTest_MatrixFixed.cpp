@@ -0,0 +1,142 @@
+#include "../../include/MatrixFixed.hpp"
+#include "../../include/model_fixed.hpp"
+#include "../../include/gemv.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the fixed-size matrices (MatrixFixed.hpp) and the fixed-size model
+ * (model_fixed.hpp), in both double & single precision:
+ *     mmm_fixed                C += A*B on a few small shapes, compared with a plain loop on MatrixFlat
+ *     dense_fixed              every activation, compared with gemv and the epilogue of the runtime-sized layers
+ *     ModelFixed               the Iris network (4 -> 128 -> 3) with random weights, compared with the same
+ *                              layers run with gemv, in both term of result and time per sample
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_MatrixFixed
+ *
+ * To run this test you have to pass the number of samples to time
+ *
+ */
+
+template<typename T, std::size_t M, std::size_t K, std::size_t N>
+int check_mmm(T tolerance){
+    MatrixFlat<T> A(M, K, -10, 10), B(K, N, -10, 10), C(M, N, -10, 10);
+    MatrixFixed<T, M, K> Af(A);
+    MatrixFixed<T, K, N> Bf(B);
+    MatrixFixed<T, M, N> Cf(C);
+    mmm_fixed(Af, Bf, Cf);
+    for (std::size_t i = 0; i < M; i++)
+        for (std::size_t k = 0; k < K; k++)
+            for (std::size_t j = 0; j < N; j++)
+                C[i * N + j] += A[i * K + k] * B[k * N + j];
+    const T err = max_relative_error(Cf.get_ptr(), C.get_ptr(), M * N);
+    std::cout<<"mmm_fixed "<<M<<"X"<<K<<" * "<<K<<"X"<<N<<": max relative error "<<err<<std::endl;
+    return err > tolerance;
+}
+
+//! Output of the runtime-sized layer: h = act(x * W + b) with gemv and the epilogue
+template<typename T>
+void dense_reference(const T* x, const T* W, const T* b, T* h, std::size_t in, std::size_t out, Activation activation){
+    std::vector<T> z(out, 0);
+    Epilogue<T> epilogue;
+    epilogue.bias = b;
+    epilogue.activation = activation;
+    epilogue.h = h;
+    gemv(Trans, in, out, W, out, x, z.data(), epilogue, 1);
+}
+
+template<Activation A, typename T>
+int check_dense(const std::string& name, T tolerance){
+    constexpr std::size_t In = 13, Out = 37;
+    MatrixFixed<T, 1, In> x(MatrixFlat<T>(1, In, -1, 1));
+    MatrixFixed<T, In, Out> W(MatrixFlat<T>(In, Out, -1, 1));
+    MatrixFixed<T, 1, Out> b(MatrixFlat<T>(1, Out, -1, 1)), h;
+    dense_fixed<A>(x, W, b, h);
+    std::vector<T> href(Out);
+    dense_reference(x.get_ptr(), W.get_ptr(), b.get_ptr(), href.data(), In, Out, A);
+    const T err = max_relative_error(h.get_ptr(), href.data(), Out);
+    std::cout<<"dense_fixed "<<name<<": max relative error "<<err<<std::endl;
+    return err > tolerance;
+}
+
+template<typename T>
+int check_model(std::size_t samples, T tolerance){
+    constexpr std::size_t In = 4, Hidden = 128, Out = 3;
+    ModelFixed<T, In, FixedLayer<Hidden, Activation::ReLu>, FixedLayer<Out, Activation::SoftMax>> model;
+    MatrixFlat<T> W0(In, Hidden, -1, 1), b0(1, Hidden, -1, 1), W1(Hidden, Out, -1, 1), b1(1, Out, -1, 1);
+    model.set_layer(0, W0.get_ptr(), b0.get_ptr());
+    model.set_layer(1, W1.get_ptr(), b1.get_ptr());
+
+    MatrixFlat<T> X(samples, In, -5, 5);
+    std::vector<T> Y(samples * Out), Yref(samples * Out), h(Hidden);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (std::size_t s = 0; s < samples; s++) {
+        MatrixFixed<T, 1, In> x;
+        std::copy(X.get_ptr() + s * In, X.get_ptr() + (s + 1) * In, x.get_ptr());
+        const MatrixFixed<T, 1, Out> y = model.predict(x);
+        std::copy(y.get_ptr(), y.get_ptr() + Out, Y.data() + s * Out);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+    t0 = std::chrono::high_resolution_clock::now();
+    for (std::size_t s = 0; s < samples; s++) {
+        dense_reference(X.get_ptr() + s * In, W0.get_ptr(), b0.get_ptr(), h.data(), In, Hidden, Activation::ReLu);
+        dense_reference(h.data(), W1.get_ptr(), b1.get_ptr(), Yref.data() + s * Out, Hidden, Out, Activation::SoftMax);
+    }
+    t1 = std::chrono::high_resolution_clock::now();
+    const int64_t time_ref = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+    const T err = max_relative_error(Y.data(), Yref.data(), samples * Out);
+    std::cout<<"ModelFixed 4 -> 128 -> 3: max relative error "<<err<<std::endl;
+    std::cout<<"ModelFixed took: "<<time / (int64_t)samples<<" [ns] per sample, with gemv: "
+             <<time_ref / (int64_t)samples<<" [ns]"<<std::endl;
+    return err > tolerance;
+}
+
+template<typename T>
+int check(std::size_t samples, T tolerance){
+    int errors = 0;
+    errors += check_mmm<T, 1, 1, 1>(tolerance);
+    errors += check_mmm<T, 3, 5, 7>(tolerance);
+    errors += check_mmm<T, 16, 16, 16>(tolerance);
+    errors += check_mmm<T, 9, 33, 65>(tolerance);
+    errors += check_dense<Activation::Linear, T>("linear", tolerance);
+    errors += check_dense<Activation::ReLu, T>("ReLu", tolerance);
+    errors += check_dense<Activation::Sigmoid, T>("sigmoid", tolerance);
+    errors += check_dense<Activation::Tanh, T>("tanh", tolerance);
+    errors += check_dense<Activation::SoftMax, T>("SoftMax", tolerance);
+    errors += check_model<T>(samples, tolerance);
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 2)
+    {
+        std::cout<<"Error! You must pass one positive value to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t samples = std::stoi(argv[1]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Samples timed: "<<samples<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(samples, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(samples, 1e-5);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,143 @@
+#include "../../include/MatrixFlat.hpp"
+#include "../../include/matrixProd_VM_VV.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <type_traits>
+
+/*
+ * This test has the scope of validate the static interface of the matrices (MatrixSkltn.hpp) and the views
+ * (MatrixView.hpp), in both double & single precision:
+ *     the matrices have no virtual function (checked at compile time)
+ *     block, row and col read and write the elements of the MatrixFlat they come from
+ *     the generic matrixProd on views of blocks of the matrices, the rest of C must not change
+ * The generic matrixProd is timed on unchecked views, on checked views and on MatrixFlat (checked operator()),
+ * and compared with the same loops written on raw pointers: with unchecked views the time should be the same.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_MatrixView
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B) and the columns of B
+ *
+ */
+
+static_assert(!std::is_polymorphic_v<MatrixFlat<float>>, "MatrixFlat must not have virtual functions");
+static_assert(!std::is_polymorphic_v<MatrixView<float>>, "MatrixView must not have virtual functions");
+static_assert(sizeof(MatrixView<float>) == 5 * sizeof(std::size_t), "a view is a pointer, a stride and the shape");
+
+//! Milliseconds taken by f
+template<typename F>
+int64_t time_ms(F f){
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+//! C += A*B on raw pointers, the loops of the generic matrixProd
+template<typename T>
+void raw_product(const T* A, const T* B, T* C, std::size_t rows, std::size_t inners, std::size_t columns){
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t r = 0; r < inners; r++) {
+            const T air = A[i * inners + r];
+            for (std::size_t j = 0; j < columns; j++)
+                C[i * columns + j] += air * B[r * columns + j];
+        }
+}
+
+template<typename T>
+int check_views(std::size_t rows, std::size_t columns){
+    int errors = 0;
+    MatrixFlat<T> A(rows, columns, -10, 10);
+    const MatrixFlat<T>& Aconst = A;
+
+    const std::size_t i0 = rows / 3, j0 = columns / 4;
+    MatrixView<T> block = A.block(i0, j0, rows - i0, columns - j0);
+    MatrixView<const T> row = Aconst.row(rows - 1), col = Aconst.col(j0);
+    for (std::size_t i = 0; i < block.nrows(); i++)
+        for (std::size_t j = 0; j < block.ncols(); j++)
+            errors += block(i, j) != A(i0 + i, j0 + j);
+    for (std::size_t j = 0; j < columns; j++)
+        errors += row(0, j) != A(rows - 1, j);
+    for (std::size_t i = 0; i < rows; i++)
+        errors += col(i, 0) != A(i, j0);
+
+    // writing through a view (and through a view of a view) writes the matrix
+    block(0, 0) = 42;
+    block.row(block.nrows() - 1)(0, 1 % block.ncols()) = 43;
+    errors += A(i0, j0) != T(42) || A(rows - 1, j0 + 1 % block.ncols()) != T(43);
+    MatrixView<const T> readonly = block;
+    errors += readonly(0, 0) != T(42);
+    errors += block.template with_access<CheckedAccess>()(0, 0) != T(42);
+
+    std::cout<<"Views (block, row, col): "<<errors<<" errors"<<std::endl;
+    return errors;
+}
+
+template<typename T>
+int check_products(std::size_t rows, std::size_t inners, std::size_t columns, T tolerance){
+    int errors = 0;
+    MatrixFlat<T> A(rows, inners, -1, 1), B(inners, columns, -1, 1);
+
+    MatrixFlat<T> Cref(rows, columns), C(rows, columns), Cchecked(rows, columns), Cflat(rows, columns);
+    const int64_t time_raw = time_ms([&]{raw_product(A.get_ptr(), B.get_ptr(), Cref.get_ptr(), rows, inners, columns);});
+    MatrixView<T> Cview = C.view();
+    const int64_t time_view = time_ms([&]{matrixProd(A.view(), B.view(), Cview);});
+    MatrixView<T, CheckedAccess> Ccheck = Cchecked.view().template with_access<CheckedAccess>();
+    const int64_t time_checked = time_ms([&]{
+        matrixProd(A.view().template with_access<CheckedAccess>(), B.view().template with_access<CheckedAccess>(), Ccheck);});
+    const int64_t time_flat = time_ms([&]{matrixProd(A, B, Cflat);});
+    std::cout<<"Raw pointers took: "<<time_raw<<" [ms], unchecked views: "<<time_view<<" [ms], checked views: "
+             <<time_checked<<" [ms], MatrixFlat: "<<time_flat<<" [ms]"<<std::endl;
+    T err = std::max({max_relative_error(C, Cref), max_relative_error(Cchecked, Cref), max_relative_error(Cflat, Cref)});
+    std::cout<<"matrixProd, max relative error: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // C[r0:, c0:] += A[r0:, k0:] * B[k0:, c0:] on views, the rest of C must not change
+    const std::size_t r0 = rows / 3, k0 = inners / 3, c0 = columns / 3;
+    MatrixFlat<T> D(rows, columns, -10, 10);
+    MatrixFlat<T> Dref = D;
+    MatrixView<T> Dblock = D.block(r0, c0, rows - r0, columns - c0);
+    matrixProd(A.block(r0, k0, rows - r0, inners - k0), B.block(k0, c0, inners - k0, columns - c0), Dblock);
+    for (std::size_t i = r0; i < rows; i++)
+        for (std::size_t k = k0; k < inners; k++)
+            for (std::size_t j = c0; j < columns; j++)
+                Dref[i * columns + j] += A[i * inners + k] * B[k * columns + j];
+    err = max_relative_error(D, Dref);
+    std::cout<<"matrixProd on blocks, max relative error: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_views<double>(rows, columns);
+    errors += check_products<double>(rows, inners, columns, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_views<float>(rows, columns);
+    errors += check_products<float>(rows, inners, columns, 1e-5);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,87 @@
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/autotuner.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <cstdio>
+
+/*
+ * This test has the scope of validate the Autotuner and the tuning file.
+ * We tune mmm_packed and mmm_multiT for one shape, save the table to a temporary tuning file, load it back and check
+ * that every entry survived the round trip. Then the kernels are run with the tuned configuration and compared with
+ * the openBlas matrix-matrix multiplication.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_autotuner
+ *
+ * To run this test you have to pass the dimension of the (square) matrices and the maximum number of threads
+ *
+ */
+
+bool same_config(const TuningConfig& a, const TuningConfig& b){
+    return a.outer_tile == b.outer_tile && a.inner_tile == b.inner_tile && a.threads == b.threads &&
+           a.loop_order == b.loop_order;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 3)
+    {
+        std::cout<<"Error! You must pass two positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t dim = std::stoi(argv[1]);
+    int maxThreads = std::stoi(argv[2]);
+    int errors = 0;
+
+    Autotuner tuner(maxThreads, 1, false);
+    TuningConfig packed = tuner.tune<double>(TunedKernel::Packed, dim, dim, dim);
+    TuningConfig tiled = tuner.tune<float>(TunedKernel::Tiled, dim, dim, dim);
+
+    std::string filename = "UnitTest_autotuner_tuning.csv";
+    tuner.save(filename);
+
+    TuningTable loaded;
+    loaded.load(filename);
+    std::remove(filename.c_str());
+
+    TuningConfig config;
+    bool found = loaded.lookup(TunedKernel::Packed, sizeof(double), dim, dim, dim, config);
+    std::cout<<"Packed entry found after reload: "<<found<<std::endl;
+    errors += !found || !same_config(config, packed);
+    found = loaded.lookup(TunedKernel::Tiled, sizeof(float), dim, dim, dim, config);
+    std::cout<<"Tiled entry found after reload: "<<found<<std::endl;
+    errors += !found || !same_config(config, tiled);
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    // From now on the kernels of this process run with the tuned configurations
+    tuner.install();
+    int64_t time;
+
+    MatrixFlat<double> A(dim, dim, -10, 10);
+    MatrixFlat<double> B(dim, dim, -10, 10);
+    MatrixFlat<double> C(dim, dim);
+    MatrixFlat<double> Cblas(dim, dim);
+    mmm_packed(A, B, C, time);
+    mmm_blas(A, B, Cblas, time);
+    double err = max_relative_error(C, Cblas);
+    std::cout<<"mmm_packed max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > 1e-12;
+
+    MatrixFlat<float> Af(dim, dim, -10, 10);
+    MatrixFlat<float> Bf(dim, dim, -10, 10);
+    MatrixFlat<float> Cf(dim, dim);
+    MatrixFlat<float> Cblasf(dim, dim);
+    mmm_multiT(Af, Bf, Cf, time, 0);
+    mmm_blas(Af, Bf, Cblasf, time);
+    float errf = max_relative_error(Cf, Cblasf);
+    std::cout<<"mmm_multiT max|C-Cblas| / max|Cblas|: "<<errf<<std::endl;
+    errors += errf > 1e-4;
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
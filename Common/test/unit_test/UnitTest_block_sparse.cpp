@@ -0,0 +1,127 @@
+#include "../../include/MatrixFlat.hpp"
+#include "../../include/block_sparse.hpp"
+#include "../../include/gemv.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the block-sparse (BSR) weights: the block pruning and the three kernels of the
+ * training on the blocks left.
+ * A random ROWSxCOLUMNS matrix is pruned to the given sparsity (fraction of the blocks removed) for a few block shapes:
+ * the pattern must have the expected number of blocks, the pruned blocks must be 0 and pack_blocks / unpack_blocks
+ * must give back the pruned matrix. The kernels are compared with the dense gemv and ger on the pruned matrix, in
+ * both double & single precision:
+ *     bsr_gemv Trans:    y += x * A        (forward pass)
+ *     bsr_gemv NoTrans:  y += A * x        (backward pass)
+ *     bsr_ger:           A += 0.5 * x * y^T on the stored blocks (gradient), the padding of the blocks must stay 0
+ * The time of the block-sparse forward product is compared with the dense one, it should scale with the density.
+ * The instruction set can be lowered with NNET_SIMD=avx2|sse4|scalar to test the scalar kernels.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_block_sparse
+ *
+ * To run this test you have to pass the rows and the columns of the matrix, the sparsity and the number of threads
+ *
+ */
+
+//! Microseconds taken by f
+template<typename F>
+int64_t time_us(F f){
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+template<typename T>
+int check(std::size_t rows, std::size_t columns, std::size_t block_rows, std::size_t block_cols, float sparsity,
+          int numThreads, T tolerance){
+
+    int errors = 0;
+    std::cout<<"Blocks of "<<block_rows<<"X"<<block_cols<<std::endl;
+
+    MatrixFlat<T> A(rows, columns, -10, 10);
+    const BlockPattern p = prune_blocks(A.get_ptr(), rows, columns, block_rows, block_cols, sparsity);
+    const std::size_t total = p.block_row_count() * p.block_col_count();
+    const std::size_t expected = std::max<std::size_t>(1, std::llround((1.0 - sparsity) * total));
+    std::cout<<p.nblocks()<<" blocks kept of "<<total<<" (density "<<p.density()<<")"<<std::endl;
+    errors += p.nblocks() != expected;
+
+    // the blocks that are left are exactly the non-zero ones, and packing is reversible
+    const std::vector<T> values = pack_blocks(p, A.get_ptr(), columns);
+    const BlockPattern nonzero = block_pattern(A.get_ptr(), rows, columns, block_rows, block_cols);
+    MatrixFlat<T> back(rows, columns);
+    unpack_blocks(p, values.data(), back.get_ptr(), columns);
+    int wrong = nonzero.col_idx != p.col_idx || nonzero.row_ptr != p.row_ptr;
+    for (std::size_t i = 0; i < rows * columns; i++)
+        wrong += back[i] != A[i];
+    std::cout<<"Pattern and packing: "<<wrong<<" wrong elements"<<std::endl;
+    errors += wrong != 0;
+
+    MatrixFlat<T> x(columns, 1, -10, 10);
+    MatrixFlat<T> xt(rows, 1, -10, 10);
+
+    // y += x * A
+    MatrixFlat<T> y(columns, 1, -10, 10);
+    MatrixFlat<T> ydense = y;
+    const int64_t time = time_us([&]{bsr_gemv(Trans, p, values.data(), xt.get_ptr(), y.get_ptr(), numThreads);});
+    const int64_t time_dense = time_us([&]{gemv(Trans, rows, columns, A.get_ptr(), columns, xt.get_ptr(), ydense.get_ptr(), numThreads);});
+    T err = max_relative_error(y.get_ptr(), ydense.get_ptr(), columns);
+    std::cout<<"bsr_gemv Trans max|y-ydense| / max|ydense|: "<<err<<" in "<<time<<" us (dense "<<time_dense<<" us)"<<std::endl;
+    errors += err > tolerance;
+
+    // y += A * x
+    MatrixFlat<T> yt(rows, 1, -10, 10);
+    MatrixFlat<T> ytdense = yt;
+    bsr_gemv(NoTrans, p, values.data(), x.get_ptr(), yt.get_ptr(), numThreads);
+    gemv(NoTrans, rows, columns, A.get_ptr(), columns, x.get_ptr(), ytdense.get_ptr(), numThreads);
+    err = max_relative_error(yt.get_ptr(), ytdense.get_ptr(), rows);
+    std::cout<<"bsr_gemv NoTrans max|y-ydense| / max|ydense|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // A += 0.5 * xt * x^T on the stored blocks: the reference is the dense ger, restricted to the blocks of the pattern
+    std::vector<T> updated = values;
+    bsr_ger(p, T(0.5), xt.get_ptr(), x.get_ptr(), updated.data(), numThreads);
+    ger(rows, columns, T(0.5), xt.get_ptr(), x.get_ptr(), A.get_ptr(), columns, numThreads);
+    const std::vector<T> reference = pack_blocks(p, A.get_ptr(), columns);
+    err = max_relative_error(updated.data(), reference.data(), reference.size());
+    std::cout<<"bsr_ger max|A-Adense| / max|Adense|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 5)
+    {
+        std::cout<<"Error! You must pass four positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t columns = std::stoi(argv[2]);
+    float sparsity = std::stof(argv[3]);
+    int numThreads = std::stoi(argv[4]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrix will be of dimensions: "<<rows<<"X"<<columns<<" with block sparsity "<<sparsity<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(rows, columns, 4, 8, sparsity, numThreads, 1e-12);
+    errors += check<double>(rows, columns, 8, 16, sparsity, numThreads, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(rows, columns, 4, 8, sparsity, numThreads, 1e-4);
+    errors += check<float>(rows, columns, 8, 8, sparsity, numThreads, 1e-4);
+    errors += check<float>(rows, columns, 3, 32, sparsity, numThreads, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
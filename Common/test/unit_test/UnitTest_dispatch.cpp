@@ -0,0 +1,140 @@
+#include "../../include/kernel_dispatch.hpp"
+#include "../../include/matrixProd_VM_VV.hpp"
+#include "../../include/cpu_features.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+/*
+ * This test has the scope of validate the kernel dispatcher of mul_funct (see kernel_dispatch.hpp): every candidate
+ * kernel of a shape computes c += op(a) * op(b), compared with the naive product, for the four combinations of
+ * transpose flags, on the M x N * N x NB product and on its vector shapes (1 x N * N x NB, M x 1 * 1 x NB and
+ * M x N * N x 1), in both double & single precision. Then the shapes are planned, for every pair of transpose flags,
+ * with the cost model and with the benchmark: the plan must be one of the candidates and the cache must give back the
+ * same plan. The calibrated costs and the plans, with the predicted and the measured times, are printed.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_dispatch
+ *
+ * To run this test you have to pass the rows of A (M), the columns of A (N), the columns of B (NB)
+ *
+ */
+
+template<typename T>
+std::vector<T> random_vector(std::size_t size, std::mt19937& gen){
+    std::uniform_real_distribution<T> dist(-10, 10);
+    std::vector<T> v(size);
+    for (T& x : v)
+        x = dist(gen);
+    return v;
+}
+
+std::string plan_string(const MulPlan& plan){
+    return mul_kernel_name(plan.kernel) + " on " + std::to_string(plan.threads) + " threads";
+}
+
+//! Every candidate of the shape against the naive product
+template<typename T>
+int check_candidates(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB, T tolerance){
+
+    int errors = 0;
+    int64_t time;
+    std::mt19937 gen(44);
+    const std::vector<T> a = random_vector<T>(m * n, gen), b = random_vector<T>(n * nb, gen), c0 = random_vector<T>(m * nb, gen);
+    std::vector<T> cref(c0);
+    MatrixNaiveTrans<T>(a, b, cref, m, n, nb, transA, transB, time);
+
+    for (const MulPlan& candidate : mul_candidates<T>(m, n, nb)) {
+        std::vector<T> c(c0);
+        run_product(candidate, a, b, c, m, n, nb, transA, transB);
+        const T err = max_relative_error(c, cref);
+        std::cout<<(transA == Trans ? "T" : "N")<<(transB == Trans ? "T" : "N")<<" "<<m<<"X"<<n<<" * "<<n<<"X"<<nb
+                 <<", "<<plan_string(candidate)<<", max|C-Cref| / max|Cref|: "<<err<<std::endl;
+        errors += err > tolerance;
+    }
+    return errors;
+}
+
+//! Plans of the shape with both modes, and from the cache
+template<typename T>
+int check_plans(std::size_t m, std::size_t n, std::size_t nb, Transpose transA, Transpose transB){
+
+    int errors = 0;
+    const std::vector<MulPlan> candidates = mul_candidates<T>(m, n, nb);
+    for (DispatchMode mode : {DispatchMode::CostModel, DispatchMode::Benchmark}) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        const MulPlan plan = plan_product<T>(m, n, nb, transA, transB, mode);
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        bool found = false;
+        for (const MulPlan& candidate : candidates)
+            found |= candidate.kernel == plan.kernel && candidate.threads == plan.threads;
+        std::cout<<(mode == DispatchMode::CostModel ? "cost model" : "benchmark")<<" plan of "
+                 <<(transA == Trans ? "T" : "N")<<(transB == Trans ? "T " : "N ")<<m<<"X"<<n<<" * "<<n<<"X"<<nb
+                 <<": "<<plan_string(plan)<<", "<<(mode == DispatchMode::CostModel ? "predicted " : "measured ")
+                 <<plan.time_us<<" [us], planned in "
+                 <<std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()<<" [us]"<<std::endl;
+        errors += !found;
+    }
+
+    const MulPlan first = product_plan<T>(m, n, nb, transA, transB), second = product_plan<T>(m, n, nb, transA, transB);
+    errors += first.kernel != second.kernel || first.threads != second.threads || first.time_us != second.time_us;
+    return errors;
+}
+
+template<typename T>
+int check_all(std::size_t m, std::size_t n, std::size_t nb, T tolerance){
+
+    int errors = 0;
+    const std::size_t shapes[4][3] = {{m, n, nb}, {1, n, nb}, {m, 1, nb}, {m, n, 1}};
+    for (const auto& shape : shapes)
+        for (Transpose transA : {NoTrans, Trans})
+            for (Transpose transB : {NoTrans, Trans})
+                errors += check_candidates<T>(shape[0], shape[1], shape[2], transA, transB, tolerance);
+
+    const char* class_names[4] = {"matrix", "row vector", "outer product", "column vector"};
+    for (const auto& shape : shapes)
+        for (Transpose transA : {NoTrans, Trans})
+            for (Transpose transB : {NoTrans, Trans}) {
+                const ShapeClass sc = shape_class(shape[0], shape[1], shape[2]);
+                for (const MulPlan& candidate : mul_candidates<T>(shape[0], shape[1], shape[2])) {
+                    const KernelCost cost = kernel_cost<T>(candidate, sc, transA, transB);
+                    std::cout<<"cost of "<<plan_string(candidate)<<" on "<<(transA == Trans ? "T" : "N")
+                             <<(transB == Trans ? "T " : "N ")<<class_names[static_cast<int>(sc)]<<" shapes: "
+                             <<cost.overhead_us<<" [us] + flops / "<<cost.flops_per_us<<" [flops/us]"<<std::endl;
+                    errors += cost.flops_per_us <= 0 || cost.overhead_us < 0;
+                }
+                errors += check_plans<T>(shape[0], shape[1], shape[2], transA, transB);
+            }
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t m = std::stoi(argv[1]);
+    size_t n = std::stoi(argv[2]);
+    size_t nb = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<m<<"X"<<n<<" * "<<n<<"X"<<nb<<" ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_all<double>(m, n, nb, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_all<float>(m, n, nb, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,153 @@
+#include "../../include/gemm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/matrix_layout.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the gemm providers (see gemm.hpp): C = alpha * op(A) * op(B) + beta * C is
+ * computed by every registered provider (packed, avx, naive and blas, linked with mmm_blas) for the four combinations
+ * of transpose flags, and compared with the naive reference, in both double & single precision.
+ * The operands are blocks inside larger matrices (pointer to the first element and the leading dimension of the
+ * matrix), so the products read and write them in place: the elements of C around the block must not change.
+ * With beta = 0 the elements of C before the product must not change the result.
+ * With alpha = 1e-30, beta = 1 and C = 1e10 every provider, and the tiled layout, must give back C (no overflow).
+ * The MatrixFlat / MatrixView version and the errors (unknown provider, leading dimension too small) are checked too.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_gemm
+ *
+ * To run this test you have to pass the rows of op(A), the columns of op(A) (= rows of op(B)), the columns of op(B)
+ *
+ */
+
+//! op(A) M x K is the block at (1, 2) of a larger matrix, B and C the same: the leading dimensions are not the widths
+template<typename T>
+int check(const std::string& provider, Transpose transA, Transpose transB, std::size_t M, std::size_t N, std::size_t K,
+          T alpha, T beta, T tolerance){
+
+    const std::size_t rowsA = transA == Trans ? K : M, colsA = transA == Trans ? M : K;
+    const std::size_t rowsB = transB == Trans ? N : K, colsB = transB == Trans ? K : N;
+    MatrixFlat<T> A(rowsA + 3, colsA + 5, -10, 10);
+    MatrixFlat<T> B(rowsB + 3, colsB + 5, -10, 10);
+    MatrixFlat<T> C(M + 3, N + 5, -10, 10);
+    MatrixFlat<T> Cref(C);
+
+    const T* a = A.get_ptr() + A.ncols() + 2;
+    const T* b = B.get_ptr() + B.ncols() + 2;
+    gemm<T>("naive", transA, transB, M, N, K, alpha, a, A.ncols(), b, B.ncols(), beta, Cref.get_ptr() + Cref.ncols() + 2, Cref.ncols());
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    int errors = !gemm<T>(provider, transA, transB, M, N, K, alpha, a, A.ncols(), b, B.ncols(), beta, C.get_ptr() + C.ncols() + 2, C.ncols());
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    const T err = max_relative_error(C, Cref);
+    std::cout<<provider<<(transA == Trans ? " T" : " N")<<(transB == Trans ? "T" : "N")<<" alpha = "<<alpha<<", beta = "<<beta
+             <<" took: "<<std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()<<" [ms], max|C-Cref| / max|Cref|: "<<err<<std::endl;
+    errors += err > tolerance;
+    return errors;
+}
+
+//! alpha * op(A) * op(B) is far below the precision of C = 1e10, which must come back unchanged: a provider that
+//! divides C by alpha overflows
+template<typename T>
+int check_tiny_alpha(std::size_t M, std::size_t N, std::size_t K, T tolerance){
+
+    int errors = 0;
+    const T alpha = T(1e-30), big = T(1e10);
+    MatrixFlat<T> A(M, K, -10, 10), B(K, N, -10, 10), C0(M, N);
+    std::fill(C0.get_ptr(), C0.get_ptr() + M * N, big);
+    MatrixFlat<T> Cref(C0);
+    gemm<T>("naive", NoTrans, NoTrans, M, N, K, alpha, A.get_ptr(), K, B.get_ptr(), N, T(1), Cref.get_ptr(), N);
+
+    for (const std::string& provider : gemm_providers()) {
+        MatrixFlat<T> C(C0);
+        errors += !gemm<T>(provider, NoTrans, NoTrans, M, N, K, alpha, A.get_ptr(), K, B.get_ptr(), N, T(1), C.get_ptr(), N);
+        const T err = max_relative_error(C, Cref);
+        std::cout<<provider<<" alpha = "<<alpha<<", beta = 1, C = "<<big<<", max|C-Cref| / max|Cref|: "<<err<<std::endl;
+        errors += !(err <= tolerance);
+    }
+    MatrixFlat<T> Ctiled = to_layout(C0, Layout::Tiled);
+    errors += !gemm<T>(NoTrans, NoTrans, alpha, A, B, T(1), Ctiled);
+    const T err = max_relative_error(Ctiled, Cref);
+    std::cout<<"tiled alpha = "<<alpha<<", beta = 1, C = "<<big<<", max|C-Cref| / max|Cref|: "<<err<<std::endl;
+    errors += !(err <= tolerance);
+    return errors;
+}
+
+template<typename T>
+int check_all(std::size_t M, std::size_t N, std::size_t K, T tolerance){
+
+    int errors = 0;
+    std::cout<<"Providers:";
+    for (const std::string& provider : gemm_providers())
+        std::cout<<" "<<provider;
+    std::cout<<std::endl;
+
+    for (const std::string& provider : gemm_providers())
+        for (Transpose transA : {NoTrans, Trans})
+            for (Transpose transB : {NoTrans, Trans}) {
+                errors += check<T>(provider, transA, transB, M, N, K, T(1), T(1), tolerance);
+                errors += check<T>(provider, transA, transB, M, N, K, T(1.5), T(-0.5), tolerance);
+                errors += check<T>(provider, transA, transB, M, N, K, T(-2), T(0), tolerance);
+            }
+    errors += check_tiny_alpha<T>(M, N, K, tolerance);
+
+    // the current provider on whole matrices and on blocks
+    MatrixFlat<T> A(M, K, -10, 10), B(K, N, -10, 10), C(M, N), Cblas(M, N);
+    int64_t time;
+    mmm_blas(A, B, Cblas, time);
+    errors += !gemm<T>(NoTrans, NoTrans, T(1), A, B, T(0), C);
+    T err = max_relative_error(C, Cblas);
+    std::cout<<"gemm on MatrixFlat ("<<gemm_provider()<<"), max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    if (M > 1 && N > 1) {
+        // the top left block of C is the product of the first rows of A and the first columns of B
+        MatrixFlat<T> Cblock(M, N);
+        errors += !gemm<T>(NoTrans, NoTrans, T(1), A.block(0, 0, M / 2, K), B.block(0, 0, K, N / 2), T(0), Cblock.block(0, 0, M / 2, N / 2));
+        T max_err = 0;
+        for (std::size_t i = 0; i < M; i++)
+            for (std::size_t j = 0; j < N; j++)
+                max_err = std::max<T>(max_err, std::abs(Cblock(i, j) - (i < M / 2 && j < N / 2 ? Cblas(i, j) : T(0))));
+        std::cout<<"gemm on blocks, max|C-Cblas|: "<<max_err<<std::endl;
+        errors += max_err > tolerance * 1000 * K;
+    }
+
+    std::cout<<"Expected errors: "<<std::endl;
+    errors += gemm<T>("unknown", NoTrans, NoTrans, M, N, K, T(1), A.get_ptr(), K, B.get_ptr(), N, T(0), C.get_ptr(), N);
+    errors += gemm<T>(NoTrans, NoTrans, M, N, K + 1, T(1), A.get_ptr(), K, B.get_ptr(), N, T(0), C.get_ptr(), N);
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_all<double>(rows, columns, inners, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_all<float>(rows, columns, inners, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
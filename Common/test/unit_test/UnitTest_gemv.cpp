@@ -0,0 +1,115 @@
+#include "../../include/gemv.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "test_utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the gemv and ger kernels.
+ * We test if the functions work, in both double & single precision, comparing the result with the openBlas
+ * matrix-matrix multiplication on the same shapes (a matrix times a column, a row times a matrix, a column times
+ * a row). Both gemv variants are checked:
+ *     NoTrans: y += A * x     with A MxN, x N long
+ *     Trans:   y += A^T * x   with A MxN, x M long   (the row-vector times matrix of the forward pass)
+ * and ger is checked in its accumulate form A += alpha * x * y^T, starting from a non zero A.
+ * The forward pass of a dense layer is checked too: gemv Trans with the epilogue y += bias, h = tanh(y) and
+ * dact = 1 - h^2 (see epilogue.hpp), against openBlas followed by the same operations.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_gemv
+ *
+ * To run this test you have to pass the rows and the columns of the matrix and the number of threads
+ *
+ */
+
+template<typename T>
+int check(std::size_t rows, std::size_t columns, int numThreads, T tolerance){
+
+    int errors = 0;
+    int64_t time;
+
+    MatrixFlat<T> A(rows, columns, -10, 10);
+    MatrixFlat<T> x(columns, 1, -10, 10);
+    MatrixFlat<T> xt(rows, 1, -10, 10);
+
+    // y += A * x
+    MatrixFlat<T> y(rows, 1);
+    MatrixFlat<T> yblas(rows, 1);
+    gemv(NoTrans, rows, columns, A.get_ptr(), columns, x.get_ptr(), y.get_ptr(), numThreads);
+    mmm_blas(A, x, yblas, time);
+    T err = max_relative_error(y, yblas);
+    std::cout<<"gemv NoTrans max|y-yblas| / max|yblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // y += A^T * x
+    MatrixFlat<T> yt(columns, 1);
+    MatrixFlat<T> ytblas(columns, 1);
+    gemv(Trans, rows, columns, A.get_ptr(), columns, xt.get_ptr(), yt.get_ptr(), numThreads);
+    mmm_blas(A, xt, ytblas, time, Trans, NoTrans);
+    err = max_relative_error(yt, ytblas);
+    std::cout<<"gemv Trans max|y-yblas| / max|yblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // A += 0.5 * xt * x^T, the reference is A + 0.5 * (xt * x^T) computed by blas
+    MatrixFlat<T> outer(rows, columns);
+    MatrixFlat<T> expected(rows, columns);
+    mmm_blas(xt, x, outer, time, NoTrans, Trans);
+    for (std::size_t i = 0; i < rows * columns; i++)
+        expected[i] = A[i] + T(0.5) * outer[i];
+    ger(rows, columns, T(0.5), xt.get_ptr(), x.get_ptr(), A.get_ptr(), columns, numThreads);
+    err = max_relative_error(A, expected);
+    std::cout<<"ger max|A-Ablas| / max|Ablas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // z += A^T * x + bias, h = tanh(z), dact = tanh'(z) in one call
+    MatrixFlat<T> bias(columns, 1, -10, 10);
+    MatrixFlat<T> z(columns, 1), h(columns, 1), dact(columns, 1);
+    MatrixFlat<T> zblas(columns, 1), hblas(columns, 1), dactblas(columns, 1);
+    Epilogue<T> epilogue;
+    epilogue.bias = bias.get_ptr();
+    epilogue.activation = Activation::Tanh;
+    epilogue.h = h.get_ptr();
+    epilogue.dact = dact.get_ptr();
+    gemv(Trans, rows, columns, A.get_ptr(), columns, xt.get_ptr(), z.get_ptr(), epilogue, numThreads);
+    mmm_blas(A, xt, zblas, time, Trans, NoTrans);
+    for (std::size_t j = 0; j < columns; j++) {
+        zblas[j] += bias[j];
+        hblas[j] = std::tanh(zblas[j]);
+        dactblas[j] = 1 - hblas[j] * hblas[j];
+    }
+    err = std::max({max_relative_error(z, zblas), max_relative_error(h, hblas), max_relative_error(dact, dactblas)});
+    std::cout<<"gemv Trans + epilogue max|z-zblas| / max|zblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t columns = std::stoi(argv[2]);
+    int numThreads = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrix will be of dimensions: "<<rows<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(rows, columns, numThreads, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(rows, columns, numThreads, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
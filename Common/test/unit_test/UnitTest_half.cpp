@@ -0,0 +1,171 @@
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/gemv.hpp"
+#include "../../include/half.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the 16 bit storage types (bf16_t, fp16_t) and the kernels that read them.
+ * First the scalar conversions are checked on values whose result is known bit by bit (rounding to nearest even,
+ * overflow, subnormals), then the bulk conversions are compared with the scalar ones.
+ * The products (mmm_packed and gemv, both variants) with 16 bit operands are compared with the openBlas product of
+ * the same operands widened to float: the conversion is exact, so the only difference is the order of the fp32
+ * additions and the tolerance is the single precision one.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_half
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B), the columns of B and
+ * the number of threads
+ *
+ */
+
+template<typename H>
+int check_bits(const char* name, float value, std::uint16_t expected){
+    const std::uint16_t bits = H(value).bits;
+    if (bits == expected)
+        return 0;
+    std::cout<<"Error: "<<name<<"("<<value<<") = 0x"<<std::hex<<bits<<", expected 0x"<<expected<<std::dec<<std::endl;
+    return 1;
+}
+
+int check_scalar(){
+    int errors = 0;
+
+    errors += check_bits<bf16_t>("bfloat16", 1.0f, 0x3F80);
+    errors += check_bits<bf16_t>("bfloat16", -2.0f, 0xC000);
+    errors += check_bits<bf16_t>("bfloat16", 1.00390625f, 0x3F80);     // tie 1 + 2^-8: to even (down)
+    errors += check_bits<bf16_t>("bfloat16", 1.01171875f, 0x3F82);     // tie 1 + 3*2^-8: to even (up)
+    errors += check_bits<bf16_t>("bfloat16", 1.0041f, 0x3F81);         // above the tie: up
+
+    errors += check_bits<fp16_t>("float16", 1.0f, 0x3C00);
+    errors += check_bits<fp16_t>("float16", -2.0f, 0xC000);
+    errors += check_bits<fp16_t>("float16", 65504.0f, 0x7BFF);          // largest finite
+    errors += check_bits<fp16_t>("float16", 65520.0f, 0x7C00);          // rounds to inf
+    errors += check_bits<fp16_t>("float16", 1.00048828125f, 0x3C00);    // tie 1 + 2^-11: to even (down)
+    errors += check_bits<fp16_t>("float16", 1.00146484375f, 0x3C02);    // tie 1 + 3*2^-11: to even (up)
+    errors += check_bits<fp16_t>("float16", 5.9604644775390625e-8f, 0x0001);   // smallest subnormal
+    errors += check_bits<fp16_t>("float16", 6.103515625e-5f, 0x0400);          // smallest normal
+    errors += check_bits<fp16_t>("float16", 2.98e-8f, 0x0000);                 // below half the smallest subnormal
+
+    // the way back is exact
+    for (std::uint32_t bits = 0; bits < 0x10000; bits++) {
+        const fp16_t h = fp16_t::from_bits(static_cast<std::uint16_t>(bits));
+        if ((bits & 0x7C00) != 0x7C00 && fp16_t(float(h)).bits != bits) {
+            std::cout<<"Error: float16 0x"<<std::hex<<bits<<std::dec<<" does not survive the round trip"<<std::endl;
+            errors++;
+        }
+        const bf16_t b = bf16_t::from_bits(static_cast<std::uint16_t>(bits));
+        if ((bits & 0x7F80) != 0x7F80 && bf16_t(float(b)).bits != bits) {
+            std::cout<<"Error: bfloat16 0x"<<std::hex<<bits<<std::dec<<" does not survive the round trip"<<std::endl;
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+template<typename H>
+int check_bulk(const char* name, std::size_t n){
+    MatrixFlat<float> source(1, n, -100, 100);
+    std::vector<H> converted(n);
+    std::vector<float> back(n);
+    convert(source.get_ptr(), converted.data(), n);
+    convert(converted.data(), back.data(), n);
+
+    int errors = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        // the AVX512-BF16 conversion flushes the subnormals, none of them is generated here
+        errors += converted[i].bits != H(source[i]).bits;
+        errors += back[i] != float(converted[i]);
+    }
+    std::cout<<"Bulk conversion "<<name<<" of "<<n<<" elements: "<<errors<<" errors"<<std::endl;
+    return errors;
+}
+
+template<typename H>
+MatrixFlat<float> widen(const MatrixFlat<H>& M){
+    MatrixFlat<float> W(M.nrows(), M.ncols());
+    convert(M.get_ptr(), W.get_ptr(), M.nrows() * M.ncols());
+    return W;
+}
+
+template<typename H>
+int check_products(const char* name, std::size_t rows, std::size_t inners, std::size_t columns, int numThreads){
+
+    int64_t time;
+    int errors = 0;
+    const float tolerance = 1e-5;
+
+    MatrixFlat<H> A(rows, inners, -10, 10);
+    MatrixFlat<H> B(inners, columns, -10, 10);
+    MatrixFlat<float> Af = widen(A);
+    MatrixFlat<float> Bf = widen(B);
+
+    MatrixFlat<float> C(rows, columns);
+    MatrixFlat<float> Cblas(rows, columns);
+    mmm_blas(Af, Bf, Cblas, time);
+    std::cout<<"openBlas took: "<<time<< " [ms]"<<std::endl;
+    mmm_packed(A, B, C, time, numThreads);
+    std::cout<<"This operation took: "<<time<< " [ms]"<<std::endl;
+    float err = max_relative_error(C, Cblas);
+    std::cout<<"mmm_packed "<<name<<" max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // gemv with A as the matrix: y += A * x and y += A^T * x
+    MatrixFlat<float> x(inners, 1, -10, 10);
+    MatrixFlat<float> y(rows, 1);
+    MatrixFlat<float> yblas(rows, 1);
+    mmm_blas(Af, x, yblas, time);
+    gemv(NoTrans, rows, inners, A.get_ptr(), inners, x.get_ptr(), y.get_ptr(), numThreads);
+    err = max_relative_error(y, yblas);
+    std::cout<<"gemv NoTrans "<<name<<" max|y-yblas| / max|yblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    MatrixFlat<float> xt(1, rows, -10, 10);
+    MatrixFlat<float> yt(1, inners);
+    MatrixFlat<float> ytblas(1, inners);
+    mmm_blas(xt, Af, ytblas, time);
+    gemv(Trans, rows, inners, A.get_ptr(), inners, xt.get_ptr(), yt.get_ptr(), numThreads);
+    err = max_relative_error(yt, ytblas);
+    std::cout<<"gemv Trans "<<name<<" max|y-yblas| / max|yblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 5)
+    {
+        std::cout<<"Error! You must pass four positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+    int numThreads = std::stoi(argv[4]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = check_scalar();
+    std::cout<<"Scalar conversions: "<<errors<<" errors"<<std::endl;
+    errors += check_bulk<bf16_t>("bfloat16", rows * inners + 7);
+    errors += check_bulk<fp16_t>("float16", rows * inners + 7);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"bfloat16"<<std::endl;
+    errors += check_products<bf16_t>("bfloat16", rows, inners, columns, numThreads);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"float16"<<std::endl;
+    errors += check_products<fp16_t>("float16", rows, inners, columns, numThreads);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,168 @@
+#include "../../include/matrix_layout.hpp"
+#include "../../include/gemm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+/*
+ * This test has the scope of validate the layouts of MatrixFlat (layout.hpp, matrix_layout.hpp): a random row-major
+ * matrix is converted to every layout and back (the elements must be exactly the same, through operator() and after
+ * the round trip), used in element-wise expressions and products with matrices in the other layouts, and saved and
+ * mapped again in its layout; a matrix in another layout assigned to the mapped file is reordered into the layout of
+ * the file. Then gemm (gemm.hpp) computes C = alpha * op(A) * op(B) + beta * C for every combination
+ * of layouts of A, B and C and of transpose flags, compared with openBlas on the row-major matrices, in both
+ * double & single precision. The time of the product in each combination of layouts is printed.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_layout
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B), the columns of B
+ *
+ */
+
+const Layout layouts[] = {Layout::RowMajor, Layout::ColMajor, Layout::Tiled};
+
+template<typename T>
+int count_differences(const MatrixFlat<T>& A, const MatrixFlat<T>& B){
+    int differences = 0;
+    for (std::size_t i = 0; i < A.nrows(); i++)
+        for (std::size_t j = 0; j < A.ncols(); j++)
+            differences += A(i, j) != B(i, j);
+    return differences;
+}
+
+//! Conversions, element access, expressions and files on a rows x cols matrix
+template<typename T>
+int check_conversions(std::size_t rows, std::size_t cols, T tolerance){
+
+    int errors = 0;
+    const MatrixFlat<T> A(rows, cols, -10, 10), B(cols, rows, -10, 10);
+    const MatrixFlat<T> sum = A + A * T(2), product = A * B;
+
+    for (Layout from : layouts)
+        for (Layout to : layouts) {
+            const MatrixFlat<T> X = to_layout(A, from);
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            const MatrixFlat<T> Y = to_layout(X, to);
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            const MatrixFlat<T> back = to_layout(Y, Layout::RowMajor);
+            int differences = count_differences(Y, A) + (Y.layout() != to);
+            for (std::size_t i = 0; i < rows * cols; i++)
+                differences += back[i] != A[i];
+            std::cout<<layout_name(from)<<" -> "<<layout_name(to)<<" took: "
+                     <<std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()<<" [us], differences: "<<differences<<std::endl;
+            errors += differences != 0;
+        }
+
+    for (Layout layout : layouts) {
+        // the expressions read the elements through the layout, and their result is row-major
+        const MatrixFlat<T> X = to_layout(A, layout), Y = to_layout(B, layout);
+        MatrixFlat<T> S = X + to_layout(A, Layout::ColMajor) * T(2);
+        MatrixFlat<T> P = X * Y;
+        T err = std::max(max_relative_error(S, sum), max_relative_error(P, product));
+        MatrixFlat<T> Z = to_layout(A, layout);
+        Z += A * T(2);
+        err = std::max(err, max_relative_error(Z, sum));
+        std::cout<<"expressions on "<<layout_name(layout)<<" matrices, max relative error: "<<err<<std::endl;
+        errors += err > tolerance || S.layout() != Layout::RowMajor;
+
+        // the file keeps the layout
+        const std::string path = "UnitTest_layout.mat";
+        errors += !X.save(path);
+        const MatrixFlat<T> M = MatrixFlat<T>::map(path);
+        const int differences = count_differences(M, A) + (M.layout() != layout);
+        std::cout<<"saved and mapped "<<layout_name(layout)<<" matrix, differences: "<<differences<<std::endl;
+        errors += differences != 0;
+
+        // a matrix in another layout assigned to the file mapped ReadWrite is reordered into the layout of the file
+        {
+            MapOptions options;
+            options.mode = MapMode::ReadWrite;
+            MatrixFlat<T> W = MatrixFlat<T>::map(path, options);
+            const MatrixFlat<T> other = to_layout(sum, layout == Layout::ColMajor ? Layout::Tiled : Layout::ColMajor);
+            W = other;
+            W.mapped_file()->sync();
+        }
+        const MatrixFlat<T> R = MatrixFlat<T>::map(path);
+        const int rewritten = count_differences(R, sum) + (R.layout() != layout);
+        std::cout<<"assigned to the mapped "<<layout_name(layout)<<" matrix, differences: "<<rewritten<<std::endl;
+        errors += rewritten != 0;
+        std::remove(path.c_str());
+    }
+
+    return errors;
+}
+
+//! gemm on every combination of layouts and transpose flags
+template<typename T>
+int check_gemm(std::size_t M, std::size_t N, std::size_t K, T tolerance){
+
+    int errors = 0;
+    int64_t time;
+    for (Transpose transA : {NoTrans, Trans})
+        for (Transpose transB : {NoTrans, Trans}) {
+            // op(A) is M x K and op(B) K x N, the reference is computed on the row-major op(A) and op(B)
+            const MatrixFlat<T> A(transA == Trans ? K : M, transA == Trans ? M : K, -10, 10);
+            const MatrixFlat<T> B(transB == Trans ? N : K, transB == Trans ? K : N, -10, 10);
+            const MatrixFlat<T> C0(M, N, -10, 10);
+            const MatrixFlat<T> opA = transA == Trans ? to_layout(A, Layout::ColMajor) : A;
+            const MatrixFlat<T> opB = transB == Trans ? to_layout(B, Layout::ColMajor) : B;
+            MatrixFlat<T> Cref(M, N);
+            MatrixFlat<T> opAr(M, K, std::vector<T>(opA.get_ptr(), opA.get_ptr() + M * K));
+            MatrixFlat<T> opBr(K, N, std::vector<T>(opB.get_ptr(), opB.get_ptr() + K * N));
+            mmm_blas(opAr, opBr, Cref, time);
+            for (std::size_t i = 0; i < M * N; i++)
+                Cref[i] = T(1.5) * Cref[i] - T(0.5) * C0[i];
+
+            for (Layout la : layouts)
+                for (Layout lb : layouts)
+                    for (Layout lc : layouts) {
+                        const MatrixFlat<T> Al = to_layout(A, la), Bl = to_layout(B, lb);
+                        MatrixFlat<T> C = to_layout(C0, lc);
+                        const auto t0 = std::chrono::high_resolution_clock::now();
+                        errors += !gemm<T>(transA, transB, T(1.5), Al, Bl, T(-0.5), C);
+                        const auto t1 = std::chrono::high_resolution_clock::now();
+                        const T err = max_relative_error(C, Cref);
+                        std::cout<<(transA == Trans ? "T" : "N")<<(transB == Trans ? "T" : "N")<<" A "<<layout_name(la)
+                                 <<", B "<<layout_name(lb)<<", C "<<layout_name(lc)<<" took: "
+                                 <<std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()
+                                 <<" [ms], max|C-Cref| / max|Cref|: "<<err<<std::endl;
+                        errors += err > tolerance || C.layout() != lc;
+                    }
+        }
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_conversions<double>(rows, inners, 1e-12);
+    errors += check_gemm<double>(rows, columns, inners, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_conversions<float>(rows, inners, 1e-4);
+    errors += check_gemm<float>(rows, columns, inners, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
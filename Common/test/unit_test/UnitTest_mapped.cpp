@@ -0,0 +1,133 @@
+#include "../../include/MatrixFlat.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+/*
+ * This test has the scope of validate the file storage of MatrixFlat (MatrixFlat::map, MatrixFlat::save).
+ * A random matrix is saved to a file, then mapped in every mode and compared with the original, in both double &
+ * single precision:
+ *     ReadOnly        the elements are the ones saved, a copy shares the mapping, an assignment moves it to the heap
+ *     CopyOnWrite     the elements written are seen by the matrix, the file does not change
+ *     ReadWrite       the elements written are in the file after sync, a new mapping reads them
+ *     raw             a file without header mapped with rows, columns and offset
+ * The time to map the file is compared with the time to read it in a MatrixFlat.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_mapped
+ *
+ * To run this test you have to pass the rows and the columns of the matrix
+ *
+ */
+
+//! Microseconds taken by f
+template<typename F>
+int64_t time_us(F f){
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+template<typename T>
+int report(const std::string& name, T err){
+    std::cout<<name<<": max relative error "<<err<<std::endl;
+    return err != 0;
+}
+
+template<typename T>
+int check_mapped(std::size_t rows, std::size_t columns){
+
+    int errors = 0;
+    const std::string path = "UnitTest_mapped.mat";
+
+    MatrixFlat<T> A(rows, columns, -10, 10);
+    if (!A.save(path))
+        return 1;
+
+    MatrixFlat<T> R = MatrixFlat<T>::map(path);
+    errors += !R.is_mapped() || R.nrows() != rows || R.ncols() != columns;
+    errors += report("ReadOnly", max_relative_error(R, A));
+    MatrixFlat<T> shared = R;
+    errors += !shared.is_mapped() || shared.get_ptr() != R.get_ptr();
+    std::cout<<"Copy of a ReadOnly matrix shares the mapping: "<<(shared.get_ptr() == R.get_ptr())<<std::endl;
+    shared = shared * 2;
+    errors += shared.is_mapped();
+    MatrixFlat<T> twice = A * 2;
+    errors += report("ReadOnly then assigned (heap)", max_relative_error(shared, twice));
+
+    MatrixFlat<T> W = MatrixFlat<T>::map(path, {MapMode::CopyOnWrite});
+    W = W * 2;
+    errors += !W.is_mapped();
+    errors += report("CopyOnWrite", max_relative_error(W, twice));
+    errors += report("CopyOnWrite, file unchanged", max_relative_error(MatrixFlat<T>::map(path), A));
+
+    MapOptions options;
+    options.mode = MapMode::ReadWrite;
+    options.advice = MapAdvice::Sequential;
+    options.populate = true;
+    {
+        MatrixFlat<T> S = MatrixFlat<T>::map(path, options);
+        S -= A;
+        S.mapped_file()->sync();
+    }
+    MatrixFlat<T> zero(rows, columns);
+    errors += report("ReadWrite, file written", max_relative_error(MatrixFlat<T>::map(path), zero));
+
+    // the elements of A after a header of another program
+    const std::string raw_path = "UnitTest_mapped.raw";
+    {
+        std::ofstream raw(raw_path, std::ios::binary | std::ios::trunc);
+        const char header[16] = {};
+        raw.write(header, sizeof(header));
+        raw.write(reinterpret_cast<const char*>(A.get_ptr()), rows * columns * sizeof(T));
+    }
+    errors += report("raw, offset 16", max_relative_error(MatrixFlat<T>::map(raw_path, rows, columns, 16), A));
+
+    A.save(path);
+    const int64_t time_map = time_us([&]{MatrixFlat<T> M = MatrixFlat<T>::map(path); R = M;});
+    const int64_t time_read = time_us([&]{
+        std::ifstream file(path, std::ios::binary);
+        MatrixFileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        MatrixFlat<T> M(header.rows, header.cols);
+        file.read(reinterpret_cast<char*>(M.get_ptr()), header.rows * header.cols * sizeof(T));
+        R = M;
+    });
+    std::cout<<"Mapped in "<<time_map<<" us, read in "<<time_read<<" us"<<std::endl;
+
+    std::remove(path.c_str());
+    std::remove(raw_path.c_str());
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 3)
+    {
+        std::cout<<"Error! You must pass two positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t columns = std::stoi(argv[2]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_mapped<double>(rows, columns);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_mapped<float>(rows, columns);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,114 @@
+#include "../../include/matrixProd_AVX.hpp"
+#include "../../include/cpu_features.hpp"
+#include "../../include/mmm_blas.hpp"
+#include <algorithm>
+#include <cmath>
+
+/*
+ * This test has the scope of validate the masked SIMD kernels of matrixProd_AVX (matrixMultMasked_*), the ones used
+ * by mul_funct when matrix_mul_optimisation is 2.
+ * We test if the functions work, in both double & single precision, comparing the result with the openBlas
+ * matrix-matrix multiplication. The kernels accumulate (c += a*b) so c starts from a non zero matrix, and c has a
+ * few sentinel elements after its end to check that the masked stores of the last columns never write outside it.
+ * Every instruction set supported by the CPU is tested, not only the one picked by the dispatcher.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_matrixMult_Masked
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B) and the columns of B; use
+ * dimensions that are not multiples of 16 to cover the masked tails
+ *
+ */
+
+template<typename T>
+using MaskedKernel = int (*)(const std::vector<T>&, const std::vector<T>&, std::vector<T>&, size_t, size_t, size_t, int64_t&);
+
+template<typename T>
+int check(const char* name, MaskedKernel<T> kernel, size_t rows, size_t inners, size_t columns, T tolerance){
+
+    const size_t sentinels = 16;
+    const T sentinel = T(12345);
+    int64_t time;
+
+    MatrixFlat<T> A(rows, inners, -10, 10);
+    MatrixFlat<T> B(inners, columns, -10, 10);
+    MatrixFlat<T> C0(rows, columns, -10, 10);
+    MatrixFlat<T> Cblas(rows, columns);
+    mmm_blas(A, B, Cblas, time);
+
+    std::vector<T> c(rows * columns + sentinels, sentinel);
+    for (size_t i = 0; i < rows * columns; i++)
+        c[i] = C0[i];
+
+    kernel(A.getMdata(), B.getMdata(), c, rows, inners, columns, time);
+
+    T max_err = 0, max_ref = 0;
+    for (size_t i = 0; i < rows * columns; i++) {
+        const T expected = C0[i] + Cblas[i];
+        max_err = std::max<T>(max_err, std::abs(c[i] - expected));
+        max_ref = std::max<T>(max_ref, std::abs(expected));
+    }
+    const T err = max_ref == 0 ? max_err : max_err / max_ref;
+    size_t overwritten = 0;
+    for (size_t i = rows * columns; i < c.size(); i++)
+        overwritten += c[i] != sentinel;
+
+    std::cout<<name<<" took: "<<time<<" [ms], max|C-Cblas| / max|Cblas|: "<<err
+             <<", sentinels overwritten: "<<overwritten<<std::endl;
+    return (err > tolerance) + (overwritten != 0);
+}
+
+template<typename T>
+int check_all(size_t rows, size_t inners, size_t columns, T tolerance){
+    const CpuFeatures& cpu = cpu_features();
+    int errors = 0;
+    if (cpu.sse4_2)
+        errors += check<T>("SSE4", matrixMultMasked_Sse<T>, rows, inners, columns, tolerance);
+    if (cpu.avx2 && cpu.fma)
+        errors += check<T>("AVX2", matrixMultMasked_Avx<T>, rows, inners, columns, tolerance);
+    if (cpu.avx512f)
+        errors += check<T>("AVX-512", matrixMultMasked_Avx512<T>, rows, inners, columns, tolerance);
+    if (simd_level() != SimdLevel::Scalar) {
+        errors += check<T>("matrixMultMasked_Simd", matrixMultMasked_Simd<T>, rows, inners, columns, tolerance);
+        return errors;
+    }
+    // at the scalar tier (e.g. NNET_SIMD=scalar) the dispatcher returns 0 and leaves c untouched, mul_funct then
+    // falls back to MatrixCaheOptimised
+    int64_t time;
+    MatrixFlat<T> A(rows, inners, -10, 10), B(inners, columns, -10, 10), C0(rows, columns, -10, 10);
+    std::vector<T> c(C0.get_ptr(), C0.get_ptr() + rows * columns);
+    const int result = matrixMultMasked_Simd<T>(A.getMdata(), B.getMdata(), c, rows, inners, columns, time);
+    const bool untouched = std::equal(c.begin(), c.end(), C0.get_ptr());
+    std::cout<<"matrixMultMasked_Simd at the scalar tier returned "<<result<<", c untouched: "<<untouched<<std::endl;
+    errors += result != 0 || !untouched;
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+    std::cout<<"SIMD level selected by the dispatcher: "<<simd_level_name(simd_level())<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_all<double>(rows, inners, columns, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_all<float>(rows, inners, columns, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,175 @@
+#include "../../include/mmm.hpp"
+#include "../../include/gemm_batched.hpp"
+#include "../../include/gemm_packed.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <random>
+#include <thread>
+
+/*
+ * This test has the scope of validate the batched products (gemm_batched, mmm_batched).
+ * A batch of products of random shapes (every dimension between 1 and MAX_DIM, with leading dimensions larger than
+ * the rows so that the strides are covered) is compared with a plain triple loop, in both double & single
+ * precision. Use MAX_DIM above 64 to mix small products with the ones that go to the packed engine.
+ * The uniform API is checked with shared weights (stride of B equal to 0) and mmm_batched on lists of MatrixFlat.
+ * The time of the batch is compared with calling gemm_packed on every product (best of a few runs after a warm-up).
+ * The result is accumulated: C starts from a non zero matrix.
+ * The instruction set can be lowered with NNET_SIMD=avx2|sse4|scalar to test the other kernels.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_mmm_batched
+ *
+ * To run this test you have to pass the number of products, the largest dimension and the number of threads
+ *
+ */
+
+//! Cref += A * B for one descriptor, accumulated in double
+template<typename T>
+void reference(const GemmDescriptor<T>& d, T* Cref){
+    for (std::size_t i = 0; i < d.M; i++)
+        for (std::size_t j = 0; j < d.N; j++) {
+            double acc = Cref[i * d.ldc + j];
+            for (std::size_t k = 0; k < d.K; k++)
+                acc += double(d.A[i * d.lda + k]) * d.B[k * d.ldb + j];
+            Cref[i * d.ldc + j] = static_cast<T>(acc);
+        }
+}
+
+//! Best time [us] of fn out of 5 runs, after a warm-up run
+template<typename F>
+int64_t best_time(F fn){
+    fn();
+    int64_t best = -1;
+    for (int r = 0; r < 5; r++) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        fn();
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        if (best < 0 || us < best)
+            best = us;
+    }
+    return best;
+}
+
+template<typename T>
+int check(std::size_t count, std::size_t max_dim, int numThreads, T tolerance){
+
+    int errors = 0;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<std::size_t> dim(1, max_dim);
+    std::uniform_int_distribution<std::size_t> pad(0, 3);
+    std::uniform_real_distribution<T> value(-1, 1);
+
+    // varying shapes, every operand in its own slice of one buffer
+    std::vector<GemmDescriptor<T>> batch(count);
+    std::vector<std::size_t> offsetA(count), offsetB(count), offsetC(count);
+    std::size_t sizeA = 0, sizeB = 0, sizeC = 0;
+    for (std::size_t p = 0; p < count; p++) {
+        GemmDescriptor<T>& d = batch[p];
+        d.M = dim(gen); d.N = dim(gen); d.K = dim(gen);
+        d.lda = d.K + pad(gen); d.ldb = d.N + pad(gen); d.ldc = d.N + pad(gen);
+        offsetA[p] = sizeA; sizeA += d.M * d.lda;
+        offsetB[p] = sizeB; sizeB += d.K * d.ldb;
+        offsetC[p] = sizeC; sizeC += d.M * d.ldc;
+    }
+    std::vector<T> A(sizeA), B(sizeB), C(sizeC);
+    for (auto& a : A) a = value(gen);
+    for (auto& b : B) b = value(gen);
+    for (auto& c : C) c = value(gen);
+    std::vector<T> Cref = C;
+    for (std::size_t p = 0; p < count; p++) {
+        batch[p].A = A.data() + offsetA[p];
+        batch[p].B = B.data() + offsetB[p];
+        batch[p].C = C.data() + offsetC[p];
+    }
+
+    gemm_batched(batch, numThreads);
+    for (std::size_t p = 0; p < count; p++)
+        reference(batch[p], Cref.data() + offsetC[p]);
+    T err = max_relative_error(C, Cref);
+    std::cout<<"varying shapes, max|C-Cref| / max|Cref|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // the batch against the same products one call at a time, both accumulating in a scratch C
+    std::vector<T> Cscratch(sizeC);
+    std::vector<GemmDescriptor<T>> scratch = batch;
+    for (std::size_t p = 0; p < count; p++)
+        scratch[p].C = Cscratch.data() + offsetC[p];
+    const int64_t batched_us = best_time([&]{gemm_batched(scratch, numThreads);});
+    const int64_t packed_us = best_time([&]{
+        for (const GemmDescriptor<T>& d : scratch)
+            gemm_packed<T>(d.M, d.N, d.K, d.A, d.lda, d.B, d.ldb, d.C, d.ldc, numThreads);
+    });
+    std::cout<<"gemm_batched took: "<<batched_us<<" [us], gemm_packed on every product took: "<<packed_us<<" [us]"<<std::endl;
+
+    // same shape and shared weights: B has stride 0
+    const std::size_t M = dim(gen), N = dim(gen), K = dim(gen);
+    std::vector<T> X(count * M * K), W(K * N), Y(count * M * N), Yref(count * M * N);
+    for (auto& x : X) x = value(gen);
+    for (auto& w : W) w = value(gen);
+    gemm_batched<T>(M, N, K, X.data(), K, M * K, W.data(), N, 0, Y.data(), N, M * N, count, numThreads);
+    for (std::size_t p = 0; p < count; p++) {
+        GemmDescriptor<T> d;
+        d.M = M; d.N = N; d.K = K;
+        d.A = X.data() + p * M * K; d.lda = K;
+        d.B = W.data(); d.ldb = N;
+        d.ldc = N;
+        reference(d, Yref.data() + p * M * N);
+    }
+    err = max_relative_error(Y, Yref);
+    std::cout<<"shared weights "<<M<<"X"<<K<<" * "<<K<<"X"<<N<<", max|Y-Yref| / max|Yref|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // mmm_batched on lists of matrices
+    std::vector<MatrixFlat<T>> As, Bs, Cs;
+    for (std::size_t p = 0; p < count; p++) {
+        As.emplace_back(batch[p].M, batch[p].K, -1, 1);
+        Bs.emplace_back(batch[p].K, batch[p].N, -1, 1);
+        Cs.emplace_back(batch[p].M, batch[p].N);
+    }
+    int64_t time;
+    mmm_batched(As, Bs, Cs, time, numThreads);
+    std::cout<<"mmm_batched took: "<<time<<" [ms]"<<std::endl;
+    T max_err = 0;
+    for (std::size_t p = 0; p < count; p++) {
+        GemmDescriptor<T> d;
+        d.M = batch[p].M; d.N = batch[p].N; d.K = batch[p].K;
+        d.A = As[p].get_ptr(); d.lda = d.K;
+        d.B = Bs[p].get_ptr(); d.ldb = d.N;
+        d.ldc = d.N;
+        std::vector<T> ref(d.M * d.N), out(Cs[p].get_ptr(), Cs[p].get_ptr() + d.M * d.N);
+        reference(d, ref.data());
+        max_err = std::max(max_err, max_relative_error(out, ref));
+    }
+    std::cout<<"mmm_batched, largest max|C-Cref| / max|Cref|: "<<max_err<<std::endl;
+    errors += max_err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t count = std::stoi(argv[1]);
+    size_t max_dim = std::stoi(argv[2]);
+    int numThreads = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Batches of "<<count<<" products, dimensions from 1 to "<<max_dim<<std::endl;
+
+    std::cout<<"Double precision"<<std::endl;
+    int errors = check<double>(count, max_dim, numThreads, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(count, max_dim, numThreads, 1e-5);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -5,6 +5,7 @@
  * This test has the scope of validate the mmm_naive algorithm.
  * We test if the function works, in both double & single precision, we compare the result with the openBlas
  * matrix-matrix multiplication in both term of times and result.
+ * The transpose-flag version (C += A^T * B^T) is compared with openBlas as well.
  *
  * To compile (with -O3 -march=native -ffast-math) :
  * make UnitTest_mmm_naive
@@ -58,5 +59,16 @@ int main(int argc, char ** argv){
 
     std::cout<<"-----------------------------------------------------------------------"<<std::endl;
 
+    MatrixFlat<double> Ct(dim, dim);
+    MatrixFlat<double> Ctblas(dim, dim);
+    mmm_naive(A, B, Ct, time, Trans, Trans);
+    std::cout<<"This operation took: "<<time<< " [ms]"<<std::endl;
+    mmm_blas(A, B, Ctblas, time, Trans, Trans);
+    std::cout<<"The same operation using openBlas took: "<<time<< " [ms]"<<std::endl;
+    std::cout<<"We check if the result is the same: "<<std::endl;
+    std::cout<<"nnz(C-Cblas): "<<(Ctblas-Ct).nnzrs()<<std::endl;
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
 
 }
\ No newline at end of file
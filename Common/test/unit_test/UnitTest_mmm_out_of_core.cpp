@@ -0,0 +1,107 @@
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/gemm_out_of_core.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+/*
+ * This test has the scope of validate the mmm_out_of_core algorithm.
+ * A and B are saved to matrix files (MatrixFlat::save), multiplied from the files with panels of the given size,
+ * and the C file is mapped and compared with the openBlas result, in both double & single precision. Use a panel
+ * size that does not divide the matrices to go through the last, smaller panels; the largest dimensions use one
+ * panel (whole rows, one read per panel).
+ * The product is computed twice: C = A*B in a new file, then C += A*B on it.
+ * The time spent waiting for the disk is printed next to the time of the products: with the reads overlapped it
+ * is a small part of the total once the files are in the page cache.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_mmm_out_of_core
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B), the columns of B,
+ * the size of the panels and the number of threads
+ *
+ */
+
+void print_stats(const OutOfCoreStats& stats){
+    std::cout<<"Panels "<<stats.panel_rows<<"X"<<stats.panel_inners<<" * "<<stats.panel_inners<<"X"<<stats.panel_columns
+             <<", read "<<stats.bytes_read / (1 << 20)<<" MB, written "<<stats.bytes_written / (1 << 20)<<" MB"<<std::endl;
+    std::cout<<"Products took: "<<stats.compute_us / 1000<<" [ms], waiting for the disk: "<<stats.wait_us / 1000<<" [ms]"<<std::endl;
+}
+
+template<typename T>
+int check(std::size_t rows, std::size_t inners, std::size_t columns, std::size_t panel, int numThreads, T tolerance){
+
+    int64_t time;
+    const std::string pathA = "UnitTest_ooc_A.mat", pathB = "UnitTest_ooc_B.mat", pathC = "UnitTest_ooc_C.mat";
+
+    MatrixFlat<T> A(rows, inners, -10, 10);
+    MatrixFlat<T> B(inners, columns, -10, 10);
+    MatrixFlat<T> Cblas(rows, columns);
+    mmm_blas(A, B, Cblas, time);
+    std::cout<<"openBlas took: "<<time<< " [ms]"<<std::endl;
+    int errors = !A.save(pathA) || !B.save(pathB);
+
+    OutOfCoreOptions options;
+    options.panel = panel;
+    options.numThreads = numThreads;
+    OutOfCoreStats stats;
+    errors += !gemm_out_of_core<T>(pathA, pathB, pathC, options, &stats);
+    print_stats(stats);
+    T err = max_relative_error(MatrixFlat<T>::map(pathC), Cblas);
+    std::cout<<"C = A*B, max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    options.accumulate = true;
+    errors += !gemm_out_of_core<T>(pathA, pathB, pathC, options, &stats);
+    print_stats(stats);
+    MatrixFlat<T> C = MatrixFlat<T>::map(pathC);
+    for (std::size_t i = 0; i < rows * columns; i++)
+        Cblas[i] *= 2;
+    err = max_relative_error(C, Cblas);
+    std::cout<<"C += A*B, max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // the columns of A do not match its rows, unless A is square
+    if (rows != inners) {
+        std::cout<<"Expected error: ";
+        errors += gemm_out_of_core<T>(pathA, pathA, pathC);
+    }
+
+    std::remove(pathA.c_str());
+    std::remove(pathB.c_str());
+    std::remove(pathC.c_str());
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 6)
+    {
+        std::cout<<"Error! You must pass five positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+    size_t panel = std::stoi(argv[4]);
+    int numThreads = std::stoi(argv[5]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(rows, inners, columns, panel, numThreads, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(rows, inners, columns, panel, numThreads, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
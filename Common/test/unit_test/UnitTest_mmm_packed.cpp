@@ -0,0 +1,145 @@
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/gemm_packed.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the mmm_packed algorithm.
+ * We test if the function works, in both double & single precision, we compare the result with the openBlas
+ * matrix-matrix multiplication in both term of times and correctness of result.
+ * Since the packed engine handles ragged edges, the dimensions do not need to be multiples of anything: the test
+ * takes the three dimensions of the product separately so that non square shapes are covered too.
+ * The four transpose combinations (NN, NT, TN, TT) are checked as well, with the operands stored transposed.
+ * Then the epilogue of a dense layer (see epilogue.hpp) is checked: C += A*B, C += bias, H = ReLU(C) and D = ReLU'(C)
+ * in the same call, against openBlas followed by the same operations.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_mmm_packed
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B), the columns of B and
+ * the number of threads
+ *
+ */
+
+//! Errors of the epilogue of gemm_packed (bias + ReLU + derivative) with respect to openBlas and the same operations
+template<typename T>
+int check_epilogue(std::size_t rows, std::size_t inners, std::size_t columns, int numThreads, T tolerance){
+    MatrixFlat<T> A(rows, inners, -10, 10);
+    MatrixFlat<T> B(inners, columns, -10, 10);
+    MatrixFlat<T> bias(1, columns, -1000, 1000);
+    MatrixFlat<T> C(rows, columns), H(rows, columns), D(rows, columns);
+    MatrixFlat<T> Cblas(rows, columns), Hblas(rows, columns), Dblas(rows, columns);
+    int64_t time;
+
+    Epilogue<T> epilogue;
+    epilogue.bias = bias.get_ptr();
+    epilogue.activation = Activation::ReLu;
+    epilogue.h = H.get_ptr();
+    epilogue.dact = D.get_ptr();
+    gemm_packed(NoTrans, NoTrans, rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns,
+                C.get_ptr(), columns, epilogue, numThreads);
+
+    mmm_blas(A, B, Cblas, time);
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t j = 0; j < columns; j++) {
+            Cblas(i, j) += bias[j];
+            Hblas(i, j) = Cblas(i, j) > 0 ? Cblas(i, j) : T(0);
+            Dblas(i, j) = Cblas(i, j) > 0 ? T(1) : T(0);
+        }
+    const T err = std::max(max_relative_error(C, Cblas), max_relative_error(H, Hblas));
+    // the derivative can only differ where z is 0 up to the rounding
+    int wrong = 0;
+    for (std::size_t i = 0; i < rows * columns; i++)
+        wrong += D[i] != Dblas[i] && std::abs(Cblas[i]) > tolerance * 1e3;
+    std::cout<<"epilogue max|C-Cblas| / max|Cblas|: "<<err<<", "<<wrong<<" wrong derivatives"<<std::endl;
+    return (err > tolerance) + (wrong != 0);
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 5)
+    {
+        std::cout<<"Error! You must pass four positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+    int numThreads = std::stoi(argv[4]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    MatrixFlat<double> A(rows, inners, -10, 10);
+    MatrixFlat<double> B(inners, columns, -10, 10);
+    MatrixFlat<double> C(rows, columns);
+    MatrixFlat<double> Cblas(rows, columns);
+    MatrixFlat<float> Af(rows, inners, -10, 10);
+    MatrixFlat<float> Bf(inners, columns, -10, 10);
+    MatrixFlat<float> Cf(rows, columns);
+    MatrixFlat<float> Cblasf(rows, columns);
+
+    int64_t time;
+    int errors = 0;
+
+    mmm_packed(A, B, C, time, numThreads);
+    std::cout<<"This operation took: "<<time<< " [ms]"<<std::endl;
+    mmm_blas(A, B, Cblas, time);
+    std::cout<<"The same operation using openBlas took: "<<time<< " [ms]"<<std::endl;
+    std::cout<<"We check if the result is the same: "<<std::endl;
+    double err = max_relative_error(C, Cblas);
+    std::cout<<"max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > 1e-12;
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    mmm_packed(Af, Bf, Cf, time, numThreads);
+    std::cout<<"This operation took: "<<time<< " [ms]"<<std::endl;
+    mmm_blas(Af, Bf, Cblasf, time);
+    std::cout<<"The same operation using openBlas took: "<<time<< " [ms]"<<std::endl;
+    std::cout<<"We check if the result is the same: "<<std::endl;
+    float errf = max_relative_error(Cf, Cblasf);
+    std::cout<<"max|C-Cblas| / max|Cblas|: "<<errf<<std::endl;
+    errors += errf > 1e-4;
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    for (Transpose transA : {NoTrans, Trans}) {
+        for (Transpose transB : {NoTrans, Trans}) {
+            std::cout<<"op(A) = "<<(transA == Trans ? "A^T" : "A")<<", op(B) = "<<(transB == Trans ? "B^T" : "B")<<std::endl;
+
+            MatrixFlat<double> At(transA == Trans ? inners : rows, transA == Trans ? rows : inners, -10, 10);
+            MatrixFlat<double> Bt(transB == Trans ? columns : inners, transB == Trans ? inners : columns, -10, 10);
+            MatrixFlat<double> Ct(rows, columns);
+            MatrixFlat<double> Ctblas(rows, columns);
+            mmm_packed(At, Bt, Ct, time, transA, transB, numThreads);
+            mmm_blas(At, Bt, Ctblas, time, transA, transB);
+            err = max_relative_error(Ct, Ctblas);
+            std::cout<<"max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+            errors += err > 1e-12;
+
+            MatrixFlat<float> Atf(transA == Trans ? inners : rows, transA == Trans ? rows : inners, -10, 10);
+            MatrixFlat<float> Btf(transB == Trans ? columns : inners, transB == Trans ? inners : columns, -10, 10);
+            MatrixFlat<float> Ctf(rows, columns);
+            MatrixFlat<float> Ctblasf(rows, columns);
+            mmm_packed(Atf, Btf, Ctf, time, transA, transB, numThreads);
+            mmm_blas(Atf, Btf, Ctblasf, time, transA, transB);
+            errf = max_relative_error(Ctf, Ctblasf);
+            std::cout<<"max|C-Cblas| / max|Cblas|: "<<errf<<std::endl;
+            errors += errf > 1e-4;
+        }
+    }
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    errors += check_epilogue<double>(rows, inners, columns, numThreads, 1e-12);
+    errors += check_epilogue<float>(rows, inners, columns, numThreads, 1e-4);
+
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
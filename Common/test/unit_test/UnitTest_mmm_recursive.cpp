@@ -0,0 +1,95 @@
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/gemm_recursive.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the mmm_recursive algorithm.
+ * We test if the function works, in both double & single precision, we compare the result with the openBlas
+ * matrix-matrix multiplication in both term of times and error bound, and with the packed engine in term of times.
+ * The recursion splits the largest dimension, so non square shapes go through splits along M, N and K: use sizes
+ * that are not multiples of the base case (64) to go through the narrower strips and the last rows as well.
+ * The result is accumulated: C starts from a non zero matrix. gemm_recursive is also called on a block in the
+ * middle of the matrices, to check the leading dimensions.
+ * The instruction set can be lowered with NNET_SIMD=avx2|sse4|scalar to test the other base cases.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_mmm_recursive
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B), the columns of B
+ * and the number of threads
+ *
+ */
+
+template<typename T>
+int check(std::size_t rows, std::size_t inners, std::size_t columns, int numThreads, T tolerance){
+
+    int64_t time;
+
+    MatrixFlat<T> A(rows, inners, -10, 10);
+    MatrixFlat<T> B(inners, columns, -10, 10);
+    MatrixFlat<T> C(rows, columns, -10, 10);
+    MatrixFlat<T> Cblas(rows, columns);
+    mmm_blas(A, B, Cblas, time);
+    std::cout<<"openBlas took: "<<time<< " [ms]"<<std::endl;
+    for (std::size_t i = 0; i < rows * columns; i++)
+        Cblas[i] += C[i];
+
+    mmm_recursive(A, B, C, time, numThreads);
+    std::cout<<"This operation took: "<<time<< " [ms]"<<std::endl;
+    T err = max_relative_error(C, Cblas);
+    std::cout<<"max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    int errors = err > tolerance;
+
+    MatrixFlat<T> Cpacked(rows, columns);
+    mmm_packed(A, B, Cpacked, time, numThreads);
+    std::cout<<"mmm_packed took: "<<time<< " [ms]"<<std::endl;
+
+    // C[r0:, c0:] += A[r0:, k0:] * B[k0:, c0:], the rest of C must not change
+    const std::size_t r0 = rows / 3, k0 = inners / 3, c0 = columns / 3;
+    MatrixFlat<T> D(rows, columns, -10, 10);
+    MatrixFlat<T> Dref = D;
+    gemm_recursive(rows - r0, columns - c0, inners - k0, A.get_ptr() + r0 * inners + k0, inners,
+                   B.get_ptr() + k0 * columns + c0, columns, D.get_ptr() + r0 * columns + c0, columns, numThreads);
+    for (std::size_t i = r0; i < rows; i++)
+        for (std::size_t k = k0; k < inners; k++)
+            for (std::size_t j = c0; j < columns; j++)
+                Dref[i * columns + j] += A[i * inners + k] * B[k * columns + j];
+    err = max_relative_error(D, Dref);
+    std::cout<<"Sub-block max|D-Dref| / max|Dref|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 5)
+    {
+        std::cout<<"Error! You must pass four positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+    int numThreads = std::stoi(argv[4]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(rows, inners, columns, numThreads, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(rows, inners, columns, numThreads, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
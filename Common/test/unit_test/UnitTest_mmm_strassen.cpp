@@ -0,0 +1,97 @@
+#include "../../include/mmm.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "../../include/gemm_strassen.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the mmm_strassen algorithm.
+ * We test if the function works, in both double & single precision, we compare the result with the openBlas
+ * matrix-matrix multiplication in both term of times and error bound. Strassen does not give the same rounding
+ * as the classic product: the error grows with the number of levels of the recursion, so the tolerances are
+ * looser than the ones of the other kernels.
+ * The recursion only starts above the crossover, which is passed to the program so that small matrices can be
+ * used to go through several levels (and through the peeling of odd sizes, use odd dimensions for that).
+ * The result is accumulated: C starts from a non zero matrix.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_mmm_strassen
+ *
+ * To run this test you have to pass the rows of A, the columns of A (= rows of B), the columns of B,
+ * the number of threads and the crossover size (minimum 32)
+ *
+ */
+
+template<typename T>
+int check(std::size_t rows, std::size_t inners, std::size_t columns, int numThreads, int crossover, T tolerance){
+
+    int64_t time;
+
+    MatrixFlat<T> A(rows, inners, -10, 10);
+    MatrixFlat<T> B(inners, columns, -10, 10);
+    MatrixFlat<T> C(rows, columns, -10, 10);
+    MatrixFlat<T> Cblas(rows, columns);
+    mmm_blas(A, B, Cblas, time);
+    std::cout<<"openBlas took: "<<time<< " [ms]"<<std::endl;
+    for (std::size_t i = 0; i < rows * columns; i++)
+        Cblas[i] += C[i];
+
+    TuningConfig config;
+    config.outer_tile = crossover;
+    config.threads = numThreads;
+    std::cout<<"Workspace: "<<strassen_workspace_size(rows, columns, inners, crossover, numThreads)<<" elements"<<std::endl;
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    gemm_strassen(rows, columns, inners, A.get_ptr(), inners, B.get_ptr(), columns, C.get_ptr(), columns, config);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    std::cout<<"Strassen with crossover "<<crossover<<" took: "
+             <<std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()<<" [ms]"<<std::endl;
+
+    T err = max_relative_error(C, Cblas);
+    std::cout<<"max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    int errors = err > tolerance;
+
+    // the entry point, with the crossover of the tuning file
+    MatrixFlat<T> C2(rows, columns);
+    MatrixFlat<T> C2blas(rows, columns);
+    mmm_strassen(A, B, C2, time, numThreads);
+    std::cout<<"This operation took: "<<time<< " [ms]"<<std::endl;
+    mmm_blas(A, B, C2blas, time);
+    err = max_relative_error(C2, C2blas);
+    std::cout<<"max|C-Cblas| / max|Cblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 6)
+    {
+        std::cout<<"Error! You must pass five positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inners = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+    int numThreads = std::stoi(argv[4]);
+    int crossover = std::stoi(argv[5]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inners<<" * "<<inners<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(rows, inners, columns, numThreads, crossover, 1e-11);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(rows, inners, columns, numThreads, crossover, 1e-3);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
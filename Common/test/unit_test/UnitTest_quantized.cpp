@@ -0,0 +1,162 @@
+#include "../../include/mmm_blas.hpp"
+#include "../../include/quantized.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <random>
+#include <thread>
+
+/*
+ * This test has the scope of validate the int8 quantized kernels.
+ * The integer core (gemm_int8) must give exactly the same result as a plain loop on int32, on inner dimensions
+ * that are not multiple of the vector width so that the tails are covered.
+ * The quantized products (gemv_quantized, gemm_quantized) approximate the float ones: they are compared with the
+ * openBlas product of the original matrices, every element must be within the error bound of the quantization
+ * (half a step on both operands), for both the per-channel and the per-tensor scales. The quantization itself is checked element by element (every
+ * weight must be within half a step of its quantized value) and every row of gemm_quantized must match gemv_quantized
+ * up to the rounding.
+ * The instruction set can be lowered with NNET_SIMD=avx2|sse4|scalar to test the other kernels.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_quantized
+ *
+ * To run this test you have to pass the rows of A, the inputs and the outputs of the weight matrix (A is
+ * ROWS x INPUTS, W is INPUTS x OUTPUTS) and the number of threads
+ *
+ */
+
+int check_int8(std::size_t rows, std::size_t inputs, std::size_t outputs){
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(-127, 127);
+    std::vector<std::int8_t> A(rows * inputs), B(outputs * inputs);
+    for (auto& a : A) a = static_cast<std::int8_t>(dist(gen));
+    for (auto& b : B) b = static_cast<std::int8_t>(dist(gen));
+
+    std::vector<std::int32_t> C(rows * outputs, 1), Cref(rows * outputs, 1);
+    gemm_int8(rows, outputs, inputs, A.data(), inputs, B.data(), inputs, C.data(), outputs);
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t j = 0; j < outputs; j++)
+            for (std::size_t k = 0; k < inputs; k++)
+                Cref[i * outputs + j] += std::int32_t(A[i * inputs + k]) * B[j * inputs + k];
+
+    int errors = 0;
+    for (std::size_t i = 0; i < rows * outputs; i++)
+        errors += C[i] != Cref[i];
+    std::cout<<"gemm_int8 ["<<int8_kernel_name()<<"]: "<<errors<<" wrong elements"<<std::endl;
+    return errors != 0;
+}
+
+//! Elements of C = A * W (plus the same offset in C and Cblas) farther from Cblas than the quantization allows:
+//! every term a*w of a dot product is off by at most sa/2 |w| + sw/2 |a| + sa sw / 4, sa and sw being the scales of
+//! the row of A and of the column of W
+template<typename T>
+int out_of_bound(std::size_t rows, std::size_t inputs, std::size_t outputs, const T* A, const T* W,
+                 const QuantizedMatrix& Wq, const T* C, const T* Cblas){
+    int wrong = 0;
+    for (std::size_t i = 0; i < rows; i++) {
+        const T* a = A + i * inputs;
+        T sa = 0;
+        for (std::size_t k = 0; k < inputs; k++)
+            sa = std::max<T>(sa, std::abs(a[k]));
+        sa /= 127;
+        for (std::size_t j = 0; j < outputs; j++) {
+            const T sw = Wq.scale(j);
+            T bound = 0;
+            for (std::size_t k = 0; k < inputs; k++)
+                bound += sa / 2 * std::abs(W[k * outputs + j]) + sw / 2 * std::abs(a[k]) + sa * sw / 4;
+            wrong += std::abs(C[i * outputs + j] - Cblas[i * outputs + j]) > T(1.001) * bound + T(1e-5);
+        }
+    }
+    return wrong;
+}
+
+template<typename T>
+int check(std::size_t rows, std::size_t inputs, std::size_t outputs, int numThreads, QuantGranularity granularity){
+
+    int errors = 0;
+    int64_t time;
+
+    MatrixFlat<T> A(rows, inputs, -1, 1);
+    MatrixFlat<T> x(1, inputs, -1, 1);
+    MatrixFlat<T> W(inputs, outputs, -1, 1);
+    const QuantizedMatrix Wq(W.get_ptr(), inputs, outputs, granularity);
+
+    // every weight is within half a quantization step
+    int wrong = 0;
+    for (std::size_t k = 0; k < inputs; k++)
+        for (std::size_t j = 0; j < outputs; j++)
+            wrong += std::abs(Wq(k, j) - static_cast<float>(W[k * outputs + j])) > 0.5001f * Wq.scale(j);
+    std::cout<<"quantization: "<<wrong<<" weights out of half a step, "<<Wq.bytes()<<" bytes instead of "
+             <<inputs * outputs * sizeof(T)<<std::endl;
+    errors += wrong != 0;
+
+    // y += x * W
+    MatrixFlat<T> y(1, outputs);
+    MatrixFlat<T> yblas(1, outputs);
+    gemv_quantized(Wq, x.get_ptr(), y.get_ptr(), numThreads);
+    mmm_blas(x, W, yblas, time);
+    T err = max_relative_error(y, yblas);
+    wrong = out_of_bound(1, inputs, outputs, x.get_ptr(), W.get_ptr(), Wq, y.get_ptr(), yblas.get_ptr());
+    std::cout<<"gemv_quantized max|y-yblas| / max|yblas|: "<<err<<", "<<wrong<<" elements out of the error bound"<<std::endl;
+    errors += wrong != 0;
+
+    // C += A * W, accumulated on a non zero C
+    MatrixFlat<T> C(rows, outputs, -1, 1);
+    MatrixFlat<T> Cblas(rows, outputs);
+    MatrixFlat<T> C0 = C;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    gemm_quantized(rows, A.get_ptr(), inputs, Wq, C.get_ptr(), outputs, numThreads);
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    std::cout<<"gemm_quantized took: "<<std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()<<" [ms]"<<std::endl;
+    mmm_blas(A, W, Cblas, time);
+    std::cout<<"openBlas took: "<<time<< " [ms]"<<std::endl;
+    for (std::size_t i = 0; i < rows * outputs; i++)
+        Cblas[i] += C0[i];
+    err = max_relative_error(C, Cblas);
+    wrong = out_of_bound(rows, inputs, outputs, A.get_ptr(), W.get_ptr(), Wq, C.get_ptr(), Cblas.get_ptr());
+    std::cout<<"gemm_quantized max|C-Cblas| / max|Cblas|: "<<err<<", "<<wrong<<" elements out of the error bound"<<std::endl;
+    errors += wrong != 0;
+
+    // the rows of gemm are quantized one by one, as gemv does: only the rounding of the scaling can differ
+    for (std::size_t i = 0; i < rows; i++)
+        gemv_quantized(Wq, A.get_ptr() + i * inputs, C0.get_ptr() + i * outputs, numThreads);
+    err = max_relative_error(C, C0);
+    std::cout<<"gemm_quantized vs gemv_quantized, max|C-Cgemv| / max|Cgemv|: "<<err<<std::endl;
+    errors += err > 1e-5;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 5)
+    {
+        std::cout<<"Error! You must pass four positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inputs = std::stoi(argv[2]);
+    size_t outputs = std::stoi(argv[3]);
+    int numThreads = std::stoi(argv[4]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrices will be of dimensions: "<<rows<<"X"<<inputs<<" * "<<inputs<<"X"<<outputs<<std::endl;
+
+    int errors = check_int8(rows, inputs, outputs);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Double precision, per channel scales"<<std::endl;
+    errors += check<double>(rows, inputs, outputs, numThreads, QuantGranularity::PerChannel);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision, per channel scales"<<std::endl;
+    errors += check<float>(rows, inputs, outputs, numThreads, QuantGranularity::PerChannel);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision, per tensor scale"<<std::endl;
+    errors += check<float>(rows, inputs, outputs, numThreads, QuantGranularity::PerTensor);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,162 @@
+#include "../../include/mmm.hpp"
+#include "../../include/gemm_sparse.hpp"
+#include "../../include/mmm_blas.hpp"
+#include "test_utils.hpp"
+#include <cmath>
+#include <random>
+#include <thread>
+
+/*
+ * This test has the scope of validate the sparse matrices (MatrixCSR, MatrixCSC) and their products.
+ * A random matrix is pruned to the given density (fraction of the elements kept) and converted to CSR and CSC: the
+ * elements read through operator() and the ones of to_dense must be the ones of the pruned matrix.
+ * The products are compared with the openBlas matrix-matrix multiplication of the pruned matrix stored dense, in both
+ * double & single precision:
+ *     mmm_sparse (CSR x dense):   C += A * B      with A ROWSxINNER sparse, B INNERxCOLUMNS
+ *     mmm_sparse (dense x CSC):   C += B^T * A^T  with A^T stored in CSC (the activations times pruned weights)
+ *     spmv:                       y += A * x  and  y += x * A^T
+ * The result is accumulated: C starts from a non zero matrix. The time of the sparse product is compared with the
+ * dense one, it should scale with the density.
+ * The instruction set can be lowered with NNET_SIMD=avx2|sse4|scalar to test the other kernels.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_sparse
+ *
+ * To run this test you have to pass the rows, the inner dimension and the columns, the density and the number of
+ * threads
+ *
+ */
+
+//! Random rows x cols matrix with about density of its elements different from 0
+template<typename T>
+MatrixFlat<T> pruned(std::size_t rows, std::size_t cols, double density, int seed){
+    MatrixFlat<T> M(rows, cols, -10, 10);
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> keep(0, 1);
+    for (std::size_t i = 0; i < rows * cols; i++)
+        if (keep(gen) >= density)
+            M[i] = 0;
+    return M;
+}
+
+template<typename T>
+MatrixFlat<T> transposed(const MatrixFlat<T>& M){
+    MatrixFlat<T> Mt(M.ncols(), M.nrows());
+    for (std::size_t i = 0; i < M.nrows(); i++)
+        for (std::size_t j = 0; j < M.ncols(); j++)
+            Mt(j, i) = M(i, j);
+    return Mt;
+}
+
+//! C0 + A*B computed by blas (which overwrites its output)
+template<typename T>
+MatrixFlat<T> blas_accumulate(const MatrixFlat<T>& C0, MatrixFlat<T>& A, MatrixFlat<T>& B, int64_t& time){
+    MatrixFlat<T> C(C0.nrows(), C0.ncols());
+    mmm_blas(A, B, C, time);
+    for (std::size_t i = 0; i < C.nrows() * C.ncols(); i++)
+        C[i] += C0[i];
+    return C;
+}
+
+//! Number of elements of the sparse matrix (read through operator() and to_dense) that differ from the dense one
+template<typename Sparse, typename T>
+int check_storage(const Sparse& S, const MatrixFlat<T>& dense, std::size_t nnz){
+    int wrong = 0;
+    const MatrixFlat<T> back = S.to_dense();
+    for (std::size_t i = 0; i < dense.nrows(); i++)
+        for (std::size_t j = 0; j < dense.ncols(); j++)
+            wrong += S(i, j) != dense(i, j) || back(i, j) != dense(i, j);
+    wrong += S.values().size() != nnz;
+    return wrong;
+}
+
+template<typename T>
+int check(std::size_t rows, std::size_t inner, std::size_t columns, double density, int numThreads, T tolerance){
+
+    int errors = 0;
+    int64_t time, time_blas;
+
+    MatrixFlat<T> A = pruned<T>(rows, inner, density, 1);
+    MatrixFlat<T> At = transposed(A);
+    MatrixFlat<T> A_copy = A;
+    const MatrixCSR<T> A_csr(A);
+    const MatrixCSC<T> At_csc(At);
+    std::cout<<"A has "<<A_csr.values().size()<<" elements of "<<rows * inner<<" (density "<<A_csr.density()<<")"<<std::endl;
+
+    int wrong = check_storage(A_csr, A, A_copy.nnzrs()) + check_storage(At_csc, At, A_copy.nnzrs());
+    std::cout<<"CSR and CSC storage: "<<wrong<<" wrong elements"<<std::endl;
+    errors += wrong != 0;
+
+    // C += A * B
+    MatrixFlat<T> B(inner, columns, -10, 10);
+    MatrixFlat<T> C(rows, columns, -10, 10);
+    const MatrixFlat<T> C0 = C;
+    mmm_sparse(A_csr, B, C, time, numThreads);
+    const MatrixFlat<T> Cblas = blas_accumulate(C0, A, B, time_blas);
+    T err = max_relative_error(C, Cblas);
+    std::cout<<"CSR x dense max|C-Cblas| / max|Cblas|: "<<err<<" in "<<time<<" ms (blas "<<time_blas<<" ms)"<<std::endl;
+    errors += err > tolerance;
+
+    // Ct += Bt * At
+    MatrixFlat<T> Bt = transposed(B);
+    MatrixFlat<T> Ct(columns, rows, -10, 10);
+    const MatrixFlat<T> Ct0 = Ct;
+    mmm_sparse(Bt, At_csc, Ct, time, numThreads);
+    const MatrixFlat<T> Ctblas = blas_accumulate(Ct0, Bt, At, time_blas);
+    err = max_relative_error(Ct, Ctblas);
+    std::cout<<"dense x CSC max|C-Cblas| / max|Cblas|: "<<err<<" in "<<time<<" ms (blas "<<time_blas<<" ms)"<<std::endl;
+    errors += err > tolerance;
+
+    // y += A * x
+    MatrixFlat<T> x(inner, 1, -10, 10);
+    MatrixFlat<T> y(rows, 1, -10, 10);
+    const MatrixFlat<T> y0 = y;
+    spmv(A_csr, x.get_ptr(), y.get_ptr(), numThreads);
+    const MatrixFlat<T> yblas = blas_accumulate(y0, A, x, time_blas);
+    err = max_relative_error(y, yblas);
+    std::cout<<"spmv CSR max|y-yblas| / max|yblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    // yt += xt * At, the forward pass of a layer with pruned weights
+    MatrixFlat<T> xt(1, inner, -10, 10);
+    MatrixFlat<T> yt(1, rows, -10, 10);
+    const MatrixFlat<T> yt0 = yt;
+    spmv(xt.get_ptr(), At_csc, yt.get_ptr(), numThreads);
+    const MatrixFlat<T> ytblas = blas_accumulate(yt0, xt, At, time_blas);
+    err = max_relative_error(yt, ytblas);
+    std::cout<<"spmv CSC max|y-yblas| / max|yblas|: "<<err<<std::endl;
+    errors += err > tolerance;
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 6)
+    {
+        std::cout<<"Error! You must pass five positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t inner = std::stoi(argv[2]);
+    size_t columns = std::stoi(argv[3]);
+    double density = std::stod(argv[4]);
+    int numThreads = std::stoi(argv[5]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrix A will be of dimensions: "<<rows<<"X"<<inner<<" with density "<<density<<", B: "<<inner<<"X"<<columns<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check<double>(rows, inner, columns, density, numThreads, 1e-12);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check<float>(rows, inner, columns, density, numThreads, 1e-4);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
@@ -0,0 +1,158 @@
+#include "../../include/thread_pool.hpp"
+#include "../../include/topology.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+
+/*
+ * This test has the scope of validate the thread pool shared by the parallel kernels and the placement of its
+ * threads on the CPUs.
+ * The placement must use only the CPUs of the process, each of them once until they are all taken, one per
+ * physical core first. The workers are pinned by default only on more than one NUMA node, NNET_PIN_THREADS=0 or 1
+ * overrides it.
+ * Every item of a loop must run exactly once, for chunks that do not divide the number of items; the slots given to
+ * the items must be smaller than the number of threads and never used by two items at the same time; a sum must
+ * not depend on the number of threads. Loops started inside other loops must complete (the waiting threads run the
+ * queued tasks instead of blocking) and must not use more threads than the pool has.
+ * The size of the pool can be set with NNET_NUM_THREADS, use a value larger than the cores to test the scheduling
+ * on a small machine.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_thread_pool
+ *
+ * To run this test you have to pass the number of items of the loops
+ *
+ */
+
+int check_placement(){
+    const Topology& topo = topology();
+    const int cpus = static_cast<int>(topo.cpus.size());
+    const std::vector<int> placement = thread_placement(cpus);
+    std::set<int> allowed, used, cores;
+    for (const CpuInfo& info : topo.cpus)
+        allowed.insert(info.cpu);
+    int wrong = 0;
+    for (int i = 0; i < cpus; i++) {
+        const int cpu = placement[i];
+        wrong += !allowed.count(cpu) || !used.insert(cpu).second;
+        const int core = std::find_if(topo.cpus.begin(), topo.cpus.end(),
+                                      [cpu](const CpuInfo& info){return info.cpu == cpu;})->core;
+        // the first topo.cores threads are on distinct cores
+        wrong += i < topo.cores && !cores.insert(core).second;
+    }
+    std::cout<<"placement on "<<topology_summary()<<": "<<wrong<<" threads on a wrong or already used CPU"<<std::endl;
+    return wrong != 0;
+}
+
+int check_pinning(){
+    const char* env = std::getenv("NNET_PIN_THREADS");
+    const std::string saved = env ? env : "";
+    unsetenv("NNET_PIN_THREADS");
+    const bool by_default = pinning_enabled();
+    setenv("NNET_PIN_THREADS", "0", 1);
+    const bool off = pinning_enabled();
+    setenv("NNET_PIN_THREADS", "1", 1);
+    const bool on = pinning_enabled();
+    if (env)
+        setenv("NNET_PIN_THREADS", saved.c_str(), 1);
+    else
+        unsetenv("NNET_PIN_THREADS");
+    std::cout<<"pinning by default on "<<topology().nodes<<" NUMA nodes: "<<by_default<<", with NNET_PIN_THREADS=0: "
+             <<off<<", with NNET_PIN_THREADS=1: "<<on<<std::endl;
+    return by_default != (topology().nodes > 1) || off || !on;
+}
+
+int check_coverage(std::size_t items){
+    int errors = 0;
+    for (std::size_t grain : {std::size_t(1), std::size_t(7), items / 3 + 1}) {
+        std::vector<std::atomic<int>> runs(items);
+        parallel_for(items, 0, [&](std::size_t i){ runs[i]++; }, grain);
+        int wrong = 0;
+        for (auto& r : runs)
+            wrong += r.load() != 1;
+        std::cout<<"parallel_for, chunks of "<<grain<<": "<<wrong<<" items not run exactly once"<<std::endl;
+        errors += wrong != 0;
+    }
+    return errors;
+}
+
+int check_slots(std::size_t items){
+    const int threads = 3;
+    std::vector<std::atomic<int>> busy(threads);
+    std::atomic<int> wrong{0};
+    parallel_for_slot(items, threads, [&](std::size_t, int slot){
+        if (slot < 0 || slot >= threads) {
+            wrong++;
+            return;
+        }
+        wrong += busy[slot]++ != 0;
+        for (volatile int spin = 0; spin < 1000; spin++) {}
+        busy[slot]--;
+    });
+    std::cout<<"parallel_for_slot on "<<threads<<" threads: "<<wrong<<" items with a wrong or shared slot"<<std::endl;
+    return wrong != 0;
+}
+
+int check_reduce(std::size_t items){
+    std::vector<double> values(items);
+    for (std::size_t i = 0; i < items; i++)
+        values[i] = 1.0 / (1.0 + i);
+    auto sum = [&](std::size_t begin, std::size_t end){
+        double partial = 0;
+        for (std::size_t i = begin; i < end; i++)
+            partial += values[i];
+        return partial;
+    };
+    const double serial = parallel_reduce<double>(items, 1, sum, 64);
+    int errors = 0;
+    for (int threads : {2, 0}) {
+        const double parallel = parallel_reduce<double>(items, threads, sum, 64);
+        std::cout<<"parallel_reduce on "<<resolve_threads(threads)<<" threads: "<<parallel<<" (1 thread: "<<serial<<")"<<std::endl;
+        errors += parallel != serial;
+    }
+    return errors;
+}
+
+int check_nested(std::size_t items){
+    const std::size_t outer = 16;
+    std::atomic<std::size_t> total{0};
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    parallel_for(outer, 0, [&](std::size_t){
+        parallel_for(items, 0, [&](std::size_t){
+            total++;
+            std::lock_guard<std::mutex> guard(mutex);
+            ids.insert(std::this_thread::get_id());
+        }, 16);
+    });
+    std::cout<<"nested loops: "<<total.load()<<" items of "<<outer * items<<", run by "<<ids.size()<<" threads"<<std::endl;
+    return total.load() != outer * items || static_cast<int>(ids.size()) > pool_concurrency();
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 2)
+    {
+        std::cout<<"Error! You must pass one positive value to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t items = std::stoi(argv[1]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<" # of threads of the pool: "<<pool_concurrency()<<std::endl;
+    std::cout<<"Loops of "<<items<<" items"<<std::endl;
+
+    int errors = check_placement();
+    errors += check_pinning();
+    errors += check_coverage(items);
+    errors += check_slots(items);
+    errors += check_reduce(items);
+    errors += check_nested(items);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
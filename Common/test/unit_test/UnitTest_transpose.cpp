@@ -0,0 +1,123 @@
+#include "../../include/matrix_transpose.hpp"
+#include "../../include/cpu_features.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/*
+ * This test has the scope of validate the transpose kernels (see matrix_transpose.hpp): the out-of-place transpose,
+ * with and without non-temporal stores, of a whole matrix and of a block inside a larger one, and the in-place
+ * transpose of square and rectangular matrices, are compared with the plain double loop, in both double & single
+ * precision. The transpose only moves elements, so the results must be exactly equal. The times of the double loop
+ * and of the blocked kernels are printed.
+ *
+ * To compile (with -O3 -march=native -ffast-math) :
+ * make UnitTest_transpose
+ *
+ * To run this test you have to pass the rows and the columns of the matrix, the number of threads
+ *
+ */
+
+//! B = A^T with the double loop
+template<typename T>
+void transpose_naive(std::size_t rows, std::size_t cols, const T* A, std::size_t lda, T* B, std::size_t ldb){
+    for (std::size_t i = 0; i < rows; i++)
+        for (std::size_t j = 0; j < cols; j++)
+            B[j * ldb + i] = A[i * lda + j];
+}
+
+template<typename T>
+int count_differences(const MatrixFlat<T>& B, const MatrixFlat<T>& Bref){
+    int differences = 0;
+    for (std::size_t i = 0; i < B.nrows() * B.ncols(); i++)
+        differences += B[i] != Bref[i];
+    return differences;
+}
+
+template<typename T>
+int check_all(std::size_t rows, std::size_t cols, int numThreads){
+
+    int errors = 0;
+    MatrixFlat<T> A(rows, cols, -10, 10), Bref(cols, rows), B(cols, rows);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    transpose_naive(rows, cols, A.get_ptr(), cols, Bref.get_ptr(), rows);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::cout<<"double loop took: "<<std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()<<" [us]"<<std::endl;
+
+    for (bool streaming : {false, true}) {
+        std::fill(B.get_ptr(), B.get_ptr() + rows * cols, T(0));
+        t0 = std::chrono::high_resolution_clock::now();
+        transpose(rows, cols, A.get_ptr(), cols, B.get_ptr(), rows, numThreads, streaming);
+        t1 = std::chrono::high_resolution_clock::now();
+        const int differences = count_differences(B, Bref);
+        std::cout<<"transpose"<<(streaming ? " (streaming)" : "")<<" took: "
+                 <<std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()<<" [us], differences: "<<differences<<std::endl;
+        errors += differences != 0;
+    }
+
+    // the MatrixFlat version, and back: A^T^T = A
+    MatrixFlat<T> At = transposed(A, numThreads);
+    transpose_inplace(At, numThreads);
+    int differences = (At.nrows() != rows) + count_differences(At, A);
+    std::cout<<"in place transpose of A^T ("<<cols<<"X"<<rows<<"), differences from A: "<<differences<<std::endl;
+    errors += differences != 0;
+
+    // square in place, with the matrix as the top left block of a larger one: the elements around it must not change
+    const std::size_t n = std::min(rows, cols), ld = n + 5;
+    MatrixFlat<T> S(n + 3, ld, -10, 10), Sref(S);
+    transpose_naive(n, n, S.get_ptr(), ld, Sref.get_ptr(), ld);
+    t0 = std::chrono::high_resolution_clock::now();
+    transpose_inplace(n, n, S.get_ptr(), ld, numThreads);
+    t1 = std::chrono::high_resolution_clock::now();
+    differences = count_differences(S, Sref);
+    std::cout<<"in place transpose of a "<<n<<"X"<<n<<" block took: "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()<<" [us], differences: "<<differences<<std::endl;
+    errors += differences != 0;
+
+    // out of place between blocks: the block at (1, 2) of A to the block at (3, 1) of C
+    if (rows > 2 && cols > 3) {
+        const std::size_t r = rows - 1, c = cols - 2;
+        MatrixFlat<T> C(c + 4, r + 2, -10, 10), Cref(C);
+        transpose_naive(r, c, A.get_ptr() + cols + 2, cols, Cref.get_ptr() + 3 * Cref.ncols() + 1, Cref.ncols());
+        transpose(r, c, A.get_ptr() + cols + 2, cols, C.get_ptr() + 3 * C.ncols() + 1, C.ncols(), numThreads, true);
+        differences = count_differences(C, Cref);
+        std::cout<<"transpose of a "<<r<<"X"<<c<<" block, differences: "<<differences<<std::endl;
+        errors += differences != 0;
+    }
+
+    std::cout<<"Expected errors: "<<std::endl;
+    std::vector<T> v(2 * 4);
+    transpose_inplace(2, 3, v.data(), 4, numThreads);
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv){
+
+    if(argc != 4)
+    {
+        std::cout<<"Error! You must pass three positive values to the program. "<<std::endl;
+        std::exit(-1);
+    }
+
+    size_t rows = std::stoi(argv[1]);
+    size_t columns = std::stoi(argv[2]);
+    int numThreads = std::stoi(argv[3]);
+
+    std::cout<<" # of available threads: "<<std::thread::hardware_concurrency()<<std::endl;
+    std::cout<<"Matrix will be of dimensions: "<<rows<<"X"<<columns<<" ["<<simd_level_name(simd_level())<<"]"<<std::endl;
+
+    int errors = 0;
+
+    std::cout<<"Double precision"<<std::endl;
+    errors += check_all<double>(rows, columns, numThreads);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    std::cout<<"Single precision"<<std::endl;
+    errors += check_all<float>(rows, columns, numThreads);
+    std::cout<<"-----------------------------------------------------------------------"<<std::endl;
+
+    return errors;
+}
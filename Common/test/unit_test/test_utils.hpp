@@ -0,0 +1,48 @@
+#include "../../include/MatrixFlat.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#ifndef TEST_UTILS_HPP
+#define TEST_UTILS_HPP
+
+//**********************************************************************************************************************
+
+// Helpers shared by the unit tests. Header only, so the tests keep linking only the objects of the kernels they check.
+
+//**********************************************************************************************************************
+
+
+//! max|C - Cref| / max|Cref| over n elements (max|C - Cref| when Cref is all 0)
+template<typename T>
+T max_relative_error(const T* C, const T* Cref, std::size_t n){
+    T max_err = 0, max_ref = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        max_err = std::max<T>(max_err, std::abs(C[i] - Cref[i]));
+        max_ref = std::max<T>(max_ref, std::abs(Cref[i]));
+    }
+    return max_ref == 0 ? max_err : max_err / max_ref;
+}
+
+template<typename T>
+T max_relative_error(const std::vector<T>& C, const std::vector<T>& Cref){
+    return max_relative_error(C.data(), Cref.data(), C.size());
+}
+
+//! Same as above on matrices in any layout (see layout.hpp), compared element by element
+template<typename T>
+T max_relative_error(const MatrixFlat<T>& C, const MatrixFlat<T>& Cref){
+    if (C.layout() == Layout::RowMajor && Cref.layout() == Layout::RowMajor)
+        return max_relative_error(C.get_ptr(), Cref.get_ptr(), C.nrows() * C.ncols());
+    T max_err = 0, max_ref = 0;
+    for (std::size_t i = 0; i < C.nrows(); i++)
+        for (std::size_t j = 0; j < C.ncols(); j++) {
+            max_err = std::max<T>(max_err, std::abs(C(i, j) - Cref(i, j)));
+            max_ref = std::max<T>(max_ref, std::abs(Cref(i, j)));
+        }
+    return max_ref == 0 ? max_err : max_err / max_ref;
+}
+
+
+#endif //TEST_UTILS_HPP